@@ -0,0 +1,163 @@
+/**
+ * @file logger.cpp
+ * @brief Synchronous and deferred (ring-buffered) log sinks
+ */
+
+#include "logger.h"
+#include <stdarg.h>
+
+#if defined(NLOG_DEFERRED)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+namespace Logger
+{
+    static const char LEVEL_TAGS[] = "-EWIDT";
+    static uint32_t dropped = 0;
+
+    static void emit(uint8_t level, const char *line, size_t length)
+    {
+        Serial.print('[');
+        Serial.print(LEVEL_TAGS[level <= NLOG_LEVEL_TRACE ? level : 0]);
+        Serial.print("] ");
+        Serial.write((const uint8_t *)line, length);
+        Serial.println();
+    }
+
+#if defined(NLOG_DEFERRED)
+    // Each record is a header followed by `length` bytes of text
+    struct __attribute__((packed)) RecordHeader
+    {
+        uint16_t length;
+        uint8_t level;
+        uint32_t timestamp;
+    };
+
+    static uint8_t ring[NLOG_RING_SIZE];
+    static size_t ring_head = 0; // next byte to write
+    static size_t ring_tail = 0; // next byte to read
+    static size_t ring_used = 0;
+    static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+    static TaskHandle_t drain_task_handle = NULL;
+
+    static void ringPut(const void *data, size_t length)
+    {
+        const uint8_t *bytes = (const uint8_t *)data;
+        size_t first = min(length, (size_t)NLOG_RING_SIZE - ring_head);
+        memcpy(ring + ring_head, bytes, first);
+        memcpy(ring, bytes + first, length - first);
+        ring_head = (ring_head + length) % NLOG_RING_SIZE;
+        ring_used += length;
+    }
+
+    static void ringTake(void *data, size_t length)
+    {
+        uint8_t *bytes = (uint8_t *)data;
+        size_t first = min(length, (size_t)NLOG_RING_SIZE - ring_tail);
+        memcpy(bytes, ring + ring_tail, first);
+        memcpy(bytes + first, ring, length - first);
+        ring_tail = (ring_tail + length) % NLOG_RING_SIZE;
+        ring_used -= length;
+    }
+
+    // Low-priority task: the only place that touches the UART in deferred mode
+    static void drainTask(void *parameter)
+    {
+        char line[NLOG_MAX_LINE];
+        uint32_t reported_drops = 0;
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+            while (true)
+            {
+                RecordHeader header;
+                bool have_record = false;
+                portENTER_CRITICAL(&ring_mux);
+                if (ring_used >= sizeof(header))
+                {
+                    ringTake(&header, sizeof(header));
+                    ringTake(line, header.length);
+                    have_record = true;
+                }
+                portEXIT_CRITICAL(&ring_mux);
+
+                if (!have_record)
+                {
+                    break;
+                }
+                Serial.printf("[%lu]", (unsigned long)header.timestamp);
+                emit(header.level, line, header.length);
+            }
+
+            if (dropped != reported_drops)
+            {
+                char notice[48];
+                int length = snprintf(notice, sizeof(notice), "Logger: %lu records dropped", (unsigned long)(dropped - reported_drops));
+                emit(NLOG_LEVEL_WARN, notice, length);
+                reported_drops = dropped;
+            }
+        }
+    }
+#endif
+
+    void begin()
+    {
+#if defined(NLOG_DEFERRED)
+        if (drain_task_handle == NULL)
+        {
+            xTaskCreate(drainTask, "log_drain", 3072, NULL, tskIDLE_PRIORITY + 1, &drain_task_handle);
+        }
+#endif
+    }
+
+    void write(uint8_t level, const char *format, ...)
+    {
+        char line[NLOG_MAX_LINE];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        if (length < 0)
+        {
+            return;
+        }
+        if ((size_t)length >= sizeof(line))
+        {
+            length = sizeof(line) - 1;
+        }
+
+#if defined(NLOG_DEFERRED)
+        if (drain_task_handle != NULL)
+        {
+            RecordHeader header = {(uint16_t)length, level, (uint32_t)millis()};
+            bool stored = false;
+            portENTER_CRITICAL(&ring_mux);
+            if (NLOG_RING_SIZE - ring_used >= sizeof(header) + length)
+            {
+                ringPut(&header, sizeof(header));
+                ringPut(line, length);
+                stored = true;
+            }
+            else
+            {
+                dropped++;
+            }
+            portEXIT_CRITICAL(&ring_mux);
+
+            if (stored)
+            {
+                xTaskNotifyGive(drain_task_handle);
+            }
+            return;
+        }
+#endif
+        emit(level, line, length);
+    }
+
+    uint32_t droppedCount()
+    {
+        return dropped;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+/**
+ * @file logger.h
+ * @brief Levelled logging with compile-time filtering
+ *
+ * NLOG_LEVEL selects the most verbose level compiled in (default INFO).
+ * Calls above that level sit behind if (0), so their arguments are never
+ * evaluated - building a String just to log it costs nothing when the
+ * level is off - but they are still type-checked against the format and
+ * count as uses of the variables they name.
+ *
+ * With NLOG_DEFERRED defined, log lines are written as framed records into
+ * a RAM ring buffer and a low-priority task drains them to Serial, so the
+ * request path never waits on the UART. When the ring is full new records
+ * are dropped and counted rather than blocking.
+ */
+
+#include <Arduino.h>
+
+#define NLOG_LEVEL_NONE 0
+#define NLOG_LEVEL_ERROR 1
+#define NLOG_LEVEL_WARN 2
+#define NLOG_LEVEL_INFO 3
+#define NLOG_LEVEL_DEBUG 4
+#define NLOG_LEVEL_TRACE 5
+
+#ifndef NLOG_LEVEL
+#define NLOG_LEVEL NLOG_LEVEL_INFO
+#endif
+
+#ifndef NLOG_RING_SIZE
+#define NLOG_RING_SIZE 4096 // bytes of RAM for deferred records
+#endif
+
+#ifndef NLOG_MAX_LINE
+#define NLOG_MAX_LINE 256 // longer lines are truncated
+#endif
+
+namespace Logger
+{
+    // Start the drain task (deferred mode); safe to call in either mode
+    void begin();
+
+    void write(uint8_t level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    // Records dropped because the ring was full
+    uint32_t droppedCount();
+
+    // Stands in for write() at disabled levels; never called
+    inline void discard(const char *format, ...) __attribute__((format(printf, 1, 2)));
+    inline void discard(const char *format, ...) {}
+}
+
+#define NLOG_AT(level, format, ...) Logger::write(level, format, ##__VA_ARGS__)
+#define NLOG_OFF(format, ...)                        \
+    do                                               \
+    {                                                \
+        if (0)                                       \
+            Logger::discard(format, ##__VA_ARGS__); \
+    } while (0)
+
+#if NLOG_LEVEL >= NLOG_LEVEL_ERROR
+#define NLOG_ERROR(format, ...) NLOG_AT(NLOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define NLOG_ERROR(format, ...) NLOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if NLOG_LEVEL >= NLOG_LEVEL_WARN
+#define NLOG_WARN(format, ...) NLOG_AT(NLOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define NLOG_WARN(format, ...) NLOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if NLOG_LEVEL >= NLOG_LEVEL_INFO
+#define NLOG_INFO(format, ...) NLOG_AT(NLOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define NLOG_INFO(format, ...) NLOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if NLOG_LEVEL >= NLOG_LEVEL_DEBUG
+#define NLOG_DEBUG(format, ...) NLOG_AT(NLOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define NLOG_DEBUG(format, ...) NLOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if NLOG_LEVEL >= NLOG_LEVEL_TRACE
+#define NLOG_TRACE(format, ...) NLOG_AT(NLOG_LEVEL_TRACE, format, ##__VA_ARGS__)
+#else
+#define NLOG_TRACE(format, ...) NLOG_OFF(format, ##__VA_ARGS__)
+#endif
@@ -0,0 +1,219 @@
+#include "codec.h"
+
+namespace nostr
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // Value of each character, 0xff if it is not a hex digit
+    static const uint8_t HEX_VALUES[256] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    };
+
+    // Value of each character, 0xff if it is not in the base64 alphabet ('=' included)
+    static const uint8_t BASE64_VALUES[256] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+        0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+        0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    };
+
+    // Any invalid character leaves a bit set outside the 4 or 6 value bits
+    static const uint8_t HEX_INVALID = 0xf0;
+    static const uint8_t BASE64_INVALID = 0xc0;
+
+    void hexEncode(const uint8_t *in, size_t length, char *out)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            *out++ = HEX_DIGITS[in[i] >> 4];
+            *out++ = HEX_DIGITS[in[i] & 0x0f];
+        }
+    }
+
+    String hexEncode(const uint8_t *in, size_t length)
+    {
+        // Keys, ids and hashes fit on the stack
+        char stack[128];
+        char *out = length <= 64 ? stack : (char *)malloc(2 * length);
+        if (out == nullptr)
+        {
+            return "";
+        }
+        hexEncode(in, length, out);
+        String hex = String(out, 2 * length);
+        if (out != stack)
+        {
+            free(out);
+        }
+        return hex;
+    }
+
+    size_t hexDecode(const char *in, size_t length, uint8_t *out, size_t capacity)
+    {
+        size_t decoded = length / 2;
+        if (length % 2 != 0 || decoded > capacity)
+        {
+            return 0;
+        }
+        const uint8_t *text = (const uint8_t *)in;
+        uint8_t bad = 0;
+        for (size_t i = 0; i < decoded; i++)
+        {
+            uint8_t hi = HEX_VALUES[text[2 * i]];
+            uint8_t lo = HEX_VALUES[text[2 * i + 1]];
+            bad |= hi | lo;
+            out[i] = (uint8_t)(hi << 4) | lo;
+        }
+        return (bad & HEX_INVALID) ? 0 : decoded;
+    }
+
+    size_t hexDecode(const String &in, uint8_t *out, size_t capacity)
+    {
+        return hexDecode(in.c_str(), in.length(), out, capacity);
+    }
+
+    size_t hexDecodeInPlace(uint8_t *buffer, size_t length)
+    {
+        return hexDecode((const char *)buffer, length, buffer, length);
+    }
+
+    size_t base64DecodedLength(const char *in, size_t length)
+    {
+        if (length == 0 || length % 4 != 0)
+        {
+            return 0;
+        }
+        return length / 4 * 3 - (in[length - 1] == '=') - (in[length - 2] == '=');
+    }
+
+    size_t base64Encode(const uint8_t *in, size_t length, char *out, size_t capacity)
+    {
+        if (capacity < base64EncodedLength(length) + 1)
+        {
+            return 0;
+        }
+        // Each group is read before it is written
+        size_t o = 0;
+        size_t i = 0;
+        for (; i + 3 <= length; i += 3)
+        {
+            uint32_t v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+            out[o++] = BASE64_ALPHABET[(v >> 18) & 0x3f];
+            out[o++] = BASE64_ALPHABET[(v >> 12) & 0x3f];
+            out[o++] = BASE64_ALPHABET[(v >> 6) & 0x3f];
+            out[o++] = BASE64_ALPHABET[v & 0x3f];
+        }
+        if (i < length)
+        {
+            uint32_t v = (uint32_t)in[i] << 16;
+            bool two = i + 1 < length;
+            if (two)
+            {
+                v |= (uint32_t)in[i + 1] << 8;
+            }
+            out[o++] = BASE64_ALPHABET[(v >> 18) & 0x3f];
+            out[o++] = BASE64_ALPHABET[(v >> 12) & 0x3f];
+            out[o++] = two ? BASE64_ALPHABET[(v >> 6) & 0x3f] : '=';
+            out[o++] = '=';
+        }
+        out[o] = '\0';
+        return o;
+    }
+
+    String base64Encode(const uint8_t *in, size_t length)
+    {
+        size_t capacity = base64EncodedLength(length) + 1;
+        char *out = (char *)malloc(capacity);
+        if (out == nullptr)
+        {
+            return "";
+        }
+        size_t encoded = base64Encode(in, length, out, capacity);
+        String base64 = String(out, encoded);
+        free(out);
+        return base64;
+    }
+
+    size_t base64Decode(const char *in, size_t length, uint8_t *out, size_t capacity)
+    {
+        size_t decoded = base64DecodedLength(in, length);
+        if (decoded == 0 || decoded > capacity)
+        {
+            return 0;
+        }
+        const uint8_t *text = (const uint8_t *)in;
+        uint8_t bad = 0;
+        size_t o = 0;
+
+        // Every group but the last is four alphabet characters
+        size_t full = length - 4;
+        for (size_t i = 0; i < full; i += 4)
+        {
+            uint8_t a = BASE64_VALUES[text[i]];
+            uint8_t b = BASE64_VALUES[text[i + 1]];
+            uint8_t c = BASE64_VALUES[text[i + 2]];
+            uint8_t d = BASE64_VALUES[text[i + 3]];
+            bad |= a | b | c | d;
+            uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+            out[o++] = (v >> 16) & 0xff;
+            out[o++] = (v >> 8) & 0xff;
+            out[o++] = v & 0xff;
+        }
+
+        // The last carries the padding: one or two '=' leave two or one bytes
+        size_t rest = decoded - o;
+        uint8_t a = BASE64_VALUES[text[full]];
+        uint8_t b = BASE64_VALUES[text[full + 1]];
+        uint8_t c = rest > 1 ? BASE64_VALUES[text[full + 2]] : 0;
+        uint8_t d = rest > 2 ? BASE64_VALUES[text[full + 3]] : 0;
+        bad |= a | b | c | d;
+        if (bad & BASE64_INVALID)
+        {
+            return 0;
+        }
+        uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+        out[o++] = (v >> 16) & 0xff;
+        if (rest > 1)
+        {
+            out[o++] = (v >> 8) & 0xff;
+        }
+        if (rest > 2)
+        {
+            out[o++] = v & 0xff;
+        }
+        return o;
+    }
+
+    size_t base64DecodeInPlace(uint8_t *buffer, size_t length)
+    {
+        return base64Decode((const char *)buffer, length, buffer, length);
+    }
+}
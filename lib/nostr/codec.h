@@ -0,0 +1,45 @@
+#ifndef NOSTR_CODEC_H
+#define NOSTR_CODEC_H
+
+#include <Arduino.h>
+
+namespace nostr
+{
+    /**
+     * @brief Hex and base64 over byte spans
+     *
+     * Decoding looks every character up in a 256-entry table and ORs the
+     * values together, so a bad character is caught by one test at the end
+     * rather than a branch per character. Decoders run front to back and
+     * never write ahead of what they have read, so a buffer can be decoded
+     * over itself. Hex is written lowercase and read in either case; base64
+     * is the standard alphabet with '=' padding, as NIP-04 and NIP-44 use.
+     */
+
+    inline size_t hexEncodedLength(size_t length) { return 2 * length; }
+
+    // Write 2 * length hex digits to out, without a terminator
+    void hexEncode(const uint8_t *in, size_t length, char *out);
+    String hexEncode(const uint8_t *in, size_t length);
+
+    // Decode length / 2 bytes; returns that count, 0 if length is odd, out is too small or a digit is not hex
+    size_t hexDecode(const char *in, size_t length, uint8_t *out, size_t capacity);
+    size_t hexDecode(const String &in, uint8_t *out, size_t capacity);
+    size_t hexDecodeInPlace(uint8_t *buffer, size_t length);
+
+    inline size_t base64EncodedLength(size_t length) { return 4 * ((length + 2) / 3); }
+
+    // Bytes a padded base64 string decodes to, 0 if its length is not a multiple of 4
+    size_t base64DecodedLength(const char *in, size_t length);
+
+    // Base64 with a terminator into out; returns the length, 0 if out is too small.
+    // out may overlap in if in starts at least (encoded - length) bytes past out.
+    size_t base64Encode(const uint8_t *in, size_t length, char *out, size_t capacity);
+    String base64Encode(const uint8_t *in, size_t length);
+
+    // Decode padded base64; returns the byte count, 0 if malformed or out is too small. out may be at or before in.
+    size_t base64Decode(const char *in, size_t length, uint8_t *out, size_t capacity);
+    size_t base64DecodeInPlace(uint8_t *buffer, size_t length);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "ecdh_cache.h"
+#include <mbedtls/platform_util.h>
+
+namespace nostr
+{
+    EcdhCache::~EcdhCache()
+    {
+        clear();
+        free(entries);
+    }
+
+    bool EcdhCache::allocate()
+    {
+        if (entries != nullptr)
+        {
+            return true;
+        }
+        size_t size = sizeof(Entry) * NOSTR_ECDH_CACHE_SIZE;
+#ifdef BOARD_HAS_PSRAM
+        entries = (Entry *)ps_malloc(size);
+#endif
+        if (entries == nullptr)
+        {
+            entries = (Entry *)malloc(size);
+        }
+        if (entries == nullptr)
+        {
+            return false;
+        }
+        memset(entries, 0, size);
+        return true;
+    }
+
+    EcdhCache::Entry *EcdhCache::find(const uint8_t peer[32])
+    {
+        if (entries != nullptr)
+        {
+            for (size_t i = 0; i < NOSTR_ECDH_CACHE_SIZE; i++)
+            {
+                Entry &entry = entries[i];
+                if (entry.lastUsed != 0 && memcmp(entry.peer, peer, 32) == 0)
+                {
+                    entry.lastUsed = ++useCounter;
+                    return &entry;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool EcdhCache::lookup(const uint8_t peer[32], uint8_t sharedX[32])
+    {
+        Entry *entry = find(peer);
+        if (entry == nullptr)
+        {
+            missCount++;
+            return false;
+        }
+        memcpy(sharedX, entry->sharedX, 32);
+        hitCount++;
+        return true;
+    }
+
+    bool EcdhCache::lookupConversationKey(const uint8_t peer[32], HmacSha256Key &key)
+    {
+        Entry *entry = find(peer);
+        if (entry == nullptr || !entry->conversationKey.ready)
+        {
+            return false;
+        }
+        memcpy(&key, &entry->conversationKey, sizeof(key));
+        hitCount++;
+        return true;
+    }
+
+    void EcdhCache::insertConversationKey(const uint8_t peer[32], const HmacSha256Key &key)
+    {
+        Entry *entry = find(peer);
+        if (entry != nullptr)
+        {
+            memcpy(&entry->conversationKey, &key, sizeof(key));
+        }
+    }
+
+    void EcdhCache::insert(const uint8_t peer[32], const uint8_t sharedX[32])
+    {
+        if (!allocate())
+        {
+            return;
+        }
+
+        // Counter wrapped: restart the ages rather than misorder them
+        if (useCounter == UINT32_MAX)
+        {
+            clear();
+        }
+
+        Entry *victim = &entries[0];
+        for (size_t i = 0; i < NOSTR_ECDH_CACHE_SIZE; i++)
+        {
+            Entry &entry = entries[i];
+            if (entry.lastUsed == 0 || memcmp(entry.peer, peer, 32) == 0)
+            {
+                victim = &entry;
+                break;
+            }
+            if (entry.lastUsed < victim->lastUsed)
+            {
+                victim = &entry;
+            }
+        }
+
+        mbedtls_platform_zeroize(victim, sizeof(Entry));
+        memcpy(victim->peer, peer, 32);
+        memcpy(victim->sharedX, sharedX, 32);
+        victim->lastUsed = ++useCounter;
+    }
+
+    void EcdhCache::clear()
+    {
+        if (entries != nullptr)
+        {
+            mbedtls_platform_zeroize(entries, sizeof(Entry) * NOSTR_ECDH_CACHE_SIZE);
+        }
+        useCounter = 0;
+    }
+}
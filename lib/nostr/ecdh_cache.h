@@ -0,0 +1,70 @@
+#ifndef NOSTR_ECDH_CACHE_H
+#define NOSTR_ECDH_CACHE_H
+
+#include <Arduino.h>
+#include "hmac_key.h"
+
+#ifndef NOSTR_ECDH_CACHE_SIZE
+#define NOSTR_ECDH_CACHE_SIZE 8 // peers whose shared secret is kept
+#endif
+
+namespace nostr
+{
+    /**
+     * @brief Fixed-size LRU of ECDH shared secrets keyed by x-only peer pubkey
+     *
+     * The value is the x coordinate of the shared point. NIP-04 uses it as the
+     * AES key and NIP-44 as the HKDF input for the conversation key, so one
+     * entry serves both. The NIP-44 conversation key, keyed for HMAC, is kept
+     * next to the secret once derived. Evicted and cleared entries are
+     * zeroised.
+     *
+     * Entries are allocated on first use, from PSRAM when the board has it.
+     */
+    class EcdhCache
+    {
+    public:
+        EcdhCache() = default;
+        ~EcdhCache();
+
+        EcdhCache(const EcdhCache &) = delete;
+        EcdhCache &operator=(const EcdhCache &) = delete;
+
+        // Copy the shared secret for peer into sharedX; counts a hit or a miss
+        bool lookup(const uint8_t peer[32], uint8_t sharedX[32]);
+
+        // Store a shared secret, evicting the least recently used entry if full
+        void insert(const uint8_t peer[32], const uint8_t sharedX[32]);
+
+        // Copy the NIP-44 conversation key for peer into key, if one has been stored
+        bool lookupConversationKey(const uint8_t peer[32], HmacSha256Key &key);
+
+        // Store the conversation key with peer's shared secret; ignored if peer has no entry
+        void insertConversationKey(const uint8_t peer[32], const HmacSha256Key &key);
+
+        // Zeroise every entry, e.g. when the local key changes
+        void clear();
+
+        uint32_t hits() const { return hitCount; }
+        uint32_t misses() const { return missCount; }
+
+    private:
+        struct Entry
+        {
+            uint8_t peer[32];
+            uint8_t sharedX[32];
+            HmacSha256Key conversationKey; // ready once NIP-44 has used the entry
+            uint32_t lastUsed; // 0 = empty
+        };
+
+        bool allocate();
+        Entry *find(const uint8_t peer[32]);
+
+        Entry *entries = nullptr;
+        uint32_t useCounter = 0;
+        uint32_t hitCount = 0;
+        uint32_t missCount = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,265 @@
+#include "event_serializer.h"
+#include "codec.h"
+#include "Hash.h"
+
+namespace nostr
+{
+    static const size_t ID_HEX_LENGTH = 64;
+    static const size_t SIG_HEX_LENGTH = 128;
+    static const size_t MAX_ESCAPE_LENGTH = 6; // \u00XX
+
+    // Fixed parts of the event object, in output order
+    static const char ID_OPEN[] = "{\"id\":\"";
+    static const char PUBKEY_OPEN[] = "\",\"pubkey\":\"";
+    static const char CREATED_AT_OPEN[] = "\",\"created_at\":";
+    static const char KIND_OPEN[] = ",\"kind\":";
+    static const char TAGS_OPEN[] = ",\"tags\":";
+    static const char CONTENT_OPEN[] = ",\"content\":\"";
+    static const char SIG_OPEN[] = "\",\"sig\":\"";
+    static const char OBJECT_CLOSE[] = "\"}";
+
+    /**
+     * @brief Escape sequence for c
+     *
+     * @return length written to out, or 0 if c is copied verbatim
+     */
+    static inline size_t escapeFor(char c, char *out)
+    {
+        char escaped;
+        switch (c)
+        {
+        case '"':
+            escaped = '"';
+            break;
+        case '\\':
+            escaped = '\\';
+            break;
+        case '\n':
+            escaped = 'n';
+            break;
+        case '\r':
+            escaped = 'r';
+            break;
+        case '\t':
+            escaped = 't';
+            break;
+        case '\b':
+            escaped = 'b';
+            break;
+        case '\f':
+            escaped = 'f';
+            break;
+        default:
+            if ((uint8_t)c >= 0x20)
+            {
+                return 0;
+            }
+            // Any other control character is only valid in JSON as a \u escape
+            out[0] = '\\';
+            out[1] = 'u';
+            out[2] = '0';
+            out[3] = '0';
+            hexEncode((const uint8_t *)&c, 1, out + 4);
+            return 6;
+        }
+        out[0] = '\\';
+        out[1] = escaped;
+        return 2;
+    }
+
+    /**
+     * @brief Feed text to sink escaped, passing runs that need no escaping through whole
+     *
+     * sink(data, length) is called for each run and each escape sequence.
+     */
+    template <typename Sink>
+    static void writeEscaped(Sink &sink, const char *text, size_t length)
+    {
+        char escaped[MAX_ESCAPE_LENGTH];
+        size_t run = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            size_t escapedLength = escapeFor(text[i], escaped);
+            if (escapedLength)
+            {
+                if (i > run)
+                {
+                    sink(text + run, i - run);
+                }
+                sink(escaped, escapedLength);
+                run = i + 1;
+            }
+        }
+        if (length > run)
+        {
+            sink(text + run, length - run);
+        }
+    }
+
+    size_t escapedLength(const char *text, size_t length)
+    {
+        char escaped[MAX_ESCAPE_LENGTH];
+        size_t total = length;
+        for (size_t i = 0; i < length; i++)
+        {
+            size_t escapedLength = escapeFor(text[i], escaped);
+            if (escapedLength)
+            {
+                total += escapedLength - 1;
+            }
+        }
+        return total;
+    }
+
+    void appendEscaped(String &out, const char *text, size_t length)
+    {
+        out.reserve(out.length() + escapedLength(text, length));
+        auto sink = [&out](const char *data, size_t dataLength) { out.concat(data, dataLength); };
+        writeEscaped(sink, text, length);
+    }
+
+    // Decimal created_at and kind, as both the commitment and the object carry them
+    struct EventNumbers
+    {
+        char createdAt[21];
+        size_t createdAtLength;
+        char kind[6];
+        size_t kindLength;
+
+        explicit EventNumbers(const EventFields &event)
+        {
+            createdAtLength = snprintf(createdAt, sizeof(createdAt), "%lu", event.createdAt);
+            kindLength = snprintf(kind, sizeof(kind), "%u", (unsigned)event.kind);
+        }
+    };
+
+    size_t serializedEventLength(const EventFields &event, const char *prefix, const char *suffix)
+    {
+        EventNumbers numbers(event);
+        size_t length = strlen(prefix) + strlen(suffix);
+        length += sizeof(ID_OPEN) - 1 + ID_HEX_LENGTH;
+        length += sizeof(PUBKEY_OPEN) - 1 + strlen(event.pubKeyHex);
+        length += sizeof(CREATED_AT_OPEN) - 1 + numbers.createdAtLength;
+        length += sizeof(KIND_OPEN) - 1 + numbers.kindLength;
+        length += sizeof(TAGS_OPEN) - 1 + event.tagsLength;
+        length += sizeof(CONTENT_OPEN) - 1 + escapedLength(event.content, event.contentLength);
+        length += sizeof(SIG_OPEN) - 1 + SIG_HEX_LENGTH;
+        length += sizeof(OBJECT_CLOSE) - 1;
+        return length;
+    }
+
+    /**
+     * @brief Hash the commitment and sign it
+     *
+     * @param idHex receives the 64 hex digit event id
+     * @param sigHex receives the 128 hex digit signature
+     * @return false if the signature could not be produced
+     */
+    static bool signCommitment(const PrivateKey &privateKey, const EventFields &event, const EventNumbers &numbers,
+                               char *idHex, char *sigHex)
+    {
+        SHA256 hash;
+        auto sink = [&hash](const char *data, size_t length) { hash.write((const uint8_t *)data, length); };
+        sink("[0,\"", 4);
+        sink(event.pubKeyHex, strlen(event.pubKeyHex));
+        sink("\",", 2);
+        sink(numbers.createdAt, numbers.createdAtLength);
+        sink(",", 1);
+        sink(numbers.kind, numbers.kindLength);
+        sink(",", 1);
+        sink(event.tags, event.tagsLength);
+        sink(",\"", 2);
+        writeEscaped(sink, event.content, event.contentLength);
+        sink("\"]", 2);
+
+        uint8_t eventHash[32];
+        hash.end(eventHash);
+        hexEncode(eventHash, sizeof(eventHash), idHex);
+
+        SchnorrSignature signature = privateKey.schnorr_sign(eventHash);
+        uint8_t signatureBytes[64];
+        if (signature.serialize(signatureBytes, sizeof(signatureBytes)) != sizeof(signatureBytes))
+        {
+            return false;
+        }
+        hexEncode(signatureBytes, sizeof(signatureBytes), sigHex);
+        return true;
+    }
+
+    // Write the signed object, wrapped in prefix and suffix, through sink
+    template <typename Sink>
+    static void writeEvent(Sink &sink, const EventFields &event, const EventNumbers &numbers, const char *idHex,
+                           const char *sigHex, const char *prefix, const char *suffix)
+    {
+        sink(prefix, strlen(prefix));
+        sink(ID_OPEN, sizeof(ID_OPEN) - 1);
+        sink(idHex, ID_HEX_LENGTH);
+        sink(PUBKEY_OPEN, sizeof(PUBKEY_OPEN) - 1);
+        sink(event.pubKeyHex, strlen(event.pubKeyHex));
+        sink(CREATED_AT_OPEN, sizeof(CREATED_AT_OPEN) - 1);
+        sink(numbers.createdAt, numbers.createdAtLength);
+        sink(KIND_OPEN, sizeof(KIND_OPEN) - 1);
+        sink(numbers.kind, numbers.kindLength);
+        sink(TAGS_OPEN, sizeof(TAGS_OPEN) - 1);
+        sink(event.tags, event.tagsLength);
+        sink(CONTENT_OPEN, sizeof(CONTENT_OPEN) - 1);
+        writeEscaped(sink, event.content, event.contentLength);
+        sink(SIG_OPEN, sizeof(SIG_OPEN) - 1);
+        sink(sigHex, SIG_HEX_LENGTH);
+        sink(OBJECT_CLOSE, sizeof(OBJECT_CLOSE) - 1);
+        sink(suffix, strlen(suffix));
+    }
+
+    size_t serializeSignedEvent(char *buffer, size_t capacity, const PrivateKey &privateKey, const EventFields &event,
+                                const char *prefix, const char *suffix)
+    {
+        size_t length = serializedEventLength(event, prefix, suffix);
+        if (buffer == nullptr || capacity < length + 1)
+        {
+            return 0;
+        }
+
+        EventNumbers numbers(event);
+        char idHex[ID_HEX_LENGTH];
+        char sigHex[SIG_HEX_LENGTH];
+        if (!signCommitment(privateKey, event, numbers, idHex, sigHex))
+        {
+            return 0;
+        }
+
+        char *out = buffer;
+        auto sink = [&out](const char *data, size_t dataLength) {
+            memcpy(out, data, dataLength);
+            out += dataLength;
+        };
+        writeEvent(sink, event, numbers, idHex, sigHex, prefix, suffix);
+        *out = '\0';
+
+        return out - buffer;
+    }
+
+    String serializeSignedEvent(const PrivateKey &privateKey, const EventFields &event, const char *prefix, const char *suffix)
+    {
+        EventNumbers numbers(event);
+        char idHex[ID_HEX_LENGTH];
+        char sigHex[SIG_HEX_LENGTH];
+        if (!signCommitment(privateKey, event, numbers, idHex, sigHex))
+        {
+            return "";
+        }
+
+        size_t length = serializedEventLength(event, prefix, suffix);
+        String serialisedEvent;
+        if (!serialisedEvent.reserve(length))
+        {
+            return "";
+        }
+        auto sink = [&serialisedEvent](const char *data, size_t dataLength) { serialisedEvent.concat(data, dataLength); };
+        writeEvent(sink, event, numbers, idHex, sigHex, prefix, suffix);
+        if (serialisedEvent.length() != length)
+        {
+            return "";
+        }
+        return serialisedEvent;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef NOSTR_EVENT_SERIALIZER_H
+#define NOSTR_EVENT_SERIALIZER_H
+
+#include <Arduino.h>
+#include "Bitcoin.h"
+
+namespace nostr
+{
+    /**
+     * @brief The parts of an event that go into its NIP-01 commitment
+     *
+     * tags must already be a serialised JSON array and is copied verbatim.
+     * content is raw text; the serializer escapes it.
+     */
+    struct EventFields
+    {
+        const char *pubKeyHex;
+        unsigned long createdAt;
+        uint16_t kind;
+        const char *tags;
+        size_t tagsLength;
+        const char *content;
+        size_t contentLength;
+    };
+
+    // Length of text once escaped as a JSON string body (NIP-01 rules)
+    size_t escapedLength(const char *text, size_t length);
+
+    // Append text to a JSON string body being built, escaped as NIP-01 requires
+    void appendEscaped(String &out, const char *text, size_t length);
+
+    // Bytes serializeSignedEvent() will write, not counting the terminating NUL
+    size_t serializedEventLength(const EventFields &event, const char *prefix = "", const char *suffix = "");
+
+    /**
+     * @brief Sign an event and write it into a caller-provided buffer
+     *
+     * Writes prefix, the signed event object and suffix, e.g. prefix
+     * "[\"EVENT\"," and suffix "]" give a ready-to-send relay message. The
+     * commitment [0,pubkey,created_at,kind,tags,content] is fed to SHA-256
+     * piece by piece, then the object is written in one sequential pass with
+     * content escaped straight into the buffer.
+     *
+     * @return bytes written (excluding the NUL), or 0 if capacity is too small
+     */
+    size_t serializeSignedEvent(char *buffer, size_t capacity, const PrivateKey &privateKey, const EventFields &event,
+                                const char *prefix = "", const char *suffix = "");
+
+    /**
+     * @brief As above, into a String reserved to the exact length
+     *
+     * @return String empty on failure
+     */
+    String serializeSignedEvent(const PrivateKey &privateKey, const EventFields &event,
+                                const char *prefix = "", const char *suffix = "");
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "hmac_key.h"
+#include <mbedtls/platform_util.h>
+#include <mbedtls/version.h>
+
+// mbedtls 2.x names the int-returning SHA-256 calls *_ret
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+#define sha256_starts mbedtls_sha256_starts_ret
+#define sha256_update mbedtls_sha256_update_ret
+#define sha256_finish mbedtls_sha256_finish_ret
+#else
+#define sha256_starts mbedtls_sha256_starts
+#define sha256_update mbedtls_sha256_update
+#define sha256_finish mbedtls_sha256_finish
+#endif
+
+namespace nostr
+{
+    static const size_t BLOCK_SIZE = 64;
+
+    // Hash one pad block and keep a copy of the state; the working context is released
+    static void absorbPad(const uint8_t block[BLOCK_SIZE], mbedtls_sha256_context &state)
+    {
+        mbedtls_sha256_context ctx;
+        mbedtls_sha256_init(&ctx);
+        sha256_starts(&ctx, 0);
+        sha256_update(&ctx, block, BLOCK_SIZE);
+        mbedtls_sha256_init(&state);
+        mbedtls_sha256_clone(&state, &ctx);
+        mbedtls_sha256_free(&ctx);
+    }
+
+    void HmacSha256Key::setKey(const uint8_t *key, size_t length)
+    {
+        uint8_t block[BLOCK_SIZE] = {0};
+        if (length > BLOCK_SIZE)
+        {
+            mbedtls_sha256_context ctx;
+            mbedtls_sha256_init(&ctx);
+            sha256_starts(&ctx, 0);
+            sha256_update(&ctx, key, length);
+            sha256_finish(&ctx, block);
+            mbedtls_sha256_free(&ctx);
+        }
+        else
+        {
+            memcpy(block, key, length);
+        }
+
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            block[i] ^= 0x36;
+        }
+        absorbPad(block, inner);
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            block[i] ^= 0x36 ^ 0x5c;
+        }
+        absorbPad(block, outer);
+        mbedtls_platform_zeroize(block, sizeof(block));
+        ready = true;
+    }
+
+    void HmacSha256Key::clear()
+    {
+        mbedtls_platform_zeroize(this, sizeof(*this));
+    }
+
+    HmacSha256Key::Mac::Mac(const HmacSha256Key &key) : key(key)
+    {
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_clone(&ctx, &key.inner);
+    }
+
+    HmacSha256Key::Mac::~Mac()
+    {
+        mbedtls_sha256_free(&ctx);
+    }
+
+    void HmacSha256Key::Mac::update(const uint8_t *data, size_t length)
+    {
+        sha256_update(&ctx, data, length);
+    }
+
+    void HmacSha256Key::Mac::finish(uint8_t mac[32])
+    {
+        uint8_t inner_hash[32];
+        sha256_finish(&ctx, inner_hash);
+        mbedtls_sha256_free(&ctx);
+
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_clone(&ctx, &key.outer);
+        sha256_update(&ctx, inner_hash, sizeof(inner_hash));
+        sha256_finish(&ctx, mac);
+        mbedtls_platform_zeroize(inner_hash, sizeof(inner_hash));
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef NOSTR_HMAC_KEY_H
+#define NOSTR_HMAC_KEY_H
+
+#include <Arduino.h>
+#include <mbedtls/sha256.h>
+
+namespace nostr
+{
+    /**
+     * @brief An HMAC-SHA256 key with its pad blocks already hashed
+     *
+     * Keeps the SHA-256 states after absorbing key ^ ipad and key ^ opad, so
+     * a MAC under the key resumes from them instead of hashing both pad
+     * blocks again. Plain data: it may live in zeroed memory and be copied
+     * with memcpy, as the states kept are always software copies.
+     */
+    struct HmacSha256Key
+    {
+        mbedtls_sha256_context inner;
+        mbedtls_sha256_context outer;
+        bool ready;
+
+        // Hash the pad blocks for key
+        void setKey(const uint8_t *key, size_t length);
+
+        // Zeroise the states
+        void clear();
+
+        // One MAC under the key, fed in pieces
+        class Mac
+        {
+        public:
+            explicit Mac(const HmacSha256Key &key);
+            ~Mac();
+
+            Mac(const Mac &) = delete;
+            Mac &operator=(const Mac &) = delete;
+
+            void update(const uint8_t *data, size_t length);
+            void finish(uint8_t mac[32]);
+
+        private:
+            const HmacSha256Key &key;
+            mbedtls_sha256_context ctx;
+        };
+    };
+}
+
+#endif
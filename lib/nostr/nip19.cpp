@@ -1,14 +1,14 @@
 #include "nip19.h"
+#include "codec.h"
+#include "../logger/logger.h"
 
 namespace nip19
 {
-    // Function to convert hex string to byte array
+    // Function to convert hex string to byte array; bytesArray needs strlen(hexString) / 2 bytes
     void hexStringToByteArray(const char *hexString, uint8_t *bytesArray)
     {
-        for (size_t i = 0; hexString[i] && hexString[i + 1]; i += 2)
-        {
-            sscanf(&hexString[i], "%2hhx", &bytesArray[i / 2]);
-        }
+        size_t length = strlen(hexString) & ~(size_t)1;
+        nostr::hexDecode(hexString, length, bytesArray, length / 2);
     }
 
     void convertTo5bitArray(const uint8_t *byteArray, size_t byteArrayLen, uint8_t *bit5Array, size_t *bit5ArrayLen)
@@ -63,10 +63,8 @@ namespace nip19
     // Function to convert byte array to hex string
     void byteArrayToHexString(const uint8_t *byteArray, size_t byteArrayLen, char *hexString)
     {
-        for (size_t i = 0; i < byteArrayLen; ++i)
-        {
-            sprintf(hexString + (i * 2), "%02x", byteArray[i]);
-        }
+        nostr::hexEncode(byteArray, byteArrayLen, hexString);
+        hexString[2 * byteArrayLen] = '\0';
     }
 
     const char *encodeHexToBech32(const char *nsecHex, const char *hrp)
@@ -107,13 +105,13 @@ namespace nip19
             }
             else
             {
-                Serial.println("Error: HRP does not match expected value.");
+                NLOG_ERROR("Error: HRP does not match expected value.");
                 strcpy(hexString, "Error: HRP mismatch");
             }
         }
         else
         {
-            Serial.println("Bech32 decoding failed.");
+            NLOG_ERROR("Bech32 decoding failed.");
             strcpy(hexString, "Error: Decoding failed");
         }
 
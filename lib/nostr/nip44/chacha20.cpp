@@ -1,6 +1,23 @@
 #include "chacha20.h"
 #include "helpers.h"
 
+#ifdef NIP44_CHACHA20_MBEDTLS
+
+void chacha20_init_ctx(struct chacha20_ctx *ctx, const uint8_t key[32], const uint8_t nonce[12]) {
+    mbedtls_chacha20_init(&ctx->mbedtls);
+    mbedtls_chacha20_setkey(&ctx->mbedtls, key);
+    mbedtls_chacha20_starts(&ctx->mbedtls, nonce, 0);
+}
+
+void chacha20_encrypt(struct chacha20_ctx *ctx, uint8_t *output, const uint8_t *input, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    mbedtls_chacha20_update(&ctx->mbedtls, length, input, output);
+}
+
+#else
+
 #define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
 
 #define QUARTERROUND(a, b, c, d) \
@@ -9,10 +26,29 @@
     a += b; d ^= a; d = ROTL32(d, 8); \
     c += d; b ^= c; b = ROTL32(b, 7);
 
+// Both ESP32 cores are little-endian: a word is loaded or stored with one (unaligned-safe) memcpy
+static inline uint32_t load32_le(const uint8_t *p) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#else
+    return ((uint32_t)p[0] << 0) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+#endif
+}
+
+static inline void store32_le(uint8_t *p, uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, &v, sizeof(v));
+#else
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+#endif
+}
+
 void chacha20_init_ctx(struct chacha20_ctx *ctx, const uint8_t key[32], const uint8_t nonce[12]) {
-    // Initialize context
-    memset(ctx, 0, sizeof(*ctx));
-    
     // Constants - "expand 32-byte k"
     ctx->state[0] = 0x61707865;
     ctx->state[1] = 0x3320646e;
@@ -21,35 +57,23 @@ void chacha20_init_ctx(struct chacha20_ctx *ctx, const uint8_t key[32], const ui
     
     // Key
     for (int i = 0; i < 8; i++) {
-        ctx->state[4 + i] = ((uint32_t)key[4*i + 0] << 0) |
-                           ((uint32_t)key[4*i + 1] << 8) |
-                           ((uint32_t)key[4*i + 2] << 16) |
-                           ((uint32_t)key[4*i + 3] << 24);
+        ctx->state[4 + i] = load32_le(key + 4 * i);
     }
     
     // Counter (starts at 0)
     ctx->state[12] = 0;
     
     // Nonce
-    ctx->state[13] = ((uint32_t)nonce[0] << 0) |
-                     ((uint32_t)nonce[1] << 8) |
-                     ((uint32_t)nonce[2] << 16) |
-                     ((uint32_t)nonce[3] << 24);
-    ctx->state[14] = ((uint32_t)nonce[4] << 0) |
-                     ((uint32_t)nonce[5] << 8) |
-                     ((uint32_t)nonce[6] << 16) |
-                     ((uint32_t)nonce[7] << 24);
-    ctx->state[15] = ((uint32_t)nonce[8] << 0) |
-                     ((uint32_t)nonce[9] << 8) |
-                     ((uint32_t)nonce[10] << 16) |
-                     ((uint32_t)nonce[11] << 24);
+    ctx->state[13] = load32_le(nonce + 0);
+    ctx->state[14] = load32_le(nonce + 4);
+    ctx->state[15] = load32_le(nonce + 8);
                      
     ctx->buffer_used = 64; // Force new block generation on first use
 }
 
-void chacha20_block(struct chacha20_ctx *ctx) {
-    uint32_t x[16];
-    memcpy(x, ctx->state, sizeof(x));
+// One block of keystream as words, then step the counter
+static void chacha20_keystream(struct chacha20_ctx *ctx, uint32_t x[16]) {
+    memcpy(x, ctx->state, sizeof(ctx->state));
     
     // Perform ChaCha20 rounds
     for (int i = 0; i < 10; i++) {
@@ -67,16 +91,9 @@ void chacha20_block(struct chacha20_ctx *ctx) {
     
     // Add input state to the result
     for (int i = 0; i < 16; i++) {
-        uint32_t v = x[i] + ctx->state[i];
-        ctx->buffer[4*i + 0] = v & 0xff;
-        ctx->buffer[4*i + 1] = (v >> 8) & 0xff;
-        ctx->buffer[4*i + 2] = (v >> 16) & 0xff;
-        ctx->buffer[4*i + 3] = (v >> 24) & 0xff;
+        x[i] += ctx->state[i];
     }
     
-    // Reset buffer usage
-    ctx->buffer_used = 0;
-    
     // Increment counter with overflow check
     ctx->state[12]++;
     if (ctx->state[12] == 0) {
@@ -85,61 +102,46 @@ void chacha20_block(struct chacha20_ctx *ctx) {
     }
 }
 
+void chacha20_block(struct chacha20_ctx *ctx) {
+    uint32_t x[16];
+    chacha20_keystream(ctx, x);
+    for (int i = 0; i < 16; i++) {
+        store32_le(ctx->buffer + 4 * i, x[i]);
+    }
+    ctx->buffer_used = 0;
+}
+
 void chacha20_encrypt(struct chacha20_ctx *ctx, uint8_t *output, const uint8_t *input, size_t length) {
     if (!output || !input || length == 0) {
-        logInfo("ChaCha20: Invalid parameters");
         return;
     }
     
-    logInfo("ChaCha20 processing length: " + String(length));
-    size_t total_processed = 0;
-    
-    // Log first few bytes of input
-    String inputHex;
-    for(size_t i = 0; i < std::min(length, (size_t)16); i++) {
-        char hex[3];
-        snprintf(hex, sizeof(hex), "%02x", input[i]);
-        inputHex += hex;
+    // Finish the keystream block a previous call started
+    while (length > 0 && ctx->buffer_used < 64) {
+        *output++ = *input++ ^ ctx->buffer[ctx->buffer_used++];
+        length--;
     }
-    logInfo("First bytes of input: " + inputHex);
     
-    while (length > 0) {
-        // Generate new block if needed
-        if (ctx->buffer_used >= 64) {
-            logInfo("Generating new block at offset: " + String(total_processed));
-            chacha20_block(ctx);
-        }
-        
-        // Calculate how many bytes we can process from current block
-        size_t available = 64 - ctx->buffer_used;
-        size_t use = length > available ? available : length;
-        
-        logInfo("Processing block of size: " + String(use) + 
-                " at offset: " + String(total_processed) + 
-                " buffer_used: " + String(ctx->buffer_used) +
-                " remaining: " + String(length));
-        
-        // XOR the input with the keystream
-        for (size_t i = 0; i < use; i++) {
-            output[total_processed + i] = input[total_processed + i] ^ 
-                                        ctx->buffer[ctx->buffer_used + i];
-        }
-        
-        // Log a few bytes of output after each block
-        if (total_processed < 16) {
-            String outputHex;
-            for(size_t i = total_processed; i < std::min(total_processed + use, (size_t)16); i++) {
-                char hex[3];
-                snprintf(hex, sizeof(hex), "%02x", output[i]);
-                outputHex += hex;
-            }
-            logInfo("Output bytes at " + String(total_processed) + ": " + outputHex);
+    // Whole blocks: keystream words XORed straight from input to output
+    uint32_t x[16];
+    while (length >= 64) {
+        chacha20_keystream(ctx, x);
+        for (int i = 0; i < 16; i++) {
+            store32_le(output + 4 * i, load32_le(input + 4 * i) ^ x[i]);
         }
-        
-        ctx->buffer_used += use;
-        length -= use;
-        total_processed += use;
+        input += 64;
+        output += 64;
+        length -= 64;
     }
     
-    logInfo("ChaCha20 completed, total processed: " + String(total_processed));
-} 
\ No newline at end of file
+    // Partial tail: keep the rest of its block for the next call
+    if (length > 0) {
+        chacha20_block(ctx);
+        for (size_t i = 0; i < length; i++) {
+            output[i] = input[i] ^ ctx->buffer[i];
+        }
+        ctx->buffer_used = length;
+    }
+}
+
+#endif
@@ -4,14 +4,24 @@
 #include <stdint.h>
 #include <stddef.h>
 
+// Build with -D NIP44_CHACHA20_MBEDTLS to run NIP-44 on mbedtls_chacha20 instead
+#ifdef NIP44_CHACHA20_MBEDTLS
+#include <mbedtls/chacha20.h>
+
+struct chacha20_ctx {
+    mbedtls_chacha20_context mbedtls;
+};
+#else
 struct chacha20_ctx {
     uint32_t state[16];
-    uint8_t buffer[64];  // Add buffer to context
-    size_t buffer_used;  // Track how much of buffer is used
+    uint8_t buffer[64];  // keystream left over from the last partial block
+    size_t buffer_used;  // bytes of buffer already used
 };
 
+void chacha20_block(struct chacha20_ctx *ctx);  // next keystream block into ctx->buffer
+#endif
+
 void chacha20_init_ctx(struct chacha20_ctx *ctx, const uint8_t key[32], const uint8_t nonce[12]);
-void chacha20_block(struct chacha20_ctx *ctx);  // Remove output parameter
 void chacha20_encrypt(struct chacha20_ctx *ctx, uint8_t *output, const uint8_t *input, size_t length);
 
-#endif 
\ No newline at end of file
+#endif 
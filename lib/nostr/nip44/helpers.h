@@ -2,21 +2,21 @@
 
 #include <Arduino.h>
 #include <Bitcoin.h>
-#include <gmp-ino.h>
 #include <bootloader_random.h>
 #include <mbedtls/base64.h>
 #include <mbedtls/md.h>
 #include <mbedtls/chacha20.h>
+#include "../../logger/logger.h"
+#include "../signer.h"
 
 // Utility functions
-void logInfo(const String msg);
+// Trace-level only: the message expression is not evaluated unless NLOG_LEVEL >= TRACE
+#define logInfo(msg) NLOG_TRACE("%s", String(msg).c_str())
 void generateRandomIV(uint8_t *iv, int length);
 String getTokenAtPosition(String str, String separator, int position);
 
 // Cryptographic functions
-String generateSharedSecret(String privateKeyHex, String publicKeyHex);
-String reconstructPublicKey(const String &xHex);
-bool modular_sqrt(mpz_t result, const mpz_t n, const mpz_t p);
+String generateSharedSecret(const nostr::Signer &signer, String publicKeyHex);
 
 // Validation functions
 bool isValidHexKey(const String& input);
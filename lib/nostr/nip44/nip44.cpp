@@ -1,11 +1,10 @@
 #include "chacha20.h"
 #include "helpers.h"
 #include "nip44.h"
+#include "../codec.h"
 
-#include <gmp-ino.h>
 #include <bootloader_random.h>
-#include <mbedtls/base64.h>
-#include <mbedtls/md.h>
+#include <mbedtls/platform_util.h>
 #include <vector>
 
 // NIP-44 encryption/decryption implementation
@@ -54,396 +53,289 @@ size_t calcPaddedLen(size_t unpadded_len) {
     return chunk * (((unpadded_len - 1) / chunk) + 1);
 }
 
-// Pad plaintext according to NIP-44 spec
-std::vector<uint8_t> padMessage(const String &plaintext) {
-    size_t unpadded_len = plaintext.length();
-    logInfo("padMessage input length: " + String(unpadded_len));
-    
-    // Validate length
-    if (unpadded_len < 1 || unpadded_len > 65535) {
-        logInfo("padMessage: Invalid length");
-        return std::vector<uint8_t>();
-    }
-    
-    // Calculate padded length
-    size_t padded_len = calcPaddedLen(unpadded_len);
-    logInfo("padMessage: calculated padded length: " + String(padded_len));
-    
-    if (padded_len == 0) {
-        logInfo("padMessage: padding calculation failed");
-        return std::vector<uint8_t>();
-    }
-    
-    try {
-        // Create result vector with size for prefix + padded content
-        std::vector<uint8_t> result(2 + padded_len);
-        logInfo("padMessage: allocated vector size: " + String(result.size()));
-        
-        // Write length prefix (big-endian uint16)
-        result[0] = (unpadded_len >> 8) & 0xFF;
-        result[1] = unpadded_len & 0xFF;
-        
-        // Copy plaintext
-        memcpy(result.data() + 2, plaintext.c_str(), unpadded_len);
-        
-        // Zero-pad the remainder
-        if (padded_len > unpadded_len) {
-            memset(result.data() + 2 + unpadded_len, 0, padded_len - unpadded_len);
-        }
-        
-        logInfo("padMessage: final padded size: " + String(result.size()));
-        return result;
-    } catch (...) {
-        logInfo("padMessage: exception occurred");
-        return std::vector<uint8_t>();
-    }
+// The salt never changes, so its pads are hashed once
+static const nostr::HmacSha256Key &saltKey() {
+    static const nostr::HmacSha256Key salt_key = []() {
+        nostr::HmacSha256Key key = {};
+        key.setKey(NIP44_SALT, sizeof(NIP44_SALT));
+        return key;
+    }();
+    return salt_key;
 }
 
-// Unpad according to NIP-44 spec
-String unpadMessage(const std::vector<uint8_t> &padded) {
-    if (padded.size() < 34) {
-        logInfo("unpadMessage failed: Padded size too small " + String(padded.size()));
-        return "";
-    }
-    
-    // Read length prefix
-    size_t unpadded_len = (padded[0] << 8) | padded[1];
-    size_t expected_padded_len = calcPaddedLen(unpadded_len);
-    
-    logInfo("unpadMessage: unpaddedLen=" + String(unpadded_len) + 
-            " expectedPaddedLen=" + String(expected_padded_len) + 
-            " actualPaddedSize=" + String(padded.size() - 2));
-    
-    // Validate lengths
-    if (unpadded_len == 0 || 
-        unpadded_len > 65535 || 
-        unpadded_len > padded.size() - 2 ||
-        padded.size() - 2 != expected_padded_len) {
-        logInfo("unpadMessage failed: Invalid lengths");
-        return "";
-    }
-    
-    // Extract unpadded content
-    return String((char*)(padded.data() + 2), unpadded_len);
-}
-
-// Update HKDF implementation to match reference
-void hkdf_sha256(const uint8_t *salt, size_t salt_len,
-                 const uint8_t *ikm, size_t ikm_len,
-                 const uint8_t *info, size_t info_len,
-                 uint8_t *okm, size_t okm_len) {
-    // HKDF-Extract phase
+void getConversationKey(const uint8_t *shared_x, nostr::HmacSha256Key &conversation_key) {
+    // HKDF-Extract
     uint8_t prk[32];
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
-    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
-    
-    // Extract phase
-    mbedtls_md_hmac_starts(&ctx, salt, salt_len);
-    mbedtls_md_hmac_update(&ctx, ikm, ikm_len);
-    mbedtls_md_hmac_finish(&ctx, prk);
-    
-    // Expand phase
-    uint8_t T[32] = {0}; // T(0) is empty string
-    uint8_t counter = 1;
-    size_t offset = 0;
-    
-    while (okm_len > 0) {
-        mbedtls_md_hmac_starts(&ctx, prk, 32);
-        
-        if (offset > 0) {
-            mbedtls_md_hmac_update(&ctx, T, 32);
-        }
-        
-        if (info_len > 0) {
-            mbedtls_md_hmac_update(&ctx, info, info_len);
-        }
-        
-        mbedtls_md_hmac_update(&ctx, &counter, 1);
-        mbedtls_md_hmac_finish(&ctx, T);
-        
-        size_t todo = (okm_len < 32) ? okm_len : 32;
-        memcpy(okm + offset, T, todo);
-        
-        counter++;
-        offset += todo;
-        okm_len -= todo;
-    }
+    nostr::HmacSha256Key::Mac extract(saltKey());
+    extract.update(shared_x, 32);
+    extract.finish(prk);
     
-    mbedtls_md_free(&ctx);
+    // Keyed for HKDF-Expand, which every message runs under this key
+    conversation_key.setKey(prk, sizeof(prk));
+    mbedtls_platform_zeroize(prk, sizeof(prk));
 }
 
-// Update getMessageKeys to use HKDF
-bool getMessageKeys(const uint8_t *conversation_key, const uint8_t *nonce,
+// HKDF-Expand of the message nonce, resuming from the conversation key's pad states
+bool getMessageKeys(const nostr::HmacSha256Key &conversation_key, const uint8_t *nonce,
                    uint8_t *chacha_key, uint8_t *chacha_nonce, uint8_t *hmac_key) {
+    if (!conversation_key.ready) {
+        return false;
+    }
     
-    // Use constant salt for key derivation
-    uint8_t derived_key[76]; // For chacha_key(32) + chacha_nonce(12) + hmac_key(32)
-    
-    hkdf_sha256(NIP44_SALT, sizeof(NIP44_SALT),
-                conversation_key, 32,
-                nonce, 32,
-                derived_key, sizeof(derived_key));
+    uint8_t derived_key[96]; // T(1..3); chacha_key(32) + chacha_nonce(12) + hmac_key(32) are used
+    for (uint8_t counter = 1; counter <= 3; counter++) {
+        nostr::HmacSha256Key::Mac expand(conversation_key);
+        if (counter > 1) {
+            expand.update(derived_key + 32 * (counter - 2), 32);
+        }
+        expand.update(nonce, 32);
+        expand.update(&counter, 1);
+        expand.finish(derived_key + 32 * (counter - 1));
+    }
     
     // Split derived key into components
     memcpy(chacha_key, derived_key, 32);
     memcpy(chacha_nonce, derived_key + 32, 12);
     memcpy(hmac_key, derived_key + 44, 32);
+    mbedtls_platform_zeroize(derived_key, sizeof(derived_key));
     
     return true;
 }
 
+bool getMessageKeys(const uint8_t *conversation_key, const uint8_t *nonce,
+                   uint8_t *chacha_key, uint8_t *chacha_nonce, uint8_t *hmac_key) {
+    nostr::HmacSha256Key key = {};
+    key.setKey(conversation_key, 32);
+    bool ok = getMessageKeys(key, nonce, chacha_key, chacha_nonce, hmac_key);
+    key.clear();
+    return ok;
+}
+
 // Update HMAC calculation to match reference
 void hmac_aad(const uint8_t *key, size_t key_len,
               const uint8_t *message, size_t msg_len,
               const uint8_t *aad, size_t aad_len,
               uint8_t *output) {
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
-    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
-    mbedtls_md_hmac_starts(&ctx, key, key_len);
+    // On plain SHA-256 contexts: no md context to allocate and set up per message
+    nostr::HmacSha256Key hmac = {};
+    hmac.setKey(key, key_len);
+    {
+        nostr::HmacSha256Key::Mac mac(hmac);
+
+        // First update with the nonce (aad)
+        if (aad_len > 0) {
+            mac.update(aad, aad_len);
+        }
+        
+        // Then update with the ciphertext
+        if (msg_len > 0) {
+            mac.update(message, msg_len);
+        }
+
+        mac.finish(output);
+    }
+    hmac.clear();
+}
+
+// Update the encryption function with ChaCha20 and proper MAC
+String encryptMessageNip44(const String &plaintext, const String &sharedSecretHex) {
+    // Convert shared secret from hex
+    uint8_t shared_x[32];
+    if (nostr::hexDecode(sharedSecretHex, shared_x, 32) != 32) {
+        return "";
+    }
+    nostr::HmacSha256Key conversation_key = {};
+    getConversationKey(shared_x, conversation_key);
+    mbedtls_platform_zeroize(shared_x, sizeof(shared_x));
+    
+    String result = encryptMessageNip44(plaintext, conversation_key);
+    conversation_key.clear();
+    return result;
+}
+
+size_t nip44PayloadLength(size_t plaintext_len) {
+    size_t padded_len = calcPaddedLen(plaintext_len);
+    return padded_len == 0 ? 0 : NIP44_PLAINTEXT_OFFSET + padded_len + 32;
+}
+
+size_t nip44EncodedLength(size_t plaintext_len) {
+    return nostr::base64EncodedLength(nip44PayloadLength(plaintext_len));
+}
+
+size_t nip44InPlaceOffset(size_t plaintext_len) {
+    return nip44EncodedLength(plaintext_len) - nip44PayloadLength(plaintext_len);
+}
 
-    // First update with the nonce (aad)
-    if (aad_len > 0) {
-        mbedtls_md_hmac_update(&ctx, aad, aad_len);
+size_t encryptPayloadNip44(const nostr::HmacSha256Key &conversation_key, uint8_t *payload, size_t capacity, size_t plaintext_len) {
+    size_t payload_len = nip44PayloadLength(plaintext_len);
+    if (payload_len == 0 || capacity < payload_len) {
+        logInfo("encryptPayloadNip44 failed: Invalid length " + String(plaintext_len));
+        return 0;
     }
+    size_t padded_len = payload_len - NIP44_PLAINTEXT_OFFSET - 32;
     
-    // Then update with the ciphertext
-    if (msg_len > 0) {
-        mbedtls_md_hmac_update(&ctx, message, msg_len);
+    uint8_t *nonce = payload + 1;
+    uint8_t *padded = payload + NIP44_PLAINTEXT_OFFSET - 2; // length prefix, plaintext, zeros
+    uint8_t *mac = payload + NIP44_PLAINTEXT_OFFSET + padded_len;
+    
+    payload[0] = 0x02; // Version 2
+    generateRandomIV(nonce, 32);
+    
+    // Pad message according to NIP-44 spec: big-endian length, then zeros after the plaintext
+    padded[0] = (plaintext_len >> 8) & 0xFF;
+    padded[1] = plaintext_len & 0xFF;
+    memset(padded + 2 + plaintext_len, 0, padded_len - plaintext_len);
+    
+    // Derive encryption keys
+    uint8_t chacha_key[32];
+    uint8_t chacha_nonce[12];
+    uint8_t hmac_key[32];
+    if (!getMessageKeys(conversation_key, nonce, chacha_key, chacha_nonce, hmac_key)) {
+        return 0;
     }
+    
+    // Encrypt with ChaCha20, in place
+    struct chacha20_ctx chacha;
+    chacha20_init_ctx(&chacha, chacha_key, chacha_nonce);
+    chacha20_encrypt(&chacha, padded, padded, 2 + padded_len);
+    
+    // Calculate MAC over nonce+ciphertext
+    hmac_aad(hmac_key, 32,
+             padded, 2 + padded_len,
+             nonce, 32,
+             mac);
+    
+    mbedtls_platform_zeroize(chacha_key, sizeof(chacha_key));
+    mbedtls_platform_zeroize(hmac_key, sizeof(hmac_key));
+    mbedtls_platform_zeroize(&chacha, sizeof(chacha));
+    return payload_len;
+}
 
-    mbedtls_md_hmac_finish(&ctx, output);
-    mbedtls_md_free(&ctx);
+size_t base64EncodeNip44(const uint8_t *payload, size_t length, char *out, size_t capacity) {
+    return nostr::base64Encode(payload, length, out, capacity);
 }
 
-// Helper function to verify base64 encoding/decoding
-bool verifyBase64(const std::vector<uint8_t>& input, String& output) {
-    // First calculate required length
-    size_t base64_len = 0;
-    int ret = mbedtls_base64_encode(nullptr, 0, &base64_len, input.data(), input.size());
-    if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) {
-        logInfo("Base64 length calculation failed");
+bool decryptPayloadNip44(const nostr::HmacSha256Key &conversation_key, uint8_t *buffer, size_t length,
+                         uint8_t *&plaintext, size_t &plaintext_len) {
+    size_t binary_len = nostr::base64DecodeInPlace(buffer, length);
+    
+    // version(1) + nonce(32) + length prefix(2) + padded(32..65536) + mac(32)
+    if (binary_len < NIP44_PLAINTEXT_OFFSET + 32 + 32 || binary_len > NIP44_PLAINTEXT_OFFSET + 65536 + 32) {
+        logInfo("Decrypt failed: Invalid payload length " + String(binary_len));
         return false;
     }
     
-    // Allocate buffer with space for null terminator
-    std::vector<uint8_t> base64_out(base64_len + 1);
-    ret = mbedtls_base64_encode(base64_out.data(), base64_len + 1, &base64_len,
-                               input.data(), input.size());
-    if (ret != 0) {
-        logInfo("Base64 encode failed");
+    // Validate version
+    if (buffer[0] != 0x02) {
+        logInfo("Decrypt failed: Invalid version " + String(buffer[0]));
         return false;
     }
     
-    // Verify we can decode back to original
-    size_t decoded_len = 0;
-    ret = mbedtls_base64_decode(nullptr, 0, &decoded_len,
-                               base64_out.data(), base64_len);
-    if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL || decoded_len != input.size()) {
-        logInfo("Base64 decode length check failed");
+    // Extract components
+    const uint8_t *nonce = buffer + 1;
+    uint8_t *ciphertext = buffer + 33;
+    size_t ciphertext_len = binary_len - (1 + 32 + 32);
+    const uint8_t *mac = buffer + binary_len - 32;
+    
+    // Get message keys
+    uint8_t chacha_key[32];
+    uint8_t chacha_nonce[12];
+    uint8_t hmac_key[32];
+    if (!getMessageKeys(conversation_key, nonce, chacha_key, chacha_nonce, hmac_key)) {
+        logInfo("Decrypt failed: getMessageKeys failed");
         return false;
     }
     
-    std::vector<uint8_t> decoded(decoded_len);
-    ret = mbedtls_base64_decode(decoded.data(), decoded_len, &decoded_len,
-                               base64_out.data(), base64_len);
-    if (ret != 0 || decoded_len != input.size()) {
-        logInfo("Base64 decode failed");
+    // Verify MAC, without an early exit
+    uint8_t calculated_mac[32];
+    hmac_aad(hmac_key, 32,
+             ciphertext, ciphertext_len,
+             nonce, 32,
+             calculated_mac);
+    mbedtls_platform_zeroize(hmac_key, sizeof(hmac_key));
+    uint8_t diff = 0;
+    for (size_t i = 0; i < 32; i++) {
+        diff |= calculated_mac[i] ^ mac[i];
+    }
+    if (diff != 0) {
+        logInfo("Decrypt failed: MAC verification failed");
+        mbedtls_platform_zeroize(chacha_key, sizeof(chacha_key));
         return false;
     }
     
-    // Verify content matches
-    if (memcmp(decoded.data(), input.data(), input.size()) != 0) {
-        logInfo("Base64 decoded content mismatch");
+    // Decrypt with ChaCha20, in place
+    struct chacha20_ctx chacha;
+    chacha20_init_ctx(&chacha, chacha_key, chacha_nonce);
+    chacha20_encrypt(&chacha, ciphertext, ciphertext, ciphertext_len);
+    mbedtls_platform_zeroize(chacha_key, sizeof(chacha_key));
+    mbedtls_platform_zeroize(&chacha, sizeof(chacha));
+    
+    // Unpad
+    size_t unpadded_len = (ciphertext[0] << 8) | ciphertext[1];
+    if (unpadded_len == 0 || calcPaddedLen(unpadded_len) != ciphertext_len - 2) {
+        logInfo("Decrypt failed: Invalid padding");
         return false;
     }
     
-    output = String((char*)base64_out.data());
+    plaintext = ciphertext + 2;
+    plaintext_len = unpadded_len;
     return true;
 }
 
-// Base64 encoding helper
-String base64_encode(const uint8_t* input, size_t length) {
-    size_t base64_len = 0;
-    
-    // Calculate required length
-    int ret = mbedtls_base64_encode(nullptr, 0, &base64_len, input, length);
-    if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) {
+String encryptMessageNip44(const String &plaintext, const nostr::HmacSha256Key &conversation_key) {
+    size_t plaintext_len = plaintext.length();
+    size_t encoded_len = nip44EncodedLength(plaintext_len);
+    if (encoded_len == 0) {
         return "";
     }
     
-    // Allocate buffer with space for null terminator
-    std::vector<uint8_t> base64_out(base64_len + 1);
-    ret = mbedtls_base64_encode(base64_out.data(), base64_len + 1, &base64_len,
-                               input, length);
-    if (ret != 0) {
-        return "";
-    }
-    
-    return String((char*)base64_out.data());
-}
-
-// Update the encryption function with ChaCha20 and proper MAC
-String encryptMessageNip44(const String &plaintext, const String &sharedSecretHex) {
     try {
-        // Convert shared secret from hex
-        uint8_t conversation_key[32];
-        if (!fromHex(sharedSecretHex, conversation_key, 32)) {
-            return "";
-        }
-        
-        // Generate random nonce
-        uint8_t nonce[32];
-        generateRandomIV(nonce, 32);
-        
-        // Pad message according to NIP-44 spec
-        std::vector<uint8_t> padded = padMessage(plaintext);
-        if (padded.empty()) {
-            return "";
-        }
+        // The payload sits at the end of the buffer, so its base64 can be written over it from the front
+        std::vector<uint8_t> buffer(encoded_len + 1);
+        size_t offset = nip44InPlaceOffset(plaintext_len);
+        memcpy(buffer.data() + offset + NIP44_PLAINTEXT_OFFSET, plaintext.c_str(), plaintext_len);
         
-        // Derive encryption keys
-        uint8_t chacha_key[32];
-        uint8_t chacha_nonce[12];
-        uint8_t hmac_key[32];
-        if (!getMessageKeys(conversation_key, nonce, chacha_key, chacha_nonce, hmac_key)) {
+        size_t payload_len = encryptPayloadNip44(conversation_key, buffer.data() + offset, buffer.size() - offset, plaintext_len);
+        if (payload_len == 0) {
             return "";
         }
-        
-        // Encrypt with ChaCha20
-        std::vector<uint8_t> ciphertext(padded.size());
-        struct chacha20_ctx chacha;
-        chacha20_init_ctx(&chacha, chacha_key, chacha_nonce);
-        chacha20_encrypt(&chacha, ciphertext.data(), padded.data(), padded.size());
-        
-        // Calculate MAC over nonce+ciphertext
-        uint8_t mac[32];
-        hmac_aad(hmac_key, 32,
-                 ciphertext.data(), ciphertext.size(),
-                 nonce, 32,
-                 mac);
-        
-        // Construct final payload: version + nonce + ciphertext + mac
-        std::vector<uint8_t> payload;
-        payload.push_back(0x02);  // Version 2
-        payload.insert(payload.end(), nonce, nonce + 32);
-        payload.insert(payload.end(), ciphertext.begin(), ciphertext.end());
-        payload.insert(payload.end(), mac, mac + 32);
-        
-        // Base64 encode
-        return base64_encode(payload.data(), payload.size());
+        base64EncodeNip44(buffer.data() + offset, payload_len, (char *)buffer.data(), buffer.size());
+        return String((char *)buffer.data());
     }
     catch (...) {
         return "";
     }
 }
 
-// Update decryption function with ChaCha20 and proper MAC verification
 String decryptMessageNip44(const String &payload, const String &sharedSecretHex) {
+    // Convert shared secret from hex
+    uint8_t shared_x[32];
+    if (nostr::hexDecode(sharedSecretHex, shared_x, 32) != 32) {
+        logInfo("Decrypt failed: Invalid shared secret hex");
+        return "";
+    }
+    nostr::HmacSha256Key conversation_key = {};
+    getConversationKey(shared_x, conversation_key);
+    mbedtls_platform_zeroize(shared_x, sizeof(shared_x));
+    
+    String result = decryptMessageNip44(payload, conversation_key);
+    conversation_key.clear();
+    return result;
+}
+
+String decryptMessageNip44(const String &payload, const nostr::HmacSha256Key &conversation_key) {
     try {
         logInfo("Decrypting payload of length: " + String(payload.length()));
         
-        // First get the required buffer size
-        size_t binary_len = 0;
-        int ret = mbedtls_base64_decode(nullptr, 0, &binary_len,
-                                      (const uint8_t*)payload.c_str(),
-                                      payload.length());
-                                      
-        if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) {
-            logInfo("Decrypt failed: Base64 length check failed");
+        std::vector<uint8_t> buffer((const uint8_t *)payload.c_str(), (const uint8_t *)payload.c_str() + payload.length());
+        uint8_t *plaintext = nullptr;
+        size_t plaintext_len = 0;
+        if (!decryptPayloadNip44(conversation_key, buffer.data(), buffer.size(), plaintext, plaintext_len)) {
             return "";
         }
         
-        // Allocate buffer
-        std::vector<uint8_t> binary(binary_len);
-        
-        // Decode base64
-        ret = mbedtls_base64_decode(binary.data(), binary_len, &binary_len,
-                                   (const uint8_t*)payload.c_str(),
-                                   payload.length());
-        
-        if (ret != 0) {
-            logInfo("Decrypt failed: Base64 decode failed with code: " + String(ret));
-            return "";
-        }
-        
-        logInfo("Decoded binary length: " + String(binary_len));
-        
-        // Basic length validation
-        if (binary_len < 65) { // version(1) + nonce(32) + mac(32)
-            logInfo("Decrypt failed: Binary too short");
-            return "";
-        }
-        
-        // Extract components
-        const uint8_t *nonce = binary.data() + 1;
-        const uint8_t *ciphertext = binary.data() + 33;
-        const uint8_t *mac = binary.data() + binary_len - 32;
-        size_t ciphertext_len = binary_len - (1 + 32 + 32);
-        
-        logInfo("Decryption component sizes:");
-        logInfo("Total binary length: " + String(binary_len));
-        logInfo("Ciphertext length: " + String(ciphertext_len));
-        logInfo("Ciphertext starts at: " + String(33));
-        logInfo("MAC starts at: " + String(binary_len - 32));
-        
-        // Validate version
-        if (binary[0] != 0x02) {
-            logInfo("Decrypt failed: Invalid version " + String(binary[0]));
-            return "";
-        }
-        
-        // Convert shared secret from hex
-        uint8_t conversation_key[32];
-        if (!fromHex(sharedSecretHex, conversation_key, 32)) {
-            logInfo("Decrypt failed: Invalid shared secret hex");
-            return "";
-        }
-        
-        // Get message keys
-        uint8_t chacha_key[32];
-        uint8_t chacha_nonce[12];
-        uint8_t hmac_key[32];
-        if (!getMessageKeys(conversation_key, nonce, chacha_key, chacha_nonce, hmac_key)) {
-            logInfo("Decrypt failed: getMessageKeys failed");
-            return "";
-        }
-        
-        // Verify MAC
-        uint8_t calculated_mac[32];
-        hmac_aad(hmac_key, 32,
-                 ciphertext, ciphertext_len,
-                 nonce, 32,
-                 calculated_mac);
-        
-        // Log MAC comparison
-        String calcMacHex;
-        for(size_t i = 0; i < 16; i++) {
-            char hex[3];
-            snprintf(hex, sizeof(hex), "%02x", calculated_mac[i]);
-            calcMacHex += hex;
-        }
-        logInfo("First bytes of calculated MAC: " + calcMacHex);
-        
-        if (memcmp(calculated_mac, mac, 32) != 0) {
-            logInfo("Decrypt failed: MAC verification failed");
-            return "";
-        }
-        
-        // Decrypt with ChaCha20
-        std::vector<uint8_t> plaintext(ciphertext_len);
-        struct chacha20_ctx chacha;
-        chacha20_init_ctx(&chacha, chacha_key, chacha_nonce);
-        chacha20_encrypt(&chacha, plaintext.data(), ciphertext, ciphertext_len);
-        
-        // Add logging for decrypted size
-        logInfo("Plaintext buffer size: " + String(plaintext.size()));
-        
-        // Unpad
-        String result = unpadMessage(plaintext);
-        logInfo("Unpadded result length: " + String(result.length()));
-        
+        String result((char *)plaintext, plaintext_len);
+        mbedtls_platform_zeroize(buffer.data(), buffer.size());
         return result;
     } catch (...) {
         logInfo("Decrypt failed: Exception caught");
@@ -451,20 +343,7 @@ String decryptMessageNip44(const String &payload, const String &sharedSecretHex)
     }
 }
 
-// HMAC-SHA256 implementation
-void hmac_sha256(const uint8_t* key, size_t key_len,
-                 const uint8_t* msg, size_t msg_len,
-                 uint8_t* hmac) {
-    mbedtls_md_context_t ctx;
-    mbedtls_md_init(&ctx);
-    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
-    mbedtls_md_hmac_starts(&ctx, key, key_len);
-    mbedtls_md_hmac_update(&ctx, msg, msg_len);
-    mbedtls_md_hmac_finish(&ctx, hmac);
-    mbedtls_md_free(&ctx);
-} 
-
-String executeEncryptMessageNip44(String data, String privateKeyHex, String thirdPartyPublicKeyHex) {
+String executeEncryptMessageNip44(String data, const nostr::Signer &signer, String thirdPartyPublicKeyHex) {
     if (data == "") return "";
     
     thirdPartyPublicKeyHex.trim();
@@ -475,13 +354,18 @@ String executeEncryptMessageNip44(String data, String privateKeyHex, String thir
       return "";
     }
 
-    String sharedSecretHex = generateSharedSecret(privateKeyHex, thirdPartyPublicKeyHex);
+    nostr::HmacSha256Key conversationKey = {};
+    if (!signer.conversationKey(thirdPartyPublicKeyHex.c_str(), conversationKey)) {
+      logInfo("Encrypt Message error: No shared secret with the 3rd party public key.");
+      return "";
+    }
     
     // Get the content as everything after the first space
     String content = data;
     content.trim();
     
-    String encryptedMessage = encryptMessageNip44(content, sharedSecretHex);
+    String encryptedMessage = encryptMessageNip44(content, conversationKey);
+    conversationKey.clear();
     
     // log the encrypted message
     if (encryptedMessage == "") {
@@ -495,7 +379,7 @@ String executeEncryptMessageNip44(String data, String privateKeyHex, String thir
     return encryptedMessage;
 }
 
-String executeDecryptMessageNip44(String data, String privateKeyHex, String thirdPartyPublicKeyHex) {
+String executeDecryptMessageNip44(String data, const nostr::Signer &signer, String thirdPartyPublicKeyHex) {
     logInfo("Full command data length: " + String(data.length()));
     
     if (data == "") "";
@@ -511,7 +395,11 @@ String executeDecryptMessageNip44(String data, String privateKeyHex, String thir
       return "";
     }
 
-    String sharedSecretHex = generateSharedSecret(privateKeyHex, thirdPartyPublicKeyHex);
+    nostr::HmacSha256Key conversationKey = {};
+    if (!signer.conversationKey(thirdPartyPublicKeyHex.c_str(), conversationKey)) {
+      logInfo("Decrypt Message Error: No shared secret with the 3rd party public key.");
+      return "";
+    }
     
     // Get the encrypted content
     String encryptedContent = data;
@@ -520,7 +408,8 @@ String executeDecryptMessageNip44(String data, String privateKeyHex, String thir
     logInfo("Encrypted content: " + encryptedContent);
     logInfo("Encrypted content length: " + String(encryptedContent.length()));
 
-    String decryptedMessage = decryptMessageNip44(encryptedContent, sharedSecretHex);
+    String decryptedMessage = decryptMessageNip44(encryptedContent, conversationKey);
+    conversationKey.clear();
 
     logInfo("Decrypt NIP-44: " + decryptedMessage.substring(0, 16) + "...");
     
@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 #include <vector>
+#include "../signer.h"
+#include "../hmac_key.h"
 
 // NIP-44 constant salt
 extern const uint8_t NIP44_SALT[8];
@@ -9,15 +11,13 @@ extern const uint8_t NIP44_SALT[8];
 // Helper functions
 uint32_t _math_int_log2(uint32_t x);
 size_t calcPaddedLen(size_t unpadded_len);
-std::vector<uint8_t> padMessage(const String &plaintext);
-String unpadMessage(const std::vector<uint8_t> &padded);
 
 // Cryptographic functions
-void hkdf_sha256(const uint8_t *salt, size_t salt_len,
-                 const uint8_t *ikm, size_t ikm_len,
-                 const uint8_t *info, size_t info_len,
-                 uint8_t *okm, size_t okm_len);
+// HKDF-extract(NIP44_SALT, shared_x), keyed once so each message only runs HKDF-expand
+void getConversationKey(const uint8_t *shared_x, nostr::HmacSha256Key &conversation_key);
 
+bool getMessageKeys(const nostr::HmacSha256Key &conversation_key, const uint8_t *nonce,
+                   uint8_t *chacha_key, uint8_t *chacha_nonce, uint8_t *hmac_key);
 bool getMessageKeys(const uint8_t *conversation_key, const uint8_t *nonce,
                    uint8_t *chacha_key, uint8_t *chacha_nonce, uint8_t *hmac_key);
 
@@ -26,18 +26,34 @@ void hmac_aad(const uint8_t *key, size_t key_len,
               const uint8_t *aad, size_t aad_len,
               uint8_t *output);
 
-bool verifyBase64(const std::vector<uint8_t>& input, String& output);
-String base64_encode(const uint8_t* input, size_t length);
+// Buffer-based encryption/decryption
+//
+// A binary payload is version(1) || nonce(32) || length(2) || padded plaintext || MAC(32),
+// built and opened in place in one caller buffer.
+const size_t NIP44_PLAINTEXT_OFFSET = 35; // where the plaintext sits in a binary payload
+
+size_t nip44PayloadLength(size_t plaintext_len); // binary payload size, 0 if plaintext_len is out of range
+size_t nip44EncodedLength(size_t plaintext_len); // its base64 length, without the terminator
+// Where a payload starts in a buffer of nip44EncodedLength() + 1 bytes so it can be base64-encoded over itself
+size_t nip44InPlaceOffset(size_t plaintext_len);
+
+// Encrypt the plaintext already at payload + NIP44_PLAINTEXT_OFFSET; returns the payload length, 0 on failure
+size_t encryptPayloadNip44(const nostr::HmacSha256Key &conversationKey, uint8_t *payload, size_t capacity, size_t plaintext_len);
+
+// Base64 with a terminator into out; returns the length, 0 if out is too small.
+// out may overlap payload if payload starts at least (encoded - length) bytes past out.
+size_t base64EncodeNip44(const uint8_t *payload, size_t length, char *out, size_t capacity);
+
+// Decode, check and decrypt a base64 payload in place; plaintext points into buffer
+bool decryptPayloadNip44(const nostr::HmacSha256Key &conversationKey, uint8_t *buffer, size_t length,
+                         uint8_t *&plaintext, size_t &plaintext_len);
 
 // Main encryption/decryption functions
+String encryptMessageNip44(const String &plaintext, const nostr::HmacSha256Key &conversationKey);
+String decryptMessageNip44(const String &payload, const nostr::HmacSha256Key &conversationKey);
 String encryptMessageNip44(const String &plaintext, const String &sharedSecretHex);
 String decryptMessageNip44(const String &payload, const String &sharedSecretHex);
 
-// HMAC-SHA256 implementation
-void hmac_sha256(const uint8_t* key, size_t key_len,
-                 const uint8_t* msg, size_t msg_len,
-                 uint8_t* hmac);
-
 // High-level execution functions
-String executeEncryptMessageNip44(String data, String privateKeyHex, String thirdPartyPublicKeyHex);
-String executeDecryptMessageNip44(String data, String privateKeyHex, String thirdPartyPublicKeyHex);
\ No newline at end of file
+String executeEncryptMessageNip44(String data, const nostr::Signer &signer, String thirdPartyPublicKeyHex);
+String executeDecryptMessageNip44(String data, const nostr::Signer &signer, String thirdPartyPublicKeyHex);
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include "secp256k1_field.h"
+#include <string.h>
+
+// secp256k1 field arithmetic with fixed-width limbs.
+// 2^256 = 2^32 + 977 (mod p), which is what the reductions fold with.
+
+#define LIMBS SECP256K1_FE_LIMBS
+#define LIMB_BITS (8 * (int)sizeof(secp256k1_fe_limb))
+#define LIMB_BYTES ((int)sizeof(secp256k1_fe_limb))
+
+#if LIMBS == 4
+// Double-width type for limb products and carries
+typedef unsigned __int128 fe_wide;
+
+static const secp256k1_fe_limb FIELD_P[4] = {
+    0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL
+};
+
+// 2^256 mod p fits in one limb
+static const uint64_t FIELD_R = 0x1000003D1ULL;
+#else
+typedef uint64_t fe_wide;
+
+static const secp256k1_fe_limb FIELD_P[8] = {
+    0xFFFFFC2F, 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF,
+    0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+#endif
+
+static bool fe_gte_p(const secp256k1_fe_limb n[LIMBS]) {
+    for (int i = LIMBS - 1; i >= 0; i--) {
+        if (n[i] != FIELD_P[i]) {
+            return n[i] > FIELD_P[i];
+        }
+    }
+    return true;
+}
+
+static void fe_sub_p(secp256k1_fe_limb n[LIMBS]) {
+    fe_wide borrow = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        fe_wide d = (fe_wide)n[i] - FIELD_P[i] - borrow;
+        n[i] = (secp256k1_fe_limb)d;
+        borrow = (d >> LIMB_BITS) & 1;
+    }
+}
+
+#if LIMBS == 4
+
+// r = n + c * 2^256 (mod p) for a small carry c, fully reduced
+static void fe_fold(uint64_t n[4], uint64_t c) {
+    while (c) {
+        fe_wide acc = (fe_wide)c * FIELD_R + n[0];
+        n[0] = (uint64_t)acc;
+        acc >>= 64;
+        for (int i = 1; i < 4 && acc; i++) {
+            acc += n[i];
+            n[i] = (uint64_t)acc;
+            acc >>= 64;
+        }
+        c = (uint64_t)acc;
+    }
+    if (fe_gte_p(n)) {
+        fe_sub_p(n);
+    }
+}
+
+// n = t (mod p) for a 512-bit t, fully reduced: lo + hi * 2^256
+static void fe_reduce(uint64_t n[4], const uint64_t t[8]) {
+    fe_wide acc = 0;
+    for (int i = 0; i < 4; i++) {
+        acc += (fe_wide)t[i] + (fe_wide)t[4 + i] * FIELD_R;
+        n[i] = (uint64_t)acc;
+        acc >>= 64;
+    }
+    fe_fold(n, (uint64_t)acc);
+}
+
+#else
+
+// r = n + c * 2^256 (mod p) for a small carry c, fully reduced
+static void fe_fold(uint32_t n[8], uint64_t c) {
+    while (c) {
+        uint64_t acc = (uint64_t)n[0] + c * 977;
+        n[0] = (uint32_t)acc;
+        acc = (acc >> 32) + n[1] + c;
+        n[1] = (uint32_t)acc;
+        acc >>= 32;
+        for (int i = 2; i < 8 && acc; i++) {
+            acc += n[i];
+            n[i] = (uint32_t)acc;
+            acc >>= 32;
+        }
+        c = acc;
+    }
+    if (fe_gte_p(n)) {
+        fe_sub_p(n);
+    }
+}
+
+// n = t (mod p) for a 512-bit t, fully reduced: lo + hi * (2^32 + 977)
+static void fe_reduce(uint32_t n[8], const uint32_t t[16]) {
+    uint64_t acc = 0;
+    for (int i = 0; i < 8; i++) {
+        acc += (uint64_t)t[i] + (uint64_t)t[8 + i] * 977;
+        if (i > 0) {
+            acc += t[7 + i];
+        }
+        n[i] = (uint32_t)acc;
+        acc >>= 32;
+    }
+    acc += t[15];
+    fe_fold(n, acc);
+}
+
+#endif
+
+bool secp256k1_fe_from_bytes(struct secp256k1_fe *r, const uint8_t in[32]) {
+    for (int i = 0; i < LIMBS; i++) {
+        const uint8_t *b = in + 32 - LIMB_BYTES * (i + 1);
+        secp256k1_fe_limb limb = 0;
+        for (int j = 0; j < LIMB_BYTES; j++) {
+            limb = (limb << 8) | b[j];
+        }
+        r->n[i] = limb;
+    }
+    return !fe_gte_p(r->n);
+}
+
+void secp256k1_fe_to_bytes(uint8_t out[32], const struct secp256k1_fe *a) {
+    for (int i = 0; i < LIMBS; i++) {
+        uint8_t *b = out + 32 - LIMB_BYTES * (i + 1);
+        secp256k1_fe_limb limb = a->n[i];
+        for (int j = LIMB_BYTES - 1; j >= 0; j--) {
+            b[j] = (uint8_t)limb;
+            limb >>= 8;
+        }
+    }
+}
+
+void secp256k1_fe_mul(struct secp256k1_fe *r, const struct secp256k1_fe *a, const struct secp256k1_fe *b) {
+    // Double-width schoolbook product
+    secp256k1_fe_limb t[2 * LIMBS] = {0};
+    for (int i = 0; i < LIMBS; i++) {
+        fe_wide carry = 0;
+        for (int j = 0; j < LIMBS; j++) {
+            fe_wide acc = (fe_wide)a->n[i] * b->n[j] + t[i + j] + carry;
+            t[i + j] = (secp256k1_fe_limb)acc;
+            carry = acc >> LIMB_BITS;
+        }
+        t[i + LIMBS] = (secp256k1_fe_limb)carry;
+    }
+    fe_reduce(r->n, t);
+}
+
+void secp256k1_fe_sqr(struct secp256k1_fe *r, const struct secp256k1_fe *a) {
+    // Cross products once, doubled, then the squares: 10 (4x64) or 36 (8x32)
+    // limb products instead of 16 or 64
+    secp256k1_fe_limb t[2 * LIMBS] = {0};
+    for (int i = 0; i < LIMBS - 1; i++) {
+        fe_wide carry = 0;
+        for (int j = i + 1; j < LIMBS; j++) {
+            fe_wide acc = (fe_wide)a->n[i] * a->n[j] + t[i + j] + carry;
+            t[i + j] = (secp256k1_fe_limb)acc;
+            carry = acc >> LIMB_BITS;
+        }
+        t[i + LIMBS] = (secp256k1_fe_limb)carry;
+    }
+    secp256k1_fe_limb top = 0;
+    for (int i = 0; i < 2 * LIMBS; i++) {
+        secp256k1_fe_limb next = t[i] >> (LIMB_BITS - 1);
+        t[i] = (t[i] << 1) | top;
+        top = next;
+    }
+    fe_wide carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        fe_wide sq = (fe_wide)a->n[i] * a->n[i];
+        fe_wide acc = (fe_wide)t[2 * i] + (secp256k1_fe_limb)sq + carry;
+        t[2 * i] = (secp256k1_fe_limb)acc;
+        acc = (acc >> LIMB_BITS) + t[2 * i + 1] + (sq >> LIMB_BITS);
+        t[2 * i + 1] = (secp256k1_fe_limb)acc;
+        carry = acc >> LIMB_BITS;
+    }
+    fe_reduce(r->n, t);
+}
+
+static void fe_sqr_n(struct secp256k1_fe *r, const struct secp256k1_fe *a, int count) {
+    *r = *a;
+    for (int i = 0; i < count; i++) {
+        secp256k1_fe_sqr(r, r);
+    }
+}
+
+bool secp256k1_fe_sqrt(struct secp256k1_fe *r, const struct secp256k1_fe *a) {
+    // (p+1)/4 has the bit pattern 1{223} 0 1{22} 0000 11 00; build it from
+    // runs of ones: 253 squarings and 13 multiplications in total.
+    struct secp256k1_fe x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t;
+
+    secp256k1_fe_sqr(&x2, a);
+    secp256k1_fe_mul(&x2, &x2, a);
+
+    secp256k1_fe_sqr(&x3, &x2);
+    secp256k1_fe_mul(&x3, &x3, a);
+
+    fe_sqr_n(&x6, &x3, 3);
+    secp256k1_fe_mul(&x6, &x6, &x3);
+
+    fe_sqr_n(&x9, &x6, 3);
+    secp256k1_fe_mul(&x9, &x9, &x3);
+
+    fe_sqr_n(&x11, &x9, 2);
+    secp256k1_fe_mul(&x11, &x11, &x2);
+
+    fe_sqr_n(&x22, &x11, 11);
+    secp256k1_fe_mul(&x22, &x22, &x11);
+
+    fe_sqr_n(&x44, &x22, 22);
+    secp256k1_fe_mul(&x44, &x44, &x22);
+
+    fe_sqr_n(&x88, &x44, 44);
+    secp256k1_fe_mul(&x88, &x88, &x44);
+
+    fe_sqr_n(&x176, &x88, 88);
+    secp256k1_fe_mul(&x176, &x176, &x88);
+
+    fe_sqr_n(&x220, &x176, 44);
+    secp256k1_fe_mul(&x220, &x220, &x44);
+
+    fe_sqr_n(&x223, &x220, 3);
+    secp256k1_fe_mul(&x223, &x223, &x3);
+
+    fe_sqr_n(&t, &x223, 23);
+    secp256k1_fe_mul(&t, &t, &x22);
+    fe_sqr_n(&t, &t, 6);
+    secp256k1_fe_mul(&t, &t, &x2);
+    fe_sqr_n(r, &t, 2);
+
+    // Only quadratic residues have a root; checking it replaces the Legendre symbol
+    secp256k1_fe_sqr(&t, r);
+    return memcmp(t.n, a->n, sizeof(t.n)) == 0;
+}
+
+bool secp256k1_lift_x(const uint8_t x[32], uint8_t point[64]) {
+    struct secp256k1_fe fx, rhs, y;
+    if (!secp256k1_fe_from_bytes(&fx, x)) {
+        return false;
+    }
+
+    // y^2 = x^3 + 7
+    secp256k1_fe_sqr(&rhs, &fx);
+    secp256k1_fe_mul(&rhs, &rhs, &fx);
+    fe_wide acc = (fe_wide)rhs.n[0] + 7;
+    rhs.n[0] = (secp256k1_fe_limb)acc;
+    acc >>= LIMB_BITS;
+    for (int i = 1; i < LIMBS && acc; i++) {
+        acc += rhs.n[i];
+        rhs.n[i] = (secp256k1_fe_limb)acc;
+        acc >>= LIMB_BITS;
+    }
+    fe_fold(rhs.n, (uint64_t)acc);
+
+    if (!secp256k1_fe_sqrt(&y, &rhs)) {
+        return false;
+    }
+
+    // Even y, as for an 02-prefixed key
+    if (y.n[0] & 1) {
+        struct secp256k1_fe negated;
+        fe_wide borrow = 0;
+        for (int i = 0; i < LIMBS; i++) {
+            fe_wide d = (fe_wide)FIELD_P[i] - y.n[i] - borrow;
+            negated.n[i] = (secp256k1_fe_limb)d;
+            borrow = (d >> LIMB_BITS) & 1;
+        }
+        y = negated;
+    }
+
+    memcpy(point, x, 32);
+    secp256k1_fe_to_bytes(point + 32, &y);
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef SECP256K1_FIELD_H
+#define SECP256K1_FIELD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Element of GF(p), p = 2^256 - 2^32 - 977, as little-endian limbs: four
+// 64-bit limbs where the compiler has a 128-bit product type (hosts), eight
+// 32-bit limbs otherwise (ESP32). Values are kept fully reduced (< p).
+#if defined(__SIZEOF_INT128__)
+#define SECP256K1_FE_LIMBS 4
+typedef uint64_t secp256k1_fe_limb;
+#else
+#define SECP256K1_FE_LIMBS 8
+typedef uint32_t secp256k1_fe_limb;
+#endif
+
+struct secp256k1_fe {
+    secp256k1_fe_limb n[SECP256K1_FE_LIMBS];
+};
+
+// Parse a 32-byte big-endian value; false if it is not below p
+bool secp256k1_fe_from_bytes(struct secp256k1_fe *r, const uint8_t in[32]);
+void secp256k1_fe_to_bytes(uint8_t out[32], const struct secp256k1_fe *a);
+
+void secp256k1_fe_mul(struct secp256k1_fe *r, const struct secp256k1_fe *a, const struct secp256k1_fe *b);
+void secp256k1_fe_sqr(struct secp256k1_fe *r, const struct secp256k1_fe *a);
+
+// r = a^((p+1)/4); true if that is a square root of a
+bool secp256k1_fe_sqrt(struct secp256k1_fe *r, const struct secp256k1_fe *a);
+
+/**
+ * @brief BIP-340 lift_x: the curve point with x coordinate x and even y
+ *
+ * @param x 32-byte big-endian x coordinate
+ * @param point receives x || y, 64 bytes big-endian (uBitcoin's PublicKey layout)
+ * @return false if x is not the x coordinate of a point on the curve
+ */
+bool secp256k1_lift_x(const uint8_t x[32], uint8_t point[64]);
+
+#endif
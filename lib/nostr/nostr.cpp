@@ -1,11 +1,19 @@
 #include "nostr.h"
+#include "codec.h"
 #include "nip44/nip44.h"
+#include "event_serializer.h"
+#include "signer.h"
+#include "../logger/logger.h"
+#include <mbedtls/platform_util.h>
 
 namespace nostr
 {
 
     DynamicJsonDocument nostrEventDoc(0);
-    byte *encryptedMessageBin;
+
+    // Between the NIP-04 ciphertext and its IV, both base64
+    static const char IV_SEPARATOR[] = "?iv=";
+    static const size_t IV_SEPARATOR_LENGTH = sizeof(IV_SEPARATOR) - 1;
 
     unsigned long timer = 0;
     void _startTimer(const char *timedEvent)
@@ -18,105 +26,141 @@ namespace nostr
     void _stopTimer(const char *timedEvent)
     {
         unsigned long elapsedTime = millis() - timer;
-        Serial.print(elapsedTime);
-        Serial.print(" ms - ");
-        Serial.println(timedEvent);
+        NLOG_TRACE("%lu ms - %s", elapsedTime, timedEvent);
         timer = millis();
     }
 
-    void initMemorySpace(size_t nostrEventDocCapacity, size_t encryptedMessageBinSize)
+    void initMemorySpace(size_t nostrEventDocCapacity)
     {
         nostrEventDoc = DynamicJsonDocument(nostrEventDocCapacity);
-        encryptedMessageBin = (byte *)malloc(encryptedMessageBinSize);
     }
 
     void _logToSerialWithTitle(String title, String message)
     {
-        Serial.println(title + ": " + message);
+        NLOG_INFO("%s: %s", title.c_str(), message.c_str());
     }
 
     void _logOkWithHeapSize(const char *message)
     {
-        Serial.print(message);
-        Serial.print(" OK.");
-        Serial.print(" Free heap size: ");
-        Serial.println(esp_get_free_heap_size());
+        NLOG_DEBUG("%s OK. Free heap size: %lu", message, (unsigned long)esp_get_free_heap_size());
     }
 
-    String decryptData(byte key[32], byte iv[16], byte *encryptedMessageBin, int byteSize)
+    size_t nip04EncryptInPlace(const uint8_t key[32], const uint8_t iv[16], uint8_t *buffer, size_t length, size_t capacity)
     {
-        if (!encryptedMessageBin)
+        size_t cipherLength = nip04CipherLength(length);
+        if (capacity < cipherLength)
         {
-            Serial.println("Invalid encryptedMessageBin");
-            return ""; // Handle invalid input
+            return 0;
         }
 
-        // The encryptedMessageBin is already a byte pointer to the binary data
-        // and byteSize is the size of this binary data
+        // PKCS#7: every padding byte holds the padding length, 1 to 16
+        uint8_t padding = cipherLength - length;
+        memset(buffer + length, padding, padding);
 
         AES_ctx ctx;
         AES_init_ctx_iv(&ctx, key, iv);
-        AES_CBC_decrypt_buffer(&ctx, encryptedMessageBin, byteSize); // Use byteSize directly
-
-        // //_logOkWithHeapSize("Decrypted AES data");
+        AES_CBC_encrypt_buffer(&ctx, buffer, cipherLength);
+        mbedtls_platform_zeroize(&ctx, sizeof(ctx));
+        return cipherLength;
+    }
 
-        // Convert the decrypted data to a String. Ensure that the data is null-terminated if treating as a C-string.
-        // If the decrypted data may not be null-terminated or might contain null bytes within,
-        // you'll need a different strategy to create the String object correctly.
-        String decryptedData;
-        for (int i = 0; i < byteSize; i++)
+    bool nip04DecryptInPlace(const uint8_t key[32], const uint8_t iv[16], uint8_t *buffer, size_t length, size_t &messageLength)
+    {
+        if (length == 0 || length % AES_BLOCKLEN != 0)
         {
-            if (encryptedMessageBin[i] != '\0') // Assuming the decrypted text does not include null characters
-                decryptedData += (char)encryptedMessageBin[i];
-            else
-                break; // Stop if a null character is found
+            return false;
         }
 
-        // Note: No need to free encryptedMessageBin here if it's managed outside this function
+        AES_ctx ctx;
+        AES_init_ctx_iv(&ctx, key, iv);
+        AES_CBC_decrypt_buffer(&ctx, buffer, length);
+        mbedtls_platform_zeroize(&ctx, sizeof(ctx));
+
+        uint8_t padding = buffer[length - 1];
+        if (padding == 0 || padding > AES_BLOCKLEN)
+        {
+            return false;
+        }
+        uint8_t diff = 0;
+        for (size_t i = length - padding; i < length; i++)
+        {
+            diff |= buffer[i] ^ padding;
+        }
+        if (diff != 0)
+        {
+            return false;
+        }
+        messageLength = length - padding;
+        return true;
+    }
 
-        return decryptedData;
+    String decryptData(byte key[32], byte iv[16], byte *encryptedMessageBin, int byteSize)
+    {
+        size_t length = 0;
+        if (!encryptedMessageBin || byteSize < 0 || !nip04DecryptInPlace(key, iv, encryptedMessageBin, byteSize, length))
+        {
+            NLOG_ERROR("Invalid encryptedMessageBin");
+            return ""; // Handle invalid input
+        }
+        return String((const char *)encryptedMessageBin, length);
     }
 
-    String decryptNip04Ciphertext(String &cipherText, String privateKeyHex, String senderPubKeyHex)
+    String decryptNip04Ciphertext(String &cipherText, const Signer &signer, const String &senderPubKeyHex)
     {
         _startTimer("decryptNip04Ciphertext");
-        String encryptedMessage = cipherText.substring(0, cipherText.indexOf("?iv="));
-        // //_logOkWithHeapSize("Got encryptedMessage");
-        int encryptedMessageSize = (encryptedMessage.length() * 3) / 4;
-        fromBase64(encryptedMessage, encryptedMessageBin, encryptedMessageSize); // Assuming fromBase64 modifies encryptedMessageSize to actual decoded size
-
-        String iv = cipherText.substring(cipherText.indexOf("?iv=") + 4);
-        // calculate the ivSize for ivBin based on the iv size
-        int ivSize = (iv.length() * 3) / 4;
-        byte ivBin[ivSize];
-        fromBase64(iv, ivBin, ivSize);
-        _logToSerialWithTitle("iv", iv);
-        _stopTimer("decryptNip04Ciphertext: Got ivBin");
-
-        int byteSize = 32;
-        byte privateKeyBytes[byteSize];
-        fromHex(privateKeyHex, privateKeyBytes, byteSize);
-        PrivateKey privateKey(privateKeyBytes);
-        _stopTimer("decryptNip04Ciphertext: Got privateKey");
+        int separator = cipherText.indexOf(IV_SEPARATOR);
+        if (separator <= 0)
+        {
+            NLOG_ERROR("IV not found in content");
+            return "";
+        }
+        const char *text = cipherText.c_str();
 
-        _logToSerialWithTitle("senderPubKeyHex", senderPubKeyHex);
-        byte senderPublicKeyBin[64];
-        fromHex("02" + String(senderPubKeyHex), senderPublicKeyBin, 64);
-        PublicKey senderPublicKey(senderPublicKeyBin);
-        _stopTimer("decryptNip04Ciphertext: Got senderPublicKey");
-        _logToSerialWithTitle("senderPublicKey.toString() is", senderPublicKey.toString());
+        uint8_t iv[AES_BLOCKLEN];
+        const char *ivBase64 = text + separator + IV_SEPARATOR_LENGTH;
+        if (base64Decode(ivBase64, cipherText.length() - separator - IV_SEPARATOR_LENGTH, iv, sizeof(iv)) != sizeof(iv))
+        {
+            NLOG_ERROR("Invalid IV");
+            return "";
+        }
+        NLOG_TRACE("iv: %s", ivBase64);
+        _stopTimer("decryptNip04Ciphertext: Got ivBin");
 
+        NLOG_TRACE("senderPubKeyHex: %s", senderPubKeyHex.c_str());
         byte sharedPointX[32];
-        privateKey.ecdh(senderPublicKey, sharedPointX, false);
-        String sharedPointXHex = toHex(sharedPointX, sizeof(sharedPointX));
-        _logToSerialWithTitle("sharedPointXHex is", sharedPointXHex);
+        if (!signer.sharedSecret(senderPubKeyHex.c_str(), sharedPointX))
+        {
+            NLOG_ERROR("Invalid sender public key");
+            return "";
+        }
         _stopTimer("decryptNip04Ciphertext: Got sharedPointX");
 
-        String message = decryptData(sharedPointX, ivBin, encryptedMessageBin, encryptedMessageSize);
+        // Sized to the message: the base64 is decoded and then decrypted where it lies
+        uint8_t *buffer = (uint8_t *)malloc(separator);
+        if (buffer == nullptr)
+        {
+            NLOG_ERROR("Failed to allocate %d bytes for NIP-04 message", separator);
+            mbedtls_platform_zeroize(sharedPointX, sizeof(sharedPointX));
+            return "";
+        }
+        memcpy(buffer, text, separator);
+        size_t cipherLength = base64DecodeInPlace(buffer, separator);
+        size_t length = 0;
+        bool decrypted = cipherLength != 0 && nip04DecryptInPlace(sharedPointX, iv, buffer, cipherLength, length);
+        mbedtls_platform_zeroize(sharedPointX, sizeof(sharedPointX));
+
+        String message = decrypted ? String((const char *)buffer, length) : String();
+        mbedtls_platform_zeroize(buffer, separator);
+        free(buffer);
+        if (!decrypted)
+        {
+            NLOG_ERROR("Invalid NIP-04 ciphertext");
+            return "";
+        }
         message.trim();
         _stopTimer("decryptNip04Ciphertext: Got message");
 
-        _logToSerialWithTitle("message", message);
+        NLOG_TRACE("message: %s", message.c_str());
 
         return message;
     }
@@ -126,8 +170,7 @@ namespace nostr
         DeserializationError error = deserializeJson(nostrEventDoc, serialisedJson);
         if (error)
         {
-            Serial.print(F("deserializeJson() failed: "));
-            Serial.println(error.c_str());
+            NLOG_ERROR("deserializeJson() failed: %s", error.c_str());
         }
         return nostrEventDoc[2]["content"];
     }
@@ -139,8 +182,7 @@ namespace nostr
         DeserializationError error = deserializeJson(nostrEventDoc, serialisedJson);
         if (error)
         {
-            Serial.print(F("deserializeJson() failed: "));
-            Serial.println(error.c_str());
+            NLOG_ERROR("deserializeJson() failed: %s", error.c_str());
             return tagMap;
         }
         
@@ -170,8 +212,7 @@ namespace nostr
         DeserializationError error = deserializeJson(nostrEventDoc, serialisedJson);
         if (error)
         {
-            Serial.print(F("deserializeJson() failed: "));
-            Serial.println(error.c_str());
+            NLOG_ERROR("deserializeJson() failed: %s", error.c_str());
         }
         return nostrEventDoc[2]["pubkey"];
     }
@@ -181,8 +222,7 @@ namespace nostr
         DeserializationError error = deserializeJson(nostrEventDoc, serialisedJson);
         if (error)
         {
-            Serial.print(F("deserializeJson() failed: "));
-            Serial.println(error.c_str());
+            NLOG_ERROR("deserializeJson() failed: %s", error.c_str());
             return std::make_pair("", "");
         }
 
@@ -194,7 +234,7 @@ namespace nostr
         return std::make_pair(senderPubKeyHex, content);
     }
 
-    String nip04Decrypt(const char *privateKeyHex, String serialisedJson)
+    String nip04Decrypt(const Signer &signer, String serialisedJson)
     {
         _startTimer("nip04Decrypt: nip04Decrypt");
         auto result = getPubKeyAndContent(serialisedJson);
@@ -202,169 +242,60 @@ namespace nostr
         String content = result.second;
         _stopTimer("nip04Decrypt: Got result from getPubKeyAndContent");
 
-        int ivIndex = content.indexOf("?iv=");
-        if (ivIndex == -1)
+        if (content.indexOf(IV_SEPARATOR) == -1)
         {
-            Serial.println("IV not found in content");
+            NLOG_ERROR("IV not found in content");
             return "";
         }
 
-        // Extracting encryptedMessage directly from content without using String for the intermediate steps
-        int encryptedMessageLength = ivIndex; // Length of the encrypted message part
-        const char *encryptedMessage = content.c_str(); // Use the content directly
-        if (!encryptedMessage)
-        {
-            Serial.println("Failed to allocate PSRAM for encryptedMessage");
-            return "";
-        }
-
-        int encryptedMessageSize = encryptedMessageLength / 4 * 3; // Base64 encoded size is 4/3 of the binary size
-
-        fromBase64(encryptedMessage, encryptedMessageBin, encryptedMessageSize);
-        _stopTimer("nip04Decrypt: Got encryptedMessageBin");
-
-        _logToSerialWithTitle("encryptedMessage", encryptedMessage);
-
-        int byteSize = 32;
-        byte privateKeyBytes[byteSize];
-        fromHex(privateKeyHex, privateKeyBytes, byteSize);
-        PrivateKey privateKey(privateKeyBytes);
-        _stopTimer("nip04Decrypt: Got privateKey");
-
-        _logToSerialWithTitle("senderPubKeyHex", senderPubKeyHex);
-        byte senderPublicKeyBin[64];
-        fromHex("02" + String(senderPubKeyHex), senderPublicKeyBin, 64);
-        PublicKey senderPublicKey(senderPublicKeyBin);
-        _stopTimer("nip04Decrypt: Got senderPublicKey");
-        _logToSerialWithTitle("senderPublicKey.toString() is", senderPublicKey.toString());
-
-        return decryptNip04Ciphertext(content, privateKeyHex, senderPubKeyHex);
+        return decryptNip04Ciphertext(content, signer, senderPubKeyHex);
     }
 
-    String nip44Decrypt(const char *privateKeyHex, String serialisedJson)
+    String nip44Decrypt(const Signer &signer, String serialisedJson)
     {
         _startTimer("nip44Decrypt: nip44Decrypt");
         auto result = getPubKeyAndContent(serialisedJson);
-        Serial.println("nip44Decrypt: result is: " + result.first + " " + result.second);
+        NLOG_TRACE("nip44Decrypt: result is: %s %s", result.first.c_str(), result.second.c_str());
         String senderPubKeyHex = result.first;
-        Serial.println("nip44Decrypt: senderPubKeyHex is: " + senderPubKeyHex);
+        NLOG_TRACE("nip44Decrypt: senderPubKeyHex is: %s", senderPubKeyHex.c_str());
         String content = result.second;
-        Serial.println("nip44Decrypt: content is: " + content);
+        NLOG_TRACE("nip44Decrypt: content is: %s", content.c_str());
         _stopTimer("nip44Decrypt: Got result from getPubKeyAndContent");
 
-        return executeDecryptMessageNip44(content, privateKeyHex, senderPubKeyHex);
+        return executeDecryptMessageNip44(content, signer, senderPubKeyHex);
     }
 
-    String nip44Encrypt(const char *privateKeyHex, String serialisedJson)
+    String nip44Encrypt(const Signer &signer, String serialisedJson)
     {
         _startTimer("nip44Encrypt: nip44Encrypt");
         auto result = getPubKeyAndContent(serialisedJson);
         String senderPubKeyHex = result.first;
         String content = result.second;
         _stopTimer("nip44Encrypt: Got result from getPubKeyAndContent");
-        return executeEncryptMessageNip44(content, privateKeyHex, senderPubKeyHex);
+        return executeEncryptMessageNip44(content, signer, senderPubKeyHex);
     }
 
     /**
      * @brief Get a Note object
      *
-     * @param privateKeyHex
-     * @param pubKeyHex
+     * @param signer
      * @param timestamp
-     * @param content
+     * @param content unescaped; left unchanged
      * @param kind
      * @param tags
      * @return String
      */
-    String getNote(char const *privateKeyHex, char const *pubKeyHex, unsigned long timestamp, String &content, uint16_t kind, String tags)
+    String getNote(const Signer &signer, unsigned long timestamp, String &content, uint16_t kind, String tags)
     {
         _startTimer("getNote");
-        // convert
-        // log timestamp
-        _logToSerialWithTitle("timestamp is: ", String(timestamp));
-        // escape any double quotes in content
-        content.replace("\"", "\\\"");
-        // replace new lines with \n
-        content.replace("\n", "\\n");
-        // replace carriage returns with \r
-        content.replace("\r", "\\r");
-        // replace tabs with \t
-        content.replace("\t", "\\t");
-        String message = "[0,\"" + String(pubKeyHex) + "\"," + String(timestamp) + "," + String(kind) + "," + tags + ",\"" + content + "\"]";
-        _logToSerialWithTitle("message is: ", message);
-
-        // sha256 of message converted to hex, assign to msghash
-        byte hash[32] = {0}; // hash should be 32 bytes for SHA-256
-        int hashLen = 0;
-
-        // Get the sha256 hash of the message
-        hashLen = sha256(message, hash);
-        _stopTimer("get sha256 hash of message");
-        String msgHash = toHex(hash, hashLen);
-        _stopTimer("get msgHash as hex");
-        _logToSerialWithTitle("SHA-256: ", msgHash);
-
-        // Create the private key object
-        int byteSize = 32;
-        byte privateKeyBytes[byteSize];
-        fromHex(privateKeyHex, privateKeyBytes, byteSize);
-        _stopTimer("convert privateKeyHex to byte array");
-        PrivateKey privateKey(privateKeyBytes);
-        _stopTimer("create privateKey object");
-
-        // Generate the schnorr sig of the messageHash
-        byte messageBytes[byteSize];
-        fromHex(msgHash, messageBytes, byteSize);
-        _stopTimer("convert msgHash to byte array");
-        SchnorrSignature signature = privateKey.schnorr_sign(messageBytes);
-        _stopTimer("generate schnorr sig");
-        String signatureHex = String(signature);
-        _logToSerialWithTitle("Schnorr sig is: ", signatureHex);
-
-        // Device the public key and verify the schnorr sig is valid
-        PublicKey pub = privateKey.publicKey();
-        _stopTimer("get public key");
-
-        // if (pub.schnorr_verify(signature, messageBytes))
-        // {
-        //     _logToSerialWithTitle("All good, signature is valid", "");
-        // }
-        // else
-        // {
-        //     _logToSerialWithTitle("Something went wrong, signature is invalid", "");
-        // }
-        _stopTimer("verify schnorr sig");
-
-        String serialisedDataString = "{\"id\":\"" + msgHash + "\",\"pubkey\":\"" + String(pubKeyHex) + "\",\"created_at\":" + String(timestamp) + ",\"kind\":" + String(kind) + ",\"tags\":" + tags + ",\"content\":\"" + content + "\",\"sig\":\"" + signatureHex + "\"}";
-        _logToSerialWithTitle("serialisedEventDataString is: ", String(serialisedDataString));
-
-        // Print the JSON to the serial monitor
-        _logToSerialWithTitle("Event JSON", serialisedDataString);
-        return serialisedDataString;
-    }
+        NLOG_TRACE("timestamp is: %lu", timestamp);
 
-    /**
-     * @brief Convert a string to a byte array
-     *
-     * @param input
-     * @param padding_diff
-     * @param output
-     */
-    void stringToByteArray(const char *input, int padding_diff, byte *output)
-    {
-        int i = 0;
-        // remove end-of-string char
-        while (input[i] != '\0')
-        {
-            output[i] = input[i];
-            i++;
-        }
+        EventFields event = {signer.publicKeyHex(), timestamp, kind, tags.c_str(), tags.length(), content.c_str(), content.length()};
+        String serialisedDataString = signer.signEvent(event);
+        _stopTimer("serialise and sign event");
 
-        // pad between 1 and 16 bytes
-        for (int j = 0; j < padding_diff; j++)
-        {
-            output[i + j] = padding_diff;
-        }
+        NLOG_TRACE("Event JSON: %s", serialisedDataString.c_str());
+        return serialisedDataString;
     }
 
     /**
@@ -373,134 +304,91 @@ namespace nostr
      * @param key
      * @param iv
      * @param msg
-     * @return String
+     * @return String the ciphertext as hex
      */
     String encryptData(byte key[32], byte iv[16], String &msg)
     {
-        // message has to be padded at the end so it is a multiple of 16
-        int padding_diff = msg.length() % 16 == 0 ? 16 : 16 - (msg.length() % 16);
-
-        int byteSize = msg.length() + padding_diff;
-        byte *messageBin = (byte *)malloc(byteSize);
-
+        size_t cipherLength = nip04CipherLength(msg.length());
+        uint8_t *messageBin = (uint8_t *)malloc(cipherLength);
         if (messageBin == nullptr)
         {
-            Serial.println("Failed to allocate PSRAM");
+            NLOG_ERROR("Failed to allocate PSRAM");
             return "";
         }
 
-        stringToByteArray(msg.c_str(), padding_diff, messageBin);
-
-        AES_ctx ctx;
-        AES_init_ctx_iv(&ctx, key, iv);
-
-        AES_CBC_encrypt_buffer(&ctx, messageBin, byteSize);
-
-        return toHex(messageBin, byteSize);
+        memcpy(messageBin, msg.c_str(), msg.length());
+        nip04EncryptInPlace(key, iv, messageBin, msg.length(), cipherLength);
+        String cipherHex = hexEncode(messageBin, cipherLength);
+        free(messageBin);
+        return cipherHex;
     }
 
     /**
      * @brief Get the cipher text for a nip4 message
      *
-     * @param privateKeyHex
+     * The message is copied once into a buffer laid out as the result:
+     * ciphertext base64, "?iv=", IV base64. It is padded and encrypted at the
+     * end of the first part, so its base64 can be written over it from the
+     * front.
+     *
+     * @param signer
      * @param recipientPubKeyHex
      * @param content
      * @return String
      */
-    String getCipherText(const char *privateKeyHex, const char *recipientPubKeyHex, String &content)
+    String getCipherText(const Signer &signer, const char *recipientPubKeyHex, String &content)
     {
         _startTimer("getCipherText");
         // Get shared point
-        // Create the private key object
-        int byteSize = 32;
-        byte privateKeyBytes[byteSize];
-        fromHex(privateKeyHex, privateKeyBytes, byteSize);
-        PrivateKey privateKey(privateKeyBytes);
-        _stopTimer("getCipherText: create privateKey object");
-
-        byte publicKeyBin[64];
-        fromHex("02" + String(recipientPubKeyHex), publicKeyBin, 64);
-        PublicKey otherDhPublicKey(publicKeyBin);
-        _logToSerialWithTitle("otherDhPublicKey.toString() is", otherDhPublicKey.toString());
-        _stopTimer("getCipherText: create otherDhPublicKey object");
-
         byte sharedPointX[32];
-        privateKey.ecdh(otherDhPublicKey, sharedPointX, false);
-        String sharedPointXHex = toHex(sharedPointX, sizeof(sharedPointX));
-        _logToSerialWithTitle("sharedPointXHex is", sharedPointXHex);
+        if (!signer.sharedSecret(recipientPubKeyHex, sharedPointX))
+        {
+            NLOG_ERROR("Invalid recipient public key");
+            return "";
+        }
         _stopTimer("getCipherText: get sharedPointX");
 
         // Create the initialization vector
-        uint8_t iv[16];
-        esp_random() % 256;
-        for (int i = 0; i < sizeof(iv); i++)
+        uint8_t iv[AES_BLOCKLEN];
+        for (size_t i = 0; i < sizeof(iv); i++)
         {
             iv[i] = esp_random() % 256;
         }
         _stopTimer("getCipherText: create iv");
 
-        String ivHex = toHex(iv, 16);
-        String ivBase64 = hexToBase64(ivHex);
-        _stopTimer("getCipherText: get ivBase64");
-
-        String encryptedMessageHex = encryptData(sharedPointX, iv, content);
-        _stopTimer("getCipherText: get encryptedMessageHex");
-
-        // divide the length of the hex string 2 to get the size of the byte array, since each byte consists of 2 hexadecimal characters.
-        int encryptedMessageSize = encryptedMessageHex.length() / 2;
-        // Allocate memory for the encrypted message array
-        uint8_t *encryptedMessage = (uint8_t *)malloc(encryptedMessageSize);
-        if (encryptedMessage == nullptr)
+        size_t cipherLength = nip04CipherLength(content.length());
+        size_t encodedLength = base64EncodedLength(cipherLength);
+        size_t capacity = encodedLength + IV_SEPARATOR_LENGTH + base64EncodedLength(sizeof(iv)) + 1;
+        uint8_t *buffer = (uint8_t *)malloc(capacity);
+        if (buffer == nullptr)
         {
-            Serial.println("Failed to allocate PSRAM for encryptedMessage");
+            NLOG_ERROR("Failed to allocate %u bytes for NIP-04 message", (unsigned)capacity);
+            mbedtls_platform_zeroize(sharedPointX, sizeof(sharedPointX));
+            return "";
         }
-        fromHex(encryptedMessageHex, encryptedMessage, encryptedMessageSize);
-        _stopTimer("getCipherText: get encryptedMessage fromHex");
 
-        String encryptedMessageBase64 = hexToBase64(encryptedMessageHex);
+        uint8_t *message = buffer + encodedLength - cipherLength;
+        memcpy(message, content.c_str(), content.length());
+        nip04EncryptInPlace(sharedPointX, iv, message, content.length(), cipherLength);
+        mbedtls_platform_zeroize(sharedPointX, sizeof(sharedPointX));
+        _stopTimer("getCipherText: encrypt");
+
+        char *out = (char *)buffer;
+        size_t length = base64Encode(message, cipherLength, out, encodedLength + 1);
+        memcpy(out + length, IV_SEPARATOR, IV_SEPARATOR_LENGTH);
+        length += IV_SEPARATOR_LENGTH;
+        length += base64Encode(iv, sizeof(iv), out + length, capacity - length);
         _stopTimer("getCipherText: get encryptedMessageBase64");
 
-        encryptedMessageBase64 += "?iv=" + ivBase64;
-        return encryptedMessageBase64;
-    }
-
-    /**
-     * @brief Get the Serialised Encrypted Dm Object
-     *
-     * @param pubKeyHex
-     * @param recipientPubKeyHex
-     * @param kind
-     * @param msgHash
-     * @param timestamp
-     * @param encryptedMessageWithIv
-     * @param schnorrSig
-     * @return String
-     */
-    String getSerialisedEncryptedDmObject(const char *pubKeyHex, const char *recipientPubKeyHex, uint16_t kind, String &msgHash, int timestamp, String &encryptedMessageWithIv, String &schnorrSig)
-    {
-        // parse a JSON array
-        String serialisedTagsArray = "[[\"p\",\"" + String(recipientPubKeyHex) + "\"]]";
-        // _logToSerialWithTitle("serialisedTagsArray is: ", serialisedTagsArray);
-
-        // create the serialised fullEvent string using sprintf instead of the Arduino JSON library
-        return "[\"EVENT\",{\"id\":\"" + msgHash + "\",\"pubkey\":\"" + pubKeyHex + "\",\"created_at\":" + String(timestamp) + ",\"kind\":" + String(kind) + ",\"tags\":" + serialisedTagsArray + ",\"content\":\"" + encryptedMessageWithIv + "\",\"sig\":\"" + schnorrSig + "\"}]";
-    }
-
-    String getSerialisedEncryptedDmArray(char const *pubKeyHex, char const *recipientPubKeyHex, uint16_t kind, int timestamp, String &encryptedMessageWithIv)
-    {
-        String serialisedTagsArray = "[[\"p\",\"" + String(recipientPubKeyHex) + "\"]]";
-        String message = "[0,\"" + String(pubKeyHex) + "\"," + String(timestamp) + "," + String(kind) + "," + serialisedTagsArray + ",\"" + encryptedMessageWithIv + "\"]";
-
-        // _logToSerialWithTitle("message is: ", message);
-
-        return message;
+        String cipherText = String(out, length);
+        free(buffer);
+        return cipherText;
     }
 
     /**
      * @brief Get the Encrypted Dm object
      *
-     * @param privateKeyHex
-     * @param pubKeyHex
+     * @param signer
      * @param recipientPubKeyHex
      * @param kind
      * @param timestamp
@@ -508,47 +396,25 @@ namespace nostr
      * @param type "nip44" or "nip04"
      * @return String
      */
-    String getEncryptedDm(char const *privateKeyHex, char const *pubKeyHex, char const *recipientPubKeyHex, uint16_t kind, unsigned long timestamp, String content, String type)
+    String getEncryptedDm(const Signer &signer, char const *recipientPubKeyHex, uint16_t kind, unsigned long timestamp, String content, String type)
     {
         String encryptedMessageBase64 = "";
         if (type == "nip44") {
             _startTimer("getEncrypted NIP44 Dm");
-            encryptedMessageBase64 = executeEncryptMessageNip44(content, privateKeyHex, recipientPubKeyHex);
-            Serial.println("NIP44 encrypted message: " + encryptedMessageBase64);
+            encryptedMessageBase64 = executeEncryptMessageNip44(content, signer, recipientPubKeyHex);
+            NLOG_TRACE("NIP44 encrypted message: %s", encryptedMessageBase64.c_str());
             _stopTimer("executeEncryptMessageNip44");
         } else {
             _startTimer("getEncrypted NIP44 Dm");
-            encryptedMessageBase64 = getCipherText(privateKeyHex, recipientPubKeyHex, content);
+            encryptedMessageBase64 = getCipherText(signer, recipientPubKeyHex, content);
             _stopTimer("getCipherText");
         }
 
-        String message = nostr::getSerialisedEncryptedDmArray(pubKeyHex, recipientPubKeyHex, kind, timestamp, encryptedMessageBase64);
-        _stopTimer("get serialised encrypted dm array");
-
-        byte hash[32] = {0}; // hash should be 32 bytes for SHA-256
-        int hashLen = 0;
-
-        // Get the sha256 hash of the message
-        hashLen = sha256(message, hash);
-        String msgHash = toHex(hash, hashLen);
-        _logToSerialWithTitle("SHA-256:", msgHash);
-        _stopTimer("get sha256 hash of message");
-
-        int byteSize = 32;
-        byte privateKeyBytes[byteSize];
-        fromHex(privateKeyHex, privateKeyBytes, byteSize);
-        _stopTimer("get privateKeyBytes from hex");
-        PrivateKey privateKey(privateKeyBytes);
-        _stopTimer("create privateKey object");
-        // Generate the schnorr sig of the messageHash
-        SchnorrSignature signature = privateKey.schnorr_sign(hash);
-        _stopTimer("generate schnorr sig");
-        String signatureHex = String(signature);
-        _logToSerialWithTitle("Schnorr sig is: ", signatureHex);
-
-        String serialisedEventData = nostr::getSerialisedEncryptedDmObject(pubKeyHex, recipientPubKeyHex, kind, msgHash, timestamp, encryptedMessageBase64, signatureHex);
-        _stopTimer("get serialised encrypted dm object");
-        // _logToSerialWithTitle("serialisedEventData is", serialisedEventData);
+        String tags = "[[\"p\",\"" + String(recipientPubKeyHex) + "\"]]";
+
+        EventFields event = {signer.publicKeyHex(), timestamp, kind, tags.c_str(), tags.length(), encryptedMessageBase64.c_str(), encryptedMessageBase64.length()};
+        String serialisedEventData = signer.signEvent(event, "[\"EVENT\",", "]");
+        _stopTimer("serialise and sign encrypted dm");
         return serialisedEventData;
     }
 }
\ No newline at end of file
@@ -9,15 +9,14 @@
 #include <aes.h>
 #include <ArduinoJson.h>
 #include <map>
+#include "signer.h"
 
 namespace nostr
 {
-    void initMemorySpace(size_t nostrEventDocCapacity, size_t encryptedMessageBinSize);
+    void initMemorySpace(size_t nostrEventDocCapacity);
 
     void _logToSerialWithTitle(String title, String message);
 
-    void stringToByteArray(const char *input, int padding_diff, byte *output);
-
     String getContent(const String &serialisedJson);
 
     std::map<String, String> getTags(const String &serialisedJson);
@@ -26,27 +25,34 @@ namespace nostr
 
     std::pair<String, String> getPubKeyAndContent(const String &serialisedJson);
 
-    String nip04Decrypt(const char *privateKeyHex, String serialisedJson);
+    String nip04Decrypt(const Signer &signer, String serialisedJson);
 
-    String nip44Decrypt(const char *privateKeyHex, String serialisedJson);
+    String nip44Decrypt(const Signer &signer, String serialisedJson);
 
-    String nip44Encrypt(const char *privateKeyHex, String serialisedJson);
+    String nip44Encrypt(const Signer &signer, String serialisedJson);
 
-    String decryptData(byte key[32], byte iv[16], byte* encryptedMessageBin, int byteSize);
+    // NIP-04 on caller buffers: AES-256-CBC with PKCS#7 padding, in place
 
-    String decryptNip04Ciphertext(String &cipherText, String privateKeyHex, String senderPubKeyHex);
+    // Ciphertext length for a message of length bytes; there is always at least one padding byte
+    inline size_t nip04CipherLength(size_t length) { return (length / AES_BLOCKLEN + 1) * AES_BLOCKLEN; }
 
-    String getNote(char const *privateKeyHex, char const *pubKeyHex, unsigned long timestamp, String &content, uint16_t kind, String tags = "[]");
+    // Pad the message at the start of buffer and encrypt it there; returns the ciphertext length, 0 if capacity is too small
+    size_t nip04EncryptInPlace(const uint8_t key[32], const uint8_t iv[16], uint8_t *buffer, size_t length, size_t capacity);
 
-    String encryptData(byte key[32], byte iv[16], String &msg);
+    // Decrypt in place and check the padding; the message is left at the start of buffer
+    bool nip04DecryptInPlace(const uint8_t key[32], const uint8_t iv[16], uint8_t *buffer, size_t length, size_t &messageLength);
 
-    String getCipherText(const char *privateKeyHex, const char *recipientPubKeyHex, String &content);
+    String decryptData(byte key[32], byte iv[16], byte* encryptedMessageBin, int byteSize);
 
-    String getSerialisedEncryptedDmObject(const char *pubKeyHex, const char *recipientPubKeyHex, uint16_t kind, String &msgHash, int timestamp, String &encryptedMessageWithIv, String &schnorrSig);
+    String decryptNip04Ciphertext(String &cipherText, const Signer &signer, const String &senderPubKeyHex);
+
+    String getNote(const Signer &signer, unsigned long timestamp, String &content, uint16_t kind, String tags = "[]");
+
+    String encryptData(byte key[32], byte iv[16], String &msg);
 
-    String getSerialisedEncryptedDmArray(char const *pubKeyHex, char const *recipientPubKeyHex, uint16_t kind, int timestamp, String &encryptedMessageWithIv);
+    String getCipherText(const Signer &signer, const char *recipientPubKeyHex, String &content);
 
-    String getEncryptedDm(char const *privateKeyHex, char const *pubKeyHex, char const *recipientPubKeyHex, uint16_t kind, unsigned long timestamp, String content, String type);
+    String getEncryptedDm(const Signer &signer, char const *recipientPubKeyHex, uint16_t kind, unsigned long timestamp, String content, String type);
 
 
 }
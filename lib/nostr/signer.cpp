@@ -0,0 +1,140 @@
+#include "signer.h"
+#include "codec.h"
+#include "nip44/nip44.h"
+#include <mbedtls/platform_util.h>
+#include "../logger/logger.h"
+#include "nip44/secp256k1_field.h"
+
+namespace nostr
+{
+    Signer::Signer(const char *privateKeyHex)
+    {
+        begin(privateKeyHex);
+    }
+
+    Signer::~Signer()
+    {
+        clear();
+    }
+
+    bool Signer::begin(const char *privateKeyHex)
+    {
+        clear();
+        uint8_t secret[32];
+        if (privateKeyHex == nullptr || hexDecode(privateKeyHex, strlen(privateKeyHex), secret, sizeof(secret)) != sizeof(secret))
+        {
+            mbedtls_platform_zeroize(secret, sizeof(secret));
+            NLOG_ERROR("Signer: private key must be 64 hex characters");
+            return false;
+        }
+        key = PrivateKey(secret);
+        mbedtls_platform_zeroize(secret, sizeof(secret));
+
+        // PrivateKey derives the public point on construction; keep its x coordinate
+        PublicKey pub = key.publicKey();
+        memcpy(pubKeyX, pub.point, sizeof(pubKeyX));
+        hexEncode(pubKeyX, sizeof(pubKeyX), pubKeyHex);
+        pubKeyHex[64] = '\0';
+
+        valid = true;
+        return true;
+    }
+
+    void Signer::clear()
+    {
+        key = PrivateKey();
+        valid = false;
+        ecdhCache.clear();
+        mbedtls_platform_zeroize(pubKeyX, sizeof(pubKeyX));
+        mbedtls_platform_zeroize(pubKeyHex, sizeof(pubKeyHex));
+    }
+
+    size_t Signer::signEvent(char *buffer, size_t capacity, EventFields event, const char *prefix, const char *suffix) const
+    {
+        if (!valid)
+        {
+            return 0;
+        }
+        event.pubKeyHex = pubKeyHex;
+        return serializeSignedEvent(buffer, capacity, key, event, prefix, suffix);
+    }
+
+    String Signer::signEvent(EventFields event, const char *prefix, const char *suffix) const
+    {
+        if (!valid)
+        {
+            NLOG_ERROR("Signer: no key loaded");
+            return "";
+        }
+        event.pubKeyHex = pubKeyHex;
+        return serializeSignedEvent(key, event, prefix, suffix);
+    }
+
+    bool Signer::ecdh(const PublicKey &peer, uint8_t sharedX[32]) const
+    {
+        if (!valid)
+        {
+            return false;
+        }
+        key.ecdh(peer, sharedX, false);
+        return true;
+    }
+
+    bool Signer::sharedSecret(const char *peerPubKeyHex, uint8_t sharedX[32]) const
+    {
+        if (!valid || peerPubKeyHex == nullptr || strlen(peerPubKeyHex) != 64)
+        {
+            return false;
+        }
+
+        uint8_t peerX[32];
+        if (hexDecode(peerPubKeyHex, 64, peerX, sizeof(peerX)) != sizeof(peerX))
+        {
+            return false;
+        }
+
+        if (ecdhCache.lookup(peerX, sharedX))
+        {
+            return true;
+        }
+
+        // Lift x to the point with an even y, as NIP-04/NIP-44 assume for x-only
+        // keys. An x that is not on the curve has no point; ECDH with it would be
+        // undefined, so it is rejected before anything is computed or cached.
+        uint8_t pointBytes[64];
+        if (!secp256k1_lift_x(peerX, pointBytes))
+        {
+            NLOG_WARN("Signer: peer key %s is not on the curve", peerPubKeyHex);
+            return false;
+        }
+
+        PublicKey peer(pointBytes, true);
+        key.ecdh(peer, sharedX, false);
+        ecdhCache.insert(peerX, sharedX);
+        return true;
+    }
+
+    bool Signer::conversationKey(const char *peerPubKeyHex, HmacSha256Key &conversation) const
+    {
+        uint8_t peer[32];
+        if (!valid || peerPubKeyHex == nullptr || strlen(peerPubKeyHex) != 64 || hexDecode(peerPubKeyHex, 64, peer, 32) != 32)
+        {
+            return false;
+        }
+
+        if (ecdhCache.lookupConversationKey(peer, conversation))
+        {
+            return true;
+        }
+
+        uint8_t sharedX[32];
+        if (!sharedSecret(peerPubKeyHex, sharedX))
+        {
+            return false;
+        }
+        getConversationKey(sharedX, conversation);
+        mbedtls_platform_zeroize(sharedX, sizeof(sharedX));
+        ecdhCache.insertConversationKey(peer, conversation);
+        return true;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef NOSTR_SIGNER_H
+#define NOSTR_SIGNER_H
+
+#include <Arduino.h>
+#include "Bitcoin.h"
+#include "event_serializer.h"
+#include "ecdh_cache.h"
+
+namespace nostr
+{
+    /**
+     * @brief Long-lived key material for signing events and ECDH
+     *
+     * Decodes the secret and derives the x-only public key once, when the
+     * key is loaded, instead of on every getNote/getEncryptedDm/ECDH call.
+     * Not copyable so the secret is not duplicated around the heap.
+     */
+    class Signer
+    {
+    public:
+        Signer() = default;
+        explicit Signer(const char *privateKeyHex);
+        ~Signer();
+
+        Signer(const Signer &) = delete;
+        Signer &operator=(const Signer &) = delete;
+
+        /**
+         * @brief Load a 64 character hex secret key
+         *
+         * @return false (and the signer left empty) if the key is malformed
+         */
+        bool begin(const char *privateKeyHex);
+
+        // Forget the key material
+        void clear();
+
+        bool isValid() const { return valid; }
+
+        // x-only public key as 64 lowercase hex characters, "" if not loaded
+        const char *publicKeyHex() const { return pubKeyHex; }
+
+        // x-only public key, 32 bytes
+        const uint8_t *publicKey() const { return pubKeyX; }
+
+        const PrivateKey &privateKey() const { return key; }
+
+        /**
+         * @brief Sign an event into a caller-provided buffer, see serializeSignedEvent()
+         *
+         * event.pubKeyHex is ignored; this signer's public key is used.
+         */
+        size_t signEvent(char *buffer, size_t capacity, EventFields event, const char *prefix = "", const char *suffix = "") const;
+
+        // As above, into a String reserved to the exact length; "" on failure
+        String signEvent(EventFields event, const char *prefix = "", const char *suffix = "") const;
+
+        /**
+         * @brief ECDH with a peer key
+         *
+         * @param sharedX receives the x coordinate of the shared point (unhashed)
+         */
+        bool ecdh(const PublicKey &peer, uint8_t sharedX[32]) const;
+
+        /**
+         * @brief ECDH with an x-only peer key, served from the conversation cache when possible
+         *
+         * @param peerPubKeyHex 64 hex characters
+         * @param sharedX receives the x coordinate of the shared point (unhashed)
+         */
+        bool sharedSecret(const char *peerPubKeyHex, uint8_t sharedX[32]) const;
+
+        /**
+         * @brief NIP-44 conversation key with an x-only peer key, keyed for HKDF-expand
+         *
+         * Derived from the shared secret on first use and then served from the
+         * conversation cache, so messages to a known peer skip HKDF-extract.
+         *
+         * @param peerPubKeyHex 64 hex characters
+         */
+        bool conversationKey(const char *peerPubKeyHex, HmacSha256Key &key) const;
+
+        const EcdhCache &conversationCache() const { return ecdhCache; }
+
+    private:
+        // PrivateKey::ecdh() is not declared const
+        mutable PrivateKey key;
+        bool valid = false;
+        uint8_t pubKeyX[32] = {0};
+        char pubKeyHex[65] = {0};
+        mutable EcdhCache ecdhCache;
+    };
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * Host stand-in for the ESP32 Arduino core.
+ *
+ * Provides the timing, random, Serial and ESP helpers the firmware modules
+ * use so that src/ and lib/ can be built and profiled on Linux.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Print.h"
+#include "Printable.h"
+#include "WString.h"
+#include "esp_system.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+using std::max;
+using std::min;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long baud) {}
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush();
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getHeapSize();
+    uint32_t getFreePsram() { return 0; }
+    uint32_t getPsramSize() { return 0; }
+    uint64_t getEfuseMac() { return 0x0000DEADBEEF0000ULL; }
+};
+
+extern EspClass ESP;
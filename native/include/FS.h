@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * Host stand-in for the ESP32 FS/File classes.
+ *
+ * Paths are mapped onto a directory of the host filesystem, so files
+ * written by one run are there for the next, just like flash.
+ */
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <stdio.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+    class File
+    {
+    public:
+        File() {}
+        explicit File(FILE *handle);
+
+        size_t write(const uint8_t *buf, size_t size);
+        size_t read(uint8_t *buf, size_t size);
+        int available();
+        bool seek(uint32_t pos);
+        size_t position();
+        size_t size();
+        void flush();
+        void close();
+        operator bool() const { return handle != nullptr; }
+
+    private:
+        std::shared_ptr<FILE> handle;
+    };
+
+    class FS
+    {
+    public:
+        explicit FS(const char *root) : root(root) {}
+
+        File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+        bool exists(const char *path);
+        bool remove(const char *path);
+        bool rename(const char *pathFrom, const char *pathTo);
+
+    protected:
+        std::string hostPath(const char *path);
+
+        std::string root;
+    };
+}
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,39 @@
+#pragma once
+
+/**
+ * Host stand-in for the ESP32 HTTPClient.
+ *
+ * Requests are answered by a process-wide handler (e.g. a fake LNbits) set
+ * with HTTPClient::setHandler(); without one every request fails with
+ * HTTPC_ERROR_CONNECTION_REFUSED.
+ */
+
+#include <Arduino.h>
+#include <functional>
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient
+{
+public:
+    typedef std::function<int(const String &method, const String &url, const String &body, String &response)> Handler;
+
+    static void setHandler(Handler handler);
+
+    bool begin(const String &url);
+    bool begin(WiFiClient &client, const String &url) { return begin(url); }
+    void addHeader(const String &name, const String &value) {}
+    void setReuse(bool reuse) {}
+    void setTimeout(uint16_t timeout) {}
+    int GET();
+    int POST(const String &payload);
+    String getString() { return response; }
+    void end();
+
+private:
+    int send(const char *method, const String &payload);
+
+    String url;
+    String response;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+/**
+ * Host stand-in for the ESP32 LittleFS library, backed by the
+ * .littlefs directory in the working directory.
+ */
+
+#include "FS.h"
+
+namespace fs
+{
+    class LittleFSFS : public FS
+    {
+    public:
+        LittleFSFS() : FS(".littlefs") {}
+
+        bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10, const char *partitionLabel = "spiffs");
+        bool format();
+        void end() {}
+    };
+}
+
+extern fs::LittleFSFS LittleFS;
@@ -0,0 +1,50 @@
+#pragma once
+
+/**
+ * Host stand-in for the ESP32 Preferences (NVS) library.
+ *
+ * Values live in a process-wide in-memory store so they survive
+ * begin()/end() cycles for the lifetime of the host process.
+ */
+
+#include <Arduino.h>
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partition_label = nullptr);
+    void end();
+
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBool(const char *key, bool value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putULong(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putULong64(const char *key, uint64_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putInt(const char *key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+    size_t putString(const char *key, const String &value) { return putBytes(key, value.c_str(), value.length()); }
+    size_t putBytes(const char *key, const void *value, size_t len);
+
+    bool getBool(const char *key, bool defaultValue = false) { return getValue(key, defaultValue); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint32_t getULong(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    uint64_t getULong64(const char *key, uint64_t defaultValue = 0) { return getValue(key, defaultValue); }
+    int32_t getInt(const char *key, int32_t defaultValue = 0) { return getValue(key, defaultValue); }
+    String getString(const char *key, const String &defaultValue = String());
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    template <typename T>
+    T getValue(const char *key, T defaultValue)
+    {
+        T value;
+        return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+
+    String ns;
+    bool opened = false;
+    bool readOnly = false;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+/**
+ * Host stand-in for the Arduino Print base class. Concrete sinks only need
+ * to implement write(const uint8_t*, size_t).
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Printable.h"
+#include "WString.h"
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = 10) { return print(String(n, base)); }
+    size_t print(int n, int base = 10) { return print(String(n, base)); }
+    size_t print(unsigned int n, int base = 10) { return print(String(n, base)); }
+    size_t print(long n, int base = 10) { return print(String(n, base)); }
+    size_t print(unsigned long n, int base = 10) { return print(String(n, base)); }
+    size_t print(long long n, int base = 10) { return print(String(n, base)); }
+    size_t print(unsigned long long n, int base = 10) { return print(String(n, base)); }
+    size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+    size_t print(const Printable &p) { return p.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T &value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+};
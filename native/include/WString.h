@@ -0,0 +1,160 @@
+#pragma once
+
+/**
+ * Host stand-in for the Arduino String class.
+ *
+ * Only the subset used by src/, lib/ and the libraries they pull in is
+ * provided. Behaviour follows the ESP32 Arduino core, including the
+ * "-1 for not found" conventions of indexOf().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String
+{
+public:
+    String() {}
+    String(const char *cstr) : s(cstr ? cstr : "") {}
+    String(const char *cstr, unsigned int length) : s(cstr ? std::string(cstr, length) : std::string()) {}
+    String(const uint8_t *cstr, unsigned int length) : String((const char *)cstr, length) {}
+    String(const __FlashStringHelper *str) : String(reinterpret_cast<const char *>(str)) {}
+    String(const std::string &str) : s(str) {}
+    String(const String &other) = default;
+    String(String &&other) = default;
+    explicit String(char c) : s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String &operator=(const String &rhs) = default;
+    String &operator=(String &&rhs) = default;
+    String &operator=(const char *cstr)
+    {
+        s = cstr ? cstr : "";
+        return *this;
+    }
+
+    bool reserve(unsigned int size)
+    {
+        s.reserve(size);
+        return true;
+    }
+    unsigned int length() const { return s.length(); }
+    bool isEmpty() const { return s.empty(); }
+    const char *c_str() const { return s.c_str(); }
+    char *begin() { return &s[0]; }
+    char *end() { return &s[0] + s.length(); }
+    const char *begin() const { return s.c_str(); }
+    const char *end() const { return s.c_str() + s.length(); }
+
+    bool concat(const String &str)
+    {
+        s += str.s;
+        return true;
+    }
+    bool concat(const char *cstr)
+    {
+        if (cstr)
+            s += cstr;
+        return true;
+    }
+    bool concat(const char *cstr, unsigned int length)
+    {
+        if (cstr)
+            s.append(cstr, length);
+        return true;
+    }
+    bool concat(char c)
+    {
+        s += c;
+        return true;
+    }
+    bool concat(unsigned char c) { return concat(String(c)); }
+    bool concat(int num) { return concat(String(num)); }
+    bool concat(unsigned int num) { return concat(String(num)); }
+    bool concat(long num) { return concat(String(num)); }
+    bool concat(unsigned long num) { return concat(String(num)); }
+    bool concat(float num) { return concat(String(num)); }
+    bool concat(double num) { return concat(String(num)); }
+
+    template <typename T>
+    String &operator+=(const T &rhs)
+    {
+        concat(rhs);
+        return *this;
+    }
+
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs.s + rhs.s); }
+    friend String operator+(const String &lhs, const char *rhs) { return String(lhs.s + (rhs ? rhs : "")); }
+    friend String operator+(const char *lhs, const String &rhs) { return String((lhs ? lhs : "") + rhs.s); }
+    friend String operator+(const String &lhs, char rhs) { return String(lhs.s + rhs); }
+    friend String operator+(char lhs, const String &rhs) { return String(lhs + rhs.s); }
+
+    int compareTo(const String &other) const { return s.compare(other.s); }
+    bool equals(const String &other) const { return s == other.s; }
+    bool equals(const char *cstr) const { return s == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &other) const;
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &rhs) const { return s < rhs.s; }
+    bool operator>(const String &rhs) const { return s > rhs.s; }
+    bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.length(), prefix.s) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return s.length() >= suffix.s.length() && s.compare(s.length() - suffix.s.length(), suffix.s.length(), suffix.s) == 0;
+    }
+
+    char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+    void setCharAt(unsigned int index, char c)
+    {
+        if (index < s.length())
+            s[index] = c;
+    }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return s[index]; }
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const
+    {
+        getBytes((unsigned char *)buf, bufsize, index);
+    }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const { return found(s.find(ch, fromIndex)); }
+    int indexOf(const String &str, unsigned int fromIndex = 0) const { return found(s.find(str.s, fromIndex)); }
+    int indexOf(const char *str, unsigned int fromIndex = 0) const { return found(s.find(str, fromIndex)); }
+    int lastIndexOf(char ch) const { return found(s.rfind(ch)); }
+    int lastIndexOf(const String &str) const { return found(s.rfind(str.s)); }
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, s.length()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string s;
+};
+
+typedef String StringSumHelper;
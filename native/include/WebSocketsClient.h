@@ -0,0 +1,77 @@
+#pragma once
+
+/**
+ * Host stand-in for links2004/WebSockets' WebSocketsClient.
+ *
+ * There is no network: the client "connects" on the first loop() after
+ * begin(), frames queued with inject() are delivered from loop() exactly
+ * like relay traffic, and everything sent is handed to an optional sink.
+ * This is enough to drive NostrManager end to end on the host.
+ */
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <string>
+
+typedef enum
+{
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient
+{
+public:
+    typedef std::function<void(WStype_t type, uint8_t *payload, size_t length)> WebSocketClientEvent;
+    typedef std::function<void(const char *payload, size_t length)> SendSink;
+
+    void begin(const char *host, uint16_t port, const char *url = "/", const char *protocol = "arduino");
+    void beginSSL(const char *host, uint16_t port, const char *url = "/", const char *fingerprint = "", const char *protocol = "arduino");
+    void onEvent(WebSocketClientEvent cbEvent) { eventCallback = cbEvent; }
+    void setReconnectInterval(unsigned long time) {}
+    void enableHeartbeat(uint32_t pingInterval, uint32_t pongTimeout, uint8_t disconnectTimeoutCount) {}
+
+    void loop();
+    void disconnect();
+    bool isConnected() { return connected; }
+
+    bool sendTXT(uint8_t *payload, size_t length = 0, bool headerToPayload = false);
+    bool sendTXT(const uint8_t *payload, size_t length = 0);
+    bool sendTXT(char *payload, size_t length = 0, bool headerToPayload = false) { return sendTXT((uint8_t *)payload, length, headerToPayload); }
+    bool sendTXT(const char *payload, size_t length = 0) { return sendTXT((const uint8_t *)payload, length); }
+    bool sendTXT(String &payload) { return sendTXT(payload.c_str(), payload.length()); }
+    bool sendTXT(char payload) { return sendTXT(&payload, 1); }
+    bool sendPing(uint8_t *payload = nullptr, size_t length = 0);
+
+    // Host-only helpers
+    void inject(WStype_t type, const char *payload, size_t length);
+    void injectText(const char *payload) { inject(WStype_TEXT, payload, strlen(payload)); }
+    void setSendSink(SendSink sink) { sendSink = sink; }
+    const String &getHost() const { return host; }
+
+private:
+    struct Frame
+    {
+        WStype_t type;
+        std::string payload;
+    };
+
+    void dispatch(WStype_t type, std::string &payload);
+
+    WebSocketClientEvent eventCallback;
+    SendSink sendSink;
+    std::deque<Frame> inbound;
+    String host;
+    bool started = false;
+    bool connected = false;
+};
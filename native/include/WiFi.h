@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+typedef enum
+{
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress
+{
+public:
+    String toString() const { return "127.0.0.1"; }
+};
+
+// The host is always "connected"
+class WiFiClass
+{
+public:
+    wl_status_t status() { return WL_CONNECTED; }
+    bool isConnected() { return true; }
+    String SSID() { return "native"; }
+    IPAddress localIP() { return IPAddress(); }
+    int8_t RSSI() { return -40; }
+};
+
+extern WiFiClass WiFi;
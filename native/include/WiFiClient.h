@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+class WiFiClient
+{
+public:
+    virtual ~WiFiClient() {}
+    virtual int connect(const char *host, uint16_t port) { return 0; }
+    virtual size_t write(const uint8_t *buf, size_t size) { return 0; }
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int read(uint8_t *buf, size_t size) { return -1; }
+    virtual uint8_t connected() { return 0; }
+    virtual void stop() {}
+};
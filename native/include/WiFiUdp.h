@@ -0,0 +1,9 @@
+#pragma once
+
+class UDP
+{
+};
+
+class WiFiUDP : public UDP
+{
+};
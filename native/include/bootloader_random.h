@@ -0,0 +1,5 @@
+#pragma once
+
+// The host entropy source is always available; nothing to enable
+static inline void bootloader_random_enable(void) {}
+static inline void bootloader_random_disable(void) {}
@@ -0,0 +1,138 @@
+/**
+ * @file Arduino.cpp
+ * @brief Host implementations of the Arduino/ESP32 core shims
+ */
+
+#include "Arduino.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// Figures reported by the heap helpers; real heap use should be measured
+// with heaptrack or valgrind rather than through these.
+static const uint32_t NATIVE_HEAP_SIZE = 320 * 1024;
+
+static std::chrono::steady_clock::time_point bootTime()
+{
+    static const auto boot = std::chrono::steady_clock::now();
+    return boot;
+}
+
+static std::mt19937 &prng()
+{
+    static std::mt19937 engine(std::random_device{}());
+    return engine;
+}
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime()).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime()).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+long random(long howbig)
+{
+    return howbig <= 0 ? 0 : random(0, howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+    if (howsmall >= howbig)
+    {
+        return howsmall;
+    }
+    return std::uniform_int_distribution<long>(howsmall, howbig - 1)(prng());
+}
+
+void randomSeed(unsigned long seed)
+{
+    prng().seed(seed);
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char stackBuf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(stackBuf, sizeof(stackBuf), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return 0;
+    }
+    if ((size_t)len < sizeof(stackBuf))
+    {
+        return write((const uint8_t *)stackBuf, len);
+    }
+    std::string heapBuf(len + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuf[0], heapBuf.size(), format, args);
+    va_end(args);
+    return write((const uint8_t *)heapBuf.data(), len);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+void EspClass::restart()
+{
+    esp_restart();
+}
+
+uint32_t EspClass::getFreeHeap() { return esp_get_free_heap_size(); }
+uint32_t EspClass::getMinFreeHeap() { return esp_get_minimum_free_heap_size(); }
+uint32_t EspClass::getHeapSize() { return NATIVE_HEAP_SIZE; }
+
+extern "C" uint32_t esp_random(void)
+{
+    static std::random_device device;
+    return device();
+}
+
+extern "C" void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *out = (uint8_t *)buf;
+    while (len > 0)
+    {
+        uint32_t word = esp_random();
+        size_t n = len < sizeof(word) ? len : sizeof(word);
+        memcpy(out, &word, n);
+        out += n;
+        len -= n;
+    }
+}
+
+extern "C" uint32_t esp_get_free_heap_size(void) { return NATIVE_HEAP_SIZE; }
+extern "C" uint32_t esp_get_minimum_free_heap_size(void) { return NATIVE_HEAP_SIZE; }
+
+extern "C" void esp_restart(void)
+{
+    fflush(stdout);
+    fprintf(stderr, "esp_restart() called on host build, exiting\n");
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,67 @@
+#include "HTTPClient.h"
+#include "WiFi.h"
+#include "base64.h"
+
+WiFiClass WiFi;
+
+static HTTPClient::Handler &handler()
+{
+    static HTTPClient::Handler instance;
+    return instance;
+}
+
+void HTTPClient::setHandler(Handler h)
+{
+    handler() = h;
+}
+
+bool HTTPClient::begin(const String &url)
+{
+    this->url = url;
+    response = "";
+    return true;
+}
+
+int HTTPClient::send(const char *method, const String &payload)
+{
+    if (!handler())
+    {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    return handler()(method, url, payload, response);
+}
+
+int HTTPClient::GET()
+{
+    return send("GET", String());
+}
+
+int HTTPClient::POST(const String &payload)
+{
+    return send("POST", payload);
+}
+
+void HTTPClient::end()
+{
+    url = "";
+}
+
+String base64::encode(const uint8_t *data, size_t length)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    String out;
+    out.reserve(((length + 2) / 3) * 4);
+    for (size_t i = 0; i < length; i += 3)
+    {
+        uint32_t n = (uint32_t)data[i] << 16;
+        if (i + 1 < length)
+            n |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length)
+            n |= data[i + 2];
+        out += table[(n >> 18) & 63];
+        out += table[(n >> 12) & 63];
+        out += i + 1 < length ? table[(n >> 6) & 63] : '=';
+        out += i + 2 < length ? table[n & 63] : '=';
+    }
+    return out;
+}
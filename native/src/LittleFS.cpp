@@ -0,0 +1,123 @@
+#include "LittleFS.h"
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <string>
+
+fs::LittleFSFS LittleFS;
+
+namespace fs
+{
+    File::File(FILE *handle)
+    {
+        // shared_ptr would hand a null handle to fclose as well
+        if (handle != nullptr)
+        {
+            this->handle.reset(handle, fclose);
+        }
+    }
+
+    size_t File::write(const uint8_t *buf, size_t size)
+    {
+        return handle ? fwrite(buf, 1, size, handle.get()) : 0;
+    }
+
+    size_t File::read(uint8_t *buf, size_t size)
+    {
+        return handle ? fread(buf, 1, size, handle.get()) : 0;
+    }
+
+    int File::available()
+    {
+        return handle ? (int)(size() - position()) : 0;
+    }
+
+    bool File::seek(uint32_t pos)
+    {
+        return handle && fseek(handle.get(), pos, SEEK_SET) == 0;
+    }
+
+    size_t File::position()
+    {
+        return handle ? ftell(handle.get()) : 0;
+    }
+
+    size_t File::size()
+    {
+        if (!handle)
+        {
+            return 0;
+        }
+        long pos = ftell(handle.get());
+        fseek(handle.get(), 0, SEEK_END);
+        long end = ftell(handle.get());
+        fseek(handle.get(), pos, SEEK_SET);
+        return end;
+    }
+
+    void File::flush()
+    {
+        if (handle)
+        {
+            fflush(handle.get());
+        }
+    }
+
+    void File::close()
+    {
+        handle.reset();
+    }
+
+    std::string FS::hostPath(const char *path)
+    {
+        return root + (path[0] == '/' ? "" : "/") + path;
+    }
+
+    File FS::open(const char *path, const char *mode, const bool create)
+    {
+        std::string host = hostPath(path);
+        std::string hostMode = std::string(mode) + "b";
+        return File(fopen(host.c_str(), hostMode.c_str()));
+    }
+
+    bool FS::exists(const char *path)
+    {
+        struct stat info;
+        return stat(hostPath(path).c_str(), &info) == 0;
+    }
+
+    bool FS::remove(const char *path)
+    {
+        return ::remove(hostPath(path).c_str()) == 0;
+    }
+
+    bool FS::rename(const char *pathFrom, const char *pathTo)
+    {
+        return ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0;
+    }
+
+    bool LittleFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles, const char *partitionLabel)
+    {
+        struct stat info;
+        return stat(root.c_str(), &info) == 0 || mkdir(root.c_str(), 0755) == 0;
+    }
+
+    bool LittleFSFS::format()
+    {
+        DIR *dir = opendir(root.c_str());
+        if (dir == nullptr)
+        {
+            return false;
+        }
+        while (struct dirent *entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..")
+            {
+                ::remove((root + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+        return true;
+    }
+}
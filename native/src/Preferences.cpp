@@ -0,0 +1,95 @@
+#include "Preferences.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+static std::map<std::string, Namespace> &store()
+{
+    static std::map<std::string, Namespace> namespaces;
+    return namespaces;
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partition_label)
+{
+    ns = name;
+    opened = true;
+    this->readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end()
+{
+    opened = false;
+}
+
+bool Preferences::clear()
+{
+    if (!opened || readOnly)
+    {
+        return false;
+    }
+    store()[ns.c_str()].clear();
+    return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (!opened || readOnly)
+    {
+        return false;
+    }
+    return store()[ns.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+    return opened && store()[ns.c_str()].count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+    if (!opened || readOnly)
+    {
+        return 0;
+    }
+    const uint8_t *bytes = (const uint8_t *)value;
+    store()[ns.c_str()][key] = std::vector<uint8_t>(bytes, bytes + len);
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    if (!isKey(key))
+    {
+        return 0;
+    }
+    return store()[ns.c_str()][key].size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+    if (!isKey(key))
+    {
+        return 0;
+    }
+    const std::vector<uint8_t> &value = store()[ns.c_str()][key];
+    if (value.size() > maxLen)
+    {
+        return 0;
+    }
+    memcpy(buf, value.data(), value.size());
+    return value.size();
+}
+
+String Preferences::getString(const char *key, const String &defaultValue)
+{
+    if (!isKey(key))
+    {
+        return defaultValue;
+    }
+    const std::vector<uint8_t> &value = store()[ns.c_str()][key];
+    return String((const char *)value.data(), value.size());
+}
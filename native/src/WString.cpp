@@ -0,0 +1,164 @@
+#include "WString.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string toBase(unsigned long long value, unsigned char base)
+{
+    if (base < 2 || base > 36)
+    {
+        base = 10;
+    }
+    char buf[65];
+    int pos = sizeof(buf);
+    do
+    {
+        int digit = value % base;
+        buf[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value > 0);
+    return std::string(buf + pos, sizeof(buf) - pos);
+}
+
+static std::string toSignedBase(long long value, unsigned char base)
+{
+    if (value < 0 && base == 10)
+    {
+        return "-" + toBase(0ULL - (unsigned long long)value, base);
+    }
+    return toBase((unsigned long long)value, base);
+}
+
+String::String(unsigned char value, unsigned char base) : s(toBase(value, base)) {}
+String::String(int value, unsigned char base) : s(toSignedBase(value, base)) {}
+String::String(unsigned int value, unsigned char base) : s(toBase(value, base)) {}
+String::String(long value, unsigned char base) : s(toSignedBase(value, base)) {}
+String::String(unsigned long value, unsigned char base) : s(toBase(value, base)) {}
+String::String(long long value, unsigned char base) : s(toSignedBase(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : s(toBase(value, base)) {}
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    s = buf;
+}
+
+bool String::equalsIgnoreCase(const String &other) const
+{
+    if (s.length() != other.s.length())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < s.length(); i++)
+    {
+        if (tolower((unsigned char)s[i]) != tolower((unsigned char)other.s[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+    if (!bufsize || !buf)
+    {
+        return;
+    }
+    if (index >= s.length())
+    {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = std::min<unsigned int>(bufsize - 1, s.length() - index);
+    memcpy(buf, s.data() + index, n);
+    buf[n] = 0;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        std::swap(beginIndex, endIndex);
+    }
+    if (beginIndex >= s.length())
+    {
+        return String();
+    }
+    endIndex = std::min<unsigned int>(endIndex, s.length());
+    return String(s.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(char find, char replace)
+{
+    std::replace(s.begin(), s.end(), find, replace);
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if (find.s.empty())
+    {
+        return;
+    }
+    std::string out;
+    out.reserve(s.length());
+    size_t pos = 0;
+    size_t hit;
+    while ((hit = s.find(find.s, pos)) != std::string::npos)
+    {
+        out.append(s, pos, hit - pos);
+        out += replace.s;
+        pos = hit + find.s.length();
+    }
+    out.append(s, pos, std::string::npos);
+    s.swap(out);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < s.length())
+    {
+        s.erase(index, count);
+    }
+}
+
+void String::toLowerCase()
+{
+    for (auto &c : s)
+    {
+        c = tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (auto &c : s)
+    {
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::trim()
+{
+    size_t first = 0;
+    while (first < s.length() && isspace((unsigned char)s[first]))
+    {
+        first++;
+    }
+    size_t last = s.length();
+    while (last > first && isspace((unsigned char)s[last - 1]))
+    {
+        last--;
+    }
+    s = s.substr(first, last - first);
+}
+
+long String::toInt() const { return atol(s.c_str()); }
+float String::toFloat() const { return (float)atof(s.c_str()); }
+double String::toDouble() const { return atof(s.c_str()); }
@@ -0,0 +1,91 @@
+#include "WebSocketsClient.h"
+
+void WebSocketsClient::begin(const char *host, uint16_t port, const char *url, const char *protocol)
+{
+    this->host = host;
+    started = true;
+}
+
+void WebSocketsClient::beginSSL(const char *host, uint16_t port, const char *url, const char *fingerprint, const char *protocol)
+{
+    begin(host, port, url, protocol);
+}
+
+void WebSocketsClient::dispatch(WStype_t type, std::string &payload)
+{
+    if (eventCallback)
+    {
+        // The real client hands out a NUL-terminated, writable buffer
+        eventCallback(type, (uint8_t *)&payload[0], payload.length());
+    }
+}
+
+void WebSocketsClient::loop()
+{
+    if (!started)
+    {
+        return;
+    }
+    if (!connected)
+    {
+        connected = true;
+        std::string url = std::string("wss://") + host.c_str() + "/";
+        dispatch(WStype_CONNECTED, url);
+    }
+    while (connected && !inbound.empty())
+    {
+        Frame frame = std::move(inbound.front());
+        inbound.pop_front();
+        dispatch(frame.type, frame.payload);
+    }
+}
+
+void WebSocketsClient::disconnect()
+{
+    bool wasConnected = connected;
+    connected = false;
+    started = false;
+    inbound.clear();
+    if (wasConnected)
+    {
+        std::string empty;
+        dispatch(WStype_DISCONNECTED, empty);
+    }
+}
+
+bool WebSocketsClient::sendTXT(uint8_t *payload, size_t length, bool headerToPayload)
+{
+    return sendTXT((const uint8_t *)payload, length);
+}
+
+bool WebSocketsClient::sendTXT(const uint8_t *payload, size_t length)
+{
+    if (!connected)
+    {
+        return false;
+    }
+    if (length == 0)
+    {
+        length = strlen((const char *)payload);
+    }
+    if (sendSink)
+    {
+        sendSink((const char *)payload, length);
+    }
+    return true;
+}
+
+bool WebSocketsClient::sendPing(uint8_t *payload, size_t length)
+{
+    if (!connected)
+    {
+        return false;
+    }
+    inbound.push_back({WStype_PONG, std::string()});
+    return true;
+}
+
+void WebSocketsClient::inject(WStype_t type, const char *payload, size_t length)
+{
+    inbound.push_back({type, std::string(payload, length)});
+}
@@ -0,0 +1,292 @@
+/**
+ * @file native_main.cpp
+ * @brief Host entry point for profiling the firmware modules
+ *
+ * Drives the request pipeline and the crypto hot paths in a tight loop so
+ * they can be run under perf/heaptrack. Results go to stderr, firmware
+ * logging to stdout:
+ *
+ *   pio run -e native && .pio/build/native/program > /dev/null
+ *
+ * An optional first argument scales the iteration counts.
+ *
+ * Left out of `pio test -e native` builds, where each test under test/
+ * brings its own main().
+ */
+
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <functional>
+#include <mbedtls/base64.h>
+#include <vector>
+
+#include "nostr_manager.h"
+#include "payment_provider.h"
+#include "payment_journal.h"
+#include "relay_message_parser.h"
+
+#include "../lib/nostr/nostr.h"
+#include "../lib/nostr/codec.h"
+#include "../lib/nostr/nip44/nip44.h"
+#include "../lib/nostr/nip44/secp256k1_field.h"
+#include "../lib/nostr/nip44/chacha20.h"
+#include "../lib/nostr/nip44/helpers.h"
+
+// Throwaway key pair used only on the host
+static const char *BENCH_PRIVATE_KEY = "7f7ff03d123792d6ac594bfa67bf6d0c0ab55b6b1fdb6249303fe861f1ccba9a";
+static const char *BENCH_PEER_PUBKEY = "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798";
+
+// A kind-5107 job request for a paid method, as a relay would deliver it
+static const char *BENCH_REQUEST_FRAME =
+    "[\"EVENT\",\"bench\",{\"id\":\"5c83da77af1dec6d7289834998ad7aafbd9e2191396d75ec3cc27f5a77226f36\","
+    "\"pubkey\":\"f7234bd4c1394dda46d09f35bd384dd30cc552ad5541990f98844fb06676e9ca\",\"created_at\":1700000000,"
+    "\"kind\":5107,\"tags\":[[\"i\",\"[{\\\"method\\\":\\\"runVacuum\\\"}]\"],"
+    "[\"p\",\"79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798\"]],\"content\":\"\","
+    "\"sig\":\"9b8f2a0e0e1f5c6d2b3a4f5e6d7c8b9a0f1e2d3c4b5a69788796a5b4c3d2e1f00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\"}]";
+
+// Minimal LNbits stand-in: every invoice request succeeds
+static int fakeLnbits(const String &method, const String &url, const String &body, String &response)
+{
+    static unsigned long counter = 0;
+    char hash[65];
+    snprintf(hash, sizeof(hash), "%064lx", ++counter);
+    response = String("{\"payment_hash\":\"") + hash + "\",\"bolt11\":\"lnbc100n1pnativebench" + String(counter) + "\"}";
+    return 201;
+}
+
+static void bench(const char *name, unsigned long iterations, const std::function<void()> &fn)
+{
+    fn(); // warm up
+    unsigned long start = micros();
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        fn();
+    }
+    unsigned long elapsed = micros() - start;
+    double perOp = (double)elapsed / iterations;
+    fprintf(stderr, "%-32s %8lu iters %12.1f us/op %10.1f ops/s\n", name, iterations, perOp, perOp > 0 ? 1e6 / perOp : 0);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long scale = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1;
+    if (scale == 0)
+    {
+        scale = 1;
+    }
+
+    HTTPClient::setHandler(fakeLnbits);
+    nostr::initMemorySpace(1024);
+
+    NostrManager::init();
+    NostrManager::connectToRelay();
+    NostrManager::processLoop();
+
+    nostr::Signer signer(BENCH_PRIVATE_KEY);
+
+    String frame = BENCH_REQUEST_FRAME;
+    bench("NostrManager::handleEvent", 50 * scale, [&]() {
+        String copy = frame;
+        NostrManager::handleEvent((uint8_t *)copy.begin(), copy.length());
+        // completes the invoice request and signs the payment required reply
+        NostrManager::processLoop();
+    });
+
+    // The same request split into WebSocket fragments, as a slow relay sends it
+    bench("RelayMessageParser 64B fragments", 2000 * scale, [&]() {
+        RelayMessageParser parser;
+        for (size_t offset = 0; offset < frame.length(); offset += 64)
+        {
+            parser.feed((const uint8_t *)frame.c_str() + offset, min((size_t)64, frame.length() - offset));
+        }
+        parser.finish();
+    });
+
+    // A wallet notification for an invoice that is not ours, the common case
+    String notification = "{\"payment\":{\"checking_id\":\"c0ffee\",\"pending\":false,\"amount\":21000,"
+                          "\"memo\":\"Some other invoice\",\"status\":\"success\",\"extra\":{\"tag\":\"other\"},"
+                          "\"payment_hash\":\"9e4f1c2b3a4d5e6f708192a3b4c5d6e7f8091a2b3c4d5e6f708192a3b4c5d6e7\","
+                          "\"bolt11\":\"lnbc210n1pnotours\"},\"wallet_balance\":1000}";
+    bench("handlePaymentNotification", 2000 * scale, [&]() {
+        PaymentProvider::handlePaymentNotification((uint8_t *)notification.begin(), notification.length());
+    });
+
+    // A full table's worth of requests, half of them paid, as found after a restart
+    PaymentJournal benchJournal(LittleFS, "/bench.jnl");
+    std::vector<PaymentJournal::Entry> pending;
+    std::vector<PaymentJournal::Entry> confirmed;
+    benchJournal.begin(pending, confirmed);
+    for (size_t i = 0; i < PendingPayments::CAPACITY; i++)
+    {
+        uint8_t key[PendingPayments::KEY_SIZE] = {(uint8_t)i, (uint8_t)(i >> 8)};
+        PendingPayments::Payment payment = {};
+        benchJournal.recordInsert(key, payment);
+        if (i % 2 == 0)
+        {
+            benchJournal.recordConfirm(key);
+        }
+    }
+    benchJournal.flush();
+    bench("PaymentJournal::begin", 20 * scale, [&]() {
+        PaymentJournal journal(LittleFS, "/bench.jnl");
+        pending.clear();
+        confirmed.clear();
+        journal.begin(pending, confirmed);
+    });
+    LittleFS.remove("/bench.jnl");
+
+    String content = "Temperature is 21.5C\nHumidity is 40%";
+    bench("nostr::getNote", 50 * scale, [&]() {
+        String body = content;
+        nostr::getNote(signer, 1700000000, body, 6107, "[[\"e\",\"00\"]]");
+    });
+
+    uint8_t peerX[32];
+    uint8_t peerPoint[64];
+    nostr::hexDecode(BENCH_PEER_PUBKEY, 64, peerX, sizeof(peerX));
+    bench("secp256k1_lift_x", 2000 * scale, [&]() {
+        secp256k1_lift_x(peerX, peerPoint);
+    });
+
+    // The codecs against what they replaced: uBitcoin hex, sscanf per byte and mbedtls base64
+    std::vector<uint8_t> codecBytes(1024);
+    for (size_t i = 0; i < codecBytes.size(); i++)
+    {
+        codecBytes[i] = (uint8_t)(i * 131 + 7);
+    }
+    std::vector<uint8_t> codecOut(2 * codecBytes.size() + 1);
+    for (size_t size : {32, 1024})
+    {
+        unsigned long iterations = (size > 32 ? 2000 : 50000) * scale;
+        String hex = nostr::hexEncode(codecBytes.data(), size);
+        String base64 = nostr::base64Encode(codecBytes.data(), size);
+        size_t written = 0;
+        char name[48];
+
+        snprintf(name, sizeof(name), "nostr::hexEncode %zuB", size);
+        bench(name, iterations, [&]() {
+            nostr::hexEncode(codecBytes.data(), size, (char *)codecOut.data());
+        });
+        snprintf(name, sizeof(name), "toHex %zuB", size);
+        bench(name, iterations, [&]() {
+            toHex(codecBytes.data(), size);
+        });
+        snprintf(name, sizeof(name), "nostr::hexDecode %zuB", size);
+        bench(name, iterations, [&]() {
+            nostr::hexDecode(hex.c_str(), hex.length(), codecOut.data(), codecOut.size());
+        });
+        snprintf(name, sizeof(name), "fromHex %zuB", size);
+        bench(name, iterations, [&]() {
+            fromHex(hex.c_str(), hex.length(), codecOut.data(), codecOut.size());
+        });
+        snprintf(name, sizeof(name), "sscanf hex %zuB", size);
+        bench(name, iterations, [&]() {
+            for (size_t i = 0; i < hex.length(); i += 2)
+            {
+                sscanf(hex.c_str() + i, "%2hhx", &codecOut[i / 2]);
+            }
+        });
+        snprintf(name, sizeof(name), "nostr::base64Encode %zuB", size);
+        bench(name, iterations, [&]() {
+            nostr::base64Encode(codecBytes.data(), size, (char *)codecOut.data(), codecOut.size());
+        });
+        snprintf(name, sizeof(name), "mbedtls_base64_encode %zuB", size);
+        bench(name, iterations, [&]() {
+            mbedtls_base64_encode(codecOut.data(), codecOut.size(), &written, codecBytes.data(), size);
+        });
+        snprintf(name, sizeof(name), "nostr::base64Decode %zuB", size);
+        bench(name, iterations, [&]() {
+            nostr::base64Decode(base64.c_str(), base64.length(), codecOut.data(), codecOut.size());
+        });
+        snprintf(name, sizeof(name), "mbedtls_base64_decode %zuB", size);
+        bench(name, iterations, [&]() {
+            mbedtls_base64_decode(codecOut.data(), codecOut.size(), &written, (const uint8_t *)base64.c_str(), base64.length());
+        });
+    }
+
+    // Conversation key from the signer's cache, as the NIP-44 handlers get it
+    nostr::HmacSha256Key conversationKey = {};
+    signer.conversationKey(BENCH_PEER_PUBKEY, conversationKey);
+    for (size_t size : {32, 1024, 16384, 65535})
+    {
+        String plaintext;
+        plaintext.reserve(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            plaintext += (char)('a' + i % 26);
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "encryptMessageNip44 %zuB", size);
+        bench(name, (size > 1024 ? 20 : 200) * scale, [&]() {
+            encryptMessageNip44(plaintext, conversationKey);
+        });
+
+        // In place in one buffer, as a caller that owns its buffer would
+        std::vector<uint8_t> buffer(nip44EncodedLength(size) + 1);
+        size_t offset = nip44InPlaceOffset(size);
+        snprintf(name, sizeof(name), "encryptPayloadNip44 %zuB", size);
+        bench(name, (size > 1024 ? 20 : 200) * scale, [&]() {
+            memcpy(buffer.data() + offset + NIP44_PLAINTEXT_OFFSET, plaintext.c_str(), size);
+            size_t length = encryptPayloadNip44(conversationKey, buffer.data() + offset, buffer.size() - offset, size);
+            base64EncodeNip44(buffer.data() + offset, length, (char *)buffer.data(), buffer.size());
+        });
+
+        String encrypted = encryptMessageNip44(plaintext, conversationKey);
+        snprintf(name, sizeof(name), "decryptMessageNip44 %zuB", size);
+        bench(name, (size > 1024 ? 20 : 200) * scale, [&]() {
+            decryptMessageNip44(encrypted, conversationKey);
+        });
+    }
+
+    // NIP-04 both ways; the peer and sender are the same key so the shared secret matches
+    for (size_t size : {32, 1024, 16384})
+    {
+        String plaintext;
+        plaintext.reserve(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            plaintext += (char)('a' + i % 26);
+        }
+        unsigned long iterations = (size > 1024 ? 20 : 200) * scale;
+        char name[48];
+        snprintf(name, sizeof(name), "nostr::getCipherText %zuB", size);
+        bench(name, iterations, [&]() {
+            nostr::getCipherText(signer, BENCH_PEER_PUBKEY, plaintext);
+        });
+
+        String cipherText = nostr::getCipherText(signer, BENCH_PEER_PUBKEY, plaintext);
+        snprintf(name, sizeof(name), "decryptNip04Ciphertext %zuB", size);
+        bench(name, iterations, [&]() {
+            nostr::decryptNip04Ciphertext(cipherText, signer, peerPubKeyHex);
+        });
+    }
+
+    // The NIP-44 cipher on its own, across the sizes NIP-44 allows, against mbedtls
+    std::vector<uint8_t> cipherInput(65536, 0xa5);
+    std::vector<uint8_t> cipherOutput(65536);
+    const uint8_t cipherKey[32] = {1};
+    const uint8_t cipherNonce[12] = {2};
+    for (size_t size : {32, 1024, 16384, 65536})
+    {
+        unsigned long iterations = (size > 1024 ? 200 : 5000) * scale;
+        char name[48];
+        snprintf(name, sizeof(name), "chacha20_encrypt %zuB", size);
+        bench(name, iterations, [&]() {
+            chacha20_ctx ctx;
+            chacha20_init_ctx(&ctx, cipherKey, cipherNonce);
+            chacha20_encrypt(&ctx, cipherOutput.data(), cipherInput.data(), size);
+        });
+        snprintf(name, sizeof(name), "mbedtls_chacha20_crypt %zuB", size);
+        bench(name, iterations, [&]() {
+            mbedtls_chacha20_crypt(cipherKey, cipherNonce, 0, size, cipherInput.data(), cipherOutput.data());
+        });
+    }
+
+    NostrManager::cleanup();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,581 @@
+/**
+ * @file async_https_client.cpp
+ * @brief Non-blocking keep-alive HTTPS client
+ * @version 0.1
+ * @date 2025-10-17
+ *
+ * A non-blocking lwIP socket carries an mbedtls session whose handshake,
+ * writes and reads are stepped from loop(); every call returns as soon as
+ * the socket would block. Like HTTPClient without a CA certificate, the
+ * server certificate is not verified.
+ */
+
+#include "async_https_client.h"
+#include "../lib/logger/logger.h"
+
+#ifdef NATIVE_BUILD
+#include <HTTPClient.h>
+#else
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <esp_random.h>
+#endif
+
+AsyncHttpsClient::AsyncHttpsClient(const char *host, uint16_t port) : host(host), port(port)
+{
+}
+
+AsyncHttpsClient::~AsyncHttpsClient()
+{
+    disconnect();
+}
+
+bool AsyncHttpsClient::post(const String &path, const String &body, response_callback_t callback)
+{
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    if (pending.size() >= MAX_PENDING)
+    {
+        NLOG_WARN("AsyncHttpsClient::post() - %u requests already queued for %s", (unsigned)pending.size(), host.c_str());
+        return false;
+    }
+    Request request;
+    request.path = path;
+    request.body = body;
+    request.callback = callback;
+    pending.push_back(request);
+    return true;
+}
+
+void AsyncHttpsClient::stop()
+{
+    disconnect();
+    if (in_flight)
+    {
+        fail(ERROR_CONNECT);
+    }
+
+    std::deque<Request> dropped;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        dropped.swap(pending);
+    }
+    for (auto &request : dropped)
+    {
+        if (request.callback)
+        {
+            request.callback(ERROR_CONNECT, String());
+        }
+    }
+}
+
+// Takes the headers and body out of rx once the whole response is in
+bool AsyncHttpsClient::parseResponse(bool closed)
+{
+    int header_end = rx.indexOf("\r\n\r\n");
+    if (header_end < 0 || !rx.startsWith("HTTP/1."))
+    {
+        return false;
+    }
+
+    int status = rx.substring(9, 12).toInt();
+    String headers = rx.substring(0, header_end + 2);
+    headers.toLowerCase();
+    size_t body_start = header_end + 4;
+    String body;
+
+    int length_header = headers.indexOf("\r\ncontent-length:");
+    if (headers.indexOf("\r\ntransfer-encoding: chunked") >= 0)
+    {
+        size_t pos = body_start;
+        while (true)
+        {
+            int line_end = rx.indexOf("\r\n", pos);
+            if (line_end < 0)
+            {
+                return false;
+            }
+            size_t chunk = strtoul(rx.c_str() + pos, nullptr, 16);
+            size_t data_start = line_end + 2;
+            if (chunk == 0)
+            {
+                // no trailers expected: the last chunk is followed by an empty line
+                if (rx.length() < data_start + 2)
+                {
+                    return false;
+                }
+                break;
+            }
+            if (rx.length() < data_start + chunk + 2)
+            {
+                return false;
+            }
+            body.concat(rx.c_str() + data_start, chunk);
+            pos = data_start + chunk + 2;
+        }
+    }
+    else if (length_header >= 0)
+    {
+        size_t length = headers.substring(length_header + 17).toInt();
+        if (rx.length() < body_start + length)
+        {
+            return false;
+        }
+        body = rx.substring(body_start, body_start + length);
+    }
+    else
+    {
+        // delimited by the server closing the connection
+        if (!closed)
+        {
+            return false;
+        }
+        body = rx.substring(body_start);
+        closed = true;
+    }
+
+    keep_alive = !closed && headers.indexOf("\r\nconnection: close") < 0;
+    complete(status, body);
+    return true;
+}
+
+void AsyncHttpsClient::complete(int status, const String &body)
+{
+    timings.response_ms = millis() - phase_started;
+    timings.reused = session_reused;
+    last_timings = timings;
+    request_count++;
+
+    response_callback_t callback = current.callback;
+    current = Request();
+    in_flight = false;
+    rx = String();
+
+    if (keep_alive)
+    {
+        state = STATE_IDLE;
+    }
+    else
+    {
+        disconnect();
+    }
+
+    if (callback)
+    {
+        callback(status, body);
+    }
+}
+
+void AsyncHttpsClient::fail(Error error)
+{
+    // A keep-alive session the server has since closed shows up as a failed
+    // write or an empty read; that is worth one more try on a fresh session
+    bool stale = session_reused && !current.retried && (error == ERROR_SEND || (error == ERROR_RESPONSE && rx.length() == 0));
+    disconnect();
+
+    if (!in_flight)
+    {
+        return;
+    }
+    if (stale)
+    {
+        NLOG_DEBUG("AsyncHttpsClient - Kept-alive session to %s was closed, reconnecting", host.c_str());
+        current.retried = true;
+        session_reused = false;
+        timings = Timings();
+        return;
+    }
+
+    NLOG_ERROR("AsyncHttpsClient - Request to %s failed: %d", host.c_str(), (int)error);
+    response_callback_t callback = current.callback;
+    current = Request();
+    in_flight = false;
+    if (callback)
+    {
+        callback(error, String());
+    }
+}
+
+void AsyncHttpsClient::startRequest()
+{
+    tx = "POST " + current.path + " HTTP/1.1\r\n"
+         "Host: " + host + "\r\n"
+         "Content-Type: application/json\r\n"
+         "Content-Length: " + String(current.body.length()) + "\r\n"
+         "Connection: keep-alive\r\n"
+         "\r\n" + current.body;
+    tx_offset = 0;
+    rx = String();
+    keep_alive = true;
+    phase_started = millis();
+    state = STATE_SENDING;
+}
+
+void AsyncHttpsClient::loop()
+{
+    if (!in_flight)
+    {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            if (!pending.empty())
+            {
+                current = pending.front();
+                pending.pop_front();
+                in_flight = true;
+            }
+        }
+        if (!in_flight)
+        {
+            checkIdleConnection();
+            return;
+        }
+        timings = Timings();
+        session_reused = state == STATE_IDLE;
+    }
+
+    switch (state)
+    {
+    case STATE_DISCONNECTED:
+        if (!startConnect())
+        {
+            fail(ERROR_CONNECT);
+        }
+        break;
+    case STATE_CONNECTING:
+        stepConnect();
+        break;
+    case STATE_HANDSHAKING:
+        stepHandshake();
+        break;
+    case STATE_IDLE:
+        startRequest();
+        stepSend();
+        break;
+    case STATE_SENDING:
+        stepSend();
+        break;
+    case STATE_RECEIVING:
+        stepReceive();
+        break;
+    }
+}
+
+#ifdef NATIVE_BUILD
+
+// The host has no sockets or TLS here: hand the request to the HTTPClient
+// stand-in in one go and treat the session as always open.
+
+struct AsyncHttpsClient::Tls
+{
+};
+
+bool AsyncHttpsClient::startConnect()
+{
+    timings.connect_ms = 0;
+    timings.tls_ms = 0;
+    connection_count++;
+    state = STATE_IDLE;
+    return true;
+}
+
+void AsyncHttpsClient::stepConnect()
+{
+}
+
+void AsyncHttpsClient::stepHandshake()
+{
+}
+
+void AsyncHttpsClient::stepSend()
+{
+    timings.request_ms = 0;
+    phase_started = millis();
+    state = STATE_RECEIVING;
+}
+
+void AsyncHttpsClient::stepReceive()
+{
+    HTTPClient http;
+    http.begin("https://" + host + current.path);
+    int status = http.POST(current.body);
+    String body = http.getString();
+    http.end();
+
+    if (status <= 0)
+    {
+        fail(ERROR_CONNECT);
+        return;
+    }
+    keep_alive = true;
+    complete(status, body);
+}
+
+void AsyncHttpsClient::checkIdleConnection()
+{
+}
+
+void AsyncHttpsClient::disconnect()
+{
+    state = STATE_DISCONNECTED;
+    tx = String();
+    rx = String();
+}
+
+#else
+
+struct AsyncHttpsClient::Tls
+{
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+};
+
+static int randomBytes(void *context, unsigned char *output, size_t length)
+{
+    esp_fill_random(output, length);
+    return 0;
+}
+
+static int sendBio(void *context, const unsigned char *buffer, size_t length)
+{
+    int ret = lwip_send(*(int *)context, buffer, length, 0);
+    if (ret < 0)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+    return ret;
+}
+
+static int recvBio(void *context, unsigned char *buffer, size_t length)
+{
+    int ret = lwip_recv(*(int *)context, buffer, length, 0);
+    if (ret < 0)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+    return ret;
+}
+
+static bool wouldBlock(int ret)
+{
+    return ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+bool AsyncHttpsClient::startConnect()
+{
+    if (address == 0)
+    {
+        IPAddress ip;
+        if (!WiFi.hostByName(host.c_str(), ip))
+        {
+            NLOG_ERROR("AsyncHttpsClient - Could not resolve %s", host.c_str());
+            return false;
+        }
+        address = (uint32_t)ip;
+    }
+
+    fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0)
+    {
+        NLOG_ERROR("AsyncHttpsClient - Could not create socket: %d", errno);
+        return false;
+    }
+    lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int one = 1;
+    lwip_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = address;
+    if (lwip_connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+    {
+        NLOG_ERROR("AsyncHttpsClient - Connect to %s failed: %d", host.c_str(), errno);
+        address = 0;
+        disconnect();
+        return false;
+    }
+
+    phase_started = millis();
+    state = STATE_CONNECTING;
+    return true;
+}
+
+void AsyncHttpsClient::stepConnect()
+{
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(fd, &writable);
+    struct timeval no_wait = {0, 0};
+    int ready = lwip_select(fd + 1, nullptr, &writable, nullptr, &no_wait);
+    if (ready == 0)
+    {
+        if (millis() - phase_started > CONNECT_TIMEOUT)
+        {
+            address = 0;
+            fail(ERROR_TIMEOUT);
+        }
+        return;
+    }
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (ready < 0 || lwip_getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+    {
+        NLOG_ERROR("AsyncHttpsClient - Connect to %s failed: %d", host.c_str(), error);
+        address = 0;
+        fail(ERROR_CONNECT);
+        return;
+    }
+
+    timings.connect_ms = millis() - phase_started;
+    phase_started = millis();
+
+    tls = new Tls();
+    mbedtls_ssl_init(&tls->ssl);
+    mbedtls_ssl_config_init(&tls->conf);
+    int ret = mbedtls_ssl_config_defaults(&tls->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret == 0)
+    {
+        mbedtls_ssl_conf_authmode(&tls->conf, MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_rng(&tls->conf, randomBytes, nullptr);
+        ret = mbedtls_ssl_setup(&tls->ssl, &tls->conf);
+    }
+    if (ret == 0)
+    {
+        ret = mbedtls_ssl_set_hostname(&tls->ssl, host.c_str());
+    }
+    if (ret != 0)
+    {
+        NLOG_ERROR("AsyncHttpsClient - TLS setup failed: -0x%04x", -ret);
+        fail(ERROR_TLS);
+        return;
+    }
+    mbedtls_ssl_set_bio(&tls->ssl, &fd, sendBio, recvBio, nullptr);
+    state = STATE_HANDSHAKING;
+}
+
+void AsyncHttpsClient::stepHandshake()
+{
+    int ret = mbedtls_ssl_handshake(&tls->ssl);
+    if (ret == 0)
+    {
+        timings.tls_ms = millis() - phase_started;
+        connection_count++;
+        NLOG_DEBUG("AsyncHttpsClient - Connected to %s (connect %lums, TLS %lums)", host.c_str(),
+                   (unsigned long)timings.connect_ms, (unsigned long)timings.tls_ms);
+        state = STATE_IDLE;
+        return;
+    }
+    if (!wouldBlock(ret))
+    {
+        NLOG_ERROR("AsyncHttpsClient - TLS handshake with %s failed: -0x%04x", host.c_str(), -ret);
+        fail(ERROR_TLS);
+        return;
+    }
+    if (millis() - phase_started > CONNECT_TIMEOUT)
+    {
+        fail(ERROR_TIMEOUT);
+    }
+}
+
+void AsyncHttpsClient::stepSend()
+{
+    while (tx_offset < tx.length())
+    {
+        int ret = mbedtls_ssl_write(&tls->ssl, (const unsigned char *)tx.c_str() + tx_offset, tx.length() - tx_offset);
+        if (ret > 0)
+        {
+            tx_offset += ret;
+            continue;
+        }
+        if (!wouldBlock(ret))
+        {
+            fail(ERROR_SEND);
+        }
+        else if (millis() - phase_started > RESPONSE_TIMEOUT)
+        {
+            fail(ERROR_TIMEOUT);
+        }
+        return;
+    }
+
+    timings.request_ms = millis() - phase_started;
+    phase_started = millis();
+    tx = String();
+    state = STATE_RECEIVING;
+}
+
+void AsyncHttpsClient::stepReceive()
+{
+    unsigned char buffer[512];
+    bool closed = false;
+    while (true)
+    {
+        int ret = mbedtls_ssl_read(&tls->ssl, buffer, sizeof(buffer));
+        if (ret > 0)
+        {
+            rx.concat((const char *)buffer, ret);
+            continue;
+        }
+        if (!wouldBlock(ret))
+        {
+            closed = true; // orderly close (0 or close_notify) or a dead session
+        }
+        break;
+    }
+
+    if (parseResponse(closed))
+    {
+        return;
+    }
+    if (closed)
+    {
+        fail(ERROR_RESPONSE);
+    }
+    else if (millis() - phase_started > RESPONSE_TIMEOUT)
+    {
+        fail(ERROR_TIMEOUT);
+    }
+}
+
+// Notice a server closing the idle session, so the next request does not find out the slow way
+void AsyncHttpsClient::checkIdleConnection()
+{
+    if (state != STATE_IDLE)
+    {
+        return;
+    }
+    unsigned char buffer[64];
+    int ret = mbedtls_ssl_read(&tls->ssl, buffer, sizeof(buffer));
+    if (!wouldBlock(ret))
+    {
+        NLOG_DEBUG("AsyncHttpsClient - %s closed the idle session", host.c_str());
+        disconnect();
+    }
+}
+
+void AsyncHttpsClient::disconnect()
+{
+    if (tls)
+    {
+        if (state == STATE_IDLE)
+        {
+            mbedtls_ssl_close_notify(&tls->ssl); // best effort, never waits
+        }
+        mbedtls_ssl_free(&tls->ssl);
+        mbedtls_ssl_config_free(&tls->conf);
+        delete tls;
+        tls = nullptr;
+    }
+    if (fd >= 0)
+    {
+        lwip_close(fd);
+        fd = -1;
+    }
+    state = STATE_DISCONNECTED;
+    tx = String();
+    rx = String();
+}
+
+#endif
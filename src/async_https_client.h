@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <deque>
+#include <mutex>
+
+/**
+ * @brief Non-blocking HTTPS POST client that keeps one TLS session open
+ *
+ * HTTPClient does a TCP connect and a full TLS handshake per request and
+ * blocks the caller until the response is in. This client holds a single
+ * HTTP/1.1 keep-alive connection to one host and is advanced a step at a
+ * time from loop(), so neither the handshake nor a slow response ever
+ * stalls the caller. Requests are answered in order, one at a time.
+ *
+ * post() may be called from any task; the callback always runs from loop().
+ * The host name is resolved once and cached (the lookup itself blocks), and
+ * only looked up again after a failed connect.
+ */
+class AsyncHttpsClient {
+public:
+    // status is the HTTP status code, or one of Error when no response was received
+    typedef std::function<void(int status, const String &body)> response_callback_t;
+
+    enum Error {
+        ERROR_CONNECT = -1,
+        ERROR_TLS = -2,
+        ERROR_SEND = -3,
+        ERROR_RESPONSE = -4,
+        ERROR_TIMEOUT = -5
+    };
+
+    // Per phase wall time of the last request, in ms; connect and TLS are 0 on a reused session
+    struct Timings {
+        uint32_t connect_ms = 0;
+        uint32_t tls_ms = 0;
+        uint32_t request_ms = 0;  // writing the request
+        uint32_t response_ms = 0; // request written until the whole body is in
+        bool reused = false;
+    };
+
+    static const size_t MAX_PENDING = 4;
+    static const unsigned long CONNECT_TIMEOUT = 10000;  // TCP connect plus TLS handshake
+    static const unsigned long RESPONSE_TIMEOUT = 15000; // request written until the whole body is in
+
+    explicit AsyncHttpsClient(const char *host, uint16_t port = 443);
+    ~AsyncHttpsClient();
+
+    AsyncHttpsClient(const AsyncHttpsClient &) = delete;
+    AsyncHttpsClient &operator=(const AsyncHttpsClient &) = delete;
+
+    /**
+     * @brief Queue a POST of a JSON body
+     *
+     * @param path request target, including any query string
+     * @return false if the queue was full; the callback is then not called
+     */
+    bool post(const String &path, const String &body, response_callback_t callback);
+
+    // Advance the connection and the request in flight; returns without waiting on the network
+    void loop();
+
+    // Drop the connection and fail every request in flight or queued with ERROR_CONNECT
+    void stop();
+
+    bool isConnected() const { return state != STATE_DISCONNECTED && state != STATE_CONNECTING && state != STATE_HANDSHAKING; }
+    const Timings &lastTimings() const { return last_timings; }
+    uint32_t connectionCount() const { return connection_count; }
+    uint32_t requestCount() const { return request_count; }
+
+private:
+    enum State {
+        STATE_DISCONNECTED,
+        STATE_CONNECTING,
+        STATE_HANDSHAKING,
+        STATE_IDLE,
+        STATE_SENDING,
+        STATE_RECEIVING
+    };
+
+    struct Request {
+        String path;
+        String body;
+        response_callback_t callback;
+        bool retried = false;
+    };
+
+    struct Tls; // mbedtls contexts, kept out of this header
+
+    bool startConnect();
+    void stepConnect();
+    void stepHandshake();
+    void startRequest();
+    void stepSend();
+    void stepReceive();
+    bool parseResponse(bool closed);
+    void complete(int status, const String &body);
+    void fail(Error error);
+    void disconnect();
+    void checkIdleConnection();
+
+    String host;
+    uint16_t port;
+    uint32_t address = 0; // cached IPv4 address, network byte order; 0 = resolve again
+
+    State state = STATE_DISCONNECTED;
+    Tls *tls = nullptr;
+    int fd = -1;
+    unsigned long phase_started = 0;
+    unsigned long request_started = 0;
+
+    std::mutex pending_mutex;
+    std::deque<Request> pending;
+    Request current;
+    bool in_flight = false;
+
+    String tx;
+    size_t tx_offset = 0;
+    String rx;
+    bool session_reused = false;
+    bool keep_alive = true;
+
+    Timings timings;
+    Timings last_timings;
+    uint32_t connection_count = 0;
+    uint32_t request_count = 0;
+};
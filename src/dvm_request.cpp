@@ -0,0 +1,63 @@
+/**
+ * @file dvm_request.cpp
+ * @brief Single-pass parsing of DVM job requests
+ * @version 0.1
+ * @date 2025-10-14
+ *
+ * Turns a relay EVENT message into a DvmRequest. The event itself is read
+ * by RelayMessageParser as it streams in; only the small "i" tag input is
+ * deserialised here.
+ */
+
+#include "dvm_request.h"
+#include "../lib/logger/logger.h"
+#include "../lib/nostr/codec.h"
+
+bool DvmRequest::fromMessage(RelayMessageParser::Message &message, JsonDocument &doc, DvmRequest &request)
+{
+    if (message.type != RelayMessageParser::MESSAGE_EVENT || !message.has_id || !message.has_pubkey)
+    {
+        NLOG_DEBUG("DvmRequest::fromMessage() - Message does not contain an event");
+        return false;
+    }
+
+    request.id = nostr::hexEncode(message.id, sizeof(message.id));
+    request.pubkey = nostr::hexEncode(message.pubkey, sizeof(message.pubkey));
+    request.kind = message.kind;
+    request.encrypted = message.encrypted;
+    request.input = std::move(message.input);
+    request.raw = std::move(message.raw);
+
+    // The input tag looks like [{"method": "getTemperature", "value": "25"}]
+    request.method = "";
+    request.value = "";
+    if (request.input.length() > 0)
+    {
+        DeserializationError error = deserializeJson(doc, request.input);
+        if (error)
+        {
+            NLOG_ERROR("DvmRequest::fromMessage() - Input tag parsing failed: %s", error.c_str());
+            return true;
+        }
+        request.method = doc[0]["method"] | "";
+        JsonVariant value = doc[0]["value"];
+        if (!value.isNull())
+        {
+            request.value = value.as<String>();
+        }
+    }
+
+    return true;
+}
+
+bool DvmRequest::parse(const char *frame, size_t length, JsonDocument &doc, DvmRequest &request)
+{
+    RelayMessageParser parser;
+    parser.feed((const uint8_t *)frame, length);
+    if (parser.finish() != RelayMessageParser::COMPLETE)
+    {
+        NLOG_ERROR("DvmRequest::parse() - Frame rejected: %s", parser.error());
+        return false;
+    }
+    return fromMessage(parser.message(), doc, request);
+}
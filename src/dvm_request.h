@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "relay_message_parser.h"
+
+/**
+ * @brief A kind-5107 DVM job request, parsed once from the relay frame.
+ *
+ * Everything the pipeline needs (pricing, invoicing, response building and
+ * the payment callback) is extracted here so the event JSON is only
+ * deserialised a single time per request.
+ */
+struct DvmRequest {
+    String id;          // Request event id (hex)
+    String pubkey;      // Requesting client's pubkey (hex)
+    uint16_t kind = 0;  // Event kind
+    String input;       // Raw value of the "i" tag, e.g. [{"method":"getTemperature"}]
+    String method;      // "method" from the input tag
+    String value;       // "value" from the input tag, empty if not given
+    String raw;         // The event object exactly as received, used for the "request" tag; empty if too large
+    bool encrypted = false;
+
+    /**
+     * @brief Build the request from a relay message the streaming parser has completed
+     *
+     * Only the "i" tag input is deserialised, so doc can be small.
+     *
+     * @param message An EVENT message; its input and raw strings are moved out
+     * @param doc Scratch document, reused between requests to avoid heap churn
+     * @param request Populated on success
+     * @return true if the message held an event
+     */
+    static bool fromMessage(RelayMessageParser::Message &message, JsonDocument &doc, DvmRequest &request);
+
+    /**
+     * @brief Parse a whole relay ["EVENT", <sub_id>, {...}] frame
+     *
+     * @param frame Frame payload
+     * @param length Frame length
+     * @param doc Scratch document, reused between requests to avoid heap churn
+     * @param request Populated on success
+     * @return true if the frame held a well-formed event
+     */
+    static bool parse(const char *frame, size_t length, JsonDocument &doc, DvmRequest &request);
+};
@@ -0,0 +1,159 @@
+/**
+ * @file lnbits_response.cpp
+ * @brief Allocation-free extraction of LNbits payment fields
+ * @version 0.1
+ * @date 2025-10-17
+ *
+ * Replaces a DynamicJsonDocument per invoice and per wallet notification,
+ * most of which are for other invoices on the same wallet and only need
+ * their payment_hash looked at.
+ */
+
+#include "lnbits_response.h"
+
+namespace LnbitsResponse {
+
+    static const char *skipWhitespace(const char *p, const char *end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    static bool keyIs(const char *key, size_t length, const char *name)
+    {
+        return strlen(name) == length && memcmp(key, name, length) == 0;
+    }
+
+    bool Field::equals(const char *text) const
+    {
+        return value != nullptr && keyIs(value, length, text);
+    }
+
+    String Field::toString() const
+    {
+        String text;
+        if (value != nullptr)
+        {
+            text.concat(value, length);
+        }
+        return text;
+    }
+
+    bool parse(const char *json, size_t length, Fields &fields)
+    {
+        fields = Fields();
+
+        const char *end = json + length;
+        const char *stringStart = nullptr;
+        Field *pending = nullptr; // field whose string value comes next
+        bool inString = false;
+        bool escaped = false;
+        bool paymentKey = false;  // the last top-level key was "payment"
+        bool inPayment = false;
+        int depth = 0;
+
+        for (const char *p = json; p < end; p++)
+        {
+            char c = *p;
+            if (inString)
+            {
+                if (escaped)
+                {
+                    escaped = false;
+                }
+                else if (c == '\\')
+                {
+                    escaped = true;
+                }
+                else if (c == '"')
+                {
+                    inString = false;
+                    size_t stringLength = p - stringStart;
+                    if (pending != nullptr)
+                    {
+                        pending->value = stringStart;
+                        pending->length = stringLength;
+                        pending = nullptr;
+                        if (fields.payment_hash.value && fields.bolt11.value && fields.status.value)
+                        {
+                            return true;
+                        }
+                        continue;
+                    }
+
+                    const char *colon = skipWhitespace(p + 1, end);
+                    if (colon >= end || *colon != ':')
+                    {
+                        continue;
+                    }
+                    // A key: only those of the top-level or "payment" object are wanted
+                    bool wanted = depth == 1 || (inPayment && depth == 2);
+                    if (depth == 1)
+                    {
+                        paymentKey = keyIs(stringStart, stringLength, "payment");
+                    }
+                    if (!wanted)
+                    {
+                        continue;
+                    }
+                    Field *field = nullptr;
+                    if (keyIs(stringStart, stringLength, "payment_hash"))
+                        field = &fields.payment_hash;
+                    else if (keyIs(stringStart, stringLength, "bolt11"))
+                        field = &fields.bolt11;
+                    else if (keyIs(stringStart, stringLength, "status"))
+                        field = &fields.status;
+
+                    // Only a string value is taken, and a field set earlier stays put
+                    const char *value = skipWhitespace(colon + 1, end);
+                    if (field != nullptr && field->value == nullptr && value < end && *value == '"')
+                    {
+                        pending = field;
+                    }
+                    p = colon;
+                }
+                continue;
+            }
+
+            switch (c)
+            {
+            case '"':
+                inString = true;
+                stringStart = p + 1;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                if (c == '{' && depth == 2 && paymentKey)
+                {
+                    inPayment = true;
+                }
+                break;
+            case '}':
+            case ']':
+                depth--;
+                if (depth < 2)
+                {
+                    inPayment = false;
+                }
+                if (depth <= 0)
+                {
+                    return fields.payment_hash.value != nullptr;
+                }
+                break;
+            case ',':
+                if (depth == 1)
+                {
+                    paymentKey = false;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        return fields.payment_hash.value != nullptr;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Single-pass scanner for the LNbits payment JSON this firmware reads
+ *
+ * Both the invoice creation response ({"payment_hash": ..., "bolt11": ...})
+ * and the wallet websocket notification ({"payment": {..., "status": ...}})
+ * carry the same few fields. They are found in one scan of the raw text,
+ * without a JSON document or any heap allocation. Only keys of the top-level
+ * object or of its "payment" object count, so look-alike keys in "extra" or
+ * other nested objects are ignored.
+ *
+ * Values point into the scanned buffer and are not NUL-terminated.
+ */
+namespace LnbitsResponse {
+    struct Field {
+        const char *value = nullptr;
+        size_t length = 0;
+
+        bool equals(const char *text) const;
+        String toString() const;
+    };
+
+    struct Fields {
+        Field payment_hash;
+        Field bolt11;
+        Field status;
+    };
+
+    // false if the text is not an object with a string payment_hash
+    bool parse(const char *json, size_t length, Fields &fields);
+}
@@ -14,6 +14,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "app.h"
+#include "../lib/logger/logger.h"
 
 // Import Nostr library for memory initialization
 #include "../lib/nostr/nostr.h"
@@ -22,9 +23,7 @@ static const String SOFTWARE_VERSION = "v0.0.1";
 
 // Memory space definitions for Nostr operations to prevent heap fragmentation
 // #define EVENT_NOTE_SIZE 2000000
-// #define ENCRYPTED_MESSAGE_BIN_SIZE 100000
 #define EVENT_NOTE_SIZE 1024 // declare very small to allow use on devices without PSRAM
-#define ENCRYPTED_MESSAGE_BIN_SIZE 1024 // declare very small to allow use on devices without PSRAM
 
 // Remaining global variables that main.cpp still needs
 static unsigned long wifi_connect_start_time = 0;
@@ -70,9 +69,12 @@ void setup(void)
     Serial.println("=== Nostriot Device Starting ===");
     Serial.println("Software Version: " + SOFTWARE_VERSION);
 
+    // Start the log drain task (no-op unless built with NLOG_DEFERRED)
+    Logger::begin();
+
     // Initialize PSRAM memory space for Nostr operations to prevent heap fragmentation
     Serial.println("Initializing Nostr memory space...");
-    nostr::initMemorySpace(EVENT_NOTE_SIZE, ENCRYPTED_MESSAGE_BIN_SIZE);
+    nostr::initMemorySpace(EVENT_NOTE_SIZE);
     Serial.println("Nostr memory space initialized");
 
     // Initialize all application modules through the App coordinator
@@ -1,5 +1,18 @@
 #include "nostr_manager.h"
 #include "payment_provider.h"
+#include "relay_pool.h"
+#include "request_worker.h"
+#include "subscription_cursor.h"
+#include <algorithm>
+#include <deque>
+
+#ifndef NOSTR_RELAY_URIS
+#define NOSTR_RELAY_URIS NOSTR_RELAY_URI
+#endif
+
+#ifndef NOSTR_MAX_RELAY_CONNECTIONS
+#define NOSTR_MAX_RELAY_CONNECTIONS 2 // each TLS session costs tens of KB of RAM
+#endif
 
 namespace NostrManager
 {
@@ -21,29 +34,21 @@ namespace NostrManager
     // service advertisment renewal interval
     const unsigned long ADVERTISEMENT_RENEWAL_INTERVAL = 5 * 60 * 1000;
 
-    // WebSocket client
-    static WebSocketsClient webSocket;
     static unsigned long last_loop_time = 0;
 
     // Status callback
     static signer_status_callback_t status_callback = nullptr;
 
     // Configuration
-    static String relayUrl = "";
-    static String privateKeyHex = "";
-    static String publicKeyHex = "";
+    static String relayUrls = "";
+    static nostr::Signer signer;
     static String secretKey = "";
     static String authorizedClients = "";
 
     // Connection state
     static bool signer_initialized = false;
-    static bool connection_in_progress = false;
     static unsigned long last_connection_attempt = 0;
-    static unsigned long last_ws_ping = 0;
-    static unsigned long last_ws_message_received = 0;
-    static int reconnection_attempts = 0;
-    static unsigned long last_reconnect_attempt = 0;
-    static bool manual_reconnect_needed = false;
+    static size_t connected_relays = 0;
     
     // Subscription management
     static String current_subscription_id = "";
@@ -51,12 +56,23 @@ namespace NostrManager
     static unsigned long last_advertisement_renewal = 0;
 
 
-    // WebSocket fragment management
-    static bool ws_fragment_in_progress = false;
-    static String ws_fragmented_message = "";
-    static size_t ws_fragment_total_size = 0;
-    static size_t ws_fragment_received_size = 0;
-    static unsigned long ws_fragment_start_time = 0;
+    // Relay messages are parsed as their fragments arrive, one parser per relay slot
+    static RelayMessageParser relay_parsers[RelayPool::MAX_RELAYS];
+    static unsigned long fragment_started[RelayPool::MAX_RELAYS];
+
+    // Where the subscription resumes after a reconnect or reboot
+    static SubscriptionCursor subscription_cursor;
+    // Stored events a relay sends after a resuming REQ, held until its last page so they run oldest first
+    static std::vector<RelayMessageParser::Message> catch_up[RelayPool::MAX_RELAYS];
+    static CatchUpPager catch_up_pagers[RelayPool::MAX_RELAYS];
+    // Connected before the clock was set: subscribed live only, to resume once NTP has answered
+    static bool resume_deferred[RelayPool::MAX_RELAYS];
+    // Caught-up events in created_at order, fed to the worker as its queue has room
+    static std::deque<RelayMessageParser::Message> catch_up_backlog;
+    static const size_t CATCH_UP_BUFFER = 2 * SubscriptionCursor::CATCH_UP_LIMIT;
+    // Events were turned away while the buffers or the queue were full; fetch again from the oldest
+    static bool refetch_pending = false;
+    static uint32_t refetch_from = 0;
 
     // NTP time synchronization
     static WiFiUDP ntpUDP;
@@ -64,14 +80,33 @@ namespace NostrManager
     static unsigned long unixTimestamp = 0;
 
     // Memory allocation for JSON documents
-    static const size_t JSON_DOC_SIZE = 100000;
-    static DynamicJsonDocument eventDoc(2048);
-    static DynamicJsonDocument eventParamsDoc(0);
+    // Only small JSON is deserialised now: "i" tag inputs and the capabilities advertisement
+    static const size_t JSON_DOC_SIZE = 4096;
+    static DynamicJsonDocument eventDoc(0);
+
+    // Ids of recently handled events; relays redeliver on REQ renewal and reconnect
+    static SeenEvents seenEvents;
+    static uint32_t duplicate_events = 0; // redeliveries dropped; queue-full drops are RequestWorker::droppedCount()
+
+    static void postToRelays(size_t relay, const String &message);
+    static void dispatchMessage(size_t relay);
+    static bool submitEvent(RelayMessageParser::Message &message);
+    template <typename Buffer>
+    static void bufferEvent(Buffer &buffer, RelayMessageParser::Message &message);
+    static void continueCatchUp(size_t relay, bool closed);
+    static void endCatchUp(size_t relay);
+    static void drainCatchUpBacklog();
+    static void refetchIfDrained();
+    static bool catchingUp();
+    static String subscriptionRequest(const String &filter);
+    static void handleMessage(RelayMessageParser::Message &message);
+    static void handleRequest(const DvmRequest &request);
+    static void handleInvoiceCreated(const DvmRequest &request, const NostriotProvider::PriceQuote &quote, const String &payment_hash, const String &bolt11);
+    static void sendPaymentRequired(const DvmRequest &request, const NostriotProvider::PriceQuote &quote, const String &bolt11);
 
     void updateStatus(bool connected, const char *status)
     {
-        Serial.print("NostrManager Status - ");
-        Serial.println(status);
+        NLOG_INFO("NostrManager Status - %s", status);
         if (status_callback)
         {
             status_callback(connected, status);
@@ -80,11 +115,10 @@ namespace NostrManager
 
     void init()
     {
-        Serial.println("NostrManager::init() - Initializing NostrManager module");
+        NLOG_INFO("NostrManager::init() - Initializing NostrManager module");
 
         // Initialize memory for JSON documents
         eventDoc = DynamicJsonDocument(JSON_DOC_SIZE);
-        eventParamsDoc = DynamicJsonDocument(JSON_DOC_SIZE);
 
         // Load configuration
         loadConfigFromPreferences();
@@ -92,33 +126,53 @@ namespace NostrManager
         // Initialize time client
         timeClient.begin();
 
+        // The last event handled before a reboot comes back with the catch-up; it has been dealt with
+        subscription_cursor.begin();
+        static const uint8_t no_id[8] = {};
+        if (memcmp(subscription_cursor.lastId(), no_id, sizeof(no_id)) != 0)
+        {
+            seenEvents.checkAndInsert(subscription_cursor.lastId());
+        }
+
         NostriotProvider::init();
 
         // Initialize payment provider
         PaymentProvider::init();
-        PaymentProvider::setPaymentCallback([](String payment_hash, String original_event_str, String method, String value) {
-            // Execute the action when payment is confirmed
-            String output = NostriotProvider::run(method, value);
-            String response = getResponseEvent(original_event_str, output);
-            String wrappedResponse = "[\"EVENT\", " + response + "]";
-            
-            Serial.println("NostrManager::paymentCallback() - Sending response: " + wrappedResponse);
-            webSocket.sendTXT(wrappedResponse);
+        PaymentProvider::setPaymentCallback([](const String &payment_hash, const DvmRequest &request, int price) {
+            // Execute the action when payment is confirmed, on the worker; it has been paid for, so it waits for room rather than being dropped
+            RequestWorker::submitOrHold([payment_hash, request, price]() {
+                NLOG_INFO("NostrManager::paymentCallback() - Running %s, paid %d sats as quoted", request.method.c_str(), price);
+                String output = NostriotProvider::run(request.method, request.value);
+                // Recorded before answering, so a restart never repeats the action
+                PaymentProvider::markExecuted(payment_hash);
+                String response = getResponseEvent(request, output);
+                String wrappedResponse = "[\"EVENT\", " + response + "]";
+
+                NLOG_DEBUG("NostrManager::paymentCallback() - Sending response: %s", wrappedResponse.c_str());
+                postToRelays(ALL_RELAYS, wrappedResponse);
+            });
         });
 
+        // Fixed-price methods get an invoice straight from the pool
+        PaymentProvider::setInvoicePoolPrices(NostriotProvider::getFixedPrices());
+
+        // Request handling runs on its own task from here on
+        RequestWorker::init();
+
         signer_initialized = true;
-        Serial.println("NostrManager::init() - NostrManager module initialized");
+        NLOG_INFO("NostrManager::init() - NostrManager module initialized");
     }
 
     void cleanup()
     {
-        Serial.println("NostrManager::cleanup() - Cleaning up NostrManager module");
+        NLOG_INFO("NostrManager::cleanup() - Cleaning up NostrManager module");
 
         disconnect();
         PaymentProvider::cleanup();
+        subscription_cursor.save(true);
         signer_initialized = false;
 
-        Serial.println("NostrManager::cleanup() - NostrManager module cleaned up");
+        NLOG_INFO("NostrManager::cleanup() - NostrManager module cleaned up");
     }
 
     void loadConfigFromPreferences()
@@ -126,81 +180,52 @@ namespace NostrManager
         Preferences prefs;
         prefs.begin("signer", true); // Read-only
 
-        // relayUrl = prefs.getString("relay_url", "wss://relay.nostriot.com");
+        // relayUrls = prefs.getString("relay_url", "wss://relay.nostriot.com");
         // load from config.h for now
-        relayUrl = NOSTR_RELAY_URI;
-        privateKeyHex = NOSTR_PRIVATE_KEY;
-        // derive public key from private key
-        if (privateKeyHex.length() == 64)
+        relayUrls = NOSTR_RELAY_URIS;
+        RelayPool::init(relayUrls, NOSTR_MAX_RELAY_CONNECTIONS);
+        RelayPool::setEventCallback(websocketEvent);
+        // decode the key and derive the public key once; every signature and ECDH reuses it
+        if (!signer.begin(NOSTR_PRIVATE_KEY))
         {
-            try
-            {
-                int byteSize = 32;
-                byte privateKeyBytes[byteSize];
-                fromHex(privateKeyHex, privateKeyBytes, byteSize);
-                PrivateKey privKey(privateKeyBytes);
-                PublicKey pub = privKey.publicKey();
-                publicKeyHex = pub.toString();
-                // remove leading 2 bytes from public key
-                publicKeyHex = publicKeyHex.substring(2);
-            }
-            catch (...)
-            {
-                Serial.println("NostrManager: ERROR - Failed to derive public key");
-            }
+            NLOG_ERROR("NostrManager: ERROR - Invalid private key");
         }
 
         authorizedClients = prefs.getString("auth_clients", "");
 
         prefs.end();
 
-        Serial.println("NostrManager::loadConfigFromPreferences() - Configuration loaded");
-        Serial.println("Relay URL: " + relayUrl);
-        Serial.println("Has private key: " + String(privateKeyHex.length() > 0 ? "Yes" : "No"));
+        NLOG_INFO("NostrManager::loadConfigFromPreferences() - Configuration loaded");
+        NLOG_INFO("Relay URLs: %s", relayUrls.c_str());
+        NLOG_INFO("Has private key: %s", (signer.isValid() ? "Yes" : "No"));
     }
 
     void connectToRelay()
     {
-        if (!signer_initialized || relayUrl.length() == 0)
+        if (!signer_initialized || RelayPool::relayCount() == 0)
         {
-            Serial.println("NostrManager::connectToRelay() - Cannot connect: not initialized or no relay URL");
+            NLOG_WARN("NostrManager::connectToRelay() - Cannot connect: not initialized or no relay URL");
             return;
         }
 
-        if (connection_in_progress)
-        {
-            Serial.println("NostrManager::connectToRelay() - Connection already in progress");
-            return;
-        }
-
-        Serial.println("NostrManager::connectToRelay() - Connecting to relay: " + relayUrl);
-        Serial.println("Connection attempt #" + String(reconnection_attempts + 1) + " of " + String(Config::MAX_RECONNECT_ATTEMPTS));
-
-        connection_in_progress = true;
+        NLOG_INFO("NostrManager::connectToRelay() - Connecting to relays: %s", relayUrls.c_str());
         last_connection_attempt = millis();
 
         // Update status display immediately
         displayConnectionStatus(false);
 
-        // Extract hostname from relay URL (remove wss:// prefix)
-        String hostname = relayUrl;
-        hostname.replace("wss://", "");
-        hostname.replace("ws://", "");
-
-        webSocket.beginSSL(hostname.c_str(), 443, "/");
-        webSocket.onEvent(websocketEvent);
-        webSocket.setReconnectInterval(Config::MIN_RECONNECT_INTERVAL);
+        RelayPool::connect();
 
         updateStatus(false, "Connecting to relay...");
     }
 
     void disconnect()
     {
-        Serial.println("NostrManager::disconnect() - Disconnecting from relay");
-        Serial.println("Connection was active for: " + String((millis() - last_connection_attempt) / 1000) + "s");
+        NLOG_INFO("NostrManager::disconnect() - Disconnecting from relays");
+        NLOG_INFO("Connection was active for: %lus", (millis() - last_connection_attempt) / 1000);
 
-        webSocket.disconnect();
-        connection_in_progress = false;
+        RelayPool::disconnect();
+        connected_relays = 0;
         
         // Reset subscription ID so a new one is created on reconnection
         current_subscription_id = "";
@@ -213,80 +238,151 @@ namespace NostrManager
         updateStatus(false, "Disconnected");
     }
 
-    void websocketEvent(WStype_t type, uint8_t *payload, size_t length)
+    void websocketEvent(size_t relay, WStype_t type, uint8_t *payload, size_t length)
     {
         switch (type)
         {
         case WStype_DISCONNECTED:
-            Serial.println("NostrManager::websocketEvent() - WebSocket Disconnected");
-            connection_in_progress = false;
-
-            // Update status display immediately
-            displayConnectionStatus(false);
-
-            if (reconnection_attempts < Config::MAX_RECONNECT_ATTEMPTS)
+            NLOG_INFO("NostrManager::websocketEvent() - Relay %s disconnected", RelayPool::relayUrl(relay).c_str());
+            relay_parsers[relay].reset();
+            catch_up[relay].clear();
+            catch_up_pagers[relay].cancel();
+            resume_deferred[relay] = false;
+            // RelayPool opens the next best relay in its place
+            connected_relays = RelayPool::connectedCount();
+            if (connected_relays == 0)
             {
-                reconnection_attempts++;
-                Serial.println("NostrManager::websocketEvent() - Scheduling reconnection attempt " + String(reconnection_attempts));
-                manual_reconnect_needed = true;
-
+                displayConnectionStatus(false);
                 updateStatus(false, "Reconnecting...");
             }
-            else
-            {
-                Serial.println("NostrManager::websocketEvent() - Max reconnection attempts reached");
-                updateStatus(false, "Connection failed");
-            }
             break;
 
         case WStype_CONNECTED:
-            Serial.println("NostrManager::websocketEvent() - WebSocket Connected to: " + String((char *)payload));
-            connection_in_progress = false;
-            reconnection_attempts = 0;
-            manual_reconnect_needed = false;
-            last_ws_message_received = millis();
-
-            // Update status display immediately
-            displayConnectionStatus(true);
+            NLOG_INFO("NostrManager::websocketEvent() - Relay %s connected", RelayPool::relayUrl(relay).c_str());
 
-            // Subscribe to NIP-46 events for our public key
-            sendSubscription();
+            // Subscribe, catching up on what was missed, and advertise on this relay; the others already have both
+            sendSubscription(relay, true);
+            last_advertisement_renewal = millis();
+            RequestWorker::submit([relay]() { broadcastCapabilitiesAdvertisement(relay); });
 
-            // Broadcast device capabilities
-            broadcastCapabilitiesAdvertisement();
+            if (connected_relays == 0)
+            {
+                displayConnectionStatus(true);
+                updateStatus(true, "Connected");
 
-            updateStatus(true, "Connected");
+                // Requests paid before a restart can be answered now
+                PaymentProvider::runRecoveredPayments();
+            }
+            connected_relays = RelayPool::connectedCount();
             break;
 
         case WStype_TEXT:
-            Serial.println("NostrManager::websocketEvent() - Received text message");
-            Serial.println((char *) payload);
-            last_ws_message_received = millis();
-            handleWebsocketMessage(nullptr, payload, length);
+            NLOG_DEBUG("NostrManager::websocketEvent() - Received text message");
+            NLOG_TRACE("%.*s", (int)length, (char *)payload);
+            handleWebsocketMessage(relay, payload, length);
             break;
 
         case WStype_BIN:
-            Serial.println("NostrManager::websocketEvent() - Received binary message");
-            last_ws_message_received = millis();
-            handleWebsocketMessage(nullptr, payload, length);
+            NLOG_DEBUG("NostrManager::websocketEvent() - Received binary message");
+            handleWebsocketMessage(relay, payload, length);
             break;
 
-        case WStype_PING:
-            Serial.println("NostrManager::websocketEvent() - Received ping");
-            last_ws_message_received = millis();
+        case WStype_FRAGMENT_TEXT_START:
+        case WStype_FRAGMENT_BIN_START:
+        case WStype_FRAGMENT:
+        case WStype_FRAGMENT_FIN:
+            handleFragment(relay, type, payload, length);
             break;
 
-        case WStype_PONG:
-            Serial.println("NostrManager::websocketEvent() - Received pong");
-            last_ws_message_received = millis();
+        default:
             break;
+        }
+    }
 
-        case WStype_ERROR:
-            Serial.println("NostrManager::websocketEvent() - WebSocket Error");
-            connection_in_progress = false;
-            manual_reconnect_needed = true;
+    void handleWebsocketMessage(size_t relay, uint8_t *data, size_t len)
+    {
+        RelayMessageParser &parser = relay_parsers[relay];
+        parser.reset();
+        parser.feed(data, len);
+        parser.finish();
+        dispatchMessage(relay);
+    }
 
-            updateStatus(false, "Connection error");
+    void handleFragment(size_t relay, WStype_t type, uint8_t *payload, size_t length)
+    {
+        RelayMessageParser &parser = relay_parsers[relay];
+        unsigned long now = millis();
+
+        if (type == WStype_FRAGMENT_TEXT_START || type == WStype_FRAGMENT_BIN_START)
+        {
+            parser.reset();
+            fragment_started[relay] = now;
+        }
+        else if (!parser.started())
+        {
+            // The start was never seen, e.g. it arrived before a reset
+            return;
+        }
+        else if (now - fragment_started[relay] > Config::WS_FRAGMENT_TIMEOUT)
+        {
+            NLOG_WARN("NostrManager::handleFragment() - Fragmented message from %s timed out", RelayPool::relayUrl(relay).c_str());
+            parser.reset();
+            return;
+        }
+
+        // Oversized or unwanted messages are settled here without their remaining fragments being kept
+        parser.feed(payload, length);
+        if (type == WStype_FRAGMENT_FIN)
+        {
+            parser.finish();
+            dispatchMessage(relay);
+            parser.reset();
+        }
+    }
+
+    // Hand a finished EVENT message to the worker, dropping rejects and redeliveries
+    static void dispatchMessage(size_t relay)
+    {
+        RelayMessageParser &parser = relay_parsers[relay];
+        if (parser.status() == RelayMessageParser::REJECTED)
+        {
+            NLOG_WARN("NostrManager::dispatchMessage() - Dropped message from %s: %s", RelayPool::relayUrl(relay).c_str(), parser.error());
+            return;
+        }
+        if (parser.status() != RelayMessageParser::COMPLETE)
+        {
+            return;
+        }
+
+        RelayMessageParser::Message &message = parser.message();
+        switch (message.type)
+        {
+        case RelayMessageParser::MESSAGE_EVENT:
+            // Stored events wait for the catch-up's last page, and live events wait behind the
+            // backlog, so everything runs in order. Ordering only holds per catch-up: a live event
+            // on one relay may still overtake stored events another relay has not sent yet.
+            if (catch_up_pagers[relay].active())
+            {
+                catch_up_pagers[relay].event(message.created_at);
+                bufferEvent(catch_up[relay], message);
+            }
+            else if (!catch_up_backlog.empty())
+            {
+                bufferEvent(catch_up_backlog, message);
+            }
+            else
+            {
+                submitEvent(message);
+            }
+            break;
+
+        case RelayMessageParser::MESSAGE_EOSE:
+        case RelayMessageParser::MESSAGE_CLOSED:
+            // Only one subscription is ever open, so this is the end of its stored events
+            if (catch_up_pagers[relay].active())
+            {
+                continueCatchUp(relay, message.type == RelayMessageParser::MESSAGE_CLOSED);
+            }
             break;
 
         default:
@@ -294,164 +390,353 @@ namespace NostrManager
         }
     }
 
-    void handleWebsocketMessage(void *arg, uint8_t *data, size_t len)
+    // An event was turned away; the next catch-up starts no later than it
+    static void refetchLater(uint32_t created_at)
     {
-        String message = String((char *)data);
+        refetch_pending = true;
+        if (refetch_from == 0 || created_at < refetch_from)
+        {
+            refetch_from = created_at;
+        }
+    }
 
-        if (message.indexOf("EVENT") != -1)
+    /**
+     * @brief Hold an event behind a catch-up, or leave it for a later re-fetch if there is no room
+     *
+     * A full buffer keeps its oldest events. Paging goes back in time, so the
+     * event turned away is whichever of the newcomer and the buffer's newest
+     * is newer; it comes again with the re-fetch.
+     */
+    template <typename Buffer>
+    static void bufferEvent(Buffer &buffer, RelayMessageParser::Message &message)
+    {
+        if (seenEvents.contains(message.id))
+        {
+            duplicate_events++;
+            return;
+        }
+        // Page boundaries and the relays' own redeliveries repeat events
+        for (const auto &held : buffer)
+        {
+            if (memcmp(held.id, message.id, sizeof(held.id)) == 0)
+            {
+                duplicate_events++;
+                return;
+            }
+        }
+        if (buffer.size() < CATCH_UP_BUFFER)
+        {
+            buffer.push_back(std::move(message));
+            return;
+        }
+
+        NLOG_WARN("NostrManager::bufferEvent() - Catch-up buffer full, the newest event will be fetched again");
+        auto newest = std::max_element(buffer.begin(), buffer.end(),
+            [](const RelayMessageParser::Message &a, const RelayMessageParser::Message &b) {
+                return a.created_at < b.created_at;
+            });
+        if (newest->created_at > message.created_at)
+        {
+            refetchLater(newest->created_at);
+            *newest = std::move(message);
+            // The backlog is drained front first and must stay in order
+            std::stable_sort(buffer.begin(), buffer.end(),
+                [](const RelayMessageParser::Message &a, const RelayMessageParser::Message &b) {
+                    return a.created_at < b.created_at;
+                });
+        }
+        else
         {
-            Serial.println("NostrManager::handleWebsocketMessage() - Received signing request");
-            handleEvent(data);
+            refetchLater(message.created_at);
         }
     }
 
-    void handleEvent(uint8_t *data)
+    // Runs on the worker once an event has been handled: only now may the cursor move past it
+    static void finishEvent(uint32_t created_at, const uint8_t id[8])
     {
-        String eventStr = String((char *)data);
-        Serial.println("NostrManager::handleEvent() - Processing event: " + eventStr);
+        uint8_t prefix[8];
+        memcpy(prefix, id, sizeof(prefix));
+        // The cursor belongs to the network loop. If the post is dropped the cursor lags, which only replays
+        RequestWorker::post([created_at, prefix]() { subscription_cursor.advance(created_at, prefix); });
+    }
 
-        // Extract sender public key from the event using nostr library
-        String requestingPubKey = nostr::getSenderPubKeyHex(eventStr);
-        Serial.println("NostrManager::handleEvent() - Requesting pubkey: " + requestingPubKey);
+    // Queue an EVENT for the worker unless it is a redelivery; false if it was not queued
+    static bool submitEvent(RelayMessageParser::Message &message)
+    {
+        // Drop redeliveries before they take a queue slot
+        if (seenEvents.contains(message.id))
+        {
+            duplicate_events++;
+            NLOG_DEBUG("NostrManager::submitEvent() - Duplicate event, ignoring");
+            return false;
+        }
 
-        // if the dataStr has the ["encrypted"] tag then it is encrypted and needs to be decrypted
-        // TODO: implement decryption of i and param tags instead of content property
-        if (eventStr.indexOf("[\"encrypted\"]") >= 0)
-        {
-            Serial.println("NostrManager::handleEvent() - Encrypted DVM requests are not supported yet");
-            // Serial.println("NostrManager::handleEvent() - Event is encrypted, decrypting");
-            // // Determine encryption type (NIP-04 vs NIP-44) and decrypt
-            // String decryptedMessage = "";
-            // if (dataStr.indexOf("?iv=") != -1)
-            // {
-            //     Serial.println("NostrManager::handleEvent() - Using NIP-04 decryption");
-            //     decryptedMessage = nostr::nip04Decrypt(privateKeyHex.c_str(), dataStr);
-            // }
-            // else
-            // {
-            //     Serial.println("NostrManager::handleEvent() - Using NIP-44 decryption");
-            //     decryptedMessage = nostr::nip44Decrypt(privateKeyHex.c_str(), dataStr);
-            // }
-
-            // if (decryptedMessage.length() == 0)
-            // {
-            //     Serial.println("NostrManager::handleEvent() - Failed to decrypt message");
-            //     return;
-            // }
-            // Serial.println("NostrManager::handleEvent() - Decrypted message: " + decryptedMessage);
-            // Parse the decrypted JSON
-            // DeserializationError error = deserializeJson(eventDoc, decryptedMessage);
-            // if (error)
-            // {
-            //     Serial.println("NostrManager::handleEvent() - JSON parsing failed: " + String(error.c_str()));
-            //     return;
-            // }
+        NLOG_DEBUG("NostrManager::submitEvent() - Received signing request");
+        uint32_t created_at = message.created_at;
+        uint8_t id[8];
+        memcpy(id, message.id, sizeof(id));
+        // bind moves the extracted fields into the queued work; the parser is free for the next message
+        if (!RequestWorker::submit(std::bind([created_at, id](RelayMessageParser::Message &event) {
+            handleMessage(event);
+            finishEvent(created_at, id);
+        }, std::move(message))))
+        {
+            // Not remembered, so a redelivery or the re-fetch can still bring it in
+            NLOG_WARN("NostrManager::submitEvent() - Request queue full, event will be fetched again");
+            refetchLater(created_at);
+            return false;
         }
-        else
+        seenEvents.insert(id);
+        return true;
+    }
+
+    // The relay has sent all it has for the current page: fetch the next one or finish
+    static void continueCatchUp(size_t relay, bool closed)
+    {
+        CatchUpPager &pager = catch_up_pagers[relay];
+        if (closed)
+        {
+            // Refused or ended by the relay; the next renewal reopens the subscription
+            NLOG_WARN("NostrManager::continueCatchUp() - %s closed the subscription during catch-up", RelayPool::relayUrl(relay).c_str());
+            pager.cancel();
+            endCatchUp(relay);
+            return;
+        }
+
+        switch (pager.endPage())
+        {
+        case CatchUpPager::PAGE_BACK:
+            NLOG_DEBUG("NostrManager::continueCatchUp() - %s: fetching an older page", RelayPool::relayUrl(relay).c_str());
+            RelayPool::send(relay, subscriptionRequest(pager.filter()));
+            break;
+        case CatchUpPager::REJOIN:
+            NLOG_DEBUG("NostrManager::continueCatchUp() - %s: reopening the live subscription", RelayPool::relayUrl(relay).c_str());
+            RelayPool::send(relay, subscriptionRequest(pager.filter()));
+            break;
+        case CatchUpPager::DONE:
+            endCatchUp(relay);
+            break;
+        }
+    }
+
+    static void endCatchUp(size_t relay)
+    {
+        std::vector<RelayMessageParser::Message> &events = catch_up[relay];
+        NLOG_INFO("NostrManager::endCatchUp() - %s sent %u stored events", RelayPool::relayUrl(relay).c_str(), (unsigned)events.size());
+
+        for (auto &event : events)
+        {
+            catch_up_backlog.push_back(std::move(event));
+        }
+        events.clear();
+        // Relays send stored events newest first; requests should run in the order they were made
+        std::stable_sort(catch_up_backlog.begin(), catch_up_backlog.end(),
+            [](const RelayMessageParser::Message &a, const RelayMessageParser::Message &b) {
+                return a.created_at < b.created_at;
+            });
+        subscription_cursor.caughtUp(unixTimestamp);
+        drainCatchUpBacklog();
+    }
+
+    // Hand the backlog to the worker without overrunning its queue
+    static void drainCatchUpBacklog()
+    {
+        while (!catch_up_backlog.empty() && RequestWorker::queueDepth() < RequestWorker::Config::QUEUE_DEPTH)
         {
-            Serial.println("NostrManager::handleEvent() - Event is not encrypted" + eventStr);
-            // declare a new DynamicJsonDocument with size 2048
-            DynamicJsonDocument doc(2048);
-            DeserializationError error = deserializeJson(doc, eventStr);
-            if (error)
+            RelayMessageParser::Message event = std::move(catch_up_backlog.front());
+            catch_up_backlog.pop_front();
+            submitEvent(event);
+        }
+    }
+
+    static bool catchingUp()
+    {
+        for (size_t i = 0; i < RelayPool::relayCount(); i++)
+        {
+            if (catch_up_pagers[i].active())
             {
-                Serial.println("NostrManager::handleEvent() - JSON parsing failed: " + String(error.c_str()));
-                return;
+                return true;
             }
-                        
         }
-        String method = getRequestMethod(eventStr);
-        String value = getRequestValue(eventStr);
-        Serial.println("NostrManager::handleEvent() - Method: " + method + " with value: " + value);
-        
+        return false;
+    }
+
+    // Ask the relays again for events turned away while the buffers or the queue were full
+    static void refetchIfDrained()
+    {
+        if (!refetch_pending || !catch_up_backlog.empty() || catchingUp())
+        {
+            return;
+        }
+        refetch_pending = false;
+        NLOG_INFO("NostrManager::refetchIfDrained() - Fetching events turned away since created_at %lu", (unsigned long)refetch_from);
+        sendSubscription(ALL_RELAYS, true);
+    }
+
+    void handleEvent(uint8_t *data, size_t length)
+    {
+        NLOG_TRACE("NostrManager::handleEvent() - Processing event: %.*s", (int)length, (char *)data);
+
+        RelayMessageParser parser;
+        parser.feed(data, length);
+        if (parser.finish() != RelayMessageParser::COMPLETE)
+        {
+            NLOG_ERROR("NostrManager::handleEvent() - Frame rejected: %s", parser.error());
+            return;
+        }
+        handleMessage(parser.message());
+    }
+
+    static void handleMessage(RelayMessageParser::Message &message)
+    {
+        // Everything downstream works from the request
+        DvmRequest request;
+        if (!DvmRequest::fromMessage(message, eventDoc, request))
+        {
+            return;
+        }
+        handleRequest(request);
+    }
+
+    static void handleRequest(const DvmRequest &request)
+    {
+        NLOG_DEBUG("NostrManager::handleRequest() - Requesting pubkey: %s", request.pubkey.c_str());
+
+        // if the event has the ["encrypted"] tag then it is encrypted and needs to be decrypted
+        // TODO: implement decryption of i and param tags instead of content property
+        if (request.encrypted)
+        {
+            NLOG_WARN("NostrManager::handleRequest() - Encrypted DVM requests are not supported yet");
+        }
+
+        NLOG_INFO("NostrManager::handleRequest() - Method: %s with value: %s", request.method.c_str(), request.value.c_str());
+
         // Does the provider support this method?
-        if(NostriotProvider::hasCapability(method)) {
-            Serial.println("NostrManager::handleEvent() - Method is supported by provider, handling");
+        if(NostriotProvider::hasCapability(request.method)) {
+            NLOG_DEBUG("NostrManager::handleRequest() - Method is supported by provider, handling");
             
-            int price = NostriotProvider::getPrice(method, value);
-            if (price > 0) {
+            // Priced once: the invoice, the amount tag and the paid request all use this quote
+            NostriotProvider::PriceQuote quote = NostriotProvider::quote(request.method, request.value);
+            if (quote.price > 0) {
                 // PAYMENT REQUIRED FLOW
-                Serial.println("NostrManager::handleEvent() - Payment required, generating invoice");
-                
-                String memo = "IoT Device Service: " + method;
-                String invoice_response = PaymentProvider::createPaymentRequest(price, memo);
-                String payment_hash = PaymentProvider::extractPaymentHashFromResponse(invoice_response);
-                String bolt11 = PaymentProvider::extractBolt11FromResponse(invoice_response);
+                NLOG_INFO("NostrManager::handleRequest() - Payment required, generating invoice");
                 
-                if (payment_hash.length() > 0 && bolt11.length() > 0) {
-                    // Add to payment queue
-                    PaymentProvider::addToPaymentQueue(payment_hash, eventStr, method, value);
-                    
-                    // Send immediate response with invoice
-                    String responseMsg = getPaymentRequiredEvent(eventStr, bolt11);
-                    String wrappedResponse = "[\"EVENT\", " + responseMsg + "]";
-                    Serial.println("NostrManager::handleEvent() - Sending payment required response: " + wrappedResponse);
-                    webSocket.sendTXT(wrappedResponse);
-                } else {
-                    Serial.println("NostrManager::handleEvent() - Failed to generate invoice");
+                String bolt11;
+                PaymentProvider::ClaimResult claim = PaymentProvider::claimPooledInvoice(quote.price, request, bolt11);
+                if (claim == PaymentProvider::CLAIMED) {
+                    sendPaymentRequired(request, quote, bolt11);
+                    return;
+                }
+                if (claim == PaymentProvider::NOT_QUEUED) {
+                    // A fresh invoice would fail to queue the same way
+                    NLOG_WARN("NostrManager::handleRequest() - Rejecting %s, the payment queue cannot take it", request.method.c_str());
+                    return;
+                }
+
+                String memo = "IoT Device Service: " + request.method;
+                // A price that can change is only offered for as long as it holds
+                unsigned long expiry_secs = quote.valid_for / 1000;
+                // The invoice arrives on the network loop; signing the reply goes back to the worker.
+                // The invoice already exists at LNbits, so the reply is held rather than dropped on a full queue.
+                bool queued = PaymentProvider::createPaymentRequest(quote.price, memo, [request, quote](const String &payment_hash, const String &bolt11) {
+                    RequestWorker::submitOrHold([request, quote, payment_hash, bolt11]() {
+                        handleInvoiceCreated(request, quote, payment_hash, bolt11);
+                    });
+                }, expiry_secs);
+                if (!queued) {
+                    NLOG_ERROR("NostrManager::handleRequest() - Failed to generate invoice");
                 }
             } else {
                 // No cost
-                Serial.println("NostrManager::handleEvent() - Free operation, executing immediately");
-                String providerOutput = NostriotProvider::run(method, value);
-                Serial.println("NostrManager::handleEvent() - Provider output: " + providerOutput);
-                String responseMsg = getResponseEvent(eventStr, providerOutput);
+                NLOG_INFO("NostrManager::handleRequest() - Free operation, executing immediately");
+                String providerOutput = NostriotProvider::run(request.method, request.value);
+                NLOG_DEBUG("NostrManager::handleRequest() - Provider output: %s", providerOutput.c_str());
+                String responseMsg = getResponseEvent(request, providerOutput);
                 String wrappedResponse = "[\"EVENT\", " + responseMsg + "]";
-                Serial.println("NostrManager::handleEvent() - Sending response: " + wrappedResponse);
-                webSocket.sendTXT(wrappedResponse);
+                NLOG_TRACE("NostrManager::handleRequest() - Sending response: %s", wrappedResponse.c_str());
+                postToRelays(ALL_RELAYS, wrappedResponse);
             }
         } else {
-            Serial.println("NostrManager::handleEvent() - Method is NOT supported by provider, ignoring");
+            NLOG_WARN("NostrManager::handleRequest() - Method is NOT supported by provider, ignoring");
         }
     }
 
     /**
-     * @brief Get the Nostr DVM payment required message
+     * @brief Queue the request for payment and send the payment required event
      * 
      */
-    String getPaymentRequiredEvent(String &eventStr, String &bolt11) {
-        Serial.println("NostrManager::getDvmPaymentRequiredMessage() - eventStr: " + eventStr);
-        DeserializationError error = deserializeJson(eventDoc, eventStr);
-        if (error)
-        {
-            Serial.println("NostrManager::getDvmPaymentRequiredMessage() - JSON parsing failed: " + String(error.c_str()));
-            throw std::runtime_error("JSON parsing failed");
+    static void handleInvoiceCreated(const DvmRequest &request, const NostriotProvider::PriceQuote &quote, const String &payment_hash, const String &bolt11)
+    {
+        if (payment_hash.length() == 0 || bolt11.length() == 0) {
+            NLOG_ERROR("NostrManager::handleInvoiceCreated() - Failed to generate invoice");
+            return;
         }
 
-        std::map<String, String> tags = nostr::getTags(eventStr);
-        String requestEventStr = eventDoc[2].as<String>();
-        requestEventStr.replace("\"", "\\\"");
-        // fix //" 
-        requestEventStr.replace("\\\\\"", "\\\\\\\"");
+        if (quote.expired(millis())) {
+            NLOG_WARN("NostrManager::handleInvoiceCreated() - Quote for %s ran out before its invoice arrived", request.method.c_str());
+            return;
+        }
 
-        String eventTags = tags["i"];
-        eventTags.replace("\"", "\\\"");
+        // Add to payment queue; an invoice nobody is waiting on is not worth sending
+        if (!PaymentProvider::addToPaymentQueue(payment_hash, request, quote.price)) {
+            return;
+        }
+
+        sendPaymentRequired(request, quote, bolt11);
+    }
 
-        String requestEventId = eventDoc[2]["id"].as<String>();
-        String customerPubKey = eventDoc[2]["pubkey"].as<String>();
+    /**
+     * @brief Send the payment required event for a request already in the payment queue
+     * 
+     */
+    static void sendPaymentRequired(const DvmRequest &request, const NostriotProvider::PriceQuote &quote, const String &bolt11)
+    {
+        String responseMsg = getPaymentRequiredEvent(request, quote, bolt11);
+        String wrappedResponse = "[\"EVENT\", " + responseMsg + "]";
+        NLOG_TRACE("NostrManager::sendPaymentRequired() - Sending payment required response: %s", wrappedResponse.c_str());
+        postToRelays(ALL_RELAYS, wrappedResponse);
+    }
+
+    /**
+     * @brief Build the request/e/i/p tags shared by all DVM responses to a request
+     * 
+     */
+    static String getRequestResponseTags(const DvmRequest &request)
+    {
+        String tags = "[";
+        // A request restored from the pending payment table may no longer have its original event
+        if (request.raw.length() > 0)
+        {
+            tags += "[\"request\",\"";
+            nostr::appendEscaped(tags, request.raw.c_str(), request.raw.length());
+            tags += "\"],";
+        }
+        tags += "[\"e\",\"" + request.id + "\"],[\"i\",\"";
+        nostr::appendEscaped(tags, request.input.c_str(), request.input.length());
+        tags += "\"],[\"p\",\"" + request.pubkey + "\"]";
+        return tags;
+    }
 
-        int price = NostriotProvider::getPrice(getRequestMethod(eventStr), getRequestValue(eventStr));
-        String responseTags = 
-        "["
-            "[\"request\",\"" + requestEventStr + "\"],"
-            "[\"e\",\"" + requestEventId + "\"],"
-            "[\"i\",\"" + eventTags + "\"],"
-            "[\"p\",\"" + customerPubKey + "\"],"
-            "[\"amount\",\"" + String(price) + "\",\"" + bolt11 + "\"]"
+    /**
+     * @brief Get the Nostr DVM payment required message
+     * 
+     */
+    String getPaymentRequiredEvent(const DvmRequest &request, const NostriotProvider::PriceQuote &quote, const String &bolt11) {
+        String responseTags = getRequestResponseTags(request) +
+            ",[\"amount\",\"" + String(quote.price) + "\",\"" + bolt11 + "\"]"
         "]";
 
         // Create response with empty content (payment required)
         String emptyContent = "";
         String responseMsg = nostr::getNote(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             unixTimestamp,
             emptyContent,
             6107,
             responseTags
         );
         
-        Serial.println("NostrManager::getDvmPaymentRequiredMessage() - Payment required message: " + responseMsg);
+        NLOG_TRACE("NostrManager::getDvmPaymentRequiredMessage() - Payment required message: %s", responseMsg.c_str());
         return responseMsg;
     }
 
@@ -459,114 +744,22 @@ namespace NostrManager
      * @brief Get the Nostr DVM response note
      * 
      */
-    String getResponseEvent(String &eventStr, String &responseContent) {
-        Serial.println("NostrManager::getDvmResponseMessage() - eventStr: " + eventStr);
-        DeserializationError error = deserializeJson(eventDoc, eventStr);
-        if (error)
-        {
-            Serial.println("NostrManager::getDvmResponseMessage() - JSON parsing failed: " + String(error.c_str()));
-            throw std::runtime_error("JSON parsing failed");
-        }
-
-        std::map<String, String> tags = nostr::getTags(eventStr);
-        String requestEventStr = eventDoc[2].as<String>();
-        requestEventStr.replace("\"", "\\\"");
-        // fix //" 
-        requestEventStr.replace("\\\\\"", "\\\\\\\"");
-
-        String eventTags = tags["i"];
-        eventTags.replace("\"", "\\\"");
-
-        String responseTags = 
-        "["
-            "[\"request\",\"" + requestEventStr + "\"],"
-            "[\"e\",\"" + eventDoc[2]["id"].as<String>() + "\"],"
-            "[\"i\",\"" + eventTags + "\"],"
-            "[\"p\",\"" + eventDoc[2]["pubkey"].as<String>() + "\"]"
-        "]";
+    String getResponseEvent(const DvmRequest &request, String &responseContent) {
+        String responseTags = getRequestResponseTags(request) + "]";
 
         // now construct the response message
         String responseMsg = nostr::getNote(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             unixTimestamp,
             responseContent,
             6107,
             responseTags
         );
         // Serial print tags
-        Serial.println("NostrManager::getDvmResponseMessage() - Response message: " + responseMsg);
+        NLOG_TRACE("NostrManager::getDvmResponseMessage() - Response message: %s", responseMsg.c_str());
         return responseMsg;
     }
 
-    String getRequestInputTags(String &eventStr) {
-       std::map<String, String> tags = nostr::getTags(eventStr);
-
-        // Serial print tags
-        Serial.println("NostrManager::handleEvent() - Event tags:");
-        for (auto const &tag : tags)
-        {
-            Serial.println("  " + tag.first + ": " + tag.second);
-        }
-        // get the value of the "i" tag
-        String requestInput = tags["i"];
-        
-        Serial.println("NostrManager::handleEvent() - Request input JSON: " + requestInput);
-        return requestInput;
-    }
-
-    /**
-     * @brief Get the Request Method object from the event data's "i" tag
-     * 
-     * @param dataStr 
-     * @return String 
-     */
-    String getRequestMethod(String &eventStr) {
-        String requestInputTagsJson = getRequestInputTags(eventStr);
-        Serial.println("NostrManager::handleEvent() - Request input JSON: " + requestInputTagsJson);
-        // requestInputParts will look like this [{"method": "getTemperature"}]
-        // parse the JSON input
-        DeserializationError error = deserializeJson(eventDoc, requestInputTagsJson);
-        if (error)
-        {
-            Serial.println("NostrManager::handleEvent() - JSON parsing failed: " + String(error.c_str()));
-            throw std::runtime_error("JSON parsing failed");
-        }
-        String method = eventDoc[0]["method"].as<String>();
-        Serial.println("NostrManager::handleEvent() - Method: " + method);
-
-        return method;
-    }
-
-    /**
-     * @brief Get the Request method Value object
-     * 
-     * @param eventStr 
-     * @return String 
-     */
-    String getRequestValue(String &eventStr) {
-        String requestInputTagsJson = getRequestInputTags(eventStr);
-        Serial.println("NostrManager::handleEvent() - Request input JSON: " + requestInputTagsJson);
-        // requestInputParts *might* look like this [{"method": "getTemperature", "value": "25"}]
-        // parse the JSON input
-        DeserializationError error = deserializeJson(eventDoc, requestInputTagsJson);
-        if (error)
-        {
-            Serial.println("NostrManager::handleEvent() - JSON parsing failed: " + String(error.c_str()));
-            throw std::runtime_error("JSON parsing failed");
-        }
-        try {
-            String value = eventDoc[0]["value"].as<String>();
-            Serial.println("NostrManager::handleEvent() - Value: " + value);
-            return value;
-        }
-        catch (...) {
-            Serial.println("NostrManager::handleEvent() - No value provided");
-            return "";
-        }
-
-    }
-
     void handleNip04Encrypt(DynamicJsonDocument &doc, const char *requestingPubKey)
     {
 
@@ -574,20 +767,19 @@ namespace NostrManager
         String thirdPartyPubKey = doc["params"][0];
         String plaintext = doc["params"][1];
 
-        String encryptedMessage = nostr::getCipherText(privateKeyHex.c_str(), thirdPartyPubKey.c_str(), plaintext);
+        String encryptedMessage = nostr::getCipherText(signer, thirdPartyPubKey.c_str(), plaintext);
         String responseMsg = "{\"id\":\"" + requestId + "\",\"result\":\"" + encryptedMessage + "\"}";
 
         String encryptedResponse = nostr::getEncryptedDm(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             requestingPubKey,
             24133,
             unixTimestamp,
             responseMsg,
             "nip04");
 
-        webSocket.sendTXT(encryptedResponse);
-        Serial.println("NostrManager::handleNip04Encrypt() - NIP-04 encryption completed");
+        postToRelays(ALL_RELAYS, encryptedResponse);
+        NLOG_INFO("NostrManager::handleNip04Encrypt() - NIP-04 encryption completed");
     }
 
     void handleNip04Decrypt(DynamicJsonDocument &doc, const char *requestingPubKey)
@@ -597,20 +789,19 @@ namespace NostrManager
         String thirdPartyPubKey = doc["params"][0];
         String cipherText = doc["params"][1];
 
-        String decryptedMessage = nostr::decryptNip04Ciphertext(cipherText, privateKeyHex, thirdPartyPubKey);
+        String decryptedMessage = nostr::decryptNip04Ciphertext(cipherText, signer, thirdPartyPubKey);
         String responseMsg = "{\"id\":\"" + requestId + "\",\"result\":\"" + decryptedMessage + "\"}";
 
         String encryptedResponse = nostr::getEncryptedDm(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             requestingPubKey,
             24133,
             unixTimestamp,
             responseMsg,
             "nip04");
 
-        webSocket.sendTXT(encryptedResponse);
-        Serial.println("NostrManager::handleNip04Decrypt() - NIP-04 decryption completed");
+        postToRelays(ALL_RELAYS, encryptedResponse);
+        NLOG_INFO("NostrManager::handleNip04Decrypt() - NIP-04 decryption completed");
     }
 
     void handleNip44Encrypt(DynamicJsonDocument &doc, const char *requestingPubKey)
@@ -621,20 +812,19 @@ namespace NostrManager
         String plaintext = doc["params"][1];
 
         // Use NIP-44 encryption functions
-        String encryptedMessage = executeEncryptMessageNip44(plaintext, privateKeyHex, thirdPartyPubKey);
+        String encryptedMessage = executeEncryptMessageNip44(plaintext, signer, thirdPartyPubKey);
         String responseMsg = "{\"id\":\"" + requestId + "\",\"result\":\"" + encryptedMessage + "\"}";
 
         String encryptedResponse = nostr::getEncryptedDm(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             requestingPubKey,
             24133,
             unixTimestamp,
             responseMsg,
             "nip44");
 
-        webSocket.sendTXT(encryptedResponse);
-        Serial.println("NostrManager::handleNip44Encrypt() - NIP-44 encryption completed");
+        postToRelays(ALL_RELAYS, encryptedResponse);
+        NLOG_INFO("NostrManager::handleNip44Encrypt() - NIP-44 encryption completed");
     }
 
     void handleNip44Decrypt(DynamicJsonDocument &doc, const char *requestingPubKey)
@@ -645,20 +835,19 @@ namespace NostrManager
         String cipherText = doc["params"][1];
 
         // Use NIP-44 decryption functions
-        String decryptedMessage = executeDecryptMessageNip44(cipherText, privateKeyHex, thirdPartyPubKey);
+        String decryptedMessage = executeDecryptMessageNip44(cipherText, signer, thirdPartyPubKey);
         String responseMsg = "{\"id\":\"" + requestId + "\",\"result\":\"" + decryptedMessage + "\"}";
 
         String encryptedResponse = nostr::getEncryptedDm(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             requestingPubKey,
             24133,
             unixTimestamp,
             responseMsg,
             "nip44");
 
-        webSocket.sendTXT(encryptedResponse);
-        Serial.println("NostrManager::handleNip44Decrypt() - NIP-44 decryption completed");
+        postToRelays(ALL_RELAYS, encryptedResponse);
+        NLOG_INFO("NostrManager::handleNip44Decrypt() - NIP-44 decryption completed");
     }
 
     void processLoop()
@@ -667,29 +856,43 @@ namespace NostrManager
         timeClient.update();
         unixTimestamp = timeClient.getEpochTime();
 
-        // Process WebSocket events
-        webSocket.loop();
+        // Process relay connections: pings, health checks and replacing dropped relays
+        RelayPool::loop();
         
         // Process payment provider
         PaymentProvider::processLoop();
 
-        // Send periodic ping
+        // Send whatever the request worker has produced
+        RequestWorker::poll();
+
+        // Catch-up events go to the worker as its queue has room
+        drainCatchUpBacklog();
+        refetchIfDrained();
+        subscription_cursor.save();
+
         unsigned long now = millis();
-        if (now - last_ws_ping > Config::WS_PING_INTERVAL)
-        {
-            sendPing();
-            last_ws_ping = now;
-        }
 
         if (isConnected())
         {
+            // Relays that connected before NTP answered can catch up now
+            if (unixTimestamp >= SubscriptionCursor::MIN_VALID_TIME)
+            {
+                for (size_t i = 0; i < RelayPool::relayCount(); i++)
+                {
+                    if (resume_deferred[i] && RelayPool::isRelayConnected(i))
+                    {
+                        sendSubscription(i, true);
+                    }
+                }
+            }
             if((now - last_subscription_renewal > SUBSCRIPTION_RENEWAL_INTERVAL)) {
-                Serial.println("NostrManager::processLoop() - Renewing subscription to maintain connection");
+                NLOG_DEBUG("NostrManager::processLoop() - Renewing subscription to maintain connection");
                 sendSubscription();
             }
             if((now - last_advertisement_renewal > ADVERTISEMENT_RENEWAL_INTERVAL)) {
-                Serial.println("NostrManager::processLoop() - Renewing advertisement to maintain connection");
-                broadcastCapabilitiesAdvertisement();
+                NLOG_DEBUG("NostrManager::processLoop() - Renewing advertisement to maintain connection");
+                last_advertisement_renewal = now;
+                RequestWorker::submit([]() { broadcastCapabilitiesAdvertisement(); });
             }
         }
 
@@ -708,65 +911,66 @@ namespace NostrManager
         {
             if (isConnected())
             {
-                Serial.println("NostrManager::processLoop() - Connection healthy. Last message: " + String((now - last_ws_message_received) / 1000) + "s ago");
+                NLOG_DEBUG("NostrManager::processLoop() - Connection healthy. Relays: %s", RelayPool::connectedRelayUrls().c_str());
             }
             else
             {
-                Serial.println("NostrManager::processLoop() - Not connected. Manual reconnect needed: " + String(manual_reconnect_needed ? "Yes" : "No"));
+                NLOG_DEBUG("NostrManager::processLoop() - Not connected to any relay");
+            }
+            for (size_t i = 0; i < RelayPool::relayCount(); i++)
+            {
+                NLOG_DEBUG("NostrManager::processLoop() - %s rtt: %lums", RelayPool::relayUrl(i).c_str(), (unsigned long)RelayPool::relayRtt(i));
             }
+            NLOG_DEBUG("NostrManager::processLoop() - ECDH cache hits: %lu, misses: %lu",
+                       (unsigned long)signer.conversationCache().hits(), (unsigned long)signer.conversationCache().misses());
+            NLOG_DEBUG("NostrManager::processLoop() - Pending payments: %u", (unsigned)PaymentProvider::pendingPaymentCount());
+            NLOG_DEBUG("NostrManager::processLoop() - Request queue depth: %u (max %u), held: %u, processed: %lu, dropped: %lu, replies dropped: %lu",
+                       (unsigned)RequestWorker::queueDepth(), (unsigned)RequestWorker::maxQueueDepth(), (unsigned)RequestWorker::heldCount(),
+                       (unsigned long)RequestWorker::processedCount(), (unsigned long)RequestWorker::droppedCount(),
+                       (unsigned long)RequestWorker::droppedPostCount());
+            NLOG_DEBUG("NostrManager::processLoop() - Duplicate events dropped: %lu, catch-up backlog: %u, cursor: %lu",
+                       (unsigned long)duplicate_events, (unsigned)catch_up_backlog.size(), (unsigned long)subscription_cursor.position());
             last_debug_log = now;
         }
 
-        // Check connection health
-        if (isConnected() && (now - last_ws_message_received > Config::CONNECTION_TIMEOUT))
+        // Every relay has failed repeatedly: give up and reboot the device
+        if (RelayPool::exhausted())
         {
-            Serial.println("NostrManager::processLoop() - Connection timeout detected");
-            Serial.println("Last message received: " + String((now - last_ws_message_received) / 1000) + "s ago");
-            disconnect();
-            manual_reconnect_needed = true;
+            NLOG_WARN("NostrManager::processLoop() - Max reconnection attempts reached on every relay, giving up");
+            updateStatus(false, "Connection failed permanently");
+            // Write out the payment journal and the cursor first: batched journal inserts
+            // would otherwise be lost with unpaid invoices still out there
+            cleanup();
+            ESP.restart();
         }
+    }
 
-        // Handle manual reconnection with exponential backoff
-        if (manual_reconnect_needed && !connection_in_progress && !isConnected())
+    /**
+     * @brief Send to one relay, or to all of them when relay is ALL_RELAYS
+     */
+    static void sendToRelays(size_t relay, const String &message)
+    {
+        if (relay == ALL_RELAYS)
         {
-            unsigned long backoff_delay = Config::MIN_RECONNECT_INTERVAL * (1 << min(reconnection_attempts, 5)); // Cap at 32x base interval
-
-            if (now - last_reconnect_attempt >= backoff_delay)
-            {
-                if (reconnection_attempts < Config::MAX_RECONNECT_ATTEMPTS)
-                {
-                    Serial.println("NostrManager::processLoop() - Attempting manual reconnection #" + String(reconnection_attempts + 1));
-                    Serial.println("Backoff delay was: " + String(backoff_delay) + "ms");
-
-                    connectToRelay();
-                    last_reconnect_attempt = now;
-                    reconnection_attempts++;
-                }
-                else
-                {
-                    Serial.println("NostrManager::processLoop() - Max reconnection attempts reached, giving up");
-                    // reboot the device
-                    ESP.restart();
-                    manual_reconnect_needed = false;
-                    reconnection_attempts = 0;
-
-                    // Update status display immediately
-                    displayConnectionStatus(false);
-
-                    updateStatus(false, "Connection failed permanently");
-                }
-            }
+            RelayPool::publish(message);
+        }
+        else
+        {
+            RelayPool::send(relay, message);
         }
     }
 
-    void sendSubscription()
+    /**
+     * @brief Hand a message from the request worker to the network loop for sending
+     */
+    static void postToRelays(size_t relay, const String &message)
     {
-        if (!isConnected() || publicKeyHex.length() == 0)
-        {
-            Serial.println("NostrManager::sendSubscription() - Cannot send subscription: not connected or no public key");
-            return;
-        }
+        RequestWorker::post([relay, message]() { sendToRelays(relay, message); });
+    }
 
+    // The job request REQ with filter fields from SubscriptionCursor::pageFilter()
+    static String subscriptionRequest(const String &filter)
+    {
         // Create subscription ID if we don't have one
         if (current_subscription_id.length() == 0)
         {
@@ -778,21 +982,66 @@ namespace NostrManager
         }
 
         String nostrIotDvmJobRequestIds = "[5107,9735]";
-        String subscription = "[\"REQ\", \"" + current_subscription_id + "\", {\"kinds\":" + nostrIotDvmJobRequestIds + ", \"#p\":[\"" + publicKeyHex + "\"], \"limit\":0}]";
-        webSocket.sendTXT(subscription);
+        return "[\"REQ\", \"" + current_subscription_id + "\", {\"kinds\":" + nostrIotDvmJobRequestIds + ", \"#p\":[\"" + signer.publicKeyHex() + "\"]" + filter + "}]";
+    }
+
+    void sendSubscription(size_t relay, bool resume)
+    {
+        if (!isConnected() || !signer.isValid())
+        {
+            NLOG_WARN("NostrManager::sendSubscription() - Cannot send subscription: not connected or no public key");
+            return;
+        }
+
+        // How far back to go needs the time of day; without it subscribe live and resume once NTP answers
+        bool clock_valid = unixTimestamp >= SubscriptionCursor::MIN_VALID_TIME;
+        uint32_t from = resume && clock_valid ? subscription_cursor.resumeFrom(unixTimestamp, refetch_from) : 0;
+        String live = subscriptionRequest(SubscriptionCursor::pageFilter(0));
+
+        for (size_t i = 0; i < RelayPool::relayCount(); i++)
+        {
+            // Only relays with an open session; a relay connecting later subscribes from websocketEvent()
+            if ((relay != ALL_RELAYS && relay != i) || !RelayPool::isRelayConnected(i))
+            {
+                continue;
+            }
+            if (resume && !clock_valid)
+            {
+                resume_deferred[i] = true;
+            }
+            if (from != 0)
+            {
+                // A resuming REQ first gets the stored events since the cursor, a page at a time, ended by EOSE
+                resume_deferred[i] = false;
+                catch_up[i].clear();
+                catch_up_pagers[i].begin(from);
+                RelayPool::send(i, subscriptionRequest(catch_up_pagers[i].filter()));
+            }
+            else if (!catch_up_pagers[i].active())
+            {
+                // A renewal must not replace a catch-up page
+                RelayPool::send(i, live);
+            }
+        }
+        if (resume && clock_valid)
+        {
+            refetch_from = 0;
+        }
         last_subscription_renewal = millis();
-        Serial.println("NostrManager::sendSubscription() - Sent subscription: " + subscription);
+        NLOG_DEBUG("NostrManager::sendSubscription() - Sent %s subscription%s", from != 0 ? "resuming" : "live",
+                   resume && !clock_valid ? ", resuming once the clock is set" : "");
     }
 
-    void broadcastCapabilitiesAdvertisement()
+    // Runs on the request worker: it shares eventDoc and the signer with handleEvent
+    void broadcastCapabilitiesAdvertisement(size_t relay)
     {
-        if (!isConnected() || publicKeyHex.length() == 0)
+        if (!signer.isValid())
         {
-            Serial.println("NostrManager::broadcastCapabilities() - Cannot broadcast: not connected or no public key");
+            NLOG_WARN("NostrManager::broadcastCapabilities() - Cannot broadcast: no public key");
             return;
         }
 
-        Serial.println("NostrManager::broadcastCapabilities() - Broadcasting device capabilities");
+        NLOG_INFO("NostrManager::broadcastCapabilities() - Broadcasting device capabilities");
         
         // Get the unsigned event from provider
         String unsignedEventJson = NostriotProvider::getCapabilitiesAdvertisement();
@@ -801,7 +1050,7 @@ namespace NostrManager
         DeserializationError error = deserializeJson(eventDoc, unsignedEventJson);
         if (error)
         {
-            Serial.println("NostrManager::broadcastCapabilities() - JSON parsing failed: " + String(error.c_str()));
+            NLOG_ERROR("NostrManager::broadcastCapabilities() - JSON parsing failed: %s", error.c_str());
             return;
         }
         
@@ -811,8 +1060,7 @@ namespace NostrManager
         
         // Sign and create the event using nostr::getNote
         String signedEvent = nostr::getNote(
-            privateKeyHex.c_str(),
-            publicKeyHex.c_str(),
+            signer,
             unixTimestamp,
             content,
             kind,
@@ -821,26 +1069,12 @@ namespace NostrManager
         
         // Wrap and send the event
         String wrappedEvent = "[\"EVENT\", " + signedEvent + "]";
-        webSocket.sendTXT(wrappedEvent);
-        last_advertisement_renewal = millis();
+        postToRelays(relay, wrappedEvent);
         
-        Serial.println("NostrManager::broadcastCapabilities() - Sent capabilities advertisement: " + wrappedEvent);
+        NLOG_TRACE("NostrManager::broadcastCapabilities() - Sent capabilities advertisement: %s", wrappedEvent.c_str());
     }
 
 
-    void sendPing()
-    {
-        if (isConnected())
-        {
-            Serial.println("NostrManager::sendPing() - Sending ping to relay");
-            webSocket.sendPing();
-        }
-        else
-        {
-            Serial.println("NostrManager::sendPing() - Cannot send ping: not connected");
-        }
-    }
-
     bool isInitialized()
     {
         return signer_initialized;
@@ -848,16 +1082,16 @@ namespace NostrManager
 
     bool isConnected()
     {
-        return webSocket.isConnected();
+        return RelayPool::isConnected();
     }
 
     void displayConnectionStatus(bool connected)
     {
-        Serial.println("NostrManager::displayConnectionStatus() - Connection status: " + String(connected ? "Connected" : "Disconnected"));
+        NLOG_DEBUG("NostrManager::displayConnectionStatus() - Connection status: %s", (connected ? "Connected" : "Disconnected"));
     }
 
     // Getters
-    String getRelayUrl() { return relayUrl; }
+    String getRelayUrl() { return RelayPool::connectedRelayUrls(); }
 
     void setStatusCallback(signer_status_callback_t callback)
     {
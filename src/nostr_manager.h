@@ -10,13 +10,16 @@
 #include <algorithm>
 
 #include "settings.h"
-#include "app.h"
 #include "display.h"
 #include "config.h"
 #include "nostriot_provider.h"
+#include "dvm_request.h"
+#include "seen_events.h"
 
 // Import Nostr library components from lib/ folder
+#include "../lib/logger/logger.h"
 #include "../lib/nostr/nostr.h"
+#include "../lib/nostr/event_serializer.h"
 #include "../lib/nostr/nip44/nip44.h"
 #include "../lib/nostr/nip19.h"
 
@@ -38,20 +41,21 @@ namespace NostrManager {
 
     void displayConnectionStatus(bool connected);
     
-    // WebSocket event handling
-    void websocketEvent(WStype_t type, uint8_t* payload, size_t length);
-    void handleWebsocketMessage(void* arg, uint8_t* data, size_t len);
-    void resetWebsocketFragmentState();
+    // WebSocket event handling, for the relay at index relay in the pool
+    void websocketEvent(size_t relay, WStype_t type, uint8_t* payload, size_t length);
+    // A whole message, or one fragment of a message split across WebSocket frames
+    void handleWebsocketMessage(size_t relay, uint8_t* data, size_t len);
+    void handleFragment(size_t relay, WStype_t type, uint8_t* payload, size_t length);
 
-    void sendSubscription();
-    void broadcastCapabilitiesAdvertisement();
+    // relay: index in the relay pool, or ALL_RELAYS
+    const size_t ALL_RELAYS = (size_t)-1;
+    // resume: ask for what was missed since the last event handled, not just new events
+    void sendSubscription(size_t relay = ALL_RELAYS, bool resume = false);
+    void broadcastCapabilitiesAdvertisement(size_t relay = ALL_RELAYS);
     
-    // handlers
-    void handleEvent(uint8_t* data);
-    String getRequestMethod(String &dataStr);
-    String getRequestValue(String &dataStr);
-    String getRequestInputTags(String &dataStr);
-    String getResponseEvent(String &eventStr, String &responseContent);
+    // handlers, run on the request worker task; replies go back through RequestWorker::post
+    void handleEvent(uint8_t* data, size_t length);
+    String getResponseEvent(const DvmRequest &request, String &responseContent);
     void handleNip04Encrypt(DynamicJsonDocument& doc, const char* requestingPubKey);
     void handleNip04Decrypt(DynamicJsonDocument& doc, const char* requestingPubKey);
     void handleNip44Encrypt(DynamicJsonDocument& doc, const char* requestingPubKey);
@@ -60,26 +64,16 @@ namespace NostrManager {
     
     // Connection monitoring
     void processLoop();
-    void sendPing();
     void updateConnectionStatus();
 
-    String getPaymentRequiredEvent(String& eventStr, String& bolt11);
-    
-    // Fragment handling
-    bool isFragmentInProgress();
-    void handleFragment(uint8_t* payload, size_t length, bool isBinary, bool isLast);
+    String getPaymentRequiredEvent(const DvmRequest &request, const NostriotProvider::PriceQuote &quote, const String &bolt11);
         
     // Event signing UI callbacks
     typedef void (*signing_confirmation_callback_t)(bool approved);
     
     // Constants
     namespace Config {
-        const unsigned long WS_PING_INTERVAL = 5000; // 10 seconds
         const unsigned long WS_FRAGMENT_TIMEOUT = 30000; // 30 seconds
-        const size_t WS_MAX_FRAGMENT_SIZE = 1024 * 1024; // 1MB
-        const unsigned long CONNECTION_TIMEOUT = 30000; // 30 seconds
-        const int MAX_RECONNECT_ATTEMPTS = 10;
-        const unsigned long MIN_RECONNECT_INTERVAL = 5000; // 5 seconds
     }
     
     // NIP-46 Methods
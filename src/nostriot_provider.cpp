@@ -12,83 +12,253 @@
  */
 
 #include "nostriot_provider.h"
+#include "perfect_hash.h"
+#include "sensor_sampler.h"
+#include "../lib/logger/logger.h"
 
 namespace NostriotProvider
 {
     const static String SERVICE_NAME = "ESP32C3 Supermini IoT Device";
     const static String SERVICE_DESCRIPTION = "A test device for Nostriot IoT functionality";
-    // Device capabilities and pricing
+
+    const unsigned long QUOTE_VALIDITY = 5 * 60 * 1000; // 5 minutes, the time a payer has to pay
+
+    // Sampled in the background; requests are answered from the latest sample
+    const unsigned long CLIMATE_SAMPLE_INTERVAL = 5000; // ms
+    // Charged for setTemperature while there is no reading to price the change from
+    const int UNKNOWN_TEMPERATURE_PRICE = 10;
+
+    enum ClimateChannel
+    {
+        CLIMATE_TEMPERATURE,
+        CLIMATE_HUMIDITY,
+        CLIMATE_CHANNELS
+    };
+
+    static int climate_sensor = -1;
+
+    boolean vacuumIsRunning = false;
+
+    /**
+     * @brief One read of the climate sensor: temperature and humidity together
+     *
+     * @return bool false if the sensor did not answer
+     */
+    static bool readClimate(float *values)
+    {
+        // TODO: get real data
+        // return a fake temperature for now between 5 and 15 degrees C
+        values[CLIMATE_TEMPERATURE] = random(50, 150) / 10.0;
+        // and a fake humidity between 30 and 70%
+        values[CLIMATE_HUMIDITY] = random(30, 70);
+        return true;
+    }
+
+    /**
+     * @brief Latest climate reading for a read request
+     *
+     * @param value Optional maxAge: the oldest reading, in seconds, the requester will take
+     * @return bool false if there is no reading that recent
+     */
+    static bool latestClimate(ClimateChannel channel, const String &value, SensorSampler::Reading &reading)
+    {
+        unsigned long max_age_ms = value.length() > 0 ? (unsigned long)(value.toFloat() * 1000) : 0;
+        return SensorSampler::latest(climate_sensor, channel, reading, max_age_ms);
+    }
+
+    static String noReading(const char *quantity, const String &value)
+    {
+        if (value.length() == 0)
+        {
+            return "No " + String(quantity) + " reading yet";
+        }
+        return "No " + String(quantity) + " reading within " + value + " seconds";
+    }
+
+    // Handlers: take the request value, return the job result
+    static String runGetTemperature(const String &value)
+    {
+        SensorSampler::Reading reading;
+        if (!latestClimate(CLIMATE_TEMPERATURE, value, reading))
+        {
+            return noReading("temperature", value);
+        }
+        return String(reading.value);
+    }
+
+    static String runVacuum(const String &value)
+    {
+        vacuumIsRunning = !vacuumIsRunning;
+        NLOG_INFO("NostriotProvider::runVacuum() - Vacuum is now %s", (vacuumIsRunning ? "running" : "stopped"));
+        return String(vacuumIsRunning ? "Vacuum started" : "Vacuum stopped");
+    }
+
+    static String runGetHumidity(const String &value)
+    {
+        SensorSampler::Reading reading;
+        if (!latestClimate(CLIMATE_HUMIDITY, value, reading))
+        {
+            return noReading("humidity", value);
+        }
+        return String((int)reading.value);
+    }
+
+    static String runSetTemperature(const String &value)
+    {
+        // pretend to set a temperature
+        NLOG_INFO("NostriotProvider::setTemperature() - Setting temperature to %s degrees C", value.c_str());
+        return "Temperature set to " + value + " degrees C";
+    }
+
+    // Pricing: fill in the quote for a request with the given value
+    template <int SATS>
+    static void fixedPrice(const String &value, PriceQuote &quote)
+    {
+        quote.price = SATS;
+    }
+
+    static void setTemperaturePrice(const String &value, PriceQuote &quote)
+    {
+        quote.reading = getCurrentTemperature();
+        quote.valid_for = QUOTE_VALIDITY;
+        if (isnan(quote.reading))
+        {
+            NLOG_WARN("NostriotProvider::setTemperaturePrice() - No temperature reading, charging %d sats", UNKNOWN_TEMPERATURE_PRICE);
+            quote.price = UNKNOWN_TEMPERATURE_PRICE;
+            return;
+        }
+        quote.price = getSetTemperaturePrice(value.toFloat(), quote.reading);
+    }
+
+    // Price depends on the request value, so it cannot be pre-invoiced
+    static const uint8_t CAPABILITY_VARIABLE_PRICE = 1 << 0;
+
+    // Method ids are kept in the payment journal in place of names, so they must
+    // stay put: add new methods at the end and never renumber.
+    enum MethodId : uint8_t
+    {
+        METHOD_RUN_VACUUM,
+        METHOD_GET_TEMPERATURE,
+        METHOD_GET_HUMIDITY,
+        METHOD_SET_TEMPERATURE
+    };
+
     struct Capability
     {
-        String name;
-        int price;
+        const char *name;
+        MethodId id;
+        void (*price)(const String &value, PriceQuote &quote);
+        String (*run)(const String &value);
+        uint8_t flags;
     };
 
-    static const std::vector<Capability> capabilities_with_pricing = {
-        {"runVacuum", 10},
+    // Device capabilities, in method id order
+    static constexpr Capability CAPABILITIES[] = {
+        {"runVacuum", METHOD_RUN_VACUUM, fixedPrice<10>, runVacuum, 0},
+        {"getTemperature", METHOD_GET_TEMPERATURE, fixedPrice<0>, runGetTemperature, 0},
+        {"getHumidity", METHOD_GET_HUMIDITY, fixedPrice<0>, runGetHumidity, 0},
+        {"setTemperature", METHOD_SET_TEMPERATURE, setTemperaturePrice, runSetTemperature, CAPABILITY_VARIABLE_PRICE},
     };
 
+    static constexpr size_t CAPABILITY_COUNT = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+    static constexpr bool idsInOrder(size_t i = 0)
+    {
+        return i >= CAPABILITY_COUNT || (CAPABILITIES[i].id == i && idsInOrder(i + 1));
+    }
+    static_assert(idsInOrder(), "CAPABILITIES must be listed in method id order");
+
+    // Name lookup: a perfect hash found by the compiler, so one probe per lookup
+    static constexpr size_t CAPABILITY_SLOTS = 16;
+    static constexpr uint32_t CAPABILITY_SEED = PerfectHash::findSeed(CAPABILITIES, CAPABILITY_SLOTS);
+    static constexpr PerfectHash::Index<CAPABILITY_SLOTS> CAPABILITY_INDEX = PerfectHash::build<CAPABILITY_SLOTS>(CAPABILITIES, CAPABILITY_SEED);
+
+    static const Capability *findCapability(const String &name)
+    {
+        size_t slot = PerfectHash::slot(name.c_str(), name.length(), CAPABILITY_SEED, CAPABILITY_SLOTS - 1);
+        int index = CAPABILITY_INDEX.owner[slot];
+        if (index < 0 || strlen(CAPABILITIES[index].name) != name.length() || strcmp(CAPABILITIES[index].name, name.c_str()) != 0)
+        {
+            return nullptr;
+        }
+        return &CAPABILITIES[index];
+    }
+
     void init()
     {
         // set up the sensor or whatever is needed here
+        climate_sensor = SensorSampler::addSensor("climate", CLIMATE_CHANNELS, CLIMATE_SAMPLE_INTERVAL, readClimate);
+        SensorSampler::init();
     }
 
     /**
-     * @brief Get the Capabilities object
+     * @brief Does the provider have the given capability?
      *
-     * @param count
-     * @return String*
      */
-    String *
-    getCapabilities(int &count)
+    bool hasCapability(const String &capability)
+    {
+        return findCapability(capability) != nullptr;
+    }
+
+    /**
+     * @brief Method id of a capability, a compact stand-in for its name
+     *
+     * @return int index, or -1 if the capability is unknown
+     */
+    int getCapabilityIndex(const String &capability)
+    {
+        const Capability *cap = findCapability(capability);
+        return cap ? cap->id : -1;
+    }
+
+    String getCapabilityName(int index)
     {
-        count = capabilities_with_pricing.size();
-        String *caps = new String[count];
-        for (int i = 0; i < count; i++)
+        if (index < 0 || index >= (int)CAPABILITY_COUNT)
         {
-            caps[i] = capabilities_with_pricing[i].name;
+            return "";
         }
-        return caps;
+        return CAPABILITIES[index].name;
     }
 
     /**
-     * @brief Does the provider have the given capability?
+     * @brief Price a request once; the quote is what gets invoiced, advertised and paid
      *
+     * @return PriceQuote Price 0 if the method is free or unknown
      */
-    bool hasCapability(const String &capability)
+    PriceQuote quote(const String &method, const String &value)
     {
-        int count = 0;
-        String *capabilities = getCapabilities(count);
-        for (int i = 0; i < count; i++)
+        PriceQuote result;
+        result.quoted_at = millis();
+        const Capability *cap = findCapability(method);
+        if (cap)
         {
-            if (capabilities[i] == capability)
-            {
-                return true;
-            }
+            cap->price(value, result);
         }
-        return false;
+        return result;
     }
 
     /**
-     * @brief Get the Price Per Request object
+     * @brief Prices of the capabilities whose price does not depend on the request
      *
-     * @param method
-     * @return int Price in sats, or 0 if free or unknown
+     * @return std::vector<int> Prices in sats, free capabilities left out
      */
-    int getPrice(const String &method, const String &value)
+    std::vector<int> getFixedPrices()
     {
-        if(method == "setTemperature") {
-            // variable pricing based on target temperature
-            return getSetTemperaturePrice(value.toFloat());
-        }
-        for (const auto &cap : capabilities_with_pricing)
+        std::vector<int> prices;
+        for (const Capability &cap : CAPABILITIES)
         {
-            if (cap.name == method)
+            if (cap.flags & CAPABILITY_VARIABLE_PRICE)
+            {
+                continue;
+            }
+            PriceQuote fixed;
+            cap.price("", fixed);
+            if (fixed.price > 0)
             {
-                return cap.price;
+                prices.push_back(fixed.price);
             }
         }
-        return 0; 
+        return prices;
     }
 
     /**
@@ -96,20 +266,27 @@ namespace NostriotProvider
      * 
      * @return int 
      */
-    int getSetTemperaturePrice(float targetTemp) {
+    int getSetTemperaturePrice(float targetTemp, float currentTemp) {
         // we determine the cost based on a temperature difference between current and requested temperature
-        float currentTemp = getCurrentTemperature();
         float diff = fabs(targetTemp - currentTemp);
         // calc based on price of 1 sat per degree C difference, rounded up
         int price = (int)ceil(diff * 1.0);
-        Serial.println("NostriotProvider::getSetTemperaturePrice() - Current temp: " + String(currentTemp) + "C, Target temp: " + String(targetTemp) + ", Diff: " + String(diff) + "C, Price: " + String(price) + " sats");
+        NLOG_DEBUG("NostriotProvider::getSetTemperaturePrice() - Current temp: %.2fC, Target temp: %.2f, Diff: %.2fC, Price: %d sats", currentTemp, targetTemp, diff, price);
         return price;
         
     }
 
+    /**
+     * @brief Latest sampled temperature, whatever its age
+     *
+     * @return float degrees C, or NAN if the sensor has not been read yet
+     */
     float getCurrentTemperature() {
-        // return a fake temperature for now between 5 and 15 degrees C
-        return random(50, 150) / 10.0;
+        SensorSampler::Reading reading;
+        if (!SensorSampler::latest(climate_sensor, CLIMATE_TEMPERATURE, reading)) {
+            return NAN;
+        }
+        return reading.value;
     }
 
     /**
@@ -125,9 +302,9 @@ namespace NostriotProvider
         tags += "[\"t\"";
         
         // Add supported methods to tags
-        for (size_t i = 0; i < capabilities_with_pricing.size(); i++)
+        for (const Capability &cap : CAPABILITIES)
         {
-            tags += ",\"" + capabilities_with_pricing[i].name + "\"";
+            tags += ",\"" + String(cap.name) + "\"";
         }
         tags += "]";
         // d tag
@@ -140,7 +317,7 @@ namespace NostriotProvider
             "\"tags\": " + tags +
         "}";
         
-        Serial.println("NostriotProvider::getCapabilitiesAdvertisement() - Generated: " + eventJson);
+        NLOG_TRACE("NostriotProvider::getCapabilitiesAdvertisement() - Generated: %s", eventJson.c_str());
         return eventJson;
     }
 
@@ -149,41 +326,13 @@ namespace NostriotProvider
         // Do any necessary cleanup here
     }
 
-    boolean vacuumIsRunning = false;
-
-    String run(String &method, String &value)
+    String run(const String &method, const String &value)
     {
-        // TODO: get real data
-        if (method == "getTemperature")
-        {
-            return String(getCurrentTemperature());
-        }
-        else if (method == "runVacuum")
-        {
-            vacuumIsRunning = !vacuumIsRunning;
-            Serial.println("NostriotProvider::runVacuum() - Vacuum is now " + String(vacuumIsRunning ? "running" : "stopped"));
-            return String(vacuumIsRunning ? "Vacuum started" : "Vacuum stopped");
-        }
-        else if (method == "getHumidity")
-        {
-            // return a fake humidity for now between 30 and 70%
-            int humidity = random(30, 70);
-            return String(humidity);
-        }
-        else if (method == "toggleLamp")
-        {
-            // pretend to toggle a lamp
-            return "Lamp toggled";
-        }
-        else if (method == "setTemperature")
-        {
-            // pretend to set a temperature
-            Serial.println("NostriotProvider::setTemperature() - Setting temperature to " + value + " degrees C");
-            return "Temperature set to " + value + " degrees C";
-        }
-        else
+        const Capability *cap = findCapability(method);
+        if (!cap)
         {
             return "Unknown method";
         }
+        return cap->run(value);
     }
 }
\ No newline at end of file
@@ -3,17 +3,33 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <vector>
 
 #include "config.h"
 
 namespace NostriotProvider {
+    // The price of one request, worked out once and carried through invoicing and payment
+    struct PriceQuote {
+        int price = 0;                // sats, 0 if free or unknown
+        float reading = NAN;          // sensor reading the price was based on, if any
+        unsigned long quoted_at = 0;  // millis()
+        unsigned long valid_for = 0;  // ms the price holds for, 0 if it never changes
+
+        bool expired(unsigned long now) const { return valid_for > 0 && now - quoted_at > valid_for; }
+    };
+
+    // How long a price that depends on a sensor reading holds
+    extern const unsigned long QUOTE_VALIDITY;
+
     void init();
     void cleanup();
-    int getPrice(const String &method, const String &value);
-    int getSetTemperaturePrice(float targetTemp);
+    PriceQuote quote(const String &method, const String &value);
+    std::vector<int> getFixedPrices();
+    int getSetTemperaturePrice(float targetTemp, float currentTemp);
     float getCurrentTemperature();
-    String* getCapabilities(int &count);
     bool hasCapability(const String &capability);
+    int getCapabilityIndex(const String &capability);
+    String getCapabilityName(int index);
     String getCapabilitiesAdvertisement();
-    String run(String &method, String &value);
+    String run(const String &method, const String &value);
 }
\ No newline at end of file
@@ -0,0 +1,329 @@
+/**
+ * @file payment_journal.cpp
+ * @brief Crash-safe journal of pending and paid requests
+ * @version 0.1
+ * @date 2025-10-17
+ *
+ * A record is [type][payload length][payload][CRC-32 of the preceding bytes],
+ * with the length and CRC little-endian. Payloads are a 16 byte payment_hash
+ * prefix, followed for inserts by the raw PendingPayments::Payment and for
+ * events by the request event text; the header record at the start of each
+ * file pins the version and that struct's size.
+ */
+
+#include "payment_journal.h"
+#include "../lib/logger/logger.h"
+
+static const size_t RECORD_OVERHEAD = 7;
+static const size_t INSERT_PAYLOAD = PendingPayments::KEY_SIZE + sizeof(PendingPayments::Payment);
+static const size_t MAX_PAYLOAD = PendingPayments::KEY_SIZE + PaymentJournal::MAX_EVENT_SIZE;
+static_assert(INSERT_PAYLOAD <= MAX_PAYLOAD, "an insert must fit in a record");
+static_assert(MAX_PAYLOAD <= 0xffff, "journal payload length must fit in two bytes");
+
+static uint32_t crc32(const uint8_t *data, size_t length)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+PaymentJournal::PaymentJournal(fs::FS &fs, const char *path) : fs(fs), path(path), temp_path(String(path) + ".tmp")
+{
+}
+
+size_t PaymentJournal::frame(uint8_t *out, RecordType type, const uint8_t *payload, size_t length)
+{
+    out[0] = type;
+    out[1] = length;
+    out[2] = length >> 8;
+    // The payload may already be in place
+    memmove(out + 3, payload, length);
+    uint32_t crc = crc32(out, length + 3);
+    for (int i = 0; i < 4; i++)
+    {
+        out[length + 3 + i] = crc >> (8 * i);
+    }
+    return length + RECORD_OVERHEAD;
+}
+
+bool PaymentJournal::begin(std::vector<Entry> &pending, std::vector<Entry> &confirmed)
+{
+    unsigned long started = millis();
+
+    // A compaction cut short between removing the old file and renaming the new one
+    if (!fs.exists(path.c_str()) && fs.exists(temp_path.c_str()))
+    {
+        fs.rename(temp_path.c_str(), path.c_str());
+    }
+
+    std::vector<Entry> entries;
+    std::vector<bool> paid;
+    size_t records = 0;
+    bool torn = false;
+
+    File file = fs.open(path.c_str(), FILE_READ);
+    if (file)
+    {
+        // On the heap: an event record is too big for the loop task's stack
+        std::vector<uint8_t> buffer(MAX_PAYLOAD + RECORD_OVERHEAD);
+        uint8_t *record = buffer.data();
+        bool header_ok = false;
+        while (file.read(record, 3) == 3)
+        {
+            size_t length = record[1] | (record[2] << 8);
+            if (length > MAX_PAYLOAD || file.read(record + 3, length + 4) != length + 4)
+            {
+                torn = true;
+                break;
+            }
+            uint32_t crc = record[length + 3] | (record[length + 4] << 8) | (record[length + 5] << 16) | ((uint32_t)record[length + 6] << 24);
+            if (crc != crc32(record, length + 3))
+            {
+                torn = true;
+                break;
+            }
+
+            RecordType type = (RecordType)record[0];
+            const uint8_t *payload = record + 3;
+            if (!header_ok)
+            {
+                // Written by a build with a different record layout: nothing in it can be trusted
+                size_t payment_size = length == 3 ? payload[1] | (payload[2] << 8) : 0;
+                if (type != RECORD_HEADER || payload[0] != VERSION || payment_size != sizeof(PendingPayments::Payment))
+                {
+                    NLOG_WARN("PaymentJournal::begin() - Journal layout does not match this build, discarding it");
+                    break;
+                }
+                header_ok = true;
+                continue;
+            }
+            if (length < PendingPayments::KEY_SIZE)
+            {
+                torn = true;
+                break;
+            }
+            records++;
+
+            size_t found = entries.size();
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                if (memcmp(entries[i].key, payload, PendingPayments::KEY_SIZE) == 0)
+                {
+                    found = i;
+                    break;
+                }
+            }
+
+            if (type == RECORD_INSERT && length == INSERT_PAYLOAD && found == entries.size())
+            {
+                Entry entry;
+                memcpy(entry.key, payload, PendingPayments::KEY_SIZE);
+                memcpy(&entry.payment, payload + PendingPayments::KEY_SIZE, sizeof(entry.payment));
+                entries.push_back(entry);
+                paid.push_back(false);
+            }
+            else if (type == RECORD_EVENT && found < entries.size())
+            {
+                entries[found].event = String((const char *)payload + PendingPayments::KEY_SIZE, length - PendingPayments::KEY_SIZE);
+            }
+            else if (type == RECORD_CONFIRM && found < entries.size())
+            {
+                paid[found] = true;
+            }
+            else if ((type == RECORD_EXECUTE || type == RECORD_REMOVE) && found < entries.size())
+            {
+                entries.erase(entries.begin() + found);
+                paid.erase(paid.begin() + found);
+            }
+        }
+        file.close();
+    }
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        (paid[i] ? confirmed : pending).push_back(entries[i]);
+    }
+
+    ready = true;
+    if (!compact(pending, confirmed))
+    {
+        ready = false;
+        return false;
+    }
+
+    NLOG_INFO("PaymentJournal::begin() - Replayed %u records in %lums%s: %u pending, %u paid but not run",
+              (unsigned)records, millis() - started, torn ? " (torn tail dropped)" : "",
+              (unsigned)pending.size(), (unsigned)confirmed.size());
+    return true;
+}
+
+bool PaymentJournal::compact(const std::vector<Entry> &pending, const std::vector<Entry> &confirmed)
+{
+    if (!ready)
+    {
+        return false;
+    }
+
+    File file = fs.open(temp_path.c_str(), FILE_WRITE);
+    if (!file)
+    {
+        NLOG_ERROR("PaymentJournal::compact() - Cannot create %s", temp_path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(MAX_PAYLOAD + RECORD_OVERHEAD);
+    uint8_t *record = buffer.data();
+    uint8_t header[3] = {VERSION, (uint8_t)sizeof(PendingPayments::Payment), (uint8_t)(sizeof(PendingPayments::Payment) >> 8)};
+    size_t written = 0;
+    size_t expected = 0;
+
+    size_t length = frame(record, RECORD_HEADER, header, sizeof(header));
+    written += file.write(record, length);
+    expected += length;
+
+    for (const std::vector<Entry> *list : {&pending, &confirmed})
+    {
+        for (const Entry &entry : *list)
+        {
+            uint8_t payload[INSERT_PAYLOAD];
+            memcpy(payload, entry.key, PendingPayments::KEY_SIZE);
+            memcpy(payload + PendingPayments::KEY_SIZE, &entry.payment, sizeof(entry.payment));
+            length = frame(record, RECORD_INSERT, payload, sizeof(payload));
+            written += file.write(record, length);
+            expected += length;
+
+            if (entry.event.length() > 0 && entry.event.length() <= MAX_EVENT_SIZE)
+            {
+                // Assembled where frame() puts the payload
+                memcpy(record + 3, entry.key, PendingPayments::KEY_SIZE);
+                memcpy(record + 3 + PendingPayments::KEY_SIZE, entry.event.c_str(), entry.event.length());
+                length = frame(record, RECORD_EVENT, record + 3, PendingPayments::KEY_SIZE + entry.event.length());
+                written += file.write(record, length);
+                expected += length;
+            }
+
+            if (list == &confirmed)
+            {
+                length = frame(record, RECORD_CONFIRM, entry.key, PendingPayments::KEY_SIZE);
+                written += file.write(record, length);
+                expected += length;
+            }
+        }
+    }
+
+    // Records not yet flushed describe changes the snapshot already holds
+    buffered = 0;
+    last_flush = millis();
+
+    file.close();
+    if (written != expected)
+    {
+        NLOG_ERROR("PaymentJournal::compact() - Short write, keeping the old journal");
+        fs.remove(temp_path.c_str());
+        return false;
+    }
+    fs.remove(path.c_str());
+    if (!fs.rename(temp_path.c_str(), path.c_str()))
+    {
+        NLOG_ERROR("PaymentJournal::compact() - Cannot rename %s", temp_path.c_str());
+        return false;
+    }
+    file_size = written;
+    compacted_size = written;
+    return true;
+}
+
+void PaymentJournal::append(RecordType type, const uint8_t *payload, size_t length)
+{
+    if (!ready)
+    {
+        return;
+    }
+    if (buffered + length + RECORD_OVERHEAD > BUFFER_SIZE)
+    {
+        flush();
+    }
+    if (length + RECORD_OVERHEAD > BUFFER_SIZE)
+    {
+        // Bigger than a whole batch, e.g. a long request event: written on its own
+        std::vector<uint8_t> record(length + RECORD_OVERHEAD);
+        write(record.data(), frame(record.data(), type, payload, length));
+        return;
+    }
+    buffered += frame(buffer + buffered, type, payload, length);
+}
+
+void PaymentJournal::recordInsert(const uint8_t key[PendingPayments::KEY_SIZE], const PendingPayments::Payment &payment)
+{
+    uint8_t payload[INSERT_PAYLOAD];
+    memcpy(payload, key, PendingPayments::KEY_SIZE);
+    memcpy(payload + PendingPayments::KEY_SIZE, &payment, sizeof(payment));
+    append(RECORD_INSERT, payload, sizeof(payload));
+}
+
+void PaymentJournal::recordEvent(const uint8_t key[PendingPayments::KEY_SIZE], const char *event, size_t length)
+{
+    if (length == 0 || length > MAX_EVENT_SIZE)
+    {
+        return;
+    }
+    std::vector<uint8_t> payload(PendingPayments::KEY_SIZE + length);
+    memcpy(payload.data(), key, PendingPayments::KEY_SIZE);
+    memcpy(payload.data() + PendingPayments::KEY_SIZE, event, length);
+    append(RECORD_EVENT, payload.data(), payload.size());
+}
+
+void PaymentJournal::recordConfirm(const uint8_t key[PendingPayments::KEY_SIZE])
+{
+    append(RECORD_CONFIRM, key, PendingPayments::KEY_SIZE);
+    flush();
+}
+
+void PaymentJournal::recordExecute(const uint8_t key[PendingPayments::KEY_SIZE])
+{
+    append(RECORD_EXECUTE, key, PendingPayments::KEY_SIZE);
+}
+
+void PaymentJournal::recordRemove(const uint8_t key[PendingPayments::KEY_SIZE])
+{
+    append(RECORD_REMOVE, key, PendingPayments::KEY_SIZE);
+}
+
+void PaymentJournal::loop()
+{
+    if (buffered > 0 && millis() - last_flush >= FLUSH_INTERVAL)
+    {
+        flush();
+    }
+}
+
+void PaymentJournal::flush()
+{
+    last_flush = millis();
+    if (!ready || buffered == 0)
+    {
+        return;
+    }
+    write(buffer, buffered);
+    buffered = 0;
+}
+
+void PaymentJournal::write(const uint8_t *data, size_t length)
+{
+    File file = fs.open(path.c_str(), FILE_APPEND);
+    size_t written = file ? file.write(data, length) : 0;
+    file.close();
+    if (written != length)
+    {
+        // A partial record is dropped at the next replay, like a power cut mid-write
+        NLOG_ERROR("PaymentJournal::write() - Wrote %u of %u bytes", (unsigned)written, (unsigned)length);
+    }
+    file_size += written;
+}
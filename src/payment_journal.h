@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+
+#include "pending_payments.h"
+#include "request_events.h"
+
+/**
+ * @brief Append-only journal of the payment queue, so paid jobs survive a restart
+ *
+ * Every queue insert, payment confirmation, execution and removal is
+ * appended as a CRC-framed record, and an insert is followed by its request
+ * event when one was kept, so a paid result can still carry its "request"
+ * tag. Records are buffered in RAM and written in batches to spare the
+ * flash, except confirmations: those stand for money received and are
+ * written straight away.
+ *
+ * On boot the journal is replayed: requests still waiting for payment go
+ * back into the queue, and paid requests that never ran are handed back to
+ * be run. Replay stops at the first bad record, which is where a write was
+ * cut short. The file is then rewritten with only the live entries, and again
+ * whenever it has grown to twice that size plus COMPACT_SLACK.
+ */
+class PaymentJournal {
+public:
+    struct Entry {
+        uint8_t key[PendingPayments::KEY_SIZE];
+        PendingPayments::Payment payment;
+        String event; // request event JSON, empty if it was not kept
+    };
+
+    static const size_t BUFFER_SIZE = 1024;
+    static const unsigned long FLUSH_INTERVAL = 5000; // ms between batched writes
+    static const size_t COMPACT_SLACK = 8192;         // bytes of growth allowed on top of a compacted file
+    static const size_t MAX_EVENT_SIZE = RequestEvents::MAX_EVENT_SIZE;
+
+    PaymentJournal(fs::FS &fs, const char *path);
+
+    /**
+     * @brief Replay the journal and rewrite it compacted
+     *
+     * @param pending receives requests still waiting for payment
+     * @param confirmed receives paid requests that were never run
+     * @return false if the journal cannot be used; records are then dropped
+     */
+    bool begin(std::vector<Entry> &pending, std::vector<Entry> &confirmed);
+
+    void recordInsert(const uint8_t key[PendingPayments::KEY_SIZE], const PendingPayments::Payment &payment);
+    void recordEvent(const uint8_t key[PendingPayments::KEY_SIZE], const char *event, size_t length);
+    void recordConfirm(const uint8_t key[PendingPayments::KEY_SIZE]);
+    void recordExecute(const uint8_t key[PendingPayments::KEY_SIZE]);
+    void recordRemove(const uint8_t key[PendingPayments::KEY_SIZE]);
+
+    // Write buffered records once FLUSH_INTERVAL has passed
+    void loop();
+    void flush();
+
+    /**
+     * @brief The file should be rewritten with compact()
+     *
+     * Measured against the size of the last compacted file rather than a
+     * fixed limit, so a queue whose live entries alone are large is not
+     * rewritten over and over.
+     */
+    bool needsCompaction() const { return ready && file_size > 2 * compacted_size + COMPACT_SLACK; }
+    bool compact(const std::vector<Entry> &pending, const std::vector<Entry> &confirmed);
+
+private:
+    enum RecordType : uint8_t {
+        RECORD_HEADER = 1,
+        RECORD_INSERT = 2,
+        RECORD_CONFIRM = 3,
+        RECORD_EXECUTE = 4,
+        RECORD_REMOVE = 5,
+        RECORD_EVENT = 6
+    };
+
+    static const uint8_t VERSION = 1;
+
+    void append(RecordType type, const uint8_t *payload, size_t length);
+    void write(const uint8_t *data, size_t length);
+    static size_t frame(uint8_t *out, RecordType type, const uint8_t *payload, size_t length);
+
+    fs::FS &fs;
+    String path;
+    String temp_path;
+    bool ready = false;
+    size_t file_size = 0;
+    size_t compacted_size = 0;
+
+    uint8_t buffer[BUFFER_SIZE];
+    size_t buffered = 0;
+    unsigned long last_flush = 0;
+};
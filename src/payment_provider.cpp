@@ -9,138 +9,399 @@
  */
 
 #include "payment_provider.h"
+#include "nostriot_provider.h"
+#include "lnbits_response.h"
+#include "../lib/logger/logger.h"
+#include "../lib/nostr/event_serializer.h"
+#include "../lib/nostr/codec.h"
+#include <LittleFS.h>
+#include <mutex>
+#include <algorithm>
 
 namespace PaymentProvider {
     
     // Configuration constants
-    const int MAX_QUEUE_SIZE = 5;
     const unsigned long PAYMENT_TIMEOUT = 5 * 60 * 1000; // 5 minutes
+    const size_t INVOICE_POOL_SIZE = 2; // ready invoices per fixed price
+    const unsigned long INVOICE_POOL_EXPIRY = 60 * 60; // seconds, asked of LNbits for pooled invoices
+    const char* JOURNAL_PATH = "/payments.jnl";
+
+    // A pooled invoice is rotated out while it still has a full payment window left
+    static const unsigned long INVOICE_POOL_ROTATE_AFTER = INVOICE_POOL_EXPIRY * 1000 - PAYMENT_TIMEOUT - 60 * 1000;
+    static const unsigned long INVOICE_POOL_RETRY_INTERVAL = 30000; // after a failed refill
 
     // Static variables
-    static std::vector<PendingPaymentRequest> payment_queue;
+    static PendingPayments payment_queue;
+    // Request events of the queued payments, for the "request" tag; guarded by payment_queue_mutex too
+    static RequestEvents request_events;
+    // Filled from the request worker task, drained from the network loop
+    static std::mutex payment_queue_mutex;
     static payment_callback_t payment_callback = nullptr;
+
+    // Written under payment_queue_mutex, like the queue it mirrors
+    static PaymentJournal journal(LittleFS, JOURNAL_PATH);
+    // Paid but not yet run: kept for compaction until markExecuted()
+    static std::vector<PaymentJournal::Entry> paid_payments;
+    // Paid before a restart and never run, waiting for runRecoveredPayments()
+    static std::vector<PaymentJournal::Entry> recovered_payments;
+
+    struct PooledInvoice {
+        int amount_sats;
+        String payment_hash;
+        String bolt11;
+        unsigned long minted_at;
+    };
+
+    // Claimed from the request worker task, refilled from the network loop
+    static std::vector<PooledInvoice> invoice_pool;
+    static std::vector<int> invoice_pool_prices;
+    static std::mutex invoice_pool_mutex;
+    static bool invoice_pool_refilling = false;
+    static unsigned long invoice_pool_retry_at = 0;
     
+    // One kept-alive TLS session for invoice requests, stepped from processLoop()
+    static AsyncHttpsClient lnbits_client(LNBITS_HOST_URL);
+
     // Payment monitoring WebSocket
     static WebSocketsClient payment_ws;
     static bool payment_ws_connected = false;
     
+    /**
+     * @brief Replay the payment journal into the queue
+     *
+     * Requests still waiting for payment get a fresh PAYMENT_TIMEOUT, as the
+     * time spent powered off is unknown. Paid requests that never ran are
+     * held until runRecoveredPayments(), when there is a relay to answer on.
+     */
+    static void recoverPayments() {
+        if (!LittleFS.begin(true)) {
+            NLOG_ERROR("PaymentProvider::recoverPayments() - LittleFS unavailable, payments will not survive a restart");
+            return;
+        }
+
+        std::vector<PaymentJournal::Entry> pending;
+        std::vector<PaymentJournal::Entry> confirmed;
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        if (!journal.begin(pending, confirmed)) {
+            NLOG_ERROR("PaymentProvider::recoverPayments() - Payment journal unavailable");
+            return;
+        }
+
+        for (const auto& entry : pending) {
+            // Keys are payment_hash prefixes, which is all the table looks at
+            uint8_t hash[32] = {0};
+            memcpy(hash, entry.key, PendingPayments::KEY_SIZE);
+            if (payment_queue.insert(hash, entry.payment, PAYMENT_TIMEOUT) && entry.event.length() > 0) {
+                request_events.put(hash, entry.event.c_str(), entry.event.length());
+            }
+        }
+        paid_payments = confirmed;
+        recovered_payments = confirmed;
+        if (!pending.empty() || !confirmed.empty()) {
+            NLOG_INFO("PaymentProvider::recoverPayments() - Recovered %u pending and %u paid requests",
+                      (unsigned)pending.size(), (unsigned)confirmed.size());
+        }
+    }
+
+    // Rewrite the journal with only the live entries; payment_queue_mutex held
+    static void compactJournal() {
+        std::vector<PaymentJournal::Entry> pending;
+        pending.reserve(payment_queue.size());
+        payment_queue.forEach([&pending](const uint8_t key[PendingPayments::KEY_SIZE], const PendingPayments::Payment& payment) {
+            PaymentJournal::Entry entry;
+            memcpy(entry.key, key, PendingPayments::KEY_SIZE);
+            entry.payment = payment;
+            request_events.find(key, entry.event);
+            pending.push_back(entry);
+        });
+        journal.compact(pending, paid_payments);
+    }
+
     void init() {
-        Serial.println("PaymentProvider::init() - Initializing payment provider");
+        NLOG_INFO("PaymentProvider::init() - Initializing payment provider");
+
+        // Bring back requests from before a restart
+        recoverPayments();
         
         // Initialize payment monitoring
         initPaymentMonitoring();
         
-        Serial.println("PaymentProvider::init() - Payment provider initialized");
+        NLOG_INFO("PaymentProvider::init() - Payment provider initialized");
     }
 
     void cleanup() {
-        Serial.println("PaymentProvider::cleanup() - Cleaning up payment provider");
+        NLOG_INFO("PaymentProvider::cleanup() - Cleaning up payment provider");
         
         payment_ws.disconnect();
-        payment_queue.clear();
+        lnbits_client.stop();
+        {
+            std::lock_guard<std::mutex> lock(payment_queue_mutex);
+            // The journal keeps its entries for the next boot
+            journal.flush();
+            payment_queue.clear();
+            request_events.clear();
+            paid_payments.clear();
+            recovered_payments.clear();
+        }
+        {
+            std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+            invoice_pool.clear();
+        }
         payment_callback = nullptr;
         
-        Serial.println("PaymentProvider::cleanup() - Payment provider cleaned up");
+        NLOG_INFO("PaymentProvider::cleanup() - Payment provider cleaned up");
     }
 
     void processLoop() {
         // Process payment WebSocket events
         payment_ws.loop();
+
+        // Advance the invoice request in flight, if any
+        lnbits_client.loop();
+
+        // Keep a few invoices ready for each fixed price
+        refillInvoicePool();
         
-        // Clean up expired payments every 30 seconds
-        static unsigned long last_cleanup = 0;
-        unsigned long now = millis();
-        if (now - last_cleanup > 30000) {
-            cleanupExpiredPayments();
-            last_cleanup = now;
+        // Expire unpaid requests; only timer wheel buckets that have come due are looked at
+        cleanupExpiredPayments();
+
+        // Write out batched journal records, and rewrite the journal once it has grown
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        journal.loop();
+        if (journal.needsCompaction()) {
+            compactJournal();
         }
     }
 
-    String createPaymentRequest(int amount_sats, const String& memo) {
-        Serial.println("PaymentProvider::createPaymentRequest() - Creating invoice for " + String(amount_sats) + " sats");
+    bool createPaymentRequest(int amount_sats, const String& memo, invoice_callback_t callback, unsigned long expiry_secs) {
+        NLOG_INFO("PaymentProvider::createPaymentRequest() - Creating invoice for %d sats", amount_sats);
         
-        String postData = "{\"unit\": \"sat\", \"out\": false, \"amount\": " + String(amount_sats) + ", \"memo\": \"" + memo + "\"}";
-        String url = "https://" + String(LNBITS_HOST_URL) + String(LNBITS_PAYMENTS_ENDPOINT) + "?api-key=" + String(LNBITS_INVOICE_KEY);
-        String response = httpPost(url, postData);
-        
-        return response; // Return full LNbits response
+        String postData = "{\"unit\": \"sat\", \"out\": false, \"amount\": " + String(amount_sats) + ", \"memo\": \"" + memo + "\"";
+        if (expiry_secs > 0) {
+            postData += ", \"expiry\": " + String(expiry_secs);
+        }
+        postData += "}";
+        String path = String(LNBITS_PAYMENTS_ENDPOINT) + "?api-key=" + String(LNBITS_INVOICE_KEY);
+
+        return lnbits_client.post(path, postData, [callback](int status, const String &response) {
+            LnbitsResponse::Fields fields;
+            if (status < 200 || status >= 300) {
+                NLOG_ERROR("PaymentProvider::createPaymentRequest() - Invoice request failed: %d", status);
+                callback("", "");
+                return;
+            }
+            if (!LnbitsResponse::parse(response.c_str(), response.length(), fields) || fields.bolt11.value == nullptr) {
+                NLOG_ERROR("PaymentProvider::createPaymentRequest() - No invoice in response");
+                callback("", "");
+                return;
+            }
+
+            const AsyncHttpsClient::Timings &timings = lnbits_client.lastTimings();
+            NLOG_DEBUG("PaymentProvider::createPaymentRequest() - Invoice created (connect %lums, TLS %lums, request %lums, response %lums, %s session)",
+                       (unsigned long)timings.connect_ms, (unsigned long)timings.tls_ms,
+                       (unsigned long)timings.request_ms, (unsigned long)timings.response_ms,
+                       timings.reused ? "reused" : "new");
+            NLOG_TRACE("PaymentProvider::createPaymentRequest() - Response: %s", response.c_str());
+            callback(fields.payment_hash.toString(), fields.bolt11.toString());
+        });
     }
 
-    String extractPaymentHashFromResponse(const String& invoice_response) {
-        // Parse LNbits response to extract payment_hash
-        DynamicJsonDocument doc(4096);
-        DeserializationError error = deserializeJson(doc, invoice_response);
-        
-        if (error) {
-            Serial.println("PaymentProvider::extractPaymentHashFromResponse() - JSON parsing failed: " + String(error.c_str()));
-            return "";
+    /**
+     * @brief Pack a request into a pending payment table entry
+     *
+     * Only what running the method and answering needs is kept; the original
+     * event, for the "request" tag, is held beside the table in request_events.
+     */
+    static bool packPayment(const DvmRequest& request, int price, PendingPayments::Payment& payment) {
+        int method = NostriotProvider::getCapabilityIndex(request.method);
+        if (method < 0 || request.value.length() > PendingPayments::MAX_VALUE_LENGTH ||
+            nostr::hexDecode(request.id, payment.request_id, 32) != 32 || nostr::hexDecode(request.pubkey, payment.pubkey, 32) != 32) {
+            return false;
         }
-        
-        return doc["payment_hash"];
+        payment.method = method;
+        memcpy(payment.value, request.value.c_str(), request.value.length() + 1);
+        payment.price = price;
+        return true;
     }
 
-    String extractBolt11FromResponse(const String& response) {
-        int bolt11Index = response.indexOf("\"bolt11\":\"");
-        if (bolt11Index == -1) {
-            return "";
+    static DvmRequest unpackPayment(const PendingPayments::Payment& payment, const String& event) {
+        DvmRequest request;
+        request.raw = event;
+        request.id = nostr::hexEncode(payment.request_id, 32);
+        request.pubkey = nostr::hexEncode(payment.pubkey, 32);
+        request.kind = 5107;
+        request.method = NostriotProvider::getCapabilityName(payment.method);
+        request.value = payment.value;
+
+        // Same shape as the input tag the request arrived with
+        request.input = "[{\"method\":\"";
+        nostr::appendEscaped(request.input, request.method.c_str(), request.method.length());
+        request.input += "\"";
+        if (request.value.length() > 0) {
+            request.input += ",\"value\":\"";
+            nostr::appendEscaped(request.input, request.value.c_str(), request.value.length());
+            request.input += "\"";
         }
-        int bolt11Start = bolt11Index + 10;
-        int bolt11End = response.indexOf("\"", bolt11Start);
-        if (bolt11End == -1) {
-            return "";
+        request.input += "}]";
+        return request;
+    }
+
+    bool addToPaymentQueue(const String& payment_hash, const DvmRequest& dvm_request, int price) {
+        uint8_t hash[32];
+        PendingPayments::Payment payment;
+        if (nostr::hexDecode(payment_hash, hash, sizeof(hash)) != sizeof(hash) || !packPayment(dvm_request, price, payment)) {
+            NLOG_ERROR("PaymentProvider::addToPaymentQueue() - Request cannot be queued: %s for method: %s", payment_hash.c_str(), dvm_request.method.c_str());
+            return false;
         }
-        return response.substring(bolt11Start, bolt11End);
+
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        // Never evict: the oldest entry may be the one being paid right now
+        if (!payment_queue.insert(hash, payment, PAYMENT_TIMEOUT)) {
+            NLOG_WARN("PaymentProvider::addToPaymentQueue() - Queue full or duplicate payment hash (%u pending)", (unsigned)payment_queue.size());
+            return false;
+        }
+        journal.recordInsert(hash, payment);
+        if (request_events.put(hash, dvm_request.raw.c_str(), dvm_request.raw.length())) {
+            journal.recordEvent(hash, dvm_request.raw.c_str(), dvm_request.raw.length());
+        } else {
+            NLOG_WARN("PaymentProvider::addToPaymentQueue() - Request event not kept (%u bytes), the result will have no request tag", (unsigned)dvm_request.raw.length());
+        }
+        NLOG_INFO("PaymentProvider::addToPaymentQueue() - Added to queue: %s for method: %s", payment_hash.c_str(), dvm_request.method.c_str());
+        return true;
     }
 
-    void addToPaymentQueue(const String& payment_hash, const String& original_event_str, const String& method, const String& value) {
-        // Check queue size limit
-        if (payment_queue.size() >= MAX_QUEUE_SIZE) {
-            Serial.println("PaymentProvider::addToPaymentQueue() - Queue full, removing oldest entry");
-            payment_queue.erase(payment_queue.begin());
+    void cleanupExpiredPayments() {
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        size_t expired = payment_queue.expire(millis(), [](const uint8_t key[PendingPayments::KEY_SIZE]) {
+            journal.recordRemove(key);
+            request_events.remove(key);
+        });
+        if (expired > 0) {
+            NLOG_INFO("PaymentProvider::cleanupExpiredPayments() - Removed %u expired payments", (unsigned)expired);
         }
-        
-        // Check for duplicate payment_hash
-        for (const auto& req : payment_queue) {
-            if (req.payment_hash == payment_hash) {
-                Serial.println("PaymentProvider::addToPaymentQueue() - Duplicate payment hash, ignoring");
-                return;
+    }
+
+    size_t pendingPaymentCount() {
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        return payment_queue.size();
+    }
+
+    void setInvoicePoolPrices(const std::vector<int>& prices) {
+        std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+        invoice_pool_prices.clear();
+        for (int price : prices) {
+            if (price > 0 && std::find(invoice_pool_prices.begin(), invoice_pool_prices.end(), price) == invoice_pool_prices.end()) {
+                invoice_pool_prices.push_back(price);
             }
         }
-        
-        PendingPaymentRequest request;
-        request.payment_hash = payment_hash;
-        request.original_event_str = original_event_str;
-        request.method = method;
-        request.value = value;
-        request.created_at = millis();
-        request.expires_at = millis() + PAYMENT_TIMEOUT;
-        
-        payment_queue.push_back(request);
-        Serial.println("PaymentProvider::addToPaymentQueue() - Added to queue: " + payment_hash + " for method: " + method);
+        NLOG_INFO("PaymentProvider::setInvoicePoolPrices() - Pooling invoices for %u fixed prices", (unsigned)invoice_pool_prices.size());
     }
 
-    void cleanupExpiredPayments() {
+    ClaimResult claimPooledInvoice(int amount_sats, const DvmRequest& request, String& bolt11) {
+        PooledInvoice invoice;
+        bool found = false;
+        size_t remaining = 0;
+        {
+            std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+            unsigned long now = millis();
+            for (auto it = invoice_pool.begin(); it != invoice_pool.end(); ++it) {
+                if (it->amount_sats == amount_sats && now - it->minted_at < INVOICE_POOL_ROTATE_AFTER) {
+                    invoice = *it;
+                    invoice_pool.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+            for (const auto& pooled : invoice_pool) {
+                if (pooled.amount_sats == amount_sats) {
+                    remaining++;
+                }
+            }
+        }
+
+        if (!found) {
+            NLOG_DEBUG("PaymentProvider::claimPooledInvoice() - No pooled invoice for %d sats", amount_sats);
+            return NO_POOLED_INVOICE;
+        }
+
+        if (!addToPaymentQueue(invoice.payment_hash, request, amount_sats)) {
+            // Still unclaimed, so it can go back for the next request
+            std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+            invoice_pool.push_back(invoice);
+            return NOT_QUEUED;
+        }
+        bolt11 = invoice.bolt11;
+        NLOG_DEBUG("PaymentProvider::claimPooledInvoice() - Claimed pooled invoice for %d sats, %u left", amount_sats, (unsigned)remaining);
+        return CLAIMED;
+    }
+
+    void refillInvoicePool() {
         unsigned long now = millis();
-        size_t initial_size = payment_queue.size();
-        
-        payment_queue.erase(
-            std::remove_if(payment_queue.begin(), payment_queue.end(),
-                [now](const PendingPaymentRequest& req) {
-                    return now > req.expires_at;
-                }),
-            payment_queue.end()
-        );
-        
-        if (payment_queue.size() < initial_size) {
-            Serial.println("PaymentProvider::cleanupExpiredPayments() - Removed " + 
-                         String(initial_size - payment_queue.size()) + " expired payments");
+        int amount_sats = 0;
+        {
+            std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+
+            // Rotate out invoices too close to expiry to give a payer their full window
+            size_t initial_size = invoice_pool.size();
+            invoice_pool.erase(
+                std::remove_if(invoice_pool.begin(), invoice_pool.end(),
+                    [now](const PooledInvoice& invoice) {
+                        return now - invoice.minted_at >= INVOICE_POOL_ROTATE_AFTER;
+                    }),
+                invoice_pool.end()
+            );
+            if (invoice_pool.size() < initial_size) {
+                NLOG_INFO("PaymentProvider::refillInvoicePool() - Rotated out %u pooled invoices", (unsigned)(initial_size - invoice_pool.size()));
+            }
+
+            // One refill at a time, so on-demand invoices never queue behind a batch
+            if (invoice_pool_refilling || (long)(now - invoice_pool_retry_at) < 0) {
+                return;
+            }
+            for (int price : invoice_pool_prices) {
+                size_t count = std::count_if(invoice_pool.begin(), invoice_pool.end(),
+                    [price](const PooledInvoice& invoice) { return invoice.amount_sats == price; });
+                if (count < INVOICE_POOL_SIZE) {
+                    amount_sats = price;
+                    break;
+                }
+            }
+            if (amount_sats == 0) {
+                return;
+            }
+            invoice_pool_refilling = true;
+        }
+
+        String memo = "IoT Device Service: " + String(amount_sats) + " sats";
+        bool queued = createPaymentRequest(amount_sats, memo, [amount_sats](const String& payment_hash, const String& bolt11) {
+            std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+            invoice_pool_refilling = false;
+            if (payment_hash.length() == 0 || bolt11.length() == 0) {
+                NLOG_WARN("PaymentProvider::refillInvoicePool() - Refill failed, retrying in %lus", INVOICE_POOL_RETRY_INTERVAL / 1000);
+                invoice_pool_retry_at = millis() + INVOICE_POOL_RETRY_INTERVAL;
+                return;
+            }
+
+            PooledInvoice invoice;
+            invoice.amount_sats = amount_sats;
+            invoice.payment_hash = payment_hash;
+            invoice.bolt11 = bolt11;
+            invoice.minted_at = millis();
+            invoice_pool.push_back(invoice);
+            NLOG_DEBUG("PaymentProvider::refillInvoicePool() - Pooled invoice for %d sats", amount_sats);
+        }, INVOICE_POOL_EXPIRY);
+
+        if (!queued) {
+            std::lock_guard<std::mutex> lock(invoice_pool_mutex);
+            invoice_pool_refilling = false;
+            invoice_pool_retry_at = now + INVOICE_POOL_RETRY_INTERVAL;
         }
     }
 
     void initPaymentMonitoring() {
         String ws_endpoint = "/api/v1/ws/" + String(LNBITS_INVOICE_KEY);
         
-        Serial.println("PaymentProvider::initPaymentMonitoring() - Connecting to payment WebSocket");
+        NLOG_INFO("PaymentProvider::initPaymentMonitoring() - Connecting to payment WebSocket");
         payment_ws.beginSSL(LNBITS_HOST_URL, 443, ws_endpoint.c_str());
         payment_ws.onEvent(paymentWebsocketEvent);
         payment_ws.setReconnectInterval(5000);
@@ -149,22 +410,22 @@ namespace PaymentProvider {
     void paymentWebsocketEvent(WStype_t type, uint8_t* payload, size_t length) {
         switch (type) {
         case WStype_DISCONNECTED:
-            Serial.println("PaymentProvider::paymentWebsocketEvent() - Payment WebSocket Disconnected");
+            NLOG_INFO("PaymentProvider::paymentWebsocketEvent() - Payment WebSocket Disconnected");
             payment_ws_connected = false;
             break;
 
         case WStype_CONNECTED:
-            Serial.println("PaymentProvider::paymentWebsocketEvent() - Payment WebSocket Connected");
+            NLOG_INFO("PaymentProvider::paymentWebsocketEvent() - Payment WebSocket Connected");
             payment_ws_connected = true;
             break;
 
         case WStype_TEXT:
-            Serial.println("PaymentProvider::paymentWebsocketEvent() - Payment notification received");
+            NLOG_DEBUG("PaymentProvider::paymentWebsocketEvent() - Payment notification received");
             handlePaymentNotification(payload, length);
             break;
 
         case WStype_ERROR:
-            Serial.println("PaymentProvider::paymentWebsocketEvent() - Payment WebSocket Error");
+            NLOG_ERROR("PaymentProvider::paymentWebsocketEvent() - Payment WebSocket Error");
             payment_ws_connected = false;
             break;
 
@@ -173,66 +434,99 @@ namespace PaymentProvider {
         }
     }
 
+    // Remove a paid request from the queue and journal it as paid; false if it is not ours
+    static bool takePaidRequest(const uint8_t hash[32], PaymentJournal::Entry& entry) {
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        if (!payment_queue.take(hash, entry.payment)) {
+            return false;
+        }
+        // Written straight away: the payer's money is in
+        journal.recordConfirm(hash);
+        memcpy(entry.key, hash, PendingPayments::KEY_SIZE);
+        request_events.take(hash, entry.event);
+        paid_payments.push_back(entry);
+        return true;
+    }
+
+    // Hand a paid request to the callback; runs without the queue lock held
+    static void runPaidRequest(const String& payment_hash, const PaymentJournal::Entry& entry) {
+        DvmRequest request = unpackPayment(entry.payment, entry.event);
+        NLOG_INFO("PaymentProvider::processConfirmedPayment() - Processing payment for method: %s", request.method.c_str());
+
+        // Call the callback if set
+        if (payment_callback) {
+            payment_callback(payment_hash, request, payment.price);
+        }
+        NLOG_INFO("PaymentProvider::processConfirmedPayment() - Payment processed and removed from queue");
+    }
+
     void handlePaymentNotification(uint8_t* payload, size_t length) {
-        String message = String((char*)payload);
-        Serial.println("PaymentProvider::handlePaymentNotification() - Received: " + message);
-        
-        DynamicJsonDocument doc(2048);
-        DeserializationError error = deserializeJson(doc, message);
-        
-        if (error) {
-            Serial.println("PaymentProvider::handlePaymentNotification() - JSON parsing failed: " + String(error.c_str()));
+        NLOG_TRACE("PaymentProvider::handlePaymentNotification() - Received: %.*s", (int)length, (char*)payload);
+
+        // Most notifications are for other invoices on the wallet: settle those on the hash lookup alone
+        LnbitsResponse::Fields fields;
+        uint8_t hash[32];
+        PaymentJournal::Entry entry;
+        if (!LnbitsResponse::parse((const char*)payload, length, fields) || !fields.status.equals("success") ||
+            nostr::hexDecode(fields.payment_hash.value, fields.payment_hash.length, hash, sizeof(hash)) != sizeof(hash) ||
+            !takePaidRequest(hash, entry)) {
             return;
         }
-        
-        if (doc["payment"]["status"] == "success") {
-            String payment_hash = doc["payment"]["payment_hash"];
-            Serial.println("PaymentProvider::handlePaymentNotification() - Payment confirmed: " + payment_hash);
-            processConfirmedPayment(payment_hash);
-        }
+
+        String payment_hash = fields.payment_hash.toString();
+        NLOG_INFO("PaymentProvider::handlePaymentNotification() - Payment confirmed: %s", payment_hash.c_str());
+        runPaidRequest(payment_hash, entry);
     }
 
     void processConfirmedPayment(const String& payment_hash) {
-        // Find in queue
-        for (auto it = payment_queue.begin(); it != payment_queue.end(); ++it) {
-            if (it->payment_hash == payment_hash) {
-                Serial.println("PaymentProvider::processConfirmedPayment() - Processing payment for method: " + it->method);
-                
-                // Call the callback if set
-                if (payment_callback) {
-                    payment_callback(it->payment_hash, it->original_event_str, it->method, it->value);
-                }
-                
-                // Remove from queue
-                payment_queue.erase(it);
-                Serial.println("PaymentProvider::processConfirmedPayment() - Payment processed and removed from queue");
-                return;
-            }
+        uint8_t hash[32];
+        PaymentJournal::Entry entry;
+
+        // Find in queue and remove it
+        if (nostr::hexDecode(payment_hash, hash, sizeof(hash)) != sizeof(hash) || !takePaidRequest(hash, entry)) {
+            NLOG_DEBUG("PaymentProvider::processConfirmedPayment() - Payment hash not found in queue: %s", payment_hash.c_str());
+            return;
         }
-        Serial.println("PaymentProvider::processConfirmedPayment() - Payment hash not found in queue: " + payment_hash);
+        runPaidRequest(payment_hash, entry);
     }
 
-    void setPaymentCallback(payment_callback_t callback) {
-        payment_callback = callback;
-        Serial.println("PaymentProvider::setPaymentCallback() - Payment callback registered");
+    void markExecuted(const String& payment_hash) {
+        // Full payment hashes and recovered key prefixes alike start with the key
+        uint8_t key[PendingPayments::KEY_SIZE];
+        if (payment_hash.length() < PendingPayments::KEY_SIZE * 2 ||
+            nostr::hexDecode(payment_hash.c_str(), PendingPayments::KEY_SIZE * 2, key, sizeof(key)) != sizeof(key)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(payment_queue_mutex);
+        journal.recordExecute(key);
+        paid_payments.erase(
+            std::remove_if(paid_payments.begin(), paid_payments.end(),
+                [&key](const PaymentJournal::Entry& entry) {
+                    return memcmp(entry.key, key, sizeof(key)) == 0;
+                }),
+            paid_payments.end()
+        );
     }
 
-    String httpPost(const String& url, const String& postData) {
-        HTTPClient http;
-        http.begin(url);
-        
-        int httpResponseCode = http.POST(postData);
-        String response = "";
-        
-        if (httpResponseCode > 0) {
-            response = http.getString();
-            Serial.println("PaymentProvider::httpPost() - HTTP Response code: " + String(httpResponseCode));
-            Serial.println("PaymentProvider::httpPost() - Response: " + response);
-        } else {
-            Serial.println("PaymentProvider::httpPost() - Error in HTTP request: " + String(httpResponseCode));
+    void runRecoveredPayments() {
+        std::vector<PaymentJournal::Entry> recovered;
+        {
+            std::lock_guard<std::mutex> lock(payment_queue_mutex);
+            recovered.swap(recovered_payments);
         }
-        
-        http.end();
-        return response;
+
+        for (const auto& entry : recovered) {
+            DvmRequest request = unpackPayment(entry.payment, entry.event);
+            NLOG_INFO("PaymentProvider::runRecoveredPayments() - Running recovered payment for method: %s", request.method.c_str());
+            if (payment_callback) {
+                payment_callback(nostr::hexEncode(entry.key, PendingPayments::KEY_SIZE), request, entry.payment.price);
+            }
+        }
+    }
+
+    void setPaymentCallback(payment_callback_t callback) {
+        payment_callback = callback;
+        NLOG_INFO("PaymentProvider::setPaymentCallback() - Payment callback registered");
     }
 }
\ No newline at end of file
@@ -3,39 +3,48 @@
 #include <Arduino.h>
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
-#include <HTTPClient.h>
 #include <vector>
 #include <functional>
 #include "config.h"
+#include "dvm_request.h"
+#include "async_https_client.h"
+#include "pending_payments.h"
+#include "request_events.h"
+#include "payment_journal.h"
 
 namespace PaymentProvider {
     
-    // Payment request structure
-    struct PendingPaymentRequest {
-        String payment_hash;         // Key for matching payments
-        String original_event_str;   // Complete original event for response construction
-        String method;               // Method to execute
-        String value;                // Method value parameter
-        unsigned long created_at;    // Request timestamp
-        unsigned long expires_at;    // Payment timeout (15 mins)
-    };
+    // Payment confirmation callback type; price is the quoted amount the request was queued with
+    typedef std::function<void(const String &payment_hash, const DvmRequest &request, int price)> payment_callback_t;
 
-    // Payment confirmation callback type
-    typedef std::function<void(String payment_hash, String original_event_str, String method, String value)> payment_callback_t;
+    // Invoice creation callback: the new invoice, or empty strings on failure
+    typedef std::function<void(const String &payment_hash, const String &bolt11)> invoice_callback_t;
 
     // Core payment provider functions
     void init();
     void cleanup();
     void processLoop();
 
-    // Payment request creation
-    String createPaymentRequest(int amount_sats, const String& memo);
-    String extractPaymentHashFromResponse(const String& invoice_response);
-    String extractBolt11FromResponse(const String& response);
+    // Payment request creation; returns at once, the callback runs from processLoop()
+    // expiry_secs: invoice lifetime asked of LNbits, 0 for its default
+    bool createPaymentRequest(int amount_sats, const String& memo, invoice_callback_t callback, unsigned long expiry_secs = 0);
 
-    // Payment queue management
-    void addToPaymentQueue(const String& payment_hash, const String& original_event_str, const String& method, const String& value);
+    // Payment queue management; false if the request cannot be queued (table full, value too long)
+    bool addToPaymentQueue(const String& payment_hash, const DvmRequest& request, int price);
     void cleanupExpiredPayments();
+    size_t pendingPaymentCount();
+
+    // Pre-minted invoices for fixed prices, refilled from processLoop()
+    void setInvoicePoolPrices(const std::vector<int>& prices);
+    enum ClaimResult {
+        CLAIMED,
+        NO_POOLED_INVOICE, // nothing ready for this price; mint one instead
+        NOT_QUEUED         // the request cannot be queued, so no invoice will do
+    };
+
+    // Take a ready invoice for amount_sats and queue the request against its payment_hash
+    ClaimResult claimPooledInvoice(int amount_sats, const DvmRequest& request, String& bolt11);
+    void refillInvoicePool();
     
     // Payment monitoring
     void initPaymentMonitoring();
@@ -43,13 +52,17 @@ namespace PaymentProvider {
     void handlePaymentNotification(uint8_t* payload, size_t length);
     void processConfirmedPayment(const String& payment_hash);
 
+    // Journal the paid request as run, once its action has been carried out
+    void markExecuted(const String& payment_hash);
+    // Hand paid requests recovered from the journal to the payment callback; once per boot
+    void runRecoveredPayments();
+
     // Callback management
     void setPaymentCallback(payment_callback_t callback);
 
-    // HTTP utilities
-    String httpPost(const String& url, const String& postData);
-
     // Configuration
-    extern const int MAX_QUEUE_SIZE;
     extern const unsigned long PAYMENT_TIMEOUT;
+    extern const size_t INVOICE_POOL_SIZE;
+    extern const unsigned long INVOICE_POOL_EXPIRY;
+    extern const char* JOURNAL_PATH;
 }
\ No newline at end of file
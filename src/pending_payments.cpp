@@ -0,0 +1,234 @@
+/**
+ * @file pending_payments.cpp
+ * @brief Compact hash-indexed table of requests awaiting payment
+ * @version 0.1
+ * @date 2025-10-17
+ */
+
+#include "pending_payments.h"
+
+static_assert((PendingPayments::CAPACITY & (PendingPayments::CAPACITY - 1)) == 0, "PENDING_PAYMENTS_CAPACITY must be a power of two");
+static_assert(PendingPayments::CAPACITY < 0xffff, "PENDING_PAYMENTS_CAPACITY is too large for 16 bit slot numbers");
+
+PendingPayments::~PendingPayments()
+{
+    free(slots);
+}
+
+bool PendingPayments::allocate()
+{
+    if (slots != nullptr)
+    {
+        return true;
+    }
+    size_t size = sizeof(Slot) * CAPACITY;
+#ifdef BOARD_HAS_PSRAM
+    slots = (Slot *)ps_malloc(size);
+#endif
+    if (slots == nullptr)
+    {
+        slots = (Slot *)malloc(size);
+    }
+    if (slots == nullptr)
+    {
+        return false;
+    }
+    wheel_tick = millis() / WHEEL_TICK;
+    clear();
+    return true;
+}
+
+void PendingPayments::clear()
+{
+    for (size_t i = 0; i < INDEX_SIZE; i++)
+    {
+        index[i] = NONE;
+    }
+    for (size_t i = 0; i < WHEEL_SLOTS; i++)
+    {
+        wheel[i] = NONE;
+    }
+    count = 0;
+    free_head = NONE;
+    if (slots == nullptr)
+    {
+        return;
+    }
+    memset(slots, 0, sizeof(Slot) * CAPACITY);
+    for (size_t i = CAPACITY; i-- > 0;)
+    {
+        slots[i].next = free_head;
+        free_head = i;
+    }
+}
+
+size_t PendingPayments::home(const uint8_t *key) const
+{
+    return (key[0] | (key[1] << 8)) & (INDEX_SIZE - 1);
+}
+
+// Position of key in the index, or INDEX_SIZE if it is not there
+size_t PendingPayments::findIndex(const uint8_t *key) const
+{
+    for (size_t pos = home(key); index[pos] != NONE; pos = (pos + 1) & (INDEX_SIZE - 1))
+    {
+        if (memcmp(slots[index[pos]].key, key, KEY_SIZE) == 0)
+        {
+            return pos;
+        }
+    }
+    return INDEX_SIZE;
+}
+
+// Close the gap left at pos so every later key in the probe run stays reachable
+void PendingPayments::removeIndex(size_t pos)
+{
+    index[pos] = NONE;
+    for (size_t next = (pos + 1) & (INDEX_SIZE - 1); index[next] != NONE; next = (next + 1) & (INDEX_SIZE - 1))
+    {
+        size_t from_home = (next - home(slots[index[next]].key)) & (INDEX_SIZE - 1);
+        size_t from_gap = (next - pos) & (INDEX_SIZE - 1);
+        if (from_home >= from_gap)
+        {
+            index[pos] = index[next];
+            index[next] = NONE;
+            pos = next;
+        }
+    }
+}
+
+void PendingPayments::link(uint16_t slot)
+{
+    Slot &entry = slots[slot];
+    entry.bucket = (entry.expires_at / WHEEL_TICK) % WHEEL_SLOTS;
+    entry.prev = NONE;
+    entry.next = wheel[entry.bucket];
+    if (entry.next != NONE)
+    {
+        slots[entry.next].prev = slot;
+    }
+    wheel[entry.bucket] = slot;
+}
+
+void PendingPayments::unlink(uint16_t slot)
+{
+    Slot &entry = slots[slot];
+    if (entry.prev != NONE)
+    {
+        slots[entry.prev].next = entry.next;
+    }
+    else
+    {
+        wheel[entry.bucket] = entry.next;
+    }
+    if (entry.next != NONE)
+    {
+        slots[entry.next].prev = entry.prev;
+    }
+}
+
+void PendingPayments::release(uint16_t slot)
+{
+    unlink(slot);
+    slots[slot].next = free_head;
+    free_head = slot;
+    count--;
+}
+
+bool PendingPayments::insert(const uint8_t payment_hash[32], const Payment &payment, unsigned long timeout_ms)
+{
+    if (!allocate() || findIndex(payment_hash) != INDEX_SIZE || free_head == NONE)
+    {
+        return false;
+    }
+
+    uint16_t slot = free_head;
+    Slot &entry = slots[slot];
+    free_head = entry.next;
+
+    memcpy(entry.key, payment_hash, KEY_SIZE);
+    entry.payment = payment;
+    entry.expires_at = millis() + timeout_ms;
+    link(slot);
+
+    size_t pos = home(payment_hash);
+    while (index[pos] != NONE)
+    {
+        pos = (pos + 1) & (INDEX_SIZE - 1);
+    }
+    index[pos] = slot;
+    count++;
+    return true;
+}
+
+bool PendingPayments::take(const uint8_t payment_hash[32], Payment &payment)
+{
+    if (slots == nullptr)
+    {
+        return false;
+    }
+    size_t pos = findIndex(payment_hash);
+    if (pos == INDEX_SIZE)
+    {
+        return false;
+    }
+    uint16_t slot = index[pos];
+    payment = slots[slot].payment;
+    removeIndex(pos);
+    release(slot);
+    return true;
+}
+
+void PendingPayments::forEach(const std::function<void(const uint8_t key[KEY_SIZE], const Payment &payment)> &visit) const
+{
+    if (slots == nullptr)
+    {
+        return;
+    }
+    for (size_t i = 0; i < INDEX_SIZE; i++)
+    {
+        if (index[i] != NONE)
+        {
+            visit(slots[index[i]].key, slots[index[i]].payment);
+        }
+    }
+}
+
+size_t PendingPayments::expire(unsigned long now, const expired_callback_t &on_expired)
+{
+    unsigned long tick = now / WHEEL_TICK;
+    if (slots == nullptr || count == 0)
+    {
+        wheel_tick = tick;
+        return 0;
+    }
+
+    // Only buckets whose tick has fully passed; entries a revolution or more out stay put
+    size_t expired = 0;
+    unsigned long steps = min(tick - wheel_tick, (unsigned long)WHEEL_SLOTS);
+    for (unsigned long i = 0; i < steps; i++)
+    {
+        uint16_t slot = wheel[(wheel_tick + i) % WHEEL_SLOTS];
+        while (slot != NONE)
+        {
+            uint16_t next = slots[slot].next;
+            if ((long)(now - slots[slot].expires_at) >= 0)
+            {
+                size_t pos = findIndex(slots[slot].key);
+                if (pos != INDEX_SIZE)
+                {
+                    removeIndex(pos);
+                }
+                if (on_expired)
+                {
+                    on_expired(slots[slot].key);
+                }
+                release(slot);
+                expired++;
+            }
+            slot = next;
+        }
+    }
+    wheel_tick = tick;
+    return expired;
+}
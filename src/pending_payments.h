@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+#ifndef PENDING_PAYMENTS_CAPACITY
+#define PENDING_PAYMENTS_CAPACITY 128
+#endif
+
+/**
+ * @brief Requests waiting on an invoice to be paid, keyed by payment_hash
+ *
+ * Entries sit in a fixed slab allocated once (in PSRAM when the board has
+ * it) and hold only what running the method and answering needs, as binary
+ * where possible. An open-addressing index (linear probing, backward-shift
+ * deletion) maps payment hashes to slab slots; payment hashes are SHA-256
+ * outputs, so their leading bytes are used as the hash directly. Expiry runs
+ * off a timer wheel of intrusive lists, so paying and expiring an entry are
+ * both O(1) and nothing ever sweeps the whole table.
+ */
+class PendingPayments {
+public:
+    static const size_t CAPACITY = PENDING_PAYMENTS_CAPACITY;
+    static const size_t MAX_VALUE_LENGTH = 15;
+    static const size_t KEY_SIZE = 16; // payment_hash prefix kept for matching
+
+    struct Payment {
+        uint8_t request_id[32];
+        uint8_t pubkey[32];
+        uint8_t method; // capability index
+        char value[MAX_VALUE_LENGTH + 1];
+        int32_t price;
+    };
+
+    ~PendingPayments();
+
+    typedef std::function<void(const uint8_t key[KEY_SIZE])> expired_callback_t;
+
+    // false if the table is full or already holds payment_hash; only the first KEY_SIZE bytes are kept
+    bool insert(const uint8_t payment_hash[32], const Payment &payment, unsigned long timeout_ms);
+
+    // Remove the entry for payment_hash into payment; false if there is none
+    bool take(const uint8_t payment_hash[32], Payment &payment);
+
+    // Drop entries whose timeout has passed, telling on_expired about each; returns how many
+    size_t expire(unsigned long now, const expired_callback_t &on_expired = nullptr);
+
+    // Visit every entry, e.g. to snapshot the table
+    void forEach(const std::function<void(const uint8_t key[KEY_SIZE], const Payment &payment)> &visit) const;
+
+    size_t size() const { return count; }
+    void clear();
+
+private:
+    static const uint16_t NONE = 0xffff;
+    static const size_t INDEX_SIZE = CAPACITY * 2; // power of two, at most half full
+    static const size_t WHEEL_SLOTS = 32;
+    static const unsigned long WHEEL_TICK = 16000; // ms; one revolution outlasts the payment timeout
+
+    struct Slot {
+        uint8_t key[KEY_SIZE];
+        Payment payment;
+        unsigned long expires_at;
+        uint16_t prev; // timer wheel bucket list, or the free list in next
+        uint16_t next;
+        uint8_t bucket;
+    };
+
+    bool allocate();
+    size_t home(const uint8_t *key) const;
+    size_t findIndex(const uint8_t *key) const;
+    void removeIndex(size_t position);
+    void link(uint16_t slot);
+    void unlink(uint16_t slot);
+    void release(uint16_t slot);
+
+    Slot *slots = nullptr;
+    uint16_t index[INDEX_SIZE];
+    uint16_t wheel[WHEEL_SLOTS];
+    uint16_t free_head = NONE;
+    size_t count = 0;
+    unsigned long wheel_tick = 0; // last tick processed by expire()
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Compile-time perfect hashing of a constant table keyed by name
+ *
+ * For a constexpr array of entries with a `const char *name` member, the
+ * compiler searches for a seed under which every name lands in its own slot
+ * of a power-of-two index, and builds that index. A lookup is then one hash
+ * of the key, one index read and one string compare to confirm the match.
+ *
+ * Everything is written as single-return constexpr functions so it builds as
+ * C++11. The search runs in the compiler, so the table has to stay small
+ * (tens of entries); keep the index at least twice the table size.
+ */
+namespace PerfectHash {
+    static const uint32_t FNV_OFFSET = 2166136261u;
+    static const uint32_t FNV_PRIME = 16777619u;
+
+    // Seeded FNV-1a of a NUL-terminated string
+    constexpr uint32_t hash(const char *key, uint32_t h)
+    {
+        return *key ? hash(key + 1, (h ^ (uint8_t)*key) * FNV_PRIME) : h;
+    }
+
+    constexpr size_t slot(const char *key, uint32_t seed, size_t mask)
+    {
+        return (hash(key, FNV_OFFSET ^ seed) >> 8 ^ hash(key, FNV_OFFSET ^ seed)) & mask;
+    }
+
+    // The same hash for runtime keys, as a loop
+    inline size_t slot(const char *key, size_t length, uint32_t seed, size_t mask)
+    {
+        uint32_t h = FNV_OFFSET ^ seed;
+        for (size_t i = 0; i < length; i++)
+        {
+            h = (h ^ (uint8_t)key[i]) * FNV_PRIME;
+        }
+        return (h >> 8 ^ h) & mask;
+    }
+
+    template <typename T, size_t N>
+    constexpr bool collides(const T (&table)[N], uint32_t seed, size_t mask, size_t i, size_t j)
+    {
+        return j < N && (slot(table[i].name, seed, mask) == slot(table[j].name, seed, mask) || collides(table, seed, mask, i, j + 1));
+    }
+
+    template <typename T, size_t N>
+    constexpr bool distinct(const T (&table)[N], uint32_t seed, size_t mask, size_t i = 0)
+    {
+        return i >= N || (!collides(table, seed, mask, i, i + 1) && distinct(table, seed, mask, i + 1));
+    }
+
+    // First seed that gives every name its own slot
+    template <typename T, size_t N>
+    constexpr uint32_t findSeed(const T (&table)[N], size_t slots, uint32_t seed = 0)
+    {
+        return distinct(table, seed, slots - 1) ? seed : findSeed(table, slots, seed + 1);
+    }
+
+    // Entry whose name lands in slot s, or -1
+    template <typename T, size_t N>
+    constexpr int owner(const T (&table)[N], uint32_t seed, size_t mask, size_t s, size_t i = 0)
+    {
+        return i >= N ? -1 : slot(table[i].name, seed, mask) == s ? (int)i : owner(table, seed, mask, s, i + 1);
+    }
+
+    template <size_t SLOTS>
+    struct Index {
+        int8_t owner[SLOTS]; // entry in each slot, -1 if empty
+    };
+
+    template <size_t... I>
+    struct Sequence {};
+
+    template <size_t N, size_t... I>
+    struct MakeSequence : MakeSequence<N - 1, N - 1, I...> {};
+
+    template <size_t... I>
+    struct MakeSequence<0, I...> {
+        typedef Sequence<I...> type;
+    };
+
+    template <typename T, size_t N, size_t... I>
+    constexpr Index<sizeof...(I)> buildIndex(const T (&table)[N], uint32_t seed, Sequence<I...>)
+    {
+        return Index<sizeof...(I)>{{(int8_t)owner(table, seed, sizeof...(I) - 1, I)...}};
+    }
+
+    /**
+     * @brief The slot index for table, built by the compiler
+     *
+     * static constexpr auto INDEX = PerfectHash::build<16>(TABLE, PerfectHash::findSeed(TABLE, 16));
+     */
+    template <size_t SLOTS, typename T, size_t N>
+    constexpr Index<SLOTS> build(const T (&table)[N], uint32_t seed)
+    {
+        static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+        static_assert(N <= 127 && SLOTS >= 2 * N, "index too small for the table");
+        return buildIndex(table, seed, typename MakeSequence<SLOTS>::type());
+    }
+}
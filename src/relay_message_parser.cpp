@@ -0,0 +1,622 @@
+/**
+ * @file relay_message_parser.cpp
+ * @brief Streaming tokenizer for relay messages
+ * @version 0.1
+ * @date 2025-10-17
+ *
+ * A relay message is ["EVENT", <sub_id>, {event}] or another array tagged
+ * by its first element. Depth 1 is the message, depth 2 the event object,
+ * depth 3 its "tags" array and depth 4 a single tag; only strings and
+ * literals at those positions are captured.
+ */
+
+#include "relay_message_parser.h"
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+void RelayMessageParser::reset()
+{
+    result = Message();
+    state = PARSING;
+    reason = "";
+    position = 0;
+
+    lexer = LEX_VALUE;
+    capture = CAPTURE_NONE;
+    string_is_key = false;
+    depth = 0;
+    arrays = 0;
+    index[0] = 0;
+
+    event_key = KEY_OTHER;
+    tag_name = TAG_OTHER;
+    event_open = false;
+    raw_active = false;
+    raw_overflow = false;
+
+    token_length = 0;
+    token_overflow = false;
+    unicode = 0;
+    unicode_digits = 0;
+    high_surrogate = 0;
+}
+
+RelayMessageParser::Status RelayMessageParser::feed(const uint8_t *data, size_t length)
+{
+    if (state != PARSING)
+    {
+        return state;
+    }
+    if (position + length > MAX_MESSAGE_SIZE)
+    {
+        reject("message too large");
+        return state;
+    }
+
+    // The event object is copied out a span at a time rather than per byte
+    size_t raw_from = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        bool was_raw = raw_active;
+        bool more = step((char)data[i]);
+        position++;
+        if (!was_raw && raw_active)
+        {
+            raw_from = i;
+        }
+        else if (was_raw && !raw_active && !raw_overflow)
+        {
+            appendRaw(data + raw_from, i + 1 - raw_from);
+        }
+        if (!more)
+        {
+            return state;
+        }
+    }
+    if (raw_active)
+    {
+        appendRaw(data + raw_from, length - raw_from);
+    }
+    return state;
+}
+
+RelayMessageParser::Status RelayMessageParser::finish()
+{
+    if (state == PARSING)
+    {
+        reject("message cut short");
+    }
+    return state;
+}
+
+void RelayMessageParser::appendRaw(const uint8_t *data, size_t length)
+{
+    if (result.raw.length() + length > MAX_RAW_SIZE || !result.raw.concat((const char *)data, length))
+    {
+        result.raw = String();
+        raw_overflow = true;
+        raw_active = false;
+    }
+}
+
+bool RelayMessageParser::reject(const char *why)
+{
+    state = REJECTED;
+    reason = why;
+    result.input = String();
+    result.raw = String();
+    return false;
+}
+
+bool RelayMessageParser::inEvent() const
+{
+    return event_open && depth == 2;
+}
+
+bool RelayMessageParser::inTag() const
+{
+    return event_open && depth == 4 && event_key == KEY_TAGS && (arrays & (1 << 3)) && (arrays & (1 << 4));
+}
+
+bool RelayMessageParser::tokenIs(const char *text) const
+{
+    return !token_overflow && strlen(text) == token_length && memcmp(token, text, token_length) == 0;
+}
+
+bool RelayMessageParser::decodeToken(uint8_t out[32]) const
+{
+    if (token_overflow || token_length != 64)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < 32; i++)
+    {
+        int high = hexValue(token[2 * i]);
+        int low = hexValue(token[2 * i + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        out[i] = (high << 4) | low;
+    }
+    return true;
+}
+
+bool RelayMessageParser::put(char c)
+{
+    switch (capture)
+    {
+    case CAPTURE_TOKEN:
+        if (token_length < sizeof(token))
+        {
+            token[token_length++] = c;
+        }
+        else
+        {
+            token_overflow = true;
+        }
+        return true;
+    case CAPTURE_INPUT:
+        if (result.input.length() >= MAX_INPUT_SIZE)
+        {
+            return reject("input tag too large");
+        }
+        result.input += c;
+        return true;
+    default:
+        return true;
+    }
+}
+
+// Write a \u escape out as UTF-8, joining surrogate pairs
+bool RelayMessageParser::emit(uint32_t codepoint)
+{
+    if (codepoint >= 0xd800 && codepoint < 0xdc00)
+    {
+        high_surrogate = codepoint;
+        return true;
+    }
+    if (codepoint >= 0xdc00 && codepoint < 0xe000)
+    {
+        if (high_surrogate == 0)
+        {
+            return reject("unpaired surrogate");
+        }
+        codepoint = 0x10000 + ((high_surrogate - 0xd800) << 10) + (codepoint - 0xdc00);
+    }
+    high_surrogate = 0;
+
+    if (codepoint < 0x80)
+    {
+        return put(codepoint);
+    }
+    if (codepoint < 0x800)
+    {
+        return put(0xc0 | (codepoint >> 6)) && put(0x80 | (codepoint & 0x3f));
+    }
+    if (codepoint < 0x10000)
+    {
+        return put(0xe0 | (codepoint >> 12)) && put(0x80 | ((codepoint >> 6) & 0x3f)) && put(0x80 | (codepoint & 0x3f));
+    }
+    return put(0xf0 | (codepoint >> 18)) && put(0x80 | ((codepoint >> 12) & 0x3f)) &&
+           put(0x80 | ((codepoint >> 6) & 0x3f)) && put(0x80 | (codepoint & 0x3f));
+}
+
+bool RelayMessageParser::step(char c)
+{
+    switch (lexer)
+    {
+    case LEX_STRING:
+        if (c == '"')
+        {
+            return endString();
+        }
+        if (c == '\\')
+        {
+            lexer = LEX_ESCAPE;
+            return true;
+        }
+        if ((uint8_t)c < 0x20)
+        {
+            return reject("control character in string");
+        }
+        return put(c);
+
+    case LEX_ESCAPE:
+        lexer = LEX_STRING;
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            return put(c);
+        case 'b':
+            return put('\b');
+        case 'f':
+            return put('\f');
+        case 'n':
+            return put('\n');
+        case 'r':
+            return put('\r');
+        case 't':
+            return put('\t');
+        case 'u':
+            lexer = LEX_UNICODE;
+            unicode = 0;
+            unicode_digits = 0;
+            return true;
+        default:
+            return reject("bad escape");
+        }
+
+    case LEX_UNICODE:
+    {
+        int nibble = hexValue(c);
+        if (nibble < 0)
+        {
+            return reject("bad escape");
+        }
+        unicode = (unicode << 4) | nibble;
+        if (++unicode_digits < 4)
+        {
+            return true;
+        }
+        lexer = LEX_STRING;
+        return emit(unicode);
+    }
+
+    case LEX_LITERAL:
+        if (isalnum((unsigned char)c) || c == '-' || c == '+' || c == '.')
+        {
+            return put(c);
+        }
+        if (!endLiteral())
+        {
+            return false;
+        }
+        lexer = LEX_AFTER_VALUE;
+        return step(c);
+
+    default:
+        break;
+    }
+
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+    {
+        return true;
+    }
+
+    bool in_array = arrays & (1 << depth);
+    switch (lexer)
+    {
+    case LEX_VALUE:
+        if (c == ']' && in_array)
+        {
+            return close(c);
+        }
+        return beginValue(c);
+
+    case LEX_KEY:
+        if (c == '"')
+        {
+            beginString(true);
+            return true;
+        }
+        if (c == '}')
+        {
+            return close(c);
+        }
+        return reject("expected a key");
+
+    case LEX_COLON:
+        if (c != ':')
+        {
+            return reject("expected a colon");
+        }
+        lexer = LEX_VALUE;
+        return true;
+
+    case LEX_AFTER_VALUE:
+        if (c == ',')
+        {
+            if (in_array)
+            {
+                index[depth]++;
+                lexer = LEX_VALUE;
+            }
+            else
+            {
+                lexer = LEX_KEY;
+            }
+            return true;
+        }
+        if (c == ']' || c == '}')
+        {
+            return close(c);
+        }
+        return reject("expected a comma");
+
+    default:
+        return true;
+    }
+}
+
+bool RelayMessageParser::beginValue(char c)
+{
+    if (depth == 0 && c != '[')
+    {
+        return reject("not a relay message");
+    }
+    if (depth == 1 && index[1] == 0 && c != '"')
+    {
+        return reject("message type is not a string");
+    }
+
+    switch (c)
+    {
+    case '"':
+        beginString(false);
+        return true;
+    case '[':
+        return open(true);
+    case '{':
+        return open(false);
+    default:
+        break;
+    }
+
+    if (!isalnum((unsigned char)c) && c != '-')
+    {
+        return reject("unexpected character");
+    }
+    lexer = LEX_LITERAL;
+    token_length = 0;
+    token_overflow = false;
+    capture = inEvent() && (event_key == KEY_KIND || event_key == KEY_CREATED_AT) ? CAPTURE_TOKEN : CAPTURE_NONE;
+    return put(c);
+}
+
+void RelayMessageParser::beginString(bool key)
+{
+    lexer = LEX_STRING;
+    string_is_key = key;
+    token_length = 0;
+    token_overflow = false;
+    high_surrogate = 0;
+    capture = CAPTURE_NONE;
+
+    if (key)
+    {
+        if (inEvent())
+        {
+            capture = CAPTURE_TOKEN;
+        }
+        return;
+    }
+
+    if (depth == 1 && index[1] == 0)
+    {
+        capture = CAPTURE_TOKEN;
+    }
+    else if (inEvent())
+    {
+        if (event_key == KEY_ID || event_key == KEY_PUBKEY)
+        {
+            capture = CAPTURE_TOKEN;
+        }
+        else if (event_key == KEY_CONTENT)
+        {
+            result.content_offset = position + 1;
+        }
+    }
+    else if (inTag())
+    {
+        if (index[4] == 0)
+        {
+            capture = CAPTURE_TOKEN;
+        }
+        else if (tag_name == TAG_I)
+        {
+            // The last "i" tag wins, its elements joined the way nostr::getTags() does
+            if (index[4] == 1)
+            {
+                result.input = "";
+            }
+            else
+            {
+                result.input += ',';
+            }
+            capture = CAPTURE_INPUT;
+        }
+        else if (tag_name == TAG_P && index[4] == 1 && !result.has_recipient)
+        {
+            capture = CAPTURE_TOKEN;
+        }
+    }
+}
+
+bool RelayMessageParser::endString()
+{
+    lexer = string_is_key ? LEX_COLON : LEX_AFTER_VALUE;
+
+    if (string_is_key)
+    {
+        if (inEvent())
+        {
+            event_key = tokenIs("id")           ? KEY_ID
+                        : tokenIs("pubkey")     ? KEY_PUBKEY
+                        : tokenIs("kind")       ? KEY_KIND
+                        : tokenIs("created_at") ? KEY_CREATED_AT
+                        : tokenIs("tags")       ? KEY_TAGS
+                        : tokenIs("content")    ? KEY_CONTENT
+                                                : KEY_OTHER;
+        }
+        return true;
+    }
+
+    if (depth == 1 && index[1] == 0)
+    {
+        result.type = tokenIs("EVENT")    ? MESSAGE_EVENT
+                      : tokenIs("OK")     ? MESSAGE_OK
+                      : tokenIs("EOSE")   ? MESSAGE_EOSE
+                      : tokenIs("CLOSED") ? MESSAGE_CLOSED
+                      : tokenIs("NOTICE") ? MESSAGE_NOTICE
+                      : tokenIs("AUTH")   ? MESSAGE_AUTH
+                                          : MESSAGE_UNKNOWN;
+        if (result.type != MESSAGE_EVENT)
+        {
+            // Nothing else in these is needed
+            state = COMPLETE;
+            return false;
+        }
+        return true;
+    }
+
+    if (inEvent())
+    {
+        switch (event_key)
+        {
+        case KEY_ID:
+            if (!decodeToken(result.id))
+            {
+                return reject("malformed id");
+            }
+            result.has_id = true;
+            break;
+        case KEY_PUBKEY:
+            if (!decodeToken(result.pubkey))
+            {
+                return reject("malformed pubkey");
+            }
+            result.has_pubkey = true;
+            break;
+        case KEY_CONTENT:
+            result.content_length = position - result.content_offset;
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    if (inTag())
+    {
+        if (index[4] == 0)
+        {
+            tag_name = tokenIs("i")           ? TAG_I
+                       : tokenIs("p")         ? TAG_P
+                       : tokenIs("encrypted") ? TAG_ENCRYPTED
+                                              : TAG_OTHER;
+            if (tag_name == TAG_ENCRYPTED)
+            {
+                result.encrypted = true;
+            }
+        }
+        else if (capture == CAPTURE_TOKEN)
+        {
+            result.has_recipient = decodeToken(result.recipient);
+        }
+    }
+    return true;
+}
+
+bool RelayMessageParser::endLiteral()
+{
+    if (capture != CAPTURE_TOKEN)
+    {
+        return true;
+    }
+    bool is_kind = event_key == KEY_KIND;
+    uint64_t number = 0;
+    bool valid = !token_overflow && token_length > 0 && token_length <= 10;
+    for (size_t i = 0; valid && i < token_length; i++)
+    {
+        valid = token[i] >= '0' && token[i] <= '9';
+        number = number * 10 + (token[i] - '0');
+    }
+    if (!valid || number > (is_kind ? 0xffff : 0xffffffff))
+    {
+        return reject(is_kind ? "malformed kind" : "malformed created_at");
+    }
+    if (is_kind)
+    {
+        result.kind = number;
+        result.has_kind = true;
+    }
+    else
+    {
+        result.created_at = number;
+    }
+    return true;
+}
+
+bool RelayMessageParser::open(bool array)
+{
+    if (depth >= MAX_DEPTH)
+    {
+        return reject("nested too deeply");
+    }
+    depth++;
+    if (array)
+    {
+        arrays |= 1 << depth;
+    }
+    else
+    {
+        arrays &= ~(1 << depth);
+    }
+    index[depth] = 0;
+    lexer = array ? LEX_VALUE : LEX_KEY;
+
+    if (!array && depth == 2 && index[1] == 2 && result.type == MESSAGE_EVENT)
+    {
+        event_open = true;
+        event_key = KEY_OTHER;
+        raw_active = !raw_overflow;
+    }
+    else if (inTag())
+    {
+        tag_name = TAG_OTHER;
+    }
+    return true;
+}
+
+bool RelayMessageParser::close(char c)
+{
+    bool in_array = arrays & (1 << depth);
+    if (depth == 0 || (c == ']') != in_array)
+    {
+        return reject("mismatched bracket");
+    }
+
+    if (inEvent())
+    {
+        // The event is all that is wanted from the message
+        event_open = false;
+        raw_active = false;
+        if (!result.has_id || !result.has_pubkey || !result.has_kind)
+        {
+            return reject("event without id, pubkey or kind");
+        }
+        state = COMPLETE;
+        return false;
+    }
+
+    depth--;
+    lexer = LEX_AFTER_VALUE;
+    if (depth == 0)
+    {
+        lexer = LEX_END;
+        return reject("no event in message");
+    }
+    return true;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Incremental parser for relay messages, fed one WebSocket fragment at a time
+ *
+ * A tokenizer walks the message byte by byte as fragments arrive and keeps
+ * only what the DVM pipeline reads: the message type and, for an EVENT, the
+ * event's id, pubkey, kind, created_at, its "i", first "p" and "encrypted" tags and where
+ * its content lies. Nothing else is stored, so memory use does not depend on
+ * the message size. A message is rejected as soon as it goes past
+ * MAX_MESSAGE_SIZE or MAX_DEPTH, or holds an oversized "i" tag or a malformed
+ * id. The rest of it is then skipped without being parsed.
+ *
+ * The event object is also kept verbatim for the "request" tag of replies,
+ * but only while it fits in MAX_RAW_SIZE.
+ */
+class RelayMessageParser {
+public:
+    static const size_t MAX_MESSAGE_SIZE = 16384;
+    static const size_t MAX_INPUT_SIZE = 1024; // unescaped "i" tag value
+    static const size_t MAX_RAW_SIZE = 2048;   // event kept for the "request" tag
+    static const size_t MAX_DEPTH = 8;
+
+    enum MessageType : uint8_t {
+        MESSAGE_UNKNOWN,
+        MESSAGE_EVENT,
+        MESSAGE_OK,
+        MESSAGE_EOSE,
+        MESSAGE_CLOSED,
+        MESSAGE_NOTICE,
+        MESSAGE_AUTH
+    };
+
+    enum Status : uint8_t {
+        PARSING,
+        COMPLETE, // for anything but EVENT, as soon as the type is known
+        REJECTED
+    };
+
+    struct Message {
+        MessageType type = MESSAGE_UNKNOWN;
+        uint8_t id[32];
+        uint8_t pubkey[32];
+        uint8_t recipient[32]; // first "p" tag
+        uint16_t kind = 0;
+        uint32_t created_at = 0;
+        bool has_id = false;
+        bool has_pubkey = false;
+        bool has_kind = false;
+        bool has_recipient = false;
+        bool encrypted = false;
+        String input;              // "i" tag, unescaped; extra elements comma-joined
+        size_t content_offset = 0; // bytes into the message, escapes not undone
+        size_t content_length = 0;
+        String raw;                // the event object as received, or empty if it was too large
+    };
+
+    RelayMessageParser() { reset(); }
+
+    // Start on a new message
+    void reset();
+
+    // Parse the next fragment; once COMPLETE or REJECTED further fragments are ignored
+    Status feed(const uint8_t *data, size_t length);
+
+    // The last fragment has been fed: a message still PARSING is cut short
+    Status finish();
+
+    Status status() const { return state; }
+    bool started() const { return position > 0; }
+    const char *error() const { return reason; }
+
+    const Message &message() const { return result; }
+    Message &message() { return result; }
+
+private:
+    enum Lexer : uint8_t {
+        LEX_VALUE,       // a value (or, in an array, its end)
+        LEX_AFTER_VALUE, // a comma or the end of the container
+        LEX_KEY,         // an object key (or the end of the object)
+        LEX_COLON,
+        LEX_STRING,
+        LEX_ESCAPE,
+        LEX_UNICODE,
+        LEX_LITERAL,     // number, true, false or null
+        LEX_END
+    };
+
+    enum Capture : uint8_t {
+        CAPTURE_NONE,
+        CAPTURE_TOKEN, // short strings and literals: types, keys, tag names, hex, kind, created_at
+        CAPTURE_INPUT
+    };
+
+    enum EventKey : uint8_t {
+        KEY_OTHER,
+        KEY_ID,
+        KEY_PUBKEY,
+        KEY_KIND,
+        KEY_CREATED_AT,
+        KEY_TAGS,
+        KEY_CONTENT
+    };
+
+    enum TagName : uint8_t {
+        TAG_OTHER,
+        TAG_I,
+        TAG_P,
+        TAG_ENCRYPTED
+    };
+
+    bool step(char c);
+    bool beginValue(char c);
+    void beginString(bool key);
+    bool endString();
+    bool endLiteral();
+    bool open(bool array);
+    bool close(char c);
+    bool emit(uint32_t codepoint);
+    bool put(char c);
+    bool tokenIs(const char *text) const;
+    bool decodeToken(uint8_t out[32]) const;
+    bool inEvent() const;
+    bool inTag() const;
+    void appendRaw(const uint8_t *data, size_t length);
+    bool reject(const char *why);
+
+    Message result;
+    Status state;
+    const char *reason;
+    size_t position;
+
+    Lexer lexer;
+    Capture capture;
+    bool string_is_key;
+    size_t depth;
+    uint16_t arrays;             // bit n: the container at depth n is an array
+    uint16_t index[MAX_DEPTH + 1]; // element number within each array
+
+    EventKey event_key;
+    TagName tag_name;
+    bool event_open;             // inside the event object of an EVENT message
+    bool raw_active;
+    bool raw_overflow;
+
+    char token[72];
+    size_t token_length;
+    bool token_overflow;
+    uint32_t unicode;
+    uint8_t unicode_digits;
+    uint16_t high_surrogate;
+};
@@ -0,0 +1,413 @@
+/**
+ * @file relay_pool.cpp
+ * @brief Connections to several relays with health based slot allocation
+ * @version 0.1
+ * @date 2025-10-16
+ */
+
+#include "relay_pool.h"
+#include "../lib/logger/logger.h"
+
+namespace RelayPool
+{
+    enum RelayState
+    {
+        RELAY_IDLE,
+        RELAY_CONNECTING,
+        RELAY_CONNECTED
+    };
+
+    struct Relay
+    {
+        String url;
+        String host;
+        String path;
+        uint16_t port = 443;
+        bool ssl = true;
+
+        WebSocketsClient *client = nullptr;
+        RelayState state = RELAY_IDLE;
+        bool release = false; // client closed from its own callback; delete it from loop()
+
+        unsigned long attempt_started = 0;
+        unsigned long last_message = 0;
+        unsigned long ping_sent = 0;
+        bool ping_outstanding = false;
+
+        uint32_t rtt_ms = 0; // smoothed, 0 = not measured
+        int failures = 0;    // consecutive
+    };
+
+    static Relay relays[MAX_RELAYS];
+    static size_t relay_count = 0;
+    static size_t max_connections = 1;
+    static bool started = false;
+    static relay_event_callback_t event_callback = nullptr;
+
+    static void parseUrl(Relay &relay, String url)
+    {
+        url.trim();
+        relay.url = url;
+        relay.ssl = !url.startsWith("ws://");
+        relay.port = relay.ssl ? 443 : 80;
+
+        int schemeEnd = url.indexOf("://");
+        String rest = schemeEnd >= 0 ? url.substring(schemeEnd + 3) : url;
+        int pathStart = rest.indexOf('/');
+        relay.path = pathStart >= 0 ? rest.substring(pathStart) : "/";
+        relay.host = pathStart >= 0 ? rest.substring(0, pathStart) : rest;
+
+        int portStart = relay.host.indexOf(':');
+        if (portStart >= 0)
+        {
+            relay.port = relay.host.substring(portStart + 1).toInt();
+            relay.host = relay.host.substring(0, portStart);
+        }
+    }
+
+    static uint32_t score(const Relay &relay)
+    {
+        uint32_t rtt = relay.rtt_ms ? relay.rtt_ms : Config::UNKNOWN_RTT_MS;
+        return rtt + relay.failures * Config::FAILURE_PENALTY_MS;
+    }
+
+    static void updateRtt(Relay &relay, uint32_t sample)
+    {
+        // EWMA with weight 1/4 for the new sample
+        relay.rtt_ms = relay.rtt_ms ? (3 * relay.rtt_ms + sample) / 4 : sample;
+        if (relay.rtt_ms == 0)
+        {
+            relay.rtt_ms = 1;
+        }
+    }
+
+    static void onClientEvent(size_t index, WStype_t type, uint8_t *payload, size_t length)
+    {
+        Relay &relay = relays[index];
+        unsigned long now = millis();
+
+        switch (type)
+        {
+        case WStype_CONNECTED:
+            NLOG_INFO("RelayPool - Connected to %s in %lums", relay.url.c_str(), now - relay.attempt_started);
+            relay.state = RELAY_CONNECTED;
+            relay.failures = 0;
+            relay.last_message = now;
+            relay.ping_sent = now;
+            relay.ping_outstanding = false;
+            break;
+
+        case WStype_DISCONNECTED:
+        case WStype_ERROR:
+            if (relay.state == RELAY_IDLE)
+            {
+                return;
+            }
+            NLOG_WARN("RelayPool - %s from %s", type == WStype_ERROR ? "Error" : "Disconnected", relay.url.c_str());
+            relay.state = RELAY_IDLE;
+            relay.release = true;
+            relay.failures++;
+            break;
+
+        case WStype_PONG:
+            relay.last_message = now;
+            if (relay.ping_outstanding)
+            {
+                updateRtt(relay, now - relay.ping_sent);
+                relay.ping_outstanding = false;
+                NLOG_DEBUG("RelayPool - %s rtt %lums", relay.url.c_str(), (unsigned long)relay.rtt_ms);
+            }
+            break;
+
+        default:
+            relay.last_message = now;
+            break;
+        }
+
+        if (event_callback)
+        {
+            event_callback(index, type, payload, length);
+        }
+    }
+
+    static void closeRelay(size_t index, bool failed)
+    {
+        Relay &relay = relays[index];
+        RelayState previous = relay.state;
+        relay.state = RELAY_IDLE; // so the callback fired by disconnect() is ignored
+        if (relay.client)
+        {
+            relay.client->disconnect();
+            delete relay.client;
+            relay.client = nullptr;
+        }
+        relay.release = false;
+        relay.ping_outstanding = false;
+        if (failed)
+        {
+            relay.failures++;
+        }
+        if (previous == RELAY_CONNECTED && event_callback)
+        {
+            event_callback(index, WStype_DISCONNECTED, nullptr, 0);
+        }
+    }
+
+    static void openRelay(size_t index)
+    {
+        Relay &relay = relays[index];
+        NLOG_INFO("RelayPool - Connecting to %s (attempt %d)", relay.url.c_str(), relay.failures + 1);
+
+        relay.client = new WebSocketsClient();
+        relay.state = RELAY_CONNECTING;
+        relay.attempt_started = millis();
+        relay.client->onEvent([index](WStype_t type, uint8_t *payload, size_t length) {
+            onClientEvent(index, type, payload, length);
+        });
+        if (relay.ssl)
+        {
+            relay.client->beginSSL(relay.host.c_str(), relay.port, relay.path.c_str());
+        }
+        else
+        {
+            relay.client->begin(relay.host.c_str(), relay.port, relay.path.c_str());
+        }
+    }
+
+    static bool readyToRetry(const Relay &relay, unsigned long now)
+    {
+        if (relay.failures == 0 || relay.attempt_started == 0)
+        {
+            return true;
+        }
+        unsigned long backoff = Config::MIN_RECONNECT_INTERVAL * (1UL << min(relay.failures, 5));
+        return now - relay.attempt_started >= backoff;
+    }
+
+    static void fillSlots(unsigned long now)
+    {
+        size_t active = 0;
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            if (relays[i].state != RELAY_IDLE)
+            {
+                active++;
+            }
+        }
+
+        while (active < max_connections)
+        {
+            int best = -1;
+            for (size_t i = 0; i < relay_count; i++)
+            {
+                const Relay &relay = relays[i];
+                if (relay.state != RELAY_IDLE || relay.client != nullptr || !readyToRetry(relay, now))
+                {
+                    continue;
+                }
+                if (best < 0 || score(relay) < score(relays[best]))
+                {
+                    best = i;
+                }
+            }
+            if (best < 0)
+            {
+                return;
+            }
+            openRelay(best);
+            active++;
+        }
+    }
+
+    void init(const String &relayUrls, size_t maxConnections)
+    {
+        disconnect();
+        relay_count = 0;
+
+        int start = 0;
+        while (start <= (int)relayUrls.length() && relay_count < MAX_RELAYS)
+        {
+            int comma = relayUrls.indexOf(',', start);
+            String url = relayUrls.substring(start, comma < 0 ? relayUrls.length() : comma);
+            url.trim();
+            if (url.length() > 0)
+            {
+                relays[relay_count] = Relay();
+                parseUrl(relays[relay_count], url);
+                relay_count++;
+            }
+            if (comma < 0)
+            {
+                break;
+            }
+            start = comma + 1;
+        }
+
+        max_connections = max((size_t)1, min(maxConnections, relay_count));
+        NLOG_INFO("RelayPool::init() - %u relays, up to %u connected", (unsigned)relay_count, (unsigned)max_connections);
+    }
+
+    void setEventCallback(relay_event_callback_t callback)
+    {
+        event_callback = callback;
+    }
+
+    void connect()
+    {
+        started = true;
+        fillSlots(millis());
+    }
+
+    void disconnect()
+    {
+        started = false;
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            closeRelay(i, false);
+        }
+    }
+
+    void loop()
+    {
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            if (relays[i].client)
+            {
+                relays[i].client->loop();
+            }
+        }
+
+        unsigned long now = millis();
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            Relay &relay = relays[i];
+            if (relay.release)
+            {
+                // failure already counted by the callback
+                closeRelay(i, false);
+                continue;
+            }
+
+            if (relay.state == RELAY_CONNECTING && now - relay.attempt_started > Config::CONNECTION_TIMEOUT)
+            {
+                NLOG_WARN("RelayPool - Timed out connecting to %s", relay.url.c_str());
+                closeRelay(i, true);
+            }
+            else if (relay.state == RELAY_CONNECTED)
+            {
+                if (now - relay.last_message > Config::CONNECTION_TIMEOUT)
+                {
+                    NLOG_WARN("RelayPool - No traffic from %s for %lus, dropping it", relay.url.c_str(), (now - relay.last_message) / 1000);
+                    closeRelay(i, true);
+                }
+                else if (now - relay.ping_sent > Config::PING_INTERVAL)
+                {
+                    relay.ping_sent = now;
+                    relay.ping_outstanding = relay.client->sendPing();
+                }
+            }
+        }
+
+        if (started)
+        {
+            fillSlots(now);
+        }
+    }
+
+    size_t publish(const String &message)
+    {
+        size_t sent = 0;
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            if (send(i, message))
+            {
+                sent++;
+            }
+        }
+        if (sent == 0)
+        {
+            NLOG_WARN("RelayPool::publish() - No relay connected, message dropped");
+        }
+        return sent;
+    }
+
+    bool send(size_t relay, const String &message)
+    {
+        if (relay >= relay_count || relays[relay].state != RELAY_CONNECTED)
+        {
+            return false;
+        }
+        return relays[relay].client->sendTXT(message.c_str(), message.length());
+    }
+
+    bool isConnected()
+    {
+        return connectedCount() > 0;
+    }
+
+    bool isRelayConnected(size_t relay)
+    {
+        return relay < relay_count && relays[relay].state == RELAY_CONNECTED;
+    }
+
+    size_t connectedCount()
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            if (relays[i].state == RELAY_CONNECTED)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    size_t relayCount()
+    {
+        return relay_count;
+    }
+
+    String relayUrl(size_t relay)
+    {
+        return relay < relay_count ? relays[relay].url : String();
+    }
+
+    uint32_t relayRtt(size_t relay)
+    {
+        return relay < relay_count ? relays[relay].rtt_ms : 0;
+    }
+
+    String connectedRelayUrls()
+    {
+        String urls;
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            if (relays[i].state == RELAY_CONNECTED)
+            {
+                if (urls.length() > 0)
+                {
+                    urls += ",";
+                }
+                urls += relays[i].url;
+            }
+        }
+        return urls;
+    }
+
+    bool exhausted()
+    {
+        if (relay_count == 0 || isConnected())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < relay_count; i++)
+        {
+            if (relays[i].failures < Config::MAX_RECONNECT_ATTEMPTS)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WebSocketsClient.h>
+#include <functional>
+
+/**
+ * @brief A set of relays, of which the healthiest few hold open sessions
+ *
+ * Each TLS session costs tens of KB of RAM, so only maxConnections relays
+ * are connected at once. Relays are ranked by a smoothed ping RTT plus a
+ * penalty per recent failure; a free slot always goes to the best ranked
+ * relay that is not backing off. A relay that drops is replaced straight
+ * away by the next one instead of the whole device waiting out a backoff.
+ */
+namespace RelayPool {
+    static const size_t MAX_RELAYS = 8;
+
+    // Relay index, then the WebSocketsClient event
+    typedef std::function<void(size_t relay, WStype_t type, uint8_t *payload, size_t length)> relay_event_callback_t;
+
+    /**
+     * @brief Configure the relays
+     *
+     * @param relayUrls comma separated ws:// or wss:// URLs, in order of preference
+     * @param maxConnections how many relays to keep connected at once
+     */
+    void init(const String &relayUrls, size_t maxConnections);
+    void setEventCallback(relay_event_callback_t callback);
+
+    // Start (or stop) keeping maxConnections relays connected
+    void connect();
+    void disconnect();
+
+    // Drive the clients, pings, health checks and slot refills
+    void loop();
+
+    // Send to every connected relay; returns how many accepted it
+    size_t publish(const String &message);
+    bool send(size_t relay, const String &message);
+
+    bool isConnected();
+    bool isRelayConnected(size_t relay);
+    size_t connectedCount();
+    size_t relayCount();
+    String relayUrl(size_t relay);
+    uint32_t relayRtt(size_t relay);
+
+    // Comma separated URLs of the connected relays
+    String connectedRelayUrls();
+
+    // No relay connected and every relay has failed MAX_RECONNECT_ATTEMPTS times in a row
+    bool exhausted();
+
+    namespace Config {
+        const unsigned long PING_INTERVAL = 5000;
+        const unsigned long CONNECTION_TIMEOUT = 30000; // no traffic (or no handshake) for this long drops a relay
+        const unsigned long MIN_RECONNECT_INTERVAL = 5000; // doubled per consecutive failure, capped at 32x
+        const int MAX_RECONNECT_ATTEMPTS = 10;
+        const uint32_t UNKNOWN_RTT_MS = 500; // rank of a relay not measured yet
+        const uint32_t FAILURE_PENALTY_MS = 1000; // added to the rank per consecutive failure
+    }
+}
@@ -0,0 +1,130 @@
+/**
+ * @file request_events.cpp
+ * @brief Bounded store of request events for queued payments
+ * @version 0.1
+ * @date 2025-10-17
+ */
+
+#include "request_events.h"
+
+static_assert(RequestEvents::MAX_EVENT_SIZE <= 0xffff, "REQUEST_EVENT_MAX_SIZE is too large for 16 bit lengths");
+
+RequestEvents::~RequestEvents()
+{
+    free(slots);
+}
+
+bool RequestEvents::allocate()
+{
+    if (slots != nullptr)
+    {
+        return true;
+    }
+    size_t size = sizeof(Slot) * CAPACITY;
+#ifdef BOARD_HAS_PSRAM
+    slots = (Slot *)ps_malloc(size);
+#endif
+    if (slots == nullptr)
+    {
+        slots = (Slot *)malloc(size);
+    }
+    if (slots == nullptr)
+    {
+        return false;
+    }
+    clear();
+    return true;
+}
+
+void RequestEvents::clear()
+{
+    count = 0;
+    if (slots == nullptr)
+    {
+        return;
+    }
+    for (size_t i = 0; i < CAPACITY; i++)
+    {
+        slots[i].length = 0;
+    }
+}
+
+// Slot holding key, or -1; the slab is small enough that a scan beats an index
+int RequestEvents::findSlot(const uint8_t *key) const
+{
+    if (slots == nullptr)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < CAPACITY; i++)
+    {
+        if (slots[i].length > 0 && memcmp(slots[i].key, key, KEY_SIZE) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool RequestEvents::put(const uint8_t key[KEY_SIZE], const char *event, size_t length)
+{
+    if (length == 0 || length > MAX_EVENT_SIZE || !allocate())
+    {
+        remove(key);
+        return false;
+    }
+
+    int slot = findSlot(key);
+    if (slot < 0)
+    {
+        for (size_t i = 0; i < CAPACITY; i++)
+        {
+            if (slots[i].length == 0)
+            {
+                slot = i;
+                count++;
+                break;
+            }
+        }
+    }
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    memcpy(slots[slot].key, key, KEY_SIZE);
+    memcpy(slots[slot].data, event, length);
+    slots[slot].length = length;
+    return true;
+}
+
+bool RequestEvents::find(const uint8_t key[KEY_SIZE], String &event) const
+{
+    int slot = findSlot(key);
+    if (slot < 0)
+    {
+        return false;
+    }
+    event = String(slots[slot].data, slots[slot].length);
+    return true;
+}
+
+bool RequestEvents::take(const uint8_t key[KEY_SIZE], String &event)
+{
+    if (!find(key, event))
+    {
+        return false;
+    }
+    remove(key);
+    return true;
+}
+
+void RequestEvents::remove(const uint8_t key[KEY_SIZE])
+{
+    int slot = findSlot(key);
+    if (slot >= 0)
+    {
+        slots[slot].length = 0;
+        count--;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef REQUEST_EVENTS_CAPACITY
+#define REQUEST_EVENTS_CAPACITY 16
+#endif
+
+#ifndef REQUEST_EVENT_MAX_SIZE
+#define REQUEST_EVENT_MAX_SIZE 1024
+#endif
+
+/**
+ * @brief Original request events of queued payments, for the "request" tag
+ *
+ * A PendingPayments entry has no room for the event JSON, so it is kept
+ * here beside the table under the same payment_hash prefix. Storage is a
+ * fixed slab of CAPACITY slots of MAX_EVENT_SIZE bytes, allocated once (in
+ * PSRAM when the board has it). An event that is too large, or that arrives
+ * when every slot is taken, is not kept; the result for that request is
+ * then published without its "request" tag.
+ */
+class RequestEvents {
+public:
+    static const size_t CAPACITY = REQUEST_EVENTS_CAPACITY;
+    static const size_t MAX_EVENT_SIZE = REQUEST_EVENT_MAX_SIZE;
+    static const size_t KEY_SIZE = 16; // payment_hash prefix, as in PendingPayments
+
+    ~RequestEvents();
+
+    // Keep event under key, replacing any event already there; false if it is not kept
+    bool put(const uint8_t key[KEY_SIZE], const char *event, size_t length);
+
+    // Copy the event for key into event; false if there is none
+    bool find(const uint8_t key[KEY_SIZE], String &event) const;
+
+    // Move the event for key into event and free its slot; false if there is none
+    bool take(const uint8_t key[KEY_SIZE], String &event);
+
+    void remove(const uint8_t key[KEY_SIZE]);
+
+    size_t size() const { return count; }
+    void clear();
+
+private:
+    struct Slot {
+        uint8_t key[KEY_SIZE];
+        uint16_t length; // 0 when the slot is free
+        char data[MAX_EVENT_SIZE];
+    };
+
+    bool allocate();
+    int findSlot(const uint8_t *key) const;
+
+    Slot *slots = nullptr;
+    size_t count = 0;
+};
@@ -0,0 +1,233 @@
+/**
+ * @file request_worker.cpp
+ * @brief Worker task and queues between the network loop and request handling
+ * @version 0.1
+ * @date 2025-10-17
+ *
+ * Queue entries are heap allocated work_t pointers, so the FreeRTOS queues
+ * only ever copy a pointer. Whoever takes an entry off a queue deletes it.
+ *
+ * Held work lives in a deque that only the network loop touches. Its size
+ * is bounded by its callers: one entry per paid request.
+ */
+
+#include "request_worker.h"
+#include "../lib/logger/logger.h"
+#include <deque>
+
+namespace RequestWorker
+{
+    static size_t max_depth = 0;
+    static uint32_t dropped_count = 0;
+    static uint32_t processed_count = 0;
+    static uint32_t dropped_post_count = 0;
+    static std::deque<work_t> held_work;
+
+    static bool enqueue(work_t &work);
+
+    bool submit(work_t work)
+    {
+        // Held work goes first; new work waits behind it like it would behind a full queue
+        if (!held_work.empty() || !enqueue(work))
+        {
+            dropped_count++;
+            NLOG_WARN("RequestWorker::submit() - Queue full, dropped request (%lu dropped so far)", (unsigned long)dropped_count);
+            return false;
+        }
+        return true;
+    }
+
+    void submitOrHold(work_t work)
+    {
+        if (held_work.empty() && enqueue(work))
+        {
+            return;
+        }
+        held_work.push_back(std::move(work));
+        NLOG_WARN("RequestWorker::submitOrHold() - Queue full, holding work (%u held)", (unsigned)held_work.size());
+    }
+
+    // Move held work into the queue, oldest first, while there is room
+    static void resubmitHeld()
+    {
+        while (!held_work.empty() && enqueue(held_work.front()))
+        {
+            held_work.pop_front();
+        }
+    }
+
+#ifndef NATIVE_BUILD
+    static QueueHandle_t work_queue = NULL;
+    static QueueHandle_t post_queue = NULL;
+    static TaskHandle_t worker_task_handle = NULL;
+
+    static void workerTask(void *parameter)
+    {
+        NLOG_INFO("RequestWorker - Worker task started");
+        while (true)
+        {
+            work_t *work = nullptr;
+            if (xQueueReceive(work_queue, &work, portMAX_DELAY) == pdTRUE)
+            {
+                (*work)();
+                delete work;
+                processed_count++;
+            }
+        }
+    }
+
+    void init()
+    {
+        if (worker_task_handle != NULL)
+        {
+            return;
+        }
+
+        work_queue = xQueueCreate(Config::QUEUE_DEPTH, sizeof(work_t *));
+        post_queue = xQueueCreate(Config::POST_QUEUE_DEPTH, sizeof(work_t *));
+        if (work_queue == NULL || post_queue == NULL ||
+            xTaskCreate(workerTask, "request_worker", Config::TASK_STACK_SIZE, NULL, Config::TASK_PRIORITY, &worker_task_handle) != pdPASS)
+        {
+            NLOG_ERROR("RequestWorker::init() - Could not start the worker task, requests will be handled inline");
+            worker_task_handle = NULL;
+            return;
+        }
+        NLOG_INFO("RequestWorker::init() - Queue depth %u", (unsigned)Config::QUEUE_DEPTH);
+    }
+
+    // Hand work to the worker; false (and work left untouched) if the queue is full
+    static bool enqueue(work_t &work)
+    {
+        if (worker_task_handle == NULL)
+        {
+            work();
+            processed_count++;
+            return true;
+        }
+
+        work_t *entry = new work_t(std::move(work));
+        if (xQueueSend(work_queue, &entry, 0) != pdTRUE)
+        {
+            work = std::move(*entry);
+            delete entry;
+            return false;
+        }
+
+        size_t depth = uxQueueMessagesWaiting(work_queue);
+        if (depth > max_depth)
+        {
+            max_depth = depth;
+        }
+        return true;
+    }
+
+    bool post(work_t work)
+    {
+        if (worker_task_handle == NULL)
+        {
+            work();
+            return true;
+        }
+
+        work_t *entry = new work_t(std::move(work));
+        if (xQueueSend(post_queue, &entry, pdMS_TO_TICKS(Config::POST_TIMEOUT)) != pdTRUE)
+        {
+            delete entry;
+            dropped_post_count++;
+            NLOG_WARN("RequestWorker::post() - Network loop not keeping up, dropped reply");
+            return false;
+        }
+        return true;
+    }
+
+    void poll()
+    {
+        resubmitHeld();
+        if (post_queue == NULL)
+        {
+            return;
+        }
+
+        work_t *entry = nullptr;
+        while (xQueueReceive(post_queue, &entry, 0) == pdTRUE)
+        {
+            (*entry)();
+            delete entry;
+        }
+    }
+
+    size_t queueDepth()
+    {
+        return work_queue != NULL ? uxQueueMessagesWaiting(work_queue) : 0;
+    }
+#else
+    static std::deque<work_t> work_queue;
+
+    void init()
+    {
+    }
+
+    static bool enqueue(work_t &work)
+    {
+        if (work_queue.size() >= Config::QUEUE_DEPTH)
+        {
+            return false;
+        }
+        work_queue.push_back(std::move(work));
+        if (work_queue.size() > max_depth)
+        {
+            max_depth = work_queue.size();
+        }
+        return true;
+    }
+
+    bool post(work_t work)
+    {
+        work();
+        return true;
+    }
+
+    void poll()
+    {
+        resubmitHeld();
+        while (!work_queue.empty())
+        {
+            work_t work = std::move(work_queue.front());
+            work_queue.pop_front();
+            work();
+            processed_count++;
+            resubmitHeld();
+        }
+    }
+
+    size_t queueDepth()
+    {
+        return work_queue.size();
+    }
+#endif
+
+    size_t maxQueueDepth()
+    {
+        return max_depth;
+    }
+
+    uint32_t droppedCount()
+    {
+        return dropped_count;
+    }
+
+    uint32_t processedCount()
+    {
+        return processed_count;
+    }
+
+    uint32_t droppedPostCount()
+    {
+        return dropped_post_count;
+    }
+
+    size_t heldCount()
+    {
+        return held_work.size();
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+
+/**
+ * @brief Runs request handling on its own task so the network loop never blocks
+ *
+ * The network loop hands work (a copied relay frame, a confirmed payment)
+ * to a bounded queue and goes straight back to servicing sockets. A worker
+ * task does the parsing, invoicing, provider calls and signing. Anything the
+ * worker wants sent is posted back and run by the network loop in poll(), so
+ * only the network loop ever touches a WebSocketsClient.
+ *
+ * A full queue drops the new work and counts it instead of stalling the
+ * network loop. Work that must not be lost (a request that has been paid
+ * for) is held on the network side instead and resubmitted from poll(),
+ * ahead of any new work.
+ *
+ * The native build has no FreeRTOS: queued work runs inline from poll() and
+ * posted work runs straight away.
+ */
+namespace RequestWorker {
+    typedef std::function<void()> work_t;
+
+    // Create the queues and start the worker task
+    void init();
+
+    // From the network loop: queue work for the worker; false if it was dropped
+    bool submit(work_t work);
+
+    // From the network loop: queue work for the worker, holding it until poll() finds room if the queue is full
+    void submitOrHold(work_t work);
+
+    // From the worker: queue work for the network loop; false if it was dropped
+    bool post(work_t work);
+
+    // From the network loop: resubmit held work, then run everything the worker has posted
+    void poll();
+
+    // Metrics
+    size_t queueDepth();
+    size_t maxQueueDepth();   // high-water mark since init
+    uint32_t droppedCount();  // inbound work turned away because the queue was full
+    uint32_t processedCount();
+    uint32_t droppedPostCount();
+    size_t heldCount();       // work waiting for room in the queue
+
+    namespace Config {
+        const size_t QUEUE_DEPTH = 8;
+        const size_t POST_QUEUE_DEPTH = 16;
+        const unsigned long POST_TIMEOUT = 1000; // ms the worker waits for room before dropping a reply
+        const uint32_t TASK_STACK_SIZE = 8192;    // same as the Arduino loop task, which used to run this work
+        const unsigned int TASK_PRIORITY = 1;
+    }
+}
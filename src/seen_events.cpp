@@ -0,0 +1,92 @@
+/**
+ * @file seen_events.cpp
+ * @brief Duplicate event filter for relay redeliveries
+ * @version 0.1
+ * @date 2025-10-16
+ *
+ * Relays redeliver events after a REQ renewal or a reconnect. The id comes
+ * from the streaming relay message parser, so a duplicate is dropped before
+ * any invoicing or signing.
+ */
+
+#include "seen_events.h"
+
+void SeenEvents::setBloomBits(const uint8_t idPrefix[8])
+{
+    for (size_t i = 0; i < 6; i += 2)
+    {
+        size_t bit = (idPrefix[i] | (idPrefix[i + 1] << 8)) % BLOOM_BITS;
+        bloom[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+bool SeenEvents::testBloomBits(const uint8_t idPrefix[8]) const
+{
+    for (size_t i = 0; i < 6; i += 2)
+    {
+        size_t bit = (idPrefix[i] | (idPrefix[i + 1] << 8)) % BLOOM_BITS;
+        if (!(bloom[bit / 8] & (1 << (bit % 8))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SeenEvents::contains(const uint8_t idPrefix[8]) const
+{
+    if (!testBloomBits(idPrefix))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (memcmp(ring[i], idPrefix, 8) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SeenEvents::checkAndInsert(const uint8_t idPrefix[8])
+{
+    if (contains(idPrefix))
+    {
+        return true;
+    }
+    insert(idPrefix);
+    return false;
+}
+
+void SeenEvents::insert(const uint8_t idPrefix[8])
+{
+    memcpy(ring[head], idPrefix, 8);
+    head = (head + 1) % SEEN_EVENTS_CAPACITY;
+    if (count < SEEN_EVENTS_CAPACITY)
+    {
+        count++;
+    }
+
+    // The bloom filter cannot forget, so rebuild it from the ring each time the ring wraps
+    if (head == 0)
+    {
+        memset(bloom, 0, sizeof(bloom));
+        for (size_t i = 0; i < count; i++)
+        {
+            setBloomBits(ring[i]);
+        }
+    }
+    else
+    {
+        setBloomBits(idPrefix);
+    }
+}
+
+void SeenEvents::clear()
+{
+    memset(ring, 0, sizeof(ring));
+    memset(bloom, 0, sizeof(bloom));
+    head = 0;
+    count = 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Remembers recently handled event ids so relay redeliveries are dropped
+ *
+ * Holds the first 8 bytes of the last SEEN_EVENTS_CAPACITY ids in a ring,
+ * fronted by a small bloom filter so an unseen id is usually rejected
+ * without scanning the ring. Event ids are SHA-256 hashes, so the prefix
+ * bytes are used directly as the bloom hashes.
+ */
+class SeenEvents {
+public:
+    static const size_t SEEN_EVENTS_CAPACITY = 64;
+
+    // true if the id was seen before; otherwise remembers it and returns false
+    bool checkAndInsert(const uint8_t idPrefix[8]);
+
+    // Lookup and insert apart, for callers that only remember an id once it has been taken on
+    bool contains(const uint8_t idPrefix[8]) const;
+    void insert(const uint8_t idPrefix[8]);
+
+    void clear();
+
+private:
+    static const size_t BLOOM_BITS = 1024;
+
+    void setBloomBits(const uint8_t idPrefix[8]);
+    bool testBloomBits(const uint8_t idPrefix[8]) const;
+
+    uint8_t ring[SEEN_EVENTS_CAPACITY][8] = {};
+    size_t head = 0;
+    size_t count = 0;
+    uint8_t bloom[BLOOM_BITS / 8] = {};
+};
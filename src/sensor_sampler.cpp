@@ -0,0 +1,210 @@
+/**
+ * @file sensor_sampler.cpp
+ * @brief Background sensor sampling into per-sensor rings of timestamped readings
+ * @version 0.1
+ * @date 2025-10-17
+ *
+ * The sampler task sleeps until the next sensor is due, reads it with no
+ * lock held and then stores the sample under the lock, overwriting the
+ * oldest once the ring is full.
+ */
+
+#include "sensor_sampler.h"
+#include "../lib/logger/logger.h"
+#include <mutex>
+#include <climits>
+
+namespace SensorSampler
+{
+    struct Sample
+    {
+        float values[Config::MAX_CHANNELS];
+        unsigned long at;
+    };
+
+    struct Sensor
+    {
+        const char *name;
+        size_t channels;
+        unsigned long interval;
+        read_t read;
+        unsigned long next_due; // only touched by the sampler
+        Sample ring[Config::HISTORY];
+        size_t head;            // next slot written
+        size_t count;
+    };
+
+    static Sensor sensors[Config::MAX_SENSORS];
+    static size_t sensor_count = 0;
+    static bool started = false;
+    static std::mutex sample_mutex;
+    static uint32_t sample_count = 0;
+    static uint32_t failed_count = 0;
+
+    int addSensor(const char *name, size_t channels, unsigned long interval_ms, read_t read)
+    {
+        if (started || sensor_count >= Config::MAX_SENSORS || channels == 0 || channels > Config::MAX_CHANNELS || read == nullptr)
+        {
+            NLOG_ERROR("SensorSampler::addSensor() - Cannot add sensor %s", name);
+            return -1;
+        }
+
+        Sensor &sensor = sensors[sensor_count];
+        sensor.name = name;
+        sensor.channels = channels;
+        sensor.interval = interval_ms;
+        sensor.read = read;
+        sensor.next_due = 0;
+        sensor.head = 0;
+        sensor.count = 0;
+        NLOG_INFO("SensorSampler::addSensor() - Sensor %s, %u channels every %lu ms", name, (unsigned)channels, interval_ms);
+        return sensor_count++;
+    }
+
+    static void sample(Sensor &sensor)
+    {
+        Sample taken;
+        if (!sensor.read(taken.values))
+        {
+            failed_count++;
+            NLOG_WARN("SensorSampler::sample() - Reading %s failed", sensor.name);
+            return;
+        }
+        taken.at = millis();
+
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        sensor.ring[sensor.head] = taken;
+        sensor.head = (sensor.head + 1) % Config::HISTORY;
+        if (sensor.count < Config::HISTORY)
+        {
+            sensor.count++;
+        }
+        sample_count++;
+    }
+
+    // Read every sensor that is due; returns ms until the next one is
+    static unsigned long sampleDue(unsigned long now)
+    {
+        unsigned long wait = ULONG_MAX;
+        for (size_t i = 0; i < sensor_count; i++)
+        {
+            Sensor &sensor = sensors[i];
+            if ((long)(now - sensor.next_due) >= 0)
+            {
+                sample(sensor);
+                // A late read does not bunch up the ones after it
+                sensor.next_due = now + sensor.interval;
+            }
+            unsigned long until = sensor.next_due - now;
+            if (until < wait)
+            {
+                wait = until;
+            }
+        }
+        return wait;
+    }
+
+    static void firstSample()
+    {
+        unsigned long now = millis();
+        for (size_t i = 0; i < sensor_count; i++)
+        {
+            sensors[i].next_due = now;
+        }
+        sampleDue(now);
+    }
+
+#ifndef NATIVE_BUILD
+    static TaskHandle_t sampler_task_handle = NULL;
+
+    static void samplerTask(void *parameter)
+    {
+        NLOG_INFO("SensorSampler - Sampler task started");
+        while (true)
+        {
+            TickType_t wait = pdMS_TO_TICKS(sampleDue(millis()));
+            vTaskDelay(wait > 0 ? wait : 1);
+        }
+    }
+
+    void init()
+    {
+        if (started)
+        {
+            return;
+        }
+        started = true;
+        if (sensor_count == 0)
+        {
+            return;
+        }
+
+        // Readings are there before the first request arrives
+        firstSample();
+        if (xTaskCreate(samplerTask, "sensor_sampler", Config::TASK_STACK_SIZE, NULL, Config::TASK_PRIORITY, &sampler_task_handle) != pdPASS)
+        {
+            NLOG_ERROR("SensorSampler::init() - Could not start the sampler task, readings will not be refreshed");
+            sampler_task_handle = NULL;
+            return;
+        }
+        NLOG_INFO("SensorSampler::init() - Sampling %u sensors", (unsigned)sensor_count);
+    }
+#else
+    void init()
+    {
+        if (started)
+        {
+            return;
+        }
+        started = true;
+        firstSample();
+    }
+#endif
+
+    static void refresh()
+    {
+#ifdef NATIVE_BUILD
+        // No sampler task: read whatever has come due
+        sampleDue(millis());
+#endif
+    }
+
+    static bool findSensor(int sensor, size_t channel)
+    {
+        return sensor >= 0 && (size_t)sensor < sensor_count && channel < sensors[sensor].channels;
+    }
+
+    bool latest(int sensor, size_t channel, Reading &reading, unsigned long max_age_ms)
+    {
+        if (!findSensor(sensor, channel))
+        {
+            return false;
+        }
+        refresh();
+
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        const Sensor &source = sensors[sensor];
+        if (source.count == 0)
+        {
+            return false;
+        }
+        const Sample &newest = source.ring[(source.head + Config::HISTORY - 1) % Config::HISTORY];
+        if (max_age_ms > 0 && millis() - newest.at > max_age_ms)
+        {
+            return false;
+        }
+        reading.value = newest.values[channel];
+        reading.at = newest.at;
+        return true;
+    }
+
+    uint32_t sampleCount()
+    {
+        return sample_count;
+    }
+
+    uint32_t failedCount()
+    {
+        return failed_count;
+    }
+}
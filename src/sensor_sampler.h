@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Samples sensors on a task of their own so requests answer from memory
+ *
+ * Each registered sensor is read on its own interval by the sampler task and
+ * the result kept, with the time it was taken, in a ring of the last
+ * Config::HISTORY samples. One read is a single bus transaction and may fill
+ * several channels (temperature and humidity from one chip, say), so several
+ * methods can be served by it. Readers only ever take the lock to copy a
+ * sample out; the bus is read with the lock released.
+ *
+ * Sensors are registered before init() and never removed.
+ *
+ * The native build has no FreeRTOS: a sensor that is due is read inline when
+ * a reading is asked for.
+ */
+namespace SensorSampler {
+    // One bus transaction: fill values[0..channels) and return true, or false if the read failed
+    typedef bool (*read_t)(float *values);
+
+    struct Reading {
+        float value;
+        unsigned long at; // millis() when it was sampled
+    };
+
+    // Register a sensor read every interval_ms; returns its id, or -1 if there is no room or init() has run
+    int addSensor(const char *name, size_t channels, unsigned long interval_ms, read_t read);
+
+    // Start the sampler task; every sensor is read once straight away
+    void init();
+
+    // Newest reading of a channel, false if there is none or it is older than max_age_ms (0 for any age)
+    bool latest(int sensor, size_t channel, Reading &reading, unsigned long max_age_ms = 0);
+
+    // Metrics
+    uint32_t sampleCount();
+    uint32_t failedCount();
+
+    namespace Config {
+        const size_t MAX_SENSORS = 4;
+        const size_t MAX_CHANNELS = 4;
+        const size_t HISTORY = 16;             // samples kept per sensor
+        const uint32_t TASK_STACK_SIZE = 4096;
+        const unsigned int TASK_PRIORITY = 1;
+    }
+}
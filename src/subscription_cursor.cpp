@@ -0,0 +1,158 @@
+/**
+ * @file subscription_cursor.cpp
+ * @brief Persisted resume point for the job request subscription
+ * @version 0.1
+ * @date 2025-10-17
+ */
+
+#include "subscription_cursor.h"
+#include "../lib/logger/logger.h"
+#include <Preferences.h>
+
+static const char *PREFS_NAMESPACE = "sub_cursor";
+
+void SubscriptionCursor::begin()
+{
+    Preferences prefs;
+    prefs.begin(PREFS_NAMESPACE, true);
+    since = prefs.getUInt("since", 0);
+    if (prefs.getBytes("last_id", last_id, sizeof(last_id)) != sizeof(last_id))
+    {
+        memset(last_id, 0, sizeof(last_id));
+    }
+    prefs.end();
+
+    dirty = false;
+    last_save = millis();
+    NLOG_INFO("SubscriptionCursor::begin() - Resuming from created_at %lu", (unsigned long)since);
+}
+
+uint32_t SubscriptionCursor::resumeFrom(uint32_t now, uint32_t not_after) const
+{
+    // since is inclusive: the last event processed comes back, and is dropped as a duplicate
+    uint32_t from = since;
+    if (not_after != 0 && (from == 0 || not_after < from))
+    {
+        from = not_after;
+    }
+    if (from != 0 && now - MAX_CATCH_UP_AGE > from)
+    {
+        from = now - MAX_CATCH_UP_AGE;
+    }
+    return from;
+}
+
+String SubscriptionCursor::pageFilter(uint32_t since, uint32_t until)
+{
+    if (since == 0)
+    {
+        return ",\"limit\":0";
+    }
+    String filter = ",\"since\":" + String((unsigned long)since);
+    if (until != 0)
+    {
+        filter += ",\"until\":" + String((unsigned long)until);
+    }
+    return filter + ",\"limit\":" + String(CATCH_UP_LIMIT);
+}
+
+void SubscriptionCursor::advance(uint32_t created_at, const uint8_t idPrefix[8])
+{
+    if (created_at < since)
+    {
+        return;
+    }
+    since = created_at;
+    memcpy(last_id, idPrefix, sizeof(last_id));
+    dirty = true;
+}
+
+void SubscriptionCursor::caughtUp(uint32_t now)
+{
+    if (since == 0 && now >= MIN_VALID_TIME)
+    {
+        since = now;
+        dirty = true;
+    }
+}
+
+void SubscriptionCursor::save(bool force)
+{
+    unsigned long now = millis();
+    if (!dirty || (!force && now - last_save < SAVE_INTERVAL))
+    {
+        return;
+    }
+
+    Preferences prefs;
+    prefs.begin(PREFS_NAMESPACE, false);
+    prefs.putUInt("since", since);
+    prefs.putBytes("last_id", last_id, sizeof(last_id));
+    prefs.end();
+
+    dirty = false;
+    last_save = now;
+    NLOG_DEBUG("SubscriptionCursor::save() - Saved created_at %lu", (unsigned long)since);
+}
+
+void CatchUpPager::begin(uint32_t from)
+{
+    since = from;
+    until = 0;
+    newest = 0;
+    paged = false;
+    is_active = true;
+    startPage();
+}
+
+void CatchUpPager::startPage()
+{
+    page_oldest = 0;
+    page_events = 0;
+}
+
+void CatchUpPager::event(uint32_t created_at)
+{
+    if (page_events == 0 || created_at < page_oldest)
+    {
+        page_oldest = created_at;
+    }
+    if (created_at > newest)
+    {
+        newest = created_at;
+    }
+    page_events++;
+}
+
+CatchUpPager::Step CatchUpPager::endPage()
+{
+    if (page_events >= SubscriptionCursor::CATCH_UP_LIMIT)
+    {
+        // There may be more, older events; ask for the ones up to the oldest of this page
+        if (until == 0 || page_oldest < until)
+        {
+            until = page_oldest < since ? since : page_oldest;
+            paged = true;
+            startPage();
+            return PAGE_BACK;
+        }
+        NLOG_WARN("CatchUpPager::endPage() - More than %u events at created_at %lu, the rest are lost",
+                  (unsigned)SubscriptionCursor::CATCH_UP_LIMIT, (unsigned long)until);
+    }
+
+    if (paged)
+    {
+        // Events published while paging come with the reopened subscription
+        if (newest > since)
+        {
+            since = newest;
+        }
+        until = 0;
+        paged = false;
+        startPage();
+        return REJOIN;
+    }
+
+    is_active = false;
+    return DONE;
+}
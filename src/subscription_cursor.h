@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief How far the job request subscription has got, so a reconnect resumes without gaps
+ *
+ * The newest created_at handled is kept in NVS, with the id of that event.
+ * After a reconnect or a reboot the subscription asks for events since then,
+ * going back at most MAX_CATCH_UP_AGE, instead of "limit":0. Requests
+ * published while the device was away are still answered, and old history
+ * is not replayed. The age limit needs the time of day, so a resume waits
+ * for NTP; until then the subscription is live only.
+ *
+ * NVS writes are spaced SAVE_INTERVAL apart to spare the flash. A reboot can
+ * therefore replay the last few seconds of requests.
+ */
+class SubscriptionCursor {
+public:
+    static const uint16_t CATCH_UP_LIMIT = 20;        // events asked for per catch-up page
+    static const uint32_t MAX_CATCH_UP_AGE = 60 * 60; // seconds
+    static const uint32_t MIN_VALID_TIME = 1600000000; // anything earlier is a clock that has not been set
+    static const unsigned long SAVE_INTERVAL = 5000;  // ms between NVS writes
+
+    // Load the saved position
+    void begin();
+
+    /**
+     * @brief Where a resuming subscription should start
+     *
+     * @param now unix time; must be at least MIN_VALID_TIME
+     * @param not_after an earlier point to resume from instead, e.g. the
+     *        oldest event dropped while the device was busy; 0 for none
+     * @return the "since" to ask for, or 0 if there is nothing to catch up on
+     */
+    uint32_t resumeFrom(uint32_t now, uint32_t not_after = 0) const;
+
+    /**
+     * @brief The filter fields that go after "kinds" and "#p" in the REQ
+     *
+     * @param since 0 for a live-only subscription
+     * @param until 0 for no upper bound
+     * @return e.g. ,"since":1700000000,"until":1700000100,"limit":20
+     */
+    static String pageFilter(uint32_t since, uint32_t until = 0);
+
+    // An event has been handled
+    void advance(uint32_t created_at, const uint8_t idPrefix[8]);
+
+    // The catch-up has finished; a cursor that has never moved starts from now
+    void caughtUp(uint32_t now);
+
+    // Write the position out if it moved, at most once per SAVE_INTERVAL unless forced
+    void save(bool force = false);
+
+    uint32_t position() const { return since; }
+    // Id of the newest event processed, all zeros if none
+    const uint8_t *lastId() const { return last_id; }
+
+private:
+    uint32_t since = 0;
+    uint8_t last_id[8] = {};
+    bool dirty = false;
+    unsigned long last_save = 0;
+};
+
+/**
+ * @brief Pages one relay's stored events back to the resume point
+ *
+ * With a "limit" a relay sends the newest matching events, so a single
+ * resuming REQ would lose the oldest ones once more than CATCH_UP_LIMIT were
+ * missed. A page that comes back full is followed by another REQ with
+ * "until" at the oldest created_at it held; the events of that second come
+ * again and are dropped as duplicates. Paging ends at a page that is not
+ * full, or at one that cannot move "until" back because CATCH_UP_LIMIT events
+ * share one second; the rest of that second is then lost.
+ *
+ * The paging REQs reuse the subscription id and so replace the live
+ * subscription. Once paging is over it rejoins the live stream from the
+ * newest event seen, which is a catch-up of its own.
+ */
+class CatchUpPager {
+public:
+    enum Step {
+        DONE,      // nothing left to fetch; the live subscription is open
+        PAGE_BACK, // send filter() to fetch the next, older page
+        REJOIN     // send filter() to reopen the live subscription
+    };
+
+    // Start with an open-ended page from since
+    void begin(uint32_t since);
+    void cancel() { is_active = false; }
+    bool active() const { return is_active; }
+
+    // A stored event of the current page arrived
+    void event(uint32_t created_at);
+
+    // The relay sent EOSE for the current page
+    Step endPage();
+
+    // Filter fields for the current page
+    String filter() const { return SubscriptionCursor::pageFilter(since, until); }
+
+private:
+    void startPage();
+
+    uint32_t since = 0;
+    uint32_t until = 0;       // 0 while the page is open-ended
+    uint32_t newest = 0;      // newest created_at seen since begin()
+    uint32_t page_oldest = 0;
+    uint16_t page_events = 0;
+    bool paged = false;
+    bool is_active = false;
+};
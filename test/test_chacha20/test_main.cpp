@@ -0,0 +1,107 @@
+#include <unity.h>
+#include "codec.h"
+#include "nip44/chacha20.h"
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void decodeHex(const char *hex, uint8_t *out, size_t length)
+{
+    TEST_ASSERT_EQUAL_UINT(length, nostr::hexDecode(hex, strlen(hex), out, length));
+}
+
+// RFC 8439 appendix A.2, test vector 1: all-zero key and nonce, block counter 0
+static void test_chacha20_zero_key_keystream()
+{
+    uint8_t key[32] = {};
+    uint8_t nonce[12] = {};
+    uint8_t zeros[64] = {};
+    uint8_t keystream[64];
+    uint8_t expected[64];
+    decodeHex("76b8e0ada0f13d90405d6ae55386bd28bdd219b8a08ded1aa836efcc8b770dc7"
+              "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586",
+              expected, sizeof(expected));
+
+    chacha20_ctx ctx;
+    chacha20_init_ctx(&ctx, key, nonce);
+    chacha20_encrypt(&ctx, keystream, zeros, sizeof(zeros));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, keystream, sizeof(expected));
+}
+
+// RFC 8439 section 2.4.2
+static const char *SUNSCREEN = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+static const char *SUNSCREEN_CIPHERTEXT =
+    "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d4360c20a27afccfd9fae0b"
+    "f91b65c5524733ab8f593dabcd62b3571639d624e65152ab8f530c359f0861d8"
+    "07ca0dbf500d6a6156a38e088a22b65e52bc514d16ccf806818ce91ab7793736"
+    "5af90bbf74a35be6b40b8eedf2785e42874d";
+
+static void test_chacha20_rfc8439_encryption()
+{
+    uint8_t key[32];
+    for (size_t i = 0; i < sizeof(key); i++)
+    {
+        key[i] = i;
+    }
+    uint8_t nonce[12];
+    decodeHex("000000000000004a00000000", nonce, sizeof(nonce));
+    size_t length = strlen(SUNSCREEN);
+    uint8_t expected[114];
+    TEST_ASSERT_EQUAL_UINT(sizeof(expected), length);
+    decodeHex(SUNSCREEN_CIPHERTEXT, expected, sizeof(expected));
+
+    // The vector starts at block counter 1 and NIP-44 at 0: spend block 0 first.
+    // Odd-sized pieces exercise the keystream left over between calls.
+    const size_t pieces[] = {1, 7, 64, 13, 29};
+    uint8_t ciphertext[114];
+    chacha20_ctx ctx;
+    chacha20_init_ctx(&ctx, key, nonce);
+    uint8_t block0[64] = {};
+    chacha20_encrypt(&ctx, block0, block0, sizeof(block0));
+    size_t done = 0;
+    for (size_t piece : pieces)
+    {
+        chacha20_encrypt(&ctx, ciphertext + done, (const uint8_t *)SUNSCREEN + done, piece);
+        done += piece;
+    }
+    chacha20_encrypt(&ctx, ciphertext + done, (const uint8_t *)SUNSCREEN + done, length - done);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, ciphertext, length);
+}
+
+// Encrypting twice with the same key and nonce gives the plaintext back, in place
+static void test_chacha20_in_place_round_trip()
+{
+    uint8_t key[32] = {1};
+    uint8_t nonce[12] = {2};
+    uint8_t data[200];
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = i;
+    }
+
+    chacha20_ctx ctx;
+    chacha20_init_ctx(&ctx, key, nonce);
+    chacha20_encrypt(&ctx, data, data, sizeof(data));
+    TEST_ASSERT_FALSE(data[10] == 10 && data[100] == 100);
+    chacha20_init_ctx(&ctx, key, nonce);
+    chacha20_encrypt(&ctx, data, data, 3);
+    chacha20_encrypt(&ctx, data + 3, data + 3, sizeof(data) - 3);
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT8(i, data[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_chacha20_zero_key_keystream);
+    RUN_TEST(test_chacha20_rfc8439_encryption);
+    RUN_TEST(test_chacha20_in_place_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+#include "codec.h"
+
+using namespace nostr;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_hex_round_trip_every_byte()
+{
+    uint8_t bytes[256];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+    {
+        bytes[i] = i;
+    }
+    String hex = hexEncode(bytes, sizeof(bytes));
+    TEST_ASSERT_EQUAL_UINT(512, hex.length());
+    TEST_ASSERT_EQUAL_STRING_LEN("000102030405060708090a0b0c0d0e0f", hex.c_str(), 32);
+    TEST_ASSERT_EQUAL_STRING("fcfdfeff", hex.c_str() + 504);
+
+    uint8_t decoded[256];
+    TEST_ASSERT_EQUAL_UINT(256, hexDecode(hex, decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bytes, decoded, sizeof(bytes));
+}
+
+static void test_hex_encode_writes_no_terminator()
+{
+    const uint8_t bytes[] = {0xde, 0xad};
+    char out[6] = {'x', 'x', 'x', 'x', 'x', '\0'};
+    hexEncode(bytes, sizeof(bytes), out);
+    TEST_ASSERT_EQUAL_STRING("deadx", out);
+}
+
+static void test_hex_decode_accepts_either_case()
+{
+    uint8_t out[4];
+    TEST_ASSERT_EQUAL_UINT(4, hexDecode("DeadBEEF", 8, out, sizeof(out)));
+    const uint8_t expected[] = {0xde, 0xad, 0xbe, 0xef};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, sizeof(expected));
+}
+
+static void test_hex_decode_rejects_bad_input()
+{
+    uint8_t out[4];
+    TEST_ASSERT_EQUAL_UINT(0, hexDecode("abc", 3, out, sizeof(out)));        // odd length
+    TEST_ASSERT_EQUAL_UINT(0, hexDecode("abcg", 4, out, sizeof(out)));       // not a hex digit
+    TEST_ASSERT_EQUAL_UINT(0, hexDecode("ab c", 4, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT(0, hexDecode("0011223344", 10, out, sizeof(out))); // five bytes into four
+    TEST_ASSERT_EQUAL_UINT(0, hexDecode("", 0, out, sizeof(out)));
+}
+
+static void test_hex_decode_in_place()
+{
+    uint8_t buffer[] = {'0', '1', 'f', 'F', '8', '0'};
+    TEST_ASSERT_EQUAL_UINT(3, hexDecodeInPlace(buffer, sizeof(buffer)));
+    const uint8_t expected[] = {0x01, 0xff, 0x80};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, buffer, sizeof(expected));
+}
+
+// RFC 4648 section 10
+static const char *const BASE64_PLAIN[] = {"f", "fo", "foo", "foob", "fooba", "foobar"};
+static const char *const BASE64_ENCODED[] = {"Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+
+static void test_base64_rfc4648_vectors()
+{
+    for (size_t i = 0; i < sizeof(BASE64_PLAIN) / sizeof(BASE64_PLAIN[0]); i++)
+    {
+        const uint8_t *plain = (const uint8_t *)BASE64_PLAIN[i];
+        size_t length = strlen(BASE64_PLAIN[i]);
+        TEST_ASSERT_EQUAL_STRING(BASE64_ENCODED[i], base64Encode(plain, length).c_str());
+
+        size_t encodedLength = strlen(BASE64_ENCODED[i]);
+        TEST_ASSERT_EQUAL_UINT(encodedLength, base64EncodedLength(length));
+        TEST_ASSERT_EQUAL_UINT(length, base64DecodedLength(BASE64_ENCODED[i], encodedLength));
+
+        uint8_t decoded[8];
+        TEST_ASSERT_EQUAL_UINT(length, base64Decode(BASE64_ENCODED[i], encodedLength, decoded, sizeof(decoded)));
+        TEST_ASSERT_EQUAL_MEMORY(plain, decoded, length);
+    }
+}
+
+static void test_base64_encode_empty_and_too_small()
+{
+    char out[9];
+    out[0] = 'x';
+    TEST_ASSERT_EQUAL_UINT(0, base64Encode((const uint8_t *)"", 0, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("", out);
+
+    // Room for the text but not the terminator
+    TEST_ASSERT_EQUAL_UINT(0, base64Encode((const uint8_t *)"foobar", 6, out, 8));
+    TEST_ASSERT_EQUAL_UINT(8, base64Encode((const uint8_t *)"foobar", 6, out, 9));
+}
+
+static void test_base64_decode_rejects_bad_input()
+{
+    uint8_t out[8];
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("Zm9", 3, out, sizeof(out)));       // not a multiple of 4
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("Zm9v!A==", 8, out, sizeof(out)));  // outside the alphabet
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("Zg=a", 4, out, sizeof(out)));      // data after padding
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("Z===", 4, out, sizeof(out)));      // too much padding
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("Zm==Zm9v", 8, out, sizeof(out)));  // padding mid-string
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("Zm9vYmFy", 8, out, 5));            // six bytes into five
+    TEST_ASSERT_EQUAL_UINT(0, base64Decode("", 0, out, sizeof(out)));
+}
+
+static void test_base64_decode_in_place()
+{
+    uint8_t buffer[] = {'Z', 'm', '9', 'v', 'Y', 'm', 'E', '='};
+    TEST_ASSERT_EQUAL_UINT(5, base64DecodeInPlace(buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY("fooba", buffer, 5);
+}
+
+static void test_base64_encode_over_its_input()
+{
+    // The input sits at the end of the buffer, as NIP-44 lays out a payload
+    uint8_t buffer[13];
+    memcpy(buffer + 4, "foobar", 6);
+    TEST_ASSERT_EQUAL_UINT(8, base64Encode(buffer + 4, 6, (char *)buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_STRING("Zm9vYmFy", (const char *)buffer);
+}
+
+static void test_base64_round_trip_lengths()
+{
+    uint8_t plain[100];
+    for (size_t i = 0; i < sizeof(plain); i++)
+    {
+        plain[i] = i * 37 + 11;
+    }
+    for (size_t length = 1; length <= sizeof(plain); length++)
+    {
+        String encoded = base64Encode(plain, length);
+        TEST_ASSERT_EQUAL_UINT(base64EncodedLength(length), encoded.length());
+        uint8_t decoded[sizeof(plain)];
+        TEST_ASSERT_EQUAL_UINT(length, base64Decode(encoded.c_str(), encoded.length(), decoded, sizeof(decoded)));
+        TEST_ASSERT_EQUAL_MEMORY(plain, decoded, length);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hex_round_trip_every_byte);
+    RUN_TEST(test_hex_encode_writes_no_terminator);
+    RUN_TEST(test_hex_decode_accepts_either_case);
+    RUN_TEST(test_hex_decode_rejects_bad_input);
+    RUN_TEST(test_hex_decode_in_place);
+    RUN_TEST(test_base64_rfc4648_vectors);
+    RUN_TEST(test_base64_encode_empty_and_too_small);
+    RUN_TEST(test_base64_decode_rejects_bad_input);
+    RUN_TEST(test_base64_decode_in_place);
+    RUN_TEST(test_base64_encode_over_its_input);
+    RUN_TEST(test_base64_round_trip_lengths);
+    return UNITY_END();
+}
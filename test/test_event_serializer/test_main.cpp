@@ -0,0 +1,91 @@
+#include <unity.h>
+#include "event_serializer.h"
+
+using namespace nostr;
+
+static const char *PUBKEY_HEX = "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798";
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static String escaped(const char *text, size_t length)
+{
+    String out = "x";
+    appendEscaped(out, text, length);
+    TEST_ASSERT_EQUAL_UINT(1 + escapedLength(text, length), out.length());
+    return out.substring(1);
+}
+
+static void test_plain_text_is_copied()
+{
+    TEST_ASSERT_EQUAL_STRING("Temperature is 21.5C", escaped("Temperature is 21.5C", 20).c_str());
+    TEST_ASSERT_EQUAL_UINT(0, escapedLength("", 0));
+}
+
+static void test_nip01_escapes()
+{
+    const char text[] = "\"q\" \\ \n\r\t\b\f";
+    TEST_ASSERT_EQUAL_STRING("\\\"q\\\" \\\\ \\n\\r\\t\\b\\f", escaped(text, sizeof(text) - 1).c_str());
+}
+
+static void test_other_control_characters_use_u_escapes()
+{
+    const char text[] = {'a', 0x00, 0x01, 0x1f, 'b', 0x7f};
+    TEST_ASSERT_EQUAL_STRING("a\\u0000\\u0001\\u001fb\x7f", escaped(text, sizeof(text)).c_str());
+}
+
+static void test_utf8_is_copied()
+{
+    TEST_ASSERT_EQUAL_STRING("21.5\xc2\xb0" "C", escaped("21.5\xc2\xb0" "C", 7).c_str());
+}
+
+static void test_signed_event_layout()
+{
+    uint8_t secret[32] = {1};
+    PrivateKey privateKey(secret);
+    const char tags[] = "[[\"p\",\"00\"]]";
+    const char content[] = "line\n\"two\"\x01";
+    EventFields event = {PUBKEY_HEX, 1700000000, 6107, tags, sizeof(tags) - 1, content, sizeof(content) - 1};
+
+    String message = serializeSignedEvent(privateKey, event, "[\"EVENT\",", "]");
+    TEST_ASSERT_EQUAL_UINT(serializedEventLength(event, "[\"EVENT\",", "]"), message.length());
+    TEST_ASSERT_TRUE(message.startsWith("[\"EVENT\",{\"id\":\""));
+    TEST_ASSERT_TRUE(message.endsWith("\"}]"));
+    TEST_ASSERT_TRUE(message.indexOf(String("\"pubkey\":\"") + PUBKEY_HEX + "\",\"created_at\":1700000000,\"kind\":6107,") > 0);
+    TEST_ASSERT_TRUE(message.indexOf("\"tags\":[[\"p\",\"00\"]],\"content\":\"line\\n\\\"two\\\"\\u0001\",\"sig\":\"") > 0);
+}
+
+static void test_buffer_and_string_forms_agree()
+{
+    uint8_t secret[32] = {1};
+    PrivateKey privateKey(secret);
+    const char content[] = "tab\there";
+    EventFields event = {PUBKEY_HEX, 1700000000, 1, "[]", 2, content, sizeof(content) - 1};
+
+    size_t length = serializedEventLength(event);
+    char buffer[512];
+    TEST_ASSERT_EQUAL_UINT(0, serializeSignedEvent(buffer, length, privateKey, event));
+    TEST_ASSERT_EQUAL_UINT(length, serializeSignedEvent(buffer, length + 1, privateKey, event));
+    TEST_ASSERT_EQUAL_UINT(length, strlen(buffer));
+
+    String message = serializeSignedEvent(privateKey, event);
+    // Ids match: the commitment is the same; signatures may use fresh nonces
+    TEST_ASSERT_EQUAL_STRING_LEN(message.c_str(), buffer, length - 128 - 2);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_plain_text_is_copied);
+    RUN_TEST(test_nip01_escapes);
+    RUN_TEST(test_other_control_characters_use_u_escapes);
+    RUN_TEST(test_utf8_is_copied);
+    RUN_TEST(test_signed_event_layout);
+    RUN_TEST(test_buffer_and_string_forms_agree);
+    return UNITY_END();
+}
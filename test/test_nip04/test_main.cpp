@@ -0,0 +1,107 @@
+#include <unity.h>
+#include "nostr.h"
+#include "codec.h"
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void decodeHex(const char *hex, uint8_t *out, size_t length)
+{
+    TEST_ASSERT_EQUAL_UINT(length, nostr::hexDecode(hex, strlen(hex), out, length));
+}
+
+// NIP-04 is AES-256-CBC with PKCS#7 padding; ciphertexts from `openssl enc -aes-256-cbc`
+static const char *NIP04_KEY = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+static const char *NIP04_IV = "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static void checkNip04(const char *message, const char *expectedHex)
+{
+    uint8_t key[32];
+    uint8_t iv[16];
+    decodeHex(NIP04_KEY, key, sizeof(key));
+    decodeHex(NIP04_IV, iv, sizeof(iv));
+
+    size_t length = strlen(message);
+    size_t cipherLength = nostr::nip04CipherLength(length);
+    TEST_ASSERT_EQUAL_UINT(strlen(expectedHex) / 2, cipherLength);
+
+    uint8_t buffer[64];
+    memcpy(buffer, message, length);
+    // One byte short of the padded length is refused
+    TEST_ASSERT_EQUAL_UINT(0, nostr::nip04EncryptInPlace(key, iv, buffer, length, cipherLength - 1));
+    TEST_ASSERT_EQUAL_UINT(cipherLength, nostr::nip04EncryptInPlace(key, iv, buffer, length, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_STRING(expectedHex, nostr::hexEncode(buffer, cipherLength).c_str());
+
+    size_t messageLength = 0;
+    TEST_ASSERT_TRUE(nostr::nip04DecryptInPlace(key, iv, buffer, cipherLength, messageLength));
+    TEST_ASSERT_EQUAL_UINT(length, messageLength);
+    TEST_ASSERT_EQUAL_MEMORY(message, buffer, length);
+}
+
+static void test_nip04_matches_openssl()
+{
+    checkNip04("Temperature is 21.5C", "1fc61bbe39f0a2d5b8dc52e83bcf29caa5fa7b2c5ccdced751a0b1193cecd622");
+    // A whole block of message gets a whole block of padding
+    checkNip04("0123456789abcdef", "cd951146cc74046a56c93a30e4a7cd50e5644b147420cb090229d6c7b90ed616");
+}
+
+static void test_nip04_round_trip_lengths()
+{
+    uint8_t key[32];
+    uint8_t iv[16];
+    decodeHex(NIP04_KEY, key, sizeof(key));
+    decodeHex(NIP04_IV, iv, sizeof(iv));
+
+    for (size_t length = 0; length <= 100; length++)
+    {
+        uint8_t buffer[128];
+        for (size_t i = 0; i < length; i++)
+        {
+            buffer[i] = i * 13 + 5;
+        }
+        size_t cipherLength = nostr::nip04EncryptInPlace(key, iv, buffer, length, sizeof(buffer));
+        TEST_ASSERT_EQUAL_UINT(nostr::nip04CipherLength(length), cipherLength);
+        size_t messageLength = 0;
+        TEST_ASSERT_TRUE(nostr::nip04DecryptInPlace(key, iv, buffer, cipherLength, messageLength));
+        TEST_ASSERT_EQUAL_UINT(length, messageLength);
+        for (size_t i = 0; i < length; i++)
+        {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)(i * 13 + 5), buffer[i]);
+        }
+    }
+}
+
+static void test_nip04_rejects_bad_input()
+{
+    uint8_t key[32];
+    uint8_t iv[16];
+    decodeHex(NIP04_KEY, key, sizeof(key));
+    decodeHex(NIP04_IV, iv, sizeof(iv));
+    size_t messageLength = 0;
+
+    // Not a whole number of blocks, or nothing at all
+    uint8_t buffer[32] = {};
+    TEST_ASSERT_FALSE(nostr::nip04DecryptInPlace(key, iv, buffer, 17, messageLength));
+    TEST_ASSERT_FALSE(nostr::nip04DecryptInPlace(key, iv, buffer, 0, messageLength));
+
+    // Decrypted under the wrong key, the padding does not check out
+    const char *message = "Temperature is 21.5C";
+    memcpy(buffer, message, strlen(message));
+    size_t cipherLength = nostr::nip04EncryptInPlace(key, iv, buffer, strlen(message), sizeof(buffer));
+    key[0] ^= 1;
+    TEST_ASSERT_FALSE(nostr::nip04DecryptInPlace(key, iv, buffer, cipherLength, messageLength));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_nip04_matches_openssl);
+    RUN_TEST(test_nip04_round_trip_lengths);
+    RUN_TEST(test_nip04_rejects_bad_input);
+    return UNITY_END();
+}
@@ -0,0 +1,189 @@
+#include <unity.h>
+#include "codec.h"
+#include "hmac_key.h"
+#include "nip44/nip44.h"
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void decodeHex(const char *hex, uint8_t *out, size_t length)
+{
+    TEST_ASSERT_EQUAL_UINT(length, nostr::hexDecode(hex, strlen(hex), out, length));
+}
+
+// RFC 4231 test case 2: a key shorter than the block
+static void test_hmac_key_rfc4231()
+{
+    const char *data = "what do ya want for nothing?";
+    uint8_t expected[32];
+    decodeHex("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", expected, sizeof(expected));
+
+    nostr::HmacSha256Key key = {};
+    key.setKey((const uint8_t *)"Jefe", 4);
+    uint8_t mac[32];
+    {
+        nostr::HmacSha256Key::Mac hmac(key);
+        hmac.update((const uint8_t *)data, 10);
+        hmac.update((const uint8_t *)data + 10, strlen(data) - 10);
+        hmac.finish(mac);
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, mac, sizeof(mac));
+
+    // The key is reusable: the pad states are only ever copied
+    {
+        nostr::HmacSha256Key::Mac hmac(key);
+        hmac.update((const uint8_t *)data, strlen(data));
+        hmac.finish(mac);
+    }
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, mac, sizeof(mac));
+    key.clear();
+}
+
+// NIP-44 v2 reference vectors; the shared x is that of sec1 = 1 and sec2 = 2, i.e. x(2G)
+static const char *NIP44_SHARED_X = "c6047f9441ed7d6d3045406e95c07cd85c778e4b8cef3ca7abac09b95c709ee5";
+static const char *NIP44_CONVERSATION_KEY = "c41c775356fd92eadc63ff5a0dc1da211b268cbea22316767095b2871ea1412d";
+static const char *NIP44_PAYLOAD = "AgAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAABee0G5VSK0/9YypIObAtDKfYEAjD35uVkHyB0F4DwrcNaCXlCWZKaArsGrY6M9wnuTMxWfp1RTN9Xga8no+kF5Vsb";
+static void test_nip44_padded_lengths()
+{
+    const size_t vectors[][2] = {
+        {16, 32}, {32, 32}, {33, 64}, {37, 64}, {45, 64}, {49, 64}, {64, 64}, {65, 96}, {100, 128},
+        {111, 128}, {200, 224}, {250, 256}, {320, 320}, {383, 384}, {384, 384}, {400, 448}, {500, 512},
+        {512, 512}, {515, 640}, {700, 768}, {800, 896}, {900, 1024}, {1020, 1024}, {65535, 65536}};
+    for (const auto &vector : vectors)
+    {
+        TEST_ASSERT_EQUAL_UINT(vector[1], calcPaddedLen(vector[0]));
+    }
+
+    // Outside what a payload can carry
+    TEST_ASSERT_EQUAL_UINT(0, calcPaddedLen(0));
+    TEST_ASSERT_EQUAL_UINT(0, calcPaddedLen(65536));
+    TEST_ASSERT_EQUAL_UINT(0, nip44PayloadLength(0));
+    TEST_ASSERT_EQUAL_UINT(0, nip44PayloadLength(65536));
+}
+
+static void test_nip44_conversation_key_states()
+{
+    uint8_t sharedX[32];
+    decodeHex(NIP44_SHARED_X, sharedX, sizeof(sharedX));
+    nostr::HmacSha256Key conversationKey = {};
+    getConversationKey(sharedX, conversationKey);
+
+    // The precomputed states derive the same message keys as the raw key
+    uint8_t rawKey[32];
+    decodeHex(NIP44_CONVERSATION_KEY, rawKey, sizeof(rawKey));
+    uint8_t nonce[32] = {};
+    nonce[31] = 1;
+    uint8_t chachaKey[32], chachaNonce[12], hmacKey[32];
+    uint8_t rawChachaKey[32], rawChachaNonce[12], rawHmacKey[32];
+    TEST_ASSERT_TRUE(getMessageKeys(conversationKey, nonce, chachaKey, chachaNonce, hmacKey));
+    TEST_ASSERT_TRUE(getMessageKeys(rawKey, nonce, rawChachaKey, rawChachaNonce, rawHmacKey));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rawChachaKey, chachaKey, sizeof(chachaKey));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rawChachaNonce, chachaNonce, sizeof(chachaNonce));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(rawHmacKey, hmacKey, sizeof(hmacKey));
+    conversationKey.clear();
+}
+
+static void test_nip44_decrypts_reference_payload()
+{
+    TEST_ASSERT_EQUAL_STRING("a", decryptMessageNip44(NIP44_PAYLOAD, NIP44_SHARED_X).c_str());
+
+    uint8_t sharedX[32];
+    decodeHex(NIP44_SHARED_X, sharedX, sizeof(sharedX));
+    nostr::HmacSha256Key conversationKey = {};
+    getConversationKey(sharedX, conversationKey);
+    TEST_ASSERT_EQUAL_STRING("a", decryptMessageNip44(NIP44_PAYLOAD, conversationKey).c_str());
+    conversationKey.clear();
+}
+
+static void test_nip44_round_trip()
+{
+    uint8_t sharedX[32];
+    decodeHex(NIP44_SHARED_X, sharedX, sizeof(sharedX));
+    nostr::HmacSha256Key conversationKey = {};
+    getConversationKey(sharedX, conversationKey);
+
+    const size_t lengths[] = {1, 31, 32, 33, 255, 256, 1000, 65535};
+    for (size_t length : lengths)
+    {
+        String plaintext;
+        plaintext.reserve(length);
+        for (size_t i = 0; i < length; i++)
+        {
+            plaintext += (char)('a' + i % 26);
+        }
+        String payload = encryptMessageNip44(plaintext, conversationKey);
+        TEST_ASSERT_EQUAL_UINT(nip44EncodedLength(length), payload.length());
+        TEST_ASSERT_TRUE(decryptMessageNip44(payload, conversationKey) == plaintext);
+    }
+    conversationKey.clear();
+}
+
+// The buffer API: encrypt, base64 over the same buffer, then decode and decrypt in place
+static void test_nip44_in_place_buffer()
+{
+    uint8_t sharedX[32];
+    decodeHex(NIP44_SHARED_X, sharedX, sizeof(sharedX));
+    nostr::HmacSha256Key conversationKey = {};
+    getConversationKey(sharedX, conversationKey);
+
+    const char *message = "in place, one buffer";
+    size_t length = strlen(message);
+    size_t encoded = nip44EncodedLength(length);
+    uint8_t buffer[256];
+    TEST_ASSERT_TRUE(encoded + 1 <= sizeof(buffer));
+
+    size_t offset = nip44InPlaceOffset(length);
+    memcpy(buffer + offset + NIP44_PLAINTEXT_OFFSET, message, length);
+    size_t payloadLength = encryptPayloadNip44(conversationKey, buffer + offset, encoded + 1 - offset, length);
+    TEST_ASSERT_EQUAL_UINT(nip44PayloadLength(length), payloadLength);
+    TEST_ASSERT_EQUAL_UINT(encoded, base64EncodeNip44(buffer + offset, payloadLength, (char *)buffer, encoded + 1));
+    TEST_ASSERT_EQUAL_UINT(encoded, strlen((char *)buffer));
+
+    // The String API reads the same payload
+    TEST_ASSERT_EQUAL_STRING(message, decryptMessageNip44(String((char *)buffer), conversationKey).c_str());
+
+    uint8_t *plaintext = nullptr;
+    size_t plaintextLength = 0;
+    TEST_ASSERT_TRUE(decryptPayloadNip44(conversationKey, buffer, encoded, plaintext, plaintextLength));
+    TEST_ASSERT_EQUAL_UINT(length, plaintextLength);
+    TEST_ASSERT_EQUAL_MEMORY(message, plaintext, length);
+
+    // Too small a buffer is refused rather than overrun
+    TEST_ASSERT_EQUAL_UINT(0, encryptPayloadNip44(conversationKey, buffer, nip44PayloadLength(length) - 1, length));
+    conversationKey.clear();
+}
+
+static void test_nip44_rejects_bad_payloads()
+{
+    // A flipped MAC bit
+    String tampered = NIP44_PAYLOAD;
+    tampered.setCharAt(tampered.length() - 2, tampered[tampered.length() - 2] == 'A' ? 'B' : 'A');
+    TEST_ASSERT_EQUAL_UINT(0, decryptMessageNip44(tampered, NIP44_SHARED_X).length());
+
+    // Another version byte
+    String version = NIP44_PAYLOAD;
+    version.setCharAt(1, 'w');
+    TEST_ASSERT_EQUAL_UINT(0, decryptMessageNip44(version, NIP44_SHARED_X).length());
+
+    // Not base64, and too short
+    TEST_ASSERT_EQUAL_UINT(0, decryptMessageNip44("#not base64", NIP44_SHARED_X).length());
+    TEST_ASSERT_EQUAL_UINT(0, decryptMessageNip44("AgAA", NIP44_SHARED_X).length());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hmac_key_rfc4231);
+    RUN_TEST(test_nip44_padded_lengths);
+    RUN_TEST(test_nip44_conversation_key_states);
+    RUN_TEST(test_nip44_decrypts_reference_payload);
+    RUN_TEST(test_nip44_round_trip);
+    RUN_TEST(test_nip44_in_place_buffer);
+    RUN_TEST(test_nip44_rejects_bad_payloads);
+    return UNITY_END();
+}
@@ -0,0 +1,352 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include "payment_journal.h"
+
+static const char *PATH = "/test.jnl";
+
+static std::vector<PaymentJournal::Entry> pending;
+static std::vector<PaymentJournal::Entry> confirmed;
+
+void setUp()
+{
+    LittleFS.begin(true);
+    LittleFS.remove(PATH);
+    pending.clear();
+    confirmed.clear();
+}
+
+void tearDown()
+{
+    LittleFS.remove(PATH);
+}
+
+static void makeKey(uint8_t key[PendingPayments::KEY_SIZE], uint8_t n)
+{
+    memset(key, n, PendingPayments::KEY_SIZE);
+}
+
+static PendingPayments::Payment makePayment(int32_t price)
+{
+    PendingPayments::Payment payment = {};
+    memset(payment.request_id, 0x11, sizeof(payment.request_id));
+    memset(payment.pubkey, 0x22, sizeof(payment.pubkey));
+    payment.method = 1;
+    strcpy(payment.value, "21");
+    payment.price = price;
+    return payment;
+}
+
+// Replay the file as a fresh boot would
+static bool replay()
+{
+    pending.clear();
+    confirmed.clear();
+    PaymentJournal journal(LittleFS, PATH);
+    return journal.begin(pending, confirmed);
+}
+
+// Event-like JSON of exactly length bytes
+static String makeEvent(size_t length)
+{
+    String event = "{\"id\":\"";
+    while (event.length() < length - 2)
+    {
+        event += "a";
+    }
+    event += "\"}";
+    return event;
+}
+
+static size_t fileSize()
+{
+    File file = LittleFS.open(PATH, FILE_READ);
+    size_t size = file ? file.size() : 0;
+    file.close();
+    return size;
+}
+
+static void test_empty_journal()
+{
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(0, pending.size());
+    TEST_ASSERT_EQUAL_UINT(0, confirmed.size());
+}
+
+static void test_replay_sorts_entries_by_state()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    {
+        PaymentJournal journal(LittleFS, PATH);
+        TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+        for (int i = 1; i <= 4; i++)
+        {
+            makeKey(key, i);
+            journal.recordInsert(key, makePayment(10 * i));
+        }
+        makeKey(key, 2);
+        journal.recordConfirm(key);
+        makeKey(key, 3);
+        journal.recordConfirm(key);
+        journal.recordExecute(key);
+        makeKey(key, 4);
+        journal.recordRemove(key);
+        journal.flush();
+    }
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(1, pending.size());
+    TEST_ASSERT_EQUAL_UINT8(1, pending[0].key[0]);
+    TEST_ASSERT_EQUAL_INT32(10, pending[0].payment.price);
+    TEST_ASSERT_EQUAL_STRING("21", pending[0].payment.value);
+    TEST_ASSERT_EQUAL_UINT(1, confirmed.size());
+    TEST_ASSERT_EQUAL_UINT8(2, confirmed[0].key[0]);
+    TEST_ASSERT_EQUAL_INT32(20, confirmed[0].payment.price);
+}
+
+static void test_unflushed_records_are_lost_but_confirms_are_not()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    makeKey(key, 5);
+    {
+        PaymentJournal journal(LittleFS, PATH);
+        TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+        journal.recordInsert(key, makePayment(50));
+        // Written straight away, taking the buffered insert with it
+        journal.recordConfirm(key);
+        makeKey(key, 6);
+        journal.recordInsert(key, makePayment(60));
+        // No flush: power is cut here
+    }
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(0, pending.size());
+    TEST_ASSERT_EQUAL_UINT(1, confirmed.size());
+    TEST_ASSERT_EQUAL_UINT8(5, confirmed[0].key[0]);
+}
+
+static void test_request_events_are_kept()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    // As long as an event can be, which with its framing is more than the batch buffer holds
+    String longEvent = makeEvent(PaymentJournal::MAX_EVENT_SIZE);
+    {
+        PaymentJournal journal(LittleFS, PATH);
+        TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+        makeKey(key, 7);
+        journal.recordInsert(key, makePayment(70));
+        journal.recordEvent(key, "{\"id\":\"short\"}", 14);
+        makeKey(key, 8);
+        journal.recordInsert(key, makePayment(80));
+        journal.recordEvent(key, longEvent.c_str(), longEvent.length());
+        journal.recordConfirm(key);
+        makeKey(key, 9);
+        journal.recordInsert(key, makePayment(90));
+        // Too long to journal, so the entry comes back without it
+        String tooLong = makeEvent(PaymentJournal::MAX_EVENT_SIZE + 1);
+        journal.recordEvent(key, tooLong.c_str(), tooLong.length());
+        journal.flush();
+    }
+
+    // Twice: the first replay rewrites the file compacted
+    for (int boot = 0; boot < 2; boot++)
+    {
+        TEST_ASSERT_TRUE(replay());
+        TEST_ASSERT_EQUAL_UINT(2, pending.size());
+        TEST_ASSERT_EQUAL_UINT(1, confirmed.size());
+        TEST_ASSERT_EQUAL_STRING("{\"id\":\"short\"}", pending[0].event.c_str());
+        TEST_ASSERT_EQUAL_UINT(0, pending[1].event.length());
+        TEST_ASSERT_EQUAL_STRING(longEvent.c_str(), confirmed[0].event.c_str());
+    }
+}
+
+static void test_torn_tail_is_dropped()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    {
+        PaymentJournal journal(LittleFS, PATH);
+        TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+        makeKey(key, 1);
+        journal.recordInsert(key, makePayment(10));
+        makeKey(key, 2);
+        journal.recordInsert(key, makePayment(20));
+        journal.flush();
+    }
+
+    // Cut the last record short, as a power cut mid-write would
+    size_t size = fileSize();
+    File file = LittleFS.open(PATH, FILE_READ);
+    std::vector<uint8_t> bytes(size);
+    file.read(bytes.data(), size);
+    file.close();
+    file = LittleFS.open(PATH, FILE_WRITE);
+    file.write(bytes.data(), size - 5);
+    file.close();
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(1, pending.size());
+    TEST_ASSERT_EQUAL_UINT8(1, pending[0].key[0]);
+}
+
+static void test_bad_crc_stops_replay()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    size_t firstEnd;
+    {
+        PaymentJournal journal(LittleFS, PATH);
+        TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+        makeKey(key, 1);
+        journal.recordInsert(key, makePayment(10));
+        journal.flush();
+        firstEnd = fileSize();
+        makeKey(key, 2);
+        journal.recordInsert(key, makePayment(20));
+        makeKey(key, 3);
+        journal.recordInsert(key, makePayment(30));
+        journal.flush();
+    }
+
+    // Flip a payload bit in the second insert: it and everything after it go
+    size_t size = fileSize();
+    File file = LittleFS.open(PATH, FILE_READ);
+    std::vector<uint8_t> bytes(size);
+    file.read(bytes.data(), size);
+    file.close();
+    bytes[firstEnd + 10] ^= 0x01;
+    file = LittleFS.open(PATH, FILE_WRITE);
+    file.write(bytes.data(), size);
+    file.close();
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(1, pending.size());
+    TEST_ASSERT_EQUAL_UINT8(1, pending[0].key[0]);
+}
+
+static void test_other_layout_is_discarded()
+{
+    File file = LittleFS.open(PATH, FILE_WRITE);
+    const uint8_t garbage[] = {1, 3, 0, 9, 9, 9, 0, 0, 0, 0};
+    file.write(garbage, sizeof(garbage));
+    file.close();
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(0, pending.size());
+    TEST_ASSERT_EQUAL_UINT(0, confirmed.size());
+}
+
+static void test_compaction_keeps_only_live_entries()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    PaymentJournal journal(LittleFS, PATH);
+    TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+
+    // Churn through inserts and removals until the file wants compacting
+    int n = 0;
+    while (!journal.needsCompaction())
+    {
+        makeKey(key, n++);
+        journal.recordInsert(key, makePayment(n));
+        journal.recordRemove(key);
+        journal.flush();
+        TEST_ASSERT_TRUE(n < 10000);
+    }
+
+    std::vector<PaymentJournal::Entry> live(1);
+    makeKey(live[0].key, 0xee);
+    live[0].payment = makePayment(99);
+    live[0].event = "{\"id\":\"live\"}";
+    std::vector<PaymentJournal::Entry> paid;
+    TEST_ASSERT_TRUE(journal.compact(live, paid));
+    TEST_ASSERT_FALSE(journal.needsCompaction());
+    TEST_ASSERT_TRUE(fileSize() < 200);
+
+    // Records after a compaction append to the new file
+    makeKey(key, 0xef);
+    journal.recordInsert(key, makePayment(100));
+    journal.flush();
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(2, pending.size());
+    TEST_ASSERT_EQUAL_UINT8(0xee, pending[0].key[0]);
+    TEST_ASSERT_EQUAL_STRING("{\"id\":\"live\"}", pending[0].event.c_str());
+    TEST_ASSERT_EQUAL_UINT8(0xef, pending[1].key[0]);
+}
+
+static void test_large_live_events_do_not_retrigger_compaction()
+{
+    // Live entries whose events alone add up to more than COMPACT_SLACK
+    std::vector<PaymentJournal::Entry> live(RequestEvents::CAPACITY);
+    for (size_t i = 0; i < live.size(); i++)
+    {
+        makeKey(live[i].key, 0x40 + i);
+        live[i].payment = makePayment(i);
+        live[i].event = makeEvent(PaymentJournal::MAX_EVENT_SIZE);
+    }
+    std::vector<PaymentJournal::Entry> paid;
+
+    PaymentJournal journal(LittleFS, PATH);
+    TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+    TEST_ASSERT_TRUE(journal.compact(live, paid));
+    size_t compacted = fileSize();
+    TEST_ASSERT_TRUE(compacted > PaymentJournal::COMPACT_SLACK);
+    TEST_ASSERT_FALSE(journal.needsCompaction());
+
+    // Still not after some churn, only once the file has grown well past the snapshot
+    uint8_t key[PendingPayments::KEY_SIZE];
+    makeKey(key, 0x01);
+    journal.recordInsert(key, makePayment(1));
+    journal.recordRemove(key);
+    journal.flush();
+    TEST_ASSERT_FALSE(journal.needsCompaction());
+
+    int n = 0;
+    while (!journal.needsCompaction())
+    {
+        makeKey(key, n++);
+        journal.recordInsert(key, makePayment(n));
+        journal.recordEvent(key, live[0].event.c_str(), live[0].event.length());
+        journal.recordRemove(key);
+        journal.flush();
+        TEST_ASSERT_TRUE(n < 10000);
+    }
+    TEST_ASSERT_TRUE(fileSize() > 2 * compacted);
+
+    TEST_ASSERT_TRUE(journal.compact(live, paid));
+    TEST_ASSERT_FALSE(journal.needsCompaction());
+    TEST_ASSERT_EQUAL_UINT(compacted, fileSize());
+}
+
+static void test_interrupted_compaction_is_finished()
+{
+    uint8_t key[PendingPayments::KEY_SIZE];
+    {
+        PaymentJournal journal(LittleFS, PATH);
+        TEST_ASSERT_TRUE(journal.begin(pending, confirmed));
+        makeKey(key, 1);
+        journal.recordInsert(key, makePayment(10));
+        journal.flush();
+    }
+
+    // The old file was removed but the new one never renamed into place
+    String temp = String(PATH) + ".tmp";
+    TEST_ASSERT_TRUE(LittleFS.rename(PATH, temp.c_str()));
+
+    TEST_ASSERT_TRUE(replay());
+    TEST_ASSERT_EQUAL_UINT(1, pending.size());
+    TEST_ASSERT_FALSE(LittleFS.exists(temp.c_str()));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_journal);
+    RUN_TEST(test_replay_sorts_entries_by_state);
+    RUN_TEST(test_unflushed_records_are_lost_but_confirms_are_not);
+    RUN_TEST(test_request_events_are_kept);
+    RUN_TEST(test_torn_tail_is_dropped);
+    RUN_TEST(test_bad_crc_stops_replay);
+    RUN_TEST(test_other_layout_is_discarded);
+    RUN_TEST(test_compaction_keeps_only_live_entries);
+    RUN_TEST(test_large_live_events_do_not_retrigger_compaction);
+    RUN_TEST(test_interrupted_compaction_is_finished);
+    return UNITY_END();
+}
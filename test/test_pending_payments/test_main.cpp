@@ -0,0 +1,224 @@
+#include <unity.h>
+#include "pending_payments.h"
+#include <vector>
+
+static const unsigned long WHEEL_TICK = 16000; // PendingPayments' timer wheel tick
+
+static PendingPayments *table;
+
+void setUp()
+{
+    table = new PendingPayments();
+}
+
+void tearDown()
+{
+    delete table;
+}
+
+// Payment hashes are SHA-256 outputs; these share their index position whenever a and b do
+static void makeHash(uint8_t hash[32], uint8_t a, uint8_t b, uint8_t tag)
+{
+    memset(hash, tag, 32);
+    hash[0] = a;
+    hash[1] = b;
+}
+
+static PendingPayments::Payment makePayment(int32_t price)
+{
+    PendingPayments::Payment payment = {};
+    memset(payment.request_id, 0x11, sizeof(payment.request_id));
+    memset(payment.pubkey, 0x22, sizeof(payment.pubkey));
+    payment.method = 3;
+    strcpy(payment.value, "on");
+    payment.price = price;
+    return payment;
+}
+
+static void test_insert_then_take()
+{
+    uint8_t hash[32];
+    makeHash(hash, 1, 2, 0xaa);
+    TEST_ASSERT_TRUE(table->insert(hash, makePayment(21), 60000));
+    TEST_ASSERT_EQUAL_UINT(1, table->size());
+
+    PendingPayments::Payment payment;
+    TEST_ASSERT_TRUE(table->take(hash, payment));
+    TEST_ASSERT_EQUAL_INT32(21, payment.price);
+    TEST_ASSERT_EQUAL_UINT8(3, payment.method);
+    TEST_ASSERT_EQUAL_STRING("on", payment.value);
+    TEST_ASSERT_EQUAL_UINT(0, table->size());
+
+    // Taken once only
+    TEST_ASSERT_FALSE(table->take(hash, payment));
+}
+
+static void test_take_on_empty_table()
+{
+    uint8_t hash[32];
+    makeHash(hash, 1, 2, 0xaa);
+    PendingPayments::Payment payment;
+    TEST_ASSERT_FALSE(table->take(hash, payment));
+}
+
+static void test_duplicate_hash_is_refused()
+{
+    uint8_t hash[32];
+    makeHash(hash, 1, 2, 0xaa);
+    TEST_ASSERT_TRUE(table->insert(hash, makePayment(21), 60000));
+    TEST_ASSERT_FALSE(table->insert(hash, makePayment(42), 60000));
+
+    // Only the key prefix is kept, so the tail of the hash does not tell entries apart
+    uint8_t sameKey[32];
+    memcpy(sameKey, hash, sizeof(sameKey));
+    sameKey[31] ^= 0xff;
+    TEST_ASSERT_FALSE(table->insert(sameKey, makePayment(42), 60000));
+    TEST_ASSERT_EQUAL_UINT(1, table->size());
+}
+
+static void test_full_table_refuses_inserts()
+{
+    uint8_t hash[32];
+    for (size_t i = 0; i < PendingPayments::CAPACITY; i++)
+    {
+        makeHash(hash, i, i >> 8, 0x33);
+        TEST_ASSERT_TRUE(table->insert(hash, makePayment(i), 60000));
+    }
+    makeHash(hash, 0xff, 0xff, 0x44);
+    TEST_ASSERT_FALSE(table->insert(hash, makePayment(0), 60000));
+
+    // A taken slot is free again
+    PendingPayments::Payment payment;
+    uint8_t first[32];
+    makeHash(first, 0, 0, 0x33);
+    TEST_ASSERT_TRUE(table->take(first, payment));
+    TEST_ASSERT_TRUE(table->insert(hash, makePayment(0), 60000));
+}
+
+static void test_colliding_keys_survive_removal()
+{
+    // All share one home position, so they sit in a single probe run
+    uint8_t hashes[6][32];
+    for (int i = 0; i < 6; i++)
+    {
+        makeHash(hashes[i], 7, 0, 0x50 + i);
+        TEST_ASSERT_TRUE(table->insert(hashes[i], makePayment(100 + i), 60000));
+    }
+
+    // Removing from the middle of the run must leave the later keys reachable
+    PendingPayments::Payment payment;
+    TEST_ASSERT_TRUE(table->take(hashes[2], payment));
+    TEST_ASSERT_EQUAL_INT32(102, payment.price);
+    TEST_ASSERT_TRUE(table->take(hashes[0], payment));
+    for (int i = 5; i >= 3; i--)
+    {
+        TEST_ASSERT_TRUE(table->take(hashes[i], payment));
+        TEST_ASSERT_EQUAL_INT32(100 + i, payment.price);
+    }
+    TEST_ASSERT_TRUE(table->take(hashes[1], payment));
+    TEST_ASSERT_EQUAL_UINT(0, table->size());
+}
+
+static void test_expire_drops_only_due_entries()
+{
+    unsigned long now = millis();
+    uint8_t soon[32];
+    uint8_t later[32];
+    makeHash(soon, 1, 0, 0x61);
+    makeHash(later, 2, 0, 0x62);
+    TEST_ASSERT_TRUE(table->insert(soon, makePayment(1), 0));
+    TEST_ASSERT_TRUE(table->insert(later, makePayment(2), 10 * WHEEL_TICK));
+
+    std::vector<uint8_t> expiredKeys;
+    size_t expired = table->expire(now + 2 * WHEEL_TICK, [&expiredKeys](const uint8_t key[PendingPayments::KEY_SIZE]) {
+        expiredKeys.push_back(key[0]);
+    });
+    TEST_ASSERT_EQUAL_UINT(1, expired);
+    TEST_ASSERT_EQUAL_UINT(1, expiredKeys.size());
+    TEST_ASSERT_EQUAL_UINT8(1, expiredKeys[0]);
+    TEST_ASSERT_EQUAL_UINT(1, table->size());
+
+    PendingPayments::Payment payment;
+    TEST_ASSERT_FALSE(table->take(soon, payment));
+
+    TEST_ASSERT_EQUAL_UINT(1, table->expire(now + 12 * WHEEL_TICK));
+    TEST_ASSERT_FALSE(table->take(later, payment));
+}
+
+static void test_expire_keeps_entries_a_revolution_out()
+{
+    // Lands in a bucket the wheel passes before it is due
+    unsigned long now = millis();
+    uint8_t hash[32];
+    makeHash(hash, 3, 0, 0x63);
+    TEST_ASSERT_TRUE(table->insert(hash, makePayment(1), 40 * WHEEL_TICK));
+
+    for (unsigned long t = 1; t <= 40; t++)
+    {
+        TEST_ASSERT_EQUAL_UINT(0, table->expire(now + t * WHEEL_TICK - WHEEL_TICK / 2));
+    }
+    TEST_ASSERT_EQUAL_UINT(1, table->size());
+    TEST_ASSERT_EQUAL_UINT(1, table->expire(now + 42 * WHEEL_TICK));
+}
+
+static void test_taken_entry_does_not_expire()
+{
+    unsigned long now = millis();
+    uint8_t first[32];
+    uint8_t second[32];
+    makeHash(first, 4, 0, 0x64);
+    makeHash(second, 5, 0, 0x65);
+    TEST_ASSERT_TRUE(table->insert(first, makePayment(1), 0));
+    TEST_ASSERT_TRUE(table->insert(second, makePayment(2), 0));
+
+    // Unlinked from its bucket list without disturbing its neighbour there
+    PendingPayments::Payment payment;
+    TEST_ASSERT_TRUE(table->take(first, payment));
+    size_t calls = 0;
+    TEST_ASSERT_EQUAL_UINT(1, table->expire(now + 2 * WHEEL_TICK, [&calls](const uint8_t key[PendingPayments::KEY_SIZE]) {
+        TEST_ASSERT_EQUAL_UINT8(5, key[0]);
+        calls++;
+    }));
+    TEST_ASSERT_EQUAL_UINT(1, calls);
+    TEST_ASSERT_EQUAL_UINT(0, table->size());
+}
+
+static void test_for_each_and_clear()
+{
+    uint8_t hash[32];
+    for (int i = 0; i < 5; i++)
+    {
+        makeHash(hash, i, 1, 0x70);
+        TEST_ASSERT_TRUE(table->insert(hash, makePayment(10 * i), 60000));
+    }
+    int32_t total = 0;
+    size_t visited = 0;
+    table->forEach([&](const uint8_t key[PendingPayments::KEY_SIZE], const PendingPayments::Payment &payment) {
+        TEST_ASSERT_EQUAL_UINT8(1, key[1]);
+        total += payment.price;
+        visited++;
+    });
+    TEST_ASSERT_EQUAL_UINT(5, visited);
+    TEST_ASSERT_EQUAL_INT32(100, total);
+
+    table->clear();
+    TEST_ASSERT_EQUAL_UINT(0, table->size());
+    PendingPayments::Payment payment;
+    TEST_ASSERT_FALSE(table->take(hash, payment));
+    TEST_ASSERT_TRUE(table->insert(hash, makePayment(1), 60000));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_insert_then_take);
+    RUN_TEST(test_take_on_empty_table);
+    RUN_TEST(test_duplicate_hash_is_refused);
+    RUN_TEST(test_full_table_refuses_inserts);
+    RUN_TEST(test_colliding_keys_survive_removal);
+    RUN_TEST(test_expire_drops_only_due_entries);
+    RUN_TEST(test_expire_keeps_entries_a_revolution_out);
+    RUN_TEST(test_taken_entry_does_not_expire);
+    RUN_TEST(test_for_each_and_clear);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+#include <unity.h>
+#include "relay_message_parser.h"
+#include "codec.h"
+
+static const char *EVENT_OBJECT =
+    "{\"id\":\"5c83da77af1dec6d7289834998ad7aafbd9e2191396d75ec3cc27f5a77226f36\","
+    "\"pubkey\":\"f7234bd4c1394dda46d09f35bd384dd30cc552ad5541990f98844fb06676e9ca\",\"created_at\":1700000000,"
+    "\"kind\":5107,\"tags\":[[\"i\",\"[{\\\"method\\\":\\\"setLight\\\",\\\"value\\\":\\\"caf\\u00e9 \\\\ \\ud83d\\ude00\\\"}]\"],"
+    "[\"p\",\"79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798\"]],\"content\":\"hi \\\"there\\\"\","
+    "\"sig\":\"9b8f2a0e0e1f5c6d2b3a4f5e6d7c8b9a0f1e2d3c4b5a69788796a5b4c3d2e1f00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\"}";
+
+// The "i" tag once its JSON string escapes are undone
+static const char *EVENT_INPUT = "[{\"method\":\"setLight\",\"value\":\"caf\xc3\xa9 \\ \xf0\x9f\x98\x80\"}]";
+
+static String frame;
+
+void setUp()
+{
+    frame = String("[\"EVENT\", \"sub\", ") + EVENT_OBJECT + "]";
+}
+
+void tearDown()
+{
+}
+
+static RelayMessageParser::Status feedString(RelayMessageParser &parser, const char *text)
+{
+    return parser.feed((const uint8_t *)text, strlen(text));
+}
+
+static void checkEvent(const RelayMessageParser &parser)
+{
+    TEST_ASSERT_EQUAL(RelayMessageParser::COMPLETE, parser.status());
+    const RelayMessageParser::Message &message = parser.message();
+    TEST_ASSERT_EQUAL(RelayMessageParser::MESSAGE_EVENT, message.type);
+    TEST_ASSERT_TRUE(message.has_id);
+    TEST_ASSERT_TRUE(message.has_pubkey);
+    TEST_ASSERT_TRUE(message.has_kind);
+    TEST_ASSERT_TRUE(message.has_recipient);
+    TEST_ASSERT_FALSE(message.encrypted);
+    TEST_ASSERT_EQUAL_STRING("5c83da77af1dec6d7289834998ad7aafbd9e2191396d75ec3cc27f5a77226f36", nostr::hexEncode(message.id, 32).c_str());
+    TEST_ASSERT_EQUAL_STRING("f7234bd4c1394dda46d09f35bd384dd30cc552ad5541990f98844fb06676e9ca", nostr::hexEncode(message.pubkey, 32).c_str());
+    TEST_ASSERT_EQUAL_STRING("79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", nostr::hexEncode(message.recipient, 32).c_str());
+    TEST_ASSERT_EQUAL_UINT16(5107, message.kind);
+    TEST_ASSERT_EQUAL_UINT32(1700000000, message.created_at);
+    TEST_ASSERT_EQUAL_STRING(EVENT_INPUT, message.input.c_str());
+    TEST_ASSERT_EQUAL_STRING(EVENT_OBJECT, message.raw.c_str());
+
+    // Content is left escaped, in place in the frame
+    TEST_ASSERT_EQUAL_UINT(strlen("hi \\\"there\\\""), message.content_length);
+    TEST_ASSERT_EQUAL_STRING_LEN("hi \\\"there\\\"", frame.c_str() + message.content_offset, message.content_length);
+}
+
+static void test_whole_event()
+{
+    RelayMessageParser parser;
+    TEST_ASSERT_EQUAL(RelayMessageParser::COMPLETE, feedString(parser, frame.c_str()));
+    checkEvent(parser);
+}
+
+static void test_event_split_at_every_position()
+{
+    // Every split lands somewhere different: inside escapes, \u sequences, numbers and the raw copy.
+    // The message is complete once the event closes, before the final bracket.
+    const uint8_t *data = (const uint8_t *)frame.c_str();
+    for (size_t split = 1; split < frame.length() - 1; split++)
+    {
+        RelayMessageParser parser;
+        TEST_ASSERT_EQUAL(RelayMessageParser::PARSING, parser.feed(data, split));
+        parser.feed(data + split, frame.length() - split);
+        checkEvent(parser);
+    }
+}
+
+static void test_event_one_byte_at_a_time()
+{
+    RelayMessageParser parser;
+    const uint8_t *data = (const uint8_t *)frame.c_str();
+    for (size_t i = 0; i < frame.length(); i++)
+    {
+        parser.feed(data + i, 1);
+    }
+    checkEvent(parser);
+}
+
+static void test_reset_between_messages()
+{
+    RelayMessageParser parser;
+    feedString(parser, frame.c_str());
+    checkEvent(parser);
+
+    parser.reset();
+    TEST_ASSERT_FALSE(parser.started());
+    TEST_ASSERT_EQUAL(RelayMessageParser::COMPLETE, feedString(parser, "[\"EOSE\",\"sub\"]"));
+    TEST_ASSERT_EQUAL(RelayMessageParser::MESSAGE_EOSE, parser.message().type);
+    TEST_ASSERT_EQUAL_UINT(0, parser.message().raw.length());
+}
+
+static void test_other_messages_complete_on_their_type()
+{
+    struct Case
+    {
+        const char *first;
+        RelayMessageParser::MessageType type;
+    };
+    const Case cases[] = {
+        {"[\"OK\",", RelayMessageParser::MESSAGE_OK},
+        {"[\"EOSE\",", RelayMessageParser::MESSAGE_EOSE},
+        {"[\"CLOSED\",", RelayMessageParser::MESSAGE_CLOSED},
+        {"[\"NOTICE\",", RelayMessageParser::MESSAGE_NOTICE},
+        {"[\"AUTH\",", RelayMessageParser::MESSAGE_AUTH},
+        {"[\"COUNT\",", RelayMessageParser::MESSAGE_UNKNOWN},
+    };
+    for (const Case &c : cases)
+    {
+        RelayMessageParser parser;
+        // The rest of the message is never looked at
+        TEST_ASSERT_EQUAL(RelayMessageParser::COMPLETE, feedString(parser, c.first));
+        TEST_ASSERT_EQUAL(c.type, parser.message().type);
+        TEST_ASSERT_EQUAL(RelayMessageParser::COMPLETE, feedString(parser, "not json at all"));
+    }
+}
+
+static void test_cut_short_is_rejected()
+{
+    RelayMessageParser parser;
+    parser.feed((const uint8_t *)frame.c_str(), frame.length() - 2);
+    TEST_ASSERT_EQUAL(RelayMessageParser::PARSING, parser.status());
+    TEST_ASSERT_EQUAL(RelayMessageParser::REJECTED, parser.finish());
+    TEST_ASSERT_EQUAL_STRING("message cut short", parser.error());
+    TEST_ASSERT_EQUAL_UINT(0, parser.message().raw.length());
+}
+
+static void test_malformed_events_are_rejected()
+{
+    const char *frames[] = {
+        "[\"EVENT\",\"s\",{\"id\":\"5c83\",\"pubkey\":\"f7\",\"kind\":1}]",     // short id
+        "[\"EVENT\",\"s\",{\"kind\":\"5107\"}]",                               // kind as a string
+        "[\"EVENT\",\"s\",{\"kind\":1,\"content\":\"a\x01\"}]",                // control character
+        "[\"EVENT\",\"s\",{\"kind\":1,\"content\":\"\\q\"}]",                  // bad escape
+        "[\"EVENT\",\"s\",{\"kind\":1]]",                                      // mismatched bracket
+        "[\"EVENT\",\"s\",{\"kind\":1}]",                                      // no id or pubkey
+        "{\"EVENT\":1}",                                                        // not an array
+        "[\"EVENT\",\"s\",[[[[[[[[[[]]]]]]]]]]]",                              // too deep
+    };
+    for (const char *text : frames)
+    {
+        RelayMessageParser parser;
+        feedString(parser, text);
+        parser.finish();
+        TEST_ASSERT_EQUAL(RelayMessageParser::REJECTED, parser.status());
+    }
+}
+
+static void test_oversized_event_keeps_fields_but_not_raw()
+{
+    String content;
+    while (content.length() <= RelayMessageParser::MAX_RAW_SIZE)
+    {
+        content += "0123456789";
+    }
+    String big = "[\"EVENT\",\"s\",{\"id\":\"5c83da77af1dec6d7289834998ad7aafbd9e2191396d75ec3cc27f5a77226f36\","
+                 "\"pubkey\":\"f7234bd4c1394dda46d09f35bd384dd30cc552ad5541990f98844fb06676e9ca\",\"kind\":5107,"
+                 "\"tags\":[[\"encrypted\"]],\"content\":\"" + content + "\"}]";
+
+    RelayMessageParser parser;
+    // In pieces, so the raw copy overflows part way through a fragment
+    const uint8_t *data = (const uint8_t *)big.c_str();
+    for (size_t i = 0; i < big.length(); i += 100)
+    {
+        parser.feed(data + i, min((size_t)100, big.length() - i));
+    }
+    TEST_ASSERT_EQUAL(RelayMessageParser::COMPLETE, parser.status());
+    TEST_ASSERT_EQUAL_UINT16(5107, parser.message().kind);
+    TEST_ASSERT_TRUE(parser.message().encrypted);
+    TEST_ASSERT_EQUAL_UINT(content.length(), parser.message().content_length);
+    TEST_ASSERT_EQUAL_UINT(0, parser.message().raw.length());
+}
+
+static void test_message_too_large_is_rejected()
+{
+    String padding;
+    while (padding.length() <= RelayMessageParser::MAX_MESSAGE_SIZE)
+    {
+        padding += "                ";
+    }
+    RelayMessageParser parser;
+    feedString(parser, "[\"EVENT\",");
+    TEST_ASSERT_EQUAL(RelayMessageParser::REJECTED, feedString(parser, padding.c_str()));
+    TEST_ASSERT_EQUAL_STRING("message too large", parser.error());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_whole_event);
+    RUN_TEST(test_event_split_at_every_position);
+    RUN_TEST(test_event_one_byte_at_a_time);
+    RUN_TEST(test_reset_between_messages);
+    RUN_TEST(test_other_messages_complete_on_their_type);
+    RUN_TEST(test_cut_short_is_rejected);
+    RUN_TEST(test_malformed_events_are_rejected);
+    RUN_TEST(test_oversized_event_keeps_fields_but_not_raw);
+    RUN_TEST(test_message_too_large_is_rejected);
+    return UNITY_END();
+}
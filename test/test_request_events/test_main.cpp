@@ -0,0 +1,119 @@
+#include <unity.h>
+#include "request_events.h"
+
+static RequestEvents *events;
+
+void setUp()
+{
+    events = new RequestEvents();
+}
+
+void tearDown()
+{
+    delete events;
+}
+
+static void makeKey(uint8_t key[RequestEvents::KEY_SIZE], uint8_t tag)
+{
+    memset(key, tag, RequestEvents::KEY_SIZE);
+}
+
+static void test_put_then_take()
+{
+    uint8_t key[RequestEvents::KEY_SIZE];
+    makeKey(key, 1);
+    const char *event = "{\"id\":\"aa\",\"kind\":5107}";
+    TEST_ASSERT_TRUE(events->put(key, event, strlen(event)));
+    TEST_ASSERT_EQUAL_UINT(1, events->size());
+
+    String found;
+    TEST_ASSERT_TRUE(events->find(key, found));
+    TEST_ASSERT_EQUAL_STRING(event, found.c_str());
+    TEST_ASSERT_EQUAL_UINT(1, events->size());
+
+    String taken;
+    TEST_ASSERT_TRUE(events->take(key, taken));
+    TEST_ASSERT_EQUAL_STRING(event, taken.c_str());
+    TEST_ASSERT_EQUAL_UINT(0, events->size());
+    TEST_ASSERT_FALSE(events->take(key, taken));
+}
+
+static void test_put_replaces_the_event_for_a_key()
+{
+    uint8_t key[RequestEvents::KEY_SIZE];
+    makeKey(key, 2);
+    TEST_ASSERT_TRUE(events->put(key, "{\"a\":1}", 7));
+    TEST_ASSERT_TRUE(events->put(key, "{\"b\":2}", 7));
+    TEST_ASSERT_EQUAL_UINT(1, events->size());
+
+    String event;
+    TEST_ASSERT_TRUE(events->take(key, event));
+    TEST_ASSERT_EQUAL_STRING("{\"b\":2}", event.c_str());
+}
+
+static void test_oversized_and_empty_events_are_not_kept()
+{
+    uint8_t key[RequestEvents::KEY_SIZE];
+    makeKey(key, 3);
+    static char big[RequestEvents::MAX_EVENT_SIZE + 1];
+    memset(big, 'x', sizeof(big));
+    TEST_ASSERT_TRUE(events->put(key, big, RequestEvents::MAX_EVENT_SIZE));
+    TEST_ASSERT_FALSE(events->put(key, big, sizeof(big)));
+
+    // The stale event for the key does not outlive the refused one
+    String event;
+    TEST_ASSERT_FALSE(events->find(key, event));
+    TEST_ASSERT_FALSE(events->put(key, "", 0));
+    TEST_ASSERT_EQUAL_UINT(0, events->size());
+}
+
+static void test_full_store_refuses_new_keys()
+{
+    uint8_t key[RequestEvents::KEY_SIZE];
+    for (size_t i = 0; i < RequestEvents::CAPACITY; i++)
+    {
+        makeKey(key, 0x10 + i);
+        TEST_ASSERT_TRUE(events->put(key, "{}", 2));
+    }
+    makeKey(key, 0xf0);
+    TEST_ASSERT_FALSE(events->put(key, "{}", 2));
+    TEST_ASSERT_EQUAL_UINT(RequestEvents::CAPACITY, events->size());
+
+    // A removed event frees its slot
+    uint8_t first[RequestEvents::KEY_SIZE];
+    makeKey(first, 0x10);
+    events->remove(first);
+    TEST_ASSERT_TRUE(events->put(key, "{}", 2));
+}
+
+static void test_remove_and_clear()
+{
+    uint8_t a[RequestEvents::KEY_SIZE];
+    uint8_t b[RequestEvents::KEY_SIZE];
+    makeKey(a, 4);
+    makeKey(b, 5);
+    TEST_ASSERT_TRUE(events->put(a, "{\"a\":1}", 7));
+    TEST_ASSERT_TRUE(events->put(b, "{\"b\":2}", 7));
+
+    events->remove(a);
+    events->remove(a);
+    TEST_ASSERT_EQUAL_UINT(1, events->size());
+    String event;
+    TEST_ASSERT_FALSE(events->find(a, event));
+    TEST_ASSERT_TRUE(events->find(b, event));
+
+    events->clear();
+    TEST_ASSERT_EQUAL_UINT(0, events->size());
+    TEST_ASSERT_FALSE(events->find(b, event));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_put_then_take);
+    RUN_TEST(test_put_replaces_the_event_for_a_key);
+    RUN_TEST(test_oversized_and_empty_events_are_not_kept);
+    RUN_TEST(test_full_store_refuses_new_keys);
+    RUN_TEST(test_remove_and_clear);
+    return UNITY_END();
+}
@@ -0,0 +1,81 @@
+#include <unity.h>
+#include <vector>
+#include "request_worker.h"
+
+// The native build runs queued work inline from poll(), in queue order
+static std::vector<int> ran;
+
+void setUp()
+{
+    RequestWorker::init();
+    RequestWorker::poll();
+    ran.clear();
+}
+
+void tearDown()
+{
+}
+
+static RequestWorker::work_t record(int id)
+{
+    return [id]() { ran.push_back(id); };
+}
+
+static void fillQueue()
+{
+    for (size_t i = 0; i < RequestWorker::Config::QUEUE_DEPTH; i++)
+    {
+        TEST_ASSERT_TRUE(RequestWorker::submit(record(i)));
+    }
+}
+
+static void test_full_queue_drops_submitted_work()
+{
+    uint32_t dropped = RequestWorker::droppedCount();
+    fillQueue();
+    TEST_ASSERT_EQUAL_UINT(RequestWorker::Config::QUEUE_DEPTH, RequestWorker::queueDepth());
+    TEST_ASSERT_FALSE(RequestWorker::submit(record(100)));
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, RequestWorker::droppedCount());
+
+    RequestWorker::poll();
+    TEST_ASSERT_EQUAL_UINT(RequestWorker::Config::QUEUE_DEPTH, ran.size());
+    TEST_ASSERT_EQUAL_UINT(0, RequestWorker::queueDepth());
+}
+
+static void test_held_work_runs_after_the_queue_drains()
+{
+    fillQueue();
+    RequestWorker::submitOrHold(record(100));
+    RequestWorker::submitOrHold(record(101));
+    TEST_ASSERT_EQUAL_UINT(2, RequestWorker::heldCount());
+
+    RequestWorker::poll();
+    TEST_ASSERT_EQUAL_UINT(0, RequestWorker::heldCount());
+    TEST_ASSERT_EQUAL_UINT(RequestWorker::Config::QUEUE_DEPTH + 2, ran.size());
+    TEST_ASSERT_EQUAL_INT(100, ran[RequestWorker::Config::QUEUE_DEPTH]);
+    TEST_ASSERT_EQUAL_INT(101, ran[RequestWorker::Config::QUEUE_DEPTH + 1]);
+}
+
+static void test_hold_is_only_used_when_the_queue_is_full()
+{
+    fillQueue();
+    RequestWorker::submitOrHold(record(100));
+    RequestWorker::poll();
+    ran.clear();
+
+    TEST_ASSERT_TRUE(RequestWorker::submit(record(1)));
+    RequestWorker::submitOrHold(record(2));
+    TEST_ASSERT_EQUAL_UINT(0, RequestWorker::heldCount());
+    TEST_ASSERT_EQUAL_UINT(2, RequestWorker::queueDepth());
+    RequestWorker::poll();
+    TEST_ASSERT_EQUAL_UINT(2, ran.size());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_queue_drops_submitted_work);
+    RUN_TEST(test_held_work_runs_after_the_queue_drains);
+    RUN_TEST(test_hold_is_only_used_when_the_queue_is_full);
+    return UNITY_END();
+}
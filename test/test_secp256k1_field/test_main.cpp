@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <string.h>
+#include "nip44/secp256k1_field.h"
+
+// Big-endian 32-byte values
+static const uint8_t G_X[32] = {
+    0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb, 0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b, 0x07,
+    0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28, 0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17, 0x98};
+static const uint8_t G_Y[32] = {
+    0x48, 0x3a, 0xda, 0x77, 0x26, 0xa3, 0xc4, 0x65, 0x5d, 0xa4, 0xfb, 0xfc, 0x0e, 0x11, 0x08, 0xa8,
+    0xfd, 0x17, 0xb4, 0x48, 0xa6, 0x85, 0x54, 0x19, 0x9c, 0x47, 0xd0, 0x8f, 0xfb, 0x10, 0xd4, 0xb8};
+static const uint8_t FIELD_P[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe, 0xff, 0xff, 0xfc, 0x2f};
+// Even square root of 2^3 + 7
+static const uint8_t TWO_Y[32] = {
+    0x66, 0xfb, 0xe7, 0x27, 0xb2, 0xba, 0x09, 0xe0, 0x9f, 0x5a, 0x98, 0xd7, 0x0a, 0x5e, 0xfc, 0xe8,
+    0x42, 0x4c, 0x5f, 0xa4, 0x25, 0xbb, 0xda, 0x1c, 0x51, 0x1f, 0x86, 0x06, 0x57, 0xb8, 0x53, 0x5e};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void smallValue(uint8_t out[32], uint8_t value)
+{
+    memset(out, 0, 32);
+    out[31] = value;
+}
+
+static void test_lift_generator_x()
+{
+    uint8_t point[64];
+    TEST_ASSERT_TRUE(secp256k1_lift_x(G_X, point));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(G_X, point, 32);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(G_Y, point + 32, 32);
+}
+
+static void test_lift_small_x_with_odd_root()
+{
+    // The root the exponentiation finds for x = 2 is odd; the even one is p - y
+    uint8_t x[32];
+    uint8_t point[64];
+    smallValue(x, 2);
+    TEST_ASSERT_TRUE(secp256k1_lift_x(x, point));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(TWO_Y, point + 32, 32);
+}
+
+static void test_lift_rejects_x_not_on_the_curve()
+{
+    // x^3 + 7 is not a square for these
+    uint8_t x[32];
+    uint8_t point[64];
+    const uint8_t values[] = {0, 5, 7, 9};
+    for (uint8_t value : values)
+    {
+        smallValue(x, value);
+        TEST_ASSERT_FALSE(secp256k1_lift_x(x, point));
+    }
+}
+
+static void test_lift_rejects_x_outside_the_field()
+{
+    uint8_t x[32];
+    uint8_t point[64];
+    memcpy(x, FIELD_P, sizeof(x));
+    TEST_ASSERT_FALSE(secp256k1_lift_x(x, point));
+    memset(x, 0xff, sizeof(x));
+    TEST_ASSERT_FALSE(secp256k1_lift_x(x, point));
+}
+
+static void test_from_bytes_round_trip_and_range()
+{
+    struct secp256k1_fe fe;
+    uint8_t out[32];
+    TEST_ASSERT_TRUE(secp256k1_fe_from_bytes(&fe, G_Y));
+    secp256k1_fe_to_bytes(out, &fe);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(G_Y, out, 32);
+
+    uint8_t belowP[32];
+    memcpy(belowP, FIELD_P, sizeof(belowP));
+    belowP[31]--;
+    TEST_ASSERT_TRUE(secp256k1_fe_from_bytes(&fe, belowP));
+    TEST_ASSERT_FALSE(secp256k1_fe_from_bytes(&fe, FIELD_P));
+}
+
+static void test_mul_wraps_modulo_p()
+{
+    // (p - 1)^2 = 1 (mod p), which exercises every carry and the final fold
+    uint8_t minusOne[32];
+    memcpy(minusOne, FIELD_P, sizeof(minusOne));
+    minusOne[31]--;
+    struct secp256k1_fe a, r;
+    uint8_t out[32];
+    uint8_t one[32];
+    smallValue(one, 1);
+
+    secp256k1_fe_from_bytes(&a, minusOne);
+    secp256k1_fe_mul(&r, &a, &a);
+    secp256k1_fe_to_bytes(out, &r);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(one, out, 32);
+
+    secp256k1_fe_sqr(&r, &a);
+    secp256k1_fe_to_bytes(out, &r);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(one, out, 32);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lift_generator_x);
+    RUN_TEST(test_lift_small_x_with_odd_root);
+    RUN_TEST(test_lift_rejects_x_not_on_the_curve);
+    RUN_TEST(test_lift_rejects_x_outside_the_field);
+    RUN_TEST(test_from_bytes_round_trip_and_range);
+    RUN_TEST(test_mul_wraps_modulo_p);
+    return UNITY_END();
+}
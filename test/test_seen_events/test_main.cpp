@@ -0,0 +1,124 @@
+#include <unity.h>
+#include "seen_events.h"
+
+static SeenEvents seen;
+
+void setUp()
+{
+    seen.clear();
+}
+
+void tearDown()
+{
+}
+
+// Event id prefixes are hash output; spread n over all eight bytes like one
+static void makeId(uint8_t id[8], uint32_t n)
+{
+    uint32_t x = n * 2654435761u + 1;
+    for (int i = 0; i < 8; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        id[i] = x;
+    }
+}
+
+static void test_first_sight_then_duplicate()
+{
+    uint8_t id[8];
+    makeId(id, 1);
+    TEST_ASSERT_FALSE(seen.checkAndInsert(id));
+    TEST_ASSERT_TRUE(seen.checkAndInsert(id));
+    TEST_ASSERT_TRUE(seen.checkAndInsert(id));
+}
+
+static void test_contains_does_not_insert()
+{
+    uint8_t id[8];
+    makeId(id, 2);
+    TEST_ASSERT_FALSE(seen.contains(id));
+    TEST_ASSERT_FALSE(seen.contains(id));
+    seen.insert(id);
+    TEST_ASSERT_TRUE(seen.contains(id));
+    TEST_ASSERT_TRUE(seen.checkAndInsert(id));
+}
+
+static void test_ring_forgets_the_oldest_on_wrap()
+{
+    uint8_t id[8];
+    const uint32_t total = SeenEvents::SEEN_EVENTS_CAPACITY + 10;
+    for (uint32_t n = 0; n < total; n++)
+    {
+        makeId(id, n);
+        TEST_ASSERT_FALSE(seen.checkAndInsert(id));
+    }
+
+    // The last SEEN_EVENTS_CAPACITY are remembered, those before are not
+    for (uint32_t n = total - SeenEvents::SEEN_EVENTS_CAPACITY; n < total; n++)
+    {
+        makeId(id, n);
+        TEST_ASSERT_TRUE(seen.checkAndInsert(id));
+    }
+    for (uint32_t n = 0; n < 10; n++)
+    {
+        makeId(id, n);
+        TEST_ASSERT_FALSE(seen.checkAndInsert(id));
+    }
+}
+
+static void test_bloom_rebuild_keeps_every_remembered_id()
+{
+    // Several wraps, checking after each insert that nothing still in the ring was lost
+    uint8_t id[8];
+    const uint32_t total = 4 * SeenEvents::SEEN_EVENTS_CAPACITY + 3;
+    for (uint32_t n = 0; n < total; n++)
+    {
+        makeId(id, n);
+        TEST_ASSERT_FALSE(seen.checkAndInsert(id));
+        uint32_t oldest = n + 1 > SeenEvents::SEEN_EVENTS_CAPACITY ? n + 1 - SeenEvents::SEEN_EVENTS_CAPACITY : 0;
+        for (uint32_t m = oldest; m <= n; m++)
+        {
+            makeId(id, m);
+            TEST_ASSERT_TRUE(seen.checkAndInsert(id));
+        }
+    }
+}
+
+static void test_unseen_ids_are_not_reported()
+{
+    uint8_t id[8];
+    for (uint32_t n = 0; n < SeenEvents::SEEN_EVENTS_CAPACITY; n++)
+    {
+        makeId(id, n);
+        seen.checkAndInsert(id);
+    }
+    // The bloom filter may let some through to the ring scan, which must still say no
+    for (uint32_t n = 1000; n < 3000; n++)
+    {
+        makeId(id, n);
+        TEST_ASSERT_FALSE(seen.checkAndInsert(id));
+    }
+}
+
+static void test_clear_forgets_everything()
+{
+    uint8_t id[8];
+    makeId(id, 3);
+    seen.checkAndInsert(id);
+    seen.clear();
+    TEST_ASSERT_FALSE(seen.checkAndInsert(id));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_sight_then_duplicate);
+    RUN_TEST(test_contains_does_not_insert);
+    RUN_TEST(test_ring_forgets_the_oldest_on_wrap);
+    RUN_TEST(test_bloom_rebuild_keeps_every_remembered_id);
+    RUN_TEST(test_unseen_ids_are_not_reported);
+    RUN_TEST(test_clear_forgets_everything);
+    return UNITY_END();
+}
@@ -0,0 +1,101 @@
+#include <unity.h>
+#include "sensor_sampler.h"
+
+static const unsigned long INTERVAL = 50;
+
+static int reads = 0;
+static bool fail_reads = false;
+
+// Two channels from one read, like a temperature and humidity chip
+static bool readFake(float *values)
+{
+    if (fail_reads)
+    {
+        return false;
+    }
+    reads++;
+    values[0] = 20.0f + reads;
+    values[1] = 40.0f + reads;
+    return true;
+}
+
+static int sensor = -1;
+
+void setUp()
+{
+    fail_reads = false;
+}
+
+void tearDown()
+{
+}
+
+static void test_first_read_at_init()
+{
+    TEST_ASSERT_EQUAL(1, reads);
+    SensorSampler::Reading reading;
+    TEST_ASSERT_TRUE(SensorSampler::latest(sensor, 0, reading));
+    TEST_ASSERT_EQUAL_FLOAT(21.0f, reading.value);
+    TEST_ASSERT_TRUE(SensorSampler::latest(sensor, 1, reading));
+    TEST_ASSERT_EQUAL_FLOAT(41.0f, reading.value);
+    // Both channels came from the one read
+    TEST_ASSERT_EQUAL(1, reads);
+}
+
+static void test_reads_between_samples_come_from_memory()
+{
+    SensorSampler::Reading reading;
+    int before = reads;
+    for (int i = 0; i < 10; i++)
+    {
+        SensorSampler::latest(sensor, 0, reading);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(before + 1, reads);
+}
+
+static void test_due_sensor_is_read_again()
+{
+    int before = reads;
+    delay(INTERVAL + 10);
+    SensorSampler::Reading reading;
+    TEST_ASSERT_TRUE(SensorSampler::latest(sensor, 0, reading));
+    TEST_ASSERT_EQUAL(before + 1, reads);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + reads, reading.value);
+}
+
+static void test_max_age()
+{
+    SensorSampler::Reading reading;
+    TEST_ASSERT_TRUE(SensorSampler::latest(sensor, 0, reading, 1000));
+
+    // Failed reads leave the last sample in place, getting older
+    fail_reads = true;
+    delay(INTERVAL + 10);
+    TEST_ASSERT_TRUE(SensorSampler::latest(sensor, 0, reading));
+    TEST_ASSERT_FALSE(SensorSampler::latest(sensor, 0, reading, INTERVAL));
+    TEST_ASSERT_TRUE(SensorSampler::failedCount() > 0);
+}
+
+static void test_unknown_sensor_or_channel()
+{
+    SensorSampler::Reading reading;
+    TEST_ASSERT_FALSE(SensorSampler::latest(sensor, 2, reading));
+    TEST_ASSERT_FALSE(SensorSampler::latest(sensor + 1, 0, reading));
+    TEST_ASSERT_FALSE(SensorSampler::latest(-1, 0, reading));
+    // No sensors once sampling has started
+    TEST_ASSERT_EQUAL(-1, SensorSampler::addSensor("late", 1, INTERVAL, readFake));
+}
+
+int main(int argc, char **argv)
+{
+    sensor = SensorSampler::addSensor("fake", 2, INTERVAL, readFake);
+    SensorSampler::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_first_read_at_init);
+    RUN_TEST(test_reads_between_samples_come_from_memory);
+    RUN_TEST(test_due_sensor_is_read_again);
+    RUN_TEST(test_max_age);
+    RUN_TEST(test_unknown_sensor_or_channel);
+    return UNITY_END();
+}
@@ -0,0 +1,62 @@
+#include <unity.h>
+#include "signer.h"
+
+using namespace nostr;
+
+static const char *SECRET_HEX = "7f7ff03d123792d6ac594bfa67bf6d0c0ab55b6b1fdb6249303fe861f1ccba9a";
+static const char *G_X = "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798";
+// x^3 + 7 has no square root mod p for x = 5
+static const char *OFF_CURVE_X = "0000000000000000000000000000000000000000000000000000000000000005";
+static const char *FIELD_PRIME = "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f";
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_shared_secret_rejects_off_curve_peer()
+{
+    Signer signer(SECRET_HEX);
+    TEST_ASSERT_TRUE(signer.isValid());
+
+    uint8_t sharedX[32];
+    TEST_ASSERT_FALSE(signer.sharedSecret(OFF_CURVE_X, sharedX));
+    TEST_ASSERT_FALSE(signer.sharedSecret(FIELD_PRIME, sharedX));
+
+    // Nothing was cached for the rejected keys: asking again is another miss
+    uint32_t misses = signer.conversationCache().misses();
+    TEST_ASSERT_FALSE(signer.sharedSecret(OFF_CURVE_X, sharedX));
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, signer.conversationCache().misses());
+    TEST_ASSERT_EQUAL_UINT32(0, signer.conversationCache().hits());
+}
+
+static void test_shared_secret_caches_valid_peer()
+{
+    Signer signer(SECRET_HEX);
+    uint8_t first[32];
+    uint8_t second[32];
+    TEST_ASSERT_TRUE(signer.sharedSecret(G_X, first));
+    TEST_ASSERT_TRUE(signer.sharedSecret(G_X, second));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(first, second, sizeof(first));
+    TEST_ASSERT_EQUAL_UINT32(1, signer.conversationCache().hits());
+}
+
+static void test_shared_secret_needs_a_key()
+{
+    Signer signer;
+    uint8_t sharedX[32];
+    TEST_ASSERT_FALSE(signer.sharedSecret(G_X, sharedX));
+    TEST_ASSERT_FALSE(Signer("not a key").sharedSecret(G_X, sharedX));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_shared_secret_rejects_off_curve_peer);
+    RUN_TEST(test_shared_secret_caches_valid_peer);
+    RUN_TEST(test_shared_secret_needs_a_key);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+#include <unity.h>
+#include "subscription_cursor.h"
+
+static const uint32_t NOW = 1700000000;
+static const uint8_t ID[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void fillPage(CatchUpPager &pager, uint32_t newest, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        pager.event(newest - i);
+    }
+}
+
+static void test_page_filter()
+{
+    TEST_ASSERT_EQUAL_STRING(",\"limit\":0", SubscriptionCursor::pageFilter(0).c_str());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000000,\"limit\":20", SubscriptionCursor::pageFilter(NOW).c_str());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000000,\"until\":1700000100,\"limit\":20",
+                             SubscriptionCursor::pageFilter(NOW, NOW + 100).c_str());
+}
+
+static void test_resume_from()
+{
+    SubscriptionCursor cursor;
+    // Never moved: nothing to catch up on
+    TEST_ASSERT_EQUAL_UINT32(0, cursor.resumeFrom(NOW));
+    // ...unless something was turned away
+    TEST_ASSERT_EQUAL_UINT32(NOW - 10, cursor.resumeFrom(NOW, NOW - 10));
+
+    cursor.advance(NOW - 100, ID);
+    TEST_ASSERT_EQUAL_UINT32(NOW - 100, cursor.resumeFrom(NOW));
+    TEST_ASSERT_EQUAL_UINT32(NOW - 200, cursor.resumeFrom(NOW, NOW - 200));
+    TEST_ASSERT_EQUAL_UINT32(NOW - 100, cursor.resumeFrom(NOW, NOW - 50));
+
+    // Older history is not replayed
+    TEST_ASSERT_EQUAL_UINT32(NOW + 10000 - SubscriptionCursor::MAX_CATCH_UP_AGE, cursor.resumeFrom(NOW + 10000));
+}
+
+static void test_advance_is_monotonic()
+{
+    SubscriptionCursor cursor;
+    uint8_t older[8] = {9, 9, 9, 9, 9, 9, 9, 9};
+    cursor.advance(NOW, ID);
+    cursor.advance(NOW - 5, older);
+    TEST_ASSERT_EQUAL_UINT32(NOW, cursor.position());
+    TEST_ASSERT_EQUAL_MEMORY(ID, cursor.lastId(), 8);
+}
+
+static void test_caught_up_starts_a_fresh_cursor_only()
+{
+    SubscriptionCursor cursor;
+    cursor.caughtUp(1000);
+    TEST_ASSERT_EQUAL_UINT32(0, cursor.position());
+    cursor.caughtUp(NOW);
+    TEST_ASSERT_EQUAL_UINT32(NOW, cursor.position());
+    cursor.caughtUp(NOW + 60);
+    TEST_ASSERT_EQUAL_UINT32(NOW, cursor.position());
+}
+
+static void test_short_page_is_done()
+{
+    CatchUpPager pager;
+    pager.begin(NOW);
+    TEST_ASSERT_TRUE(pager.active());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000000,\"limit\":20", pager.filter().c_str());
+    fillPage(pager, NOW + 50, 5);
+    TEST_ASSERT_EQUAL(CatchUpPager::DONE, pager.endPage());
+    TEST_ASSERT_FALSE(pager.active());
+}
+
+static void test_full_pages_page_back_then_rejoin()
+{
+    CatchUpPager pager;
+    pager.begin(NOW);
+    fillPage(pager, NOW + 100, SubscriptionCursor::CATCH_UP_LIMIT);
+    TEST_ASSERT_EQUAL(CatchUpPager::PAGE_BACK, pager.endPage());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000000,\"until\":1700000081,\"limit\":20", pager.filter().c_str());
+
+    fillPage(pager, NOW + 81, SubscriptionCursor::CATCH_UP_LIMIT);
+    TEST_ASSERT_EQUAL(CatchUpPager::PAGE_BACK, pager.endPage());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000000,\"until\":1700000062,\"limit\":20", pager.filter().c_str());
+
+    fillPage(pager, NOW + 62, 3);
+    // Back at the resume point: reopen the live stream from the newest event seen
+    TEST_ASSERT_EQUAL(CatchUpPager::REJOIN, pager.endPage());
+    TEST_ASSERT_TRUE(pager.active());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000100,\"limit\":20", pager.filter().c_str());
+
+    fillPage(pager, NOW + 101, 2);
+    TEST_ASSERT_EQUAL(CatchUpPager::DONE, pager.endPage());
+    TEST_ASSERT_FALSE(pager.active());
+}
+
+static void test_page_that_cannot_move_back_stops()
+{
+    CatchUpPager pager;
+    pager.begin(NOW);
+    fillPage(pager, NOW + 30, SubscriptionCursor::CATCH_UP_LIMIT);
+    TEST_ASSERT_EQUAL(CatchUpPager::PAGE_BACK, pager.endPage());
+
+    // A full page all in the second "until" already points at
+    for (uint16_t i = 0; i < SubscriptionCursor::CATCH_UP_LIMIT; i++)
+    {
+        pager.event(NOW + 11);
+    }
+    TEST_ASSERT_EQUAL(CatchUpPager::REJOIN, pager.endPage());
+    TEST_ASSERT_EQUAL_STRING(",\"since\":1700000030,\"limit\":20", pager.filter().c_str());
+}
+
+static void test_cancel()
+{
+    CatchUpPager pager;
+    pager.begin(NOW);
+    pager.cancel();
+    TEST_ASSERT_FALSE(pager.active());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_page_filter);
+    RUN_TEST(test_resume_from);
+    RUN_TEST(test_advance_is_monotonic);
+    RUN_TEST(test_caught_up_starts_a_fresh_cursor_only);
+    RUN_TEST(test_short_page_is_done);
+    RUN_TEST(test_full_pages_page_back_then_rejoin);
+    RUN_TEST(test_page_that_cannot_move_back_stops);
+    RUN_TEST(test_cancel);
+    return UNITY_END();
+}